@@ -1,4 +1,5 @@
 
+#include "cppscanner/snapshot/fileannotations.h"
 #include "cppscanner/snapshot/snapshotwriter.h"
 
 #include "cppscanner/index/reference.h"
@@ -246,6 +247,142 @@ void write_diagnosticLevelFunctions(std::ofstream& stream)
   module_exports.push_back("getDiagnosticLevelName");
 }
 
+// must be kept in sync with encodeFileAnnotations()
+constexpr const char* FILE_ANNOTATIONS_DECODER = R"(function decodeFileAnnotations(bytes) {
+  const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+  const textDecoder = new TextDecoder();
+  let pos = 0;
+
+  function ensure(n) {
+    if (pos + n > bytes.length) {
+      throw new Error("unexpected end of data");
+    }
+  }
+  function readVarint() {
+    let value = 0;
+    let factor = 1;
+    for (;;) {
+      ensure(1);
+      const b = bytes[pos++];
+      value += (b & 0x7f) * factor;
+      if ((b & 0x80) === 0) {
+        return value;
+      }
+      factor *= 128;
+    }
+  }
+  function readSignedVarint() {
+    const v = readVarint();
+    return (v % 2) ? -(v + 1) / 2 : v / 2;
+  }
+  function readId() {
+    ensure(8);
+    const id = view.getBigInt64(pos, true);
+    pos += 8;
+    return id;
+  }
+  function readString() {
+    const n = readVarint();
+    ensure(n);
+    // most names are short and ASCII, for which TextDecoder is comparatively slow
+    let str = "";
+    for (let i = pos; i < pos + n; ++i) {
+      if (bytes[i] >= 0x80) {
+        str = textDecoder.decode(bytes.subarray(pos, pos + n));
+        break;
+      }
+      str += String.fromCharCode(bytes[i]);
+    }
+    pos += n;
+    return str;
+  }
+  function readList(read) {
+    const count = readVarint();
+    const result = [];
+    for (let i = 0; i < count; ++i) {
+      result.push(read());
+    }
+    return result;
+  }
+  function readPositionedList(read) {
+    let line = 0;
+    let column = 0;
+    return readList(() => {
+      const lineDelta = readVarint();
+      const c = readVarint();
+      column = lineDelta === 0 ? column + c : c;
+      line += lineDelta;
+      return read(line, column);
+    });
+  }
+
+  ensure(fileAnnotationsMagic.length);
+  if (textDecoder.decode(bytes.subarray(0, fileAnnotationsMagic.length)) !== fileAnnotationsMagic) {
+    throw new Error("not a file annotations blob");
+  }
+  pos = fileAnnotationsMagic.length;
+  if (readVarint() !== fileAnnotationsFormatVersion) {
+    throw new Error("unsupported file annotations format version");
+  }
+
+  const symbols = readList(() => {
+    return { id: readId(), kind: readVarint(), flags: readVarint(), name: readString() };
+  });
+  function symbolAt(index) {
+    if (index >= symbols.length) {
+      throw new Error("invalid symbol index");
+    }
+    return symbols[index];
+  }
+
+  const references = readPositionedList((line, column) => {
+    const symbol = symbolAt(readVarint());
+    const flags = readVarint();
+    const parent = readVarint();
+    return { line: line, column: column, symbol: symbol, flags: flags, referencedBy: parent > 0 ? symbolAt(parent - 1) : null };
+  });
+  const declarations = readPositionedList((line, column) => {
+    const endLine = line + readSignedVarint();
+    const endColumn = readVarint();
+    const value = readVarint();
+    return { 
+      start: { line: line, column: column }, 
+      end: { line: endLine, column: endColumn }, 
+      symbol: symbolAt(Math.floor(value / 2)), 
+      isDefinition: (value % 2) === 1 
+    };
+  });
+  const diagnostics = readPositionedList((line, column) => {
+    const level = readVarint();
+    return { line: line, column: column, level: level, message: readString() };
+  });
+  const refargs = readPositionedList((line, column) => {
+    return { line: line, column: column };
+  });
+  const includes = readPositionedList((line, column) => {
+    return { line: line, includedFileID: readVarint(), includedFilePath: null };
+  });
+  const includedFiles = new Map(readList(() => [readVarint(), readString()]));
+  for (const inc of includes) {
+    inc.includedFilePath = includedFiles.get(inc.includedFileID) ?? null;
+  }
+
+  if (pos !== bytes.length) {
+    throw new Error("unexpected trailing data");
+  }
+
+  return { symbols, references, declarations, diagnostics, refargs, includes };
+})";
+
+void write_fileAnnotationsDecoder(std::ofstream& stream)
+{
+  stream << "const fileAnnotationsMagic = \"" << std::string(fileannotations::Magic, sizeof(fileannotations::Magic)) << "\";" << std::endl;
+  stream << "const fileAnnotationsFormatVersion = " << fileannotations::FormatVersion << ";" << std::endl;
+  stream << std::endl;
+  stream << FILE_ANNOTATIONS_DECODER << std::endl;
+  module_exports.push_back("decodeFileAnnotations");
+}
+
 void write_moduleExports(std::ofstream& stream)
 {
   stream << std::endl;
@@ -289,6 +426,8 @@ int main(int argc, char* argv[])
   cppscanner::genjs::write_diagnosticLevels(stream);
   stream << std::endl;
   cppscanner::genjs::write_diagnosticLevelFunctions(stream);
+  stream << std::endl;
+  cppscanner::genjs::write_fileAnnotationsDecoder(stream);
 
   cppscanner::genjs::write_moduleExports(stream);
 }
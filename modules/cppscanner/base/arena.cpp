@@ -0,0 +1,91 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "arena.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace cppscanner
+{
+
+Arena::Arena(Arena&& other) noexcept :
+  m_chunks(std::move(other.m_chunks)),
+  m_current(std::exchange(other.m_current, nullptr)),
+  m_free(std::exchange(other.m_free, 0)),
+  m_capacity(std::exchange(other.m_capacity, 0))
+{
+  other.m_chunks.clear();
+}
+
+/**
+ * \brief copies a string into the arena
+ *
+ * The returned view is never null, even for an empty string.
+ */
+std::string_view Arena::copy(std::string_view str)
+{
+  if (str.empty()) {
+    return std::string_view("");
+  }
+
+  if (str.size() > m_free)
+  {
+    // large strings get their own chunk so that the current one
+    // can still be used
+    const size_t size = std::max(ChunkSize, str.size());
+    m_chunks.push_back(std::make_unique<char[]>(size));
+    m_capacity += size;
+
+    if (size > ChunkSize)
+    {
+      std::copy(str.begin(), str.end(), m_chunks.back().get());
+      return std::string_view(m_chunks.back().get(), str.size());
+    }
+
+    m_current = m_chunks.back().get();
+    m_free = size;
+  }
+
+  char* result = m_current;
+  std::copy(str.begin(), str.end(), result);
+  m_current += str.size();
+  m_free -= str.size();
+  return std::string_view(result, str.size());
+}
+
+/**
+ * \brief releases all the memory of the arena
+ */
+void Arena::clear()
+{
+  m_chunks.clear();
+  m_current = nullptr;
+  m_free = 0;
+  m_capacity = 0;
+}
+
+/**
+ * \brief returns the number of bytes allocated by the arena
+ */
+size_t Arena::memoryUsage() const
+{
+  return m_capacity;
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept
+{
+  if (this != &other)
+  {
+    m_chunks = std::move(other.m_chunks);
+    other.m_chunks.clear();
+    m_current = std::exchange(other.m_current, nullptr);
+    m_free = std::exchange(other.m_free, 0);
+    m_capacity = std::exchange(other.m_capacity, 0);
+  }
+
+  return *this;
+}
+
+} // namespace cppscanner
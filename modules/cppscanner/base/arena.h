@@ -0,0 +1,50 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_ARENA_H
+#define CPPSCANNER_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace cppscanner
+{
+
+/**
+ * \brief a bump allocator for strings
+ *
+ * Strings are copied into large chunks of memory that are all released
+ * at once when the arena is destroyed or cleared.
+ * Chunks are never reallocated: views returned by copy() stay valid until
+ * then, even if the arena is moved.
+ */
+class Arena
+{
+public:
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena(Arena&& other) noexcept;
+  ~Arena() = default;
+
+  std::string_view copy(std::string_view str);
+
+  void clear();
+  size_t memoryUsage() const;
+
+  Arena& operator=(const Arena&) = delete;
+  Arena& operator=(Arena&& other) noexcept;
+
+private:
+  static constexpr size_t ChunkSize = 64 * 1024;
+  std::vector<std::unique_ptr<char[]>> m_chunks;
+  char* m_current = nullptr;
+  size_t m_free = 0;
+  size_t m_capacity = 0;
+};
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_ARENA_H
@@ -0,0 +1,99 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_ATOMICBLOCKARRAY_H
+#define CPPSCANNER_ATOMICBLOCKARRAY_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+namespace cppscanner
+{
+
+/**
+ * \brief a growable array of atomic values
+ * 
+ * Memory is allocated by blocks, as indices are accessed for the first time;
+ * blocks are never reallocated and only the allocation of a block 
+ * requires a lock.
+ * Values are zero-initialized.
+ */
+template<typename T, size_t BlockSize, size_t MaxBlocks>
+class AtomicBlockArray
+{
+public:
+  using Slot = std::atomic<T>;
+
+private:
+  std::array<std::atomic<Slot*>, MaxBlocks> m_blocks = {};
+  std::mutex m_mutex;
+
+public:
+  AtomicBlockArray() = default;
+  AtomicBlockArray(const AtomicBlockArray&) = delete;
+
+  ~AtomicBlockArray()
+  {
+    for (std::atomic<Slot*>& block : m_blocks) {
+      delete[] block.load();
+    }
+  }
+
+  static constexpr size_t capacity()
+  {
+    return BlockSize * MaxBlocks;
+  }
+
+  /**
+   * \brief returns the slot at a given index, or nullptr if it has not been allocated yet
+   */
+  const Slot* find(size_t index) const
+  {
+    if (index >= capacity()) {
+      return nullptr;
+    }
+
+    const Slot* block = m_blocks[index / BlockSize].load(std::memory_order_acquire);
+    return block ? block + (index % BlockSize) : nullptr;
+  }
+
+  /**
+   * \brief returns the slot at a given index, allocating it if needed
+   * 
+   * Returns nullptr if the index exceeds the capacity of the array.
+   */
+  Slot* get(size_t index)
+  {
+    if (index >= capacity()) {
+      return nullptr;
+    }
+
+    const size_t block_index = index / BlockSize;
+    Slot* block = m_blocks[block_index].load(std::memory_order_acquire);
+
+    if (!block)
+    {
+      std::lock_guard lock{ m_mutex };
+
+      block = m_blocks[block_index].load(std::memory_order_relaxed);
+
+      if (!block)
+      {
+        block = new Slot[BlockSize];
+        for (size_t i(0); i < BlockSize; ++i) {
+          block[i].store(T(), std::memory_order_relaxed);
+        }
+        m_blocks[block_index].store(block, std::memory_order_release);
+      }
+    }
+
+    return block + (index % BlockSize);
+  }
+};
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_ATOMICBLOCKARRAY_H
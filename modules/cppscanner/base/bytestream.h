@@ -0,0 +1,170 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_BYTESTREAM_H
+#define CPPSCANNER_BYTESTREAM_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace cppscanner
+{
+
+inline uint64_t zigzagEncode(int64_t value)
+{
+  return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t value)
+{
+  return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+/**
+ * \brief appends binary data to a string
+ *
+ * Integers are written either as LEB128 varints or as little-endian
+ * fixed-size values.
+ */
+class ByteWriter
+{
+private:
+  std::string m_bytes;
+
+public:
+  ByteWriter() = default;
+
+  void reserve(size_t n) { m_bytes.reserve(n); }
+  size_t size() const { return m_bytes.size(); }
+  const std::string& bytes() const { return m_bytes; }
+  std::string release() { return std::move(m_bytes); }
+
+  void writeByte(uint8_t b)
+  {
+    m_bytes.push_back(char(b));
+  }
+
+  void writeVarint(uint64_t value)
+  {
+    while (value >= 0x80)
+    {
+      writeByte(uint8_t(value) | 0x80);
+      value >>= 7;
+    }
+
+    writeByte(uint8_t(value));
+  }
+
+  void writeSignedVarint(int64_t value)
+  {
+    writeVarint(zigzagEncode(value));
+  }
+
+  void writeFixed64(uint64_t value)
+  {
+    for (int i(0); i < 8; ++i) {
+      writeByte(uint8_t(value >> (8 * i)));
+    }
+  }
+
+  void writeBytes(std::string_view bytes)
+  {
+    m_bytes.append(bytes.data(), bytes.size());
+  }
+
+  void writeString(std::string_view str)
+  {
+    writeVarint(str.size());
+    writeBytes(str);
+  }
+};
+
+/**
+ * \brief reads data written by a ByteWriter
+ *
+ * All reads are bounds-checked and throw std::runtime_error if the
+ * data is truncated or malformed.
+ */
+class ByteReader
+{
+private:
+  std::string_view m_bytes;
+  size_t m_pos = 0;
+
+public:
+  explicit ByteReader(std::string_view bytes) : m_bytes(bytes) { }
+
+  bool atEnd() const { return m_pos == m_bytes.size(); }
+  size_t remaining() const { return m_bytes.size() - m_pos; }
+
+  uint8_t readByte()
+  {
+    if (atEnd()) {
+      throw std::runtime_error("unexpected end of data");
+    }
+
+    return uint8_t(m_bytes[m_pos++]);
+  }
+
+  uint64_t readVarint()
+  {
+    uint64_t value = 0;
+
+    for (int shift(0); shift < 64; shift += 7)
+    {
+      const uint8_t b = readByte();
+      value |= uint64_t(b & 0x7F) << shift;
+
+      if (!(b & 0x80)) {
+        return value;
+      }
+    }
+
+    throw std::runtime_error("invalid varint");
+  }
+
+  int64_t readSignedVarint()
+  {
+    return zigzagDecode(readVarint());
+  }
+
+  uint64_t readFixed64()
+  {
+    if (remaining() < 8) {
+      throw std::runtime_error("unexpected end of data");
+    }
+
+    uint64_t value = 0;
+
+    for (int i(0); i < 8; ++i) {
+      value |= uint64_t(uint8_t(m_bytes[m_pos + i])) << (8 * i);
+    }
+
+    m_pos += 8;
+    return value;
+  }
+
+  std::string_view readBytes(size_t n)
+  {
+    if (remaining() < n) {
+      throw std::runtime_error("unexpected end of data");
+    }
+
+    std::string_view result = m_bytes.substr(m_pos, n);
+    m_pos += n;
+    return result;
+  }
+
+  std::string_view readString()
+  {
+    return readBytes(readVarint());
+  }
+};
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_BYTESTREAM_H
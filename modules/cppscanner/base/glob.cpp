@@ -5,7 +5,6 @@
 #include "glob.h"
 
 #include <algorithm>
-#include <regex>
 
 namespace cppscanner
 {
@@ -13,54 +12,353 @@ namespace cppscanner
 bool is_glob_pattern(const std::string& string)
 {
   return std::any_of(string.begin(), string.end(), [](char c) {
-    return c == '/' || c == '?' || c == '*';
+    return c == '/' || c == '?' || c == '*' || c == '[';
     }) || std::none_of(string.begin(), string.end(), [](char c) {
       return c == '.';
       });
 }
 
-// poor man's glob-to-regex conversion.
-// should be ok for most use case
-std::regex glob2regex(const std::string& pattern)
+bool glob_match(const std::string& input, const std::string& pattern)
+{
+  GlobMatcher matcher;
+  matcher.add(pattern);
+  return matcher.match(input);
+}
+
+namespace
+{
+
+using CharSet = std::bitset<256>;
+
+inline size_t idx(char c)
+{
+  return static_cast<unsigned char>(c);
+}
+
+inline size_t countTrailingZeros(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<size_t>(__builtin_ctzll(x));
+#else
+  size_t n = 0;
+
+  while (!(x & 1))
+  {
+    x >>= 1;
+    ++n;
+  }
+
+  return n;
+#endif
+}
+
+inline CharSet separators()
+{
+  CharSet result;
+  result.set(idx('/'));
+#ifdef WIN32
+  result.set(idx('\\'));
+#endif // WIN32
+  return result;
+}
+
+inline CharSet singleChar(char c)
+{
+#ifdef WIN32
+  if (c == '/' || c == '\\') {
+    return separators();
+  }
+#endif // WIN32
+
+  CharSet result;
+  result.set(idx(c));
+  return result;
+}
+
+// parses a character class starting at pattern[i] == '['.
+// on success, i is set to the index of the closing ']'.
+bool parseCharClass(const std::string& pattern, size_t& i, CharSet& result)
+{
+  size_t j = i + 1;
+  bool negate = false;
+
+  if (j < pattern.size() && (pattern[j] == '!' || pattern[j] == '^')) {
+    negate = true;
+    ++j;
+  }
+
+  CharSet chars;
+  bool first = true;
+
+  for (; j < pattern.size(); ++j, first = false)
+  {
+    char c = pattern[j];
+
+    if (c == ']' && !first) {
+      break;
+    }
+
+    if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']')
+    {
+      const auto lo = static_cast<unsigned char>(c);
+      const auto hi = static_cast<unsigned char>(pattern[j + 2]);
+
+      for (unsigned k = lo; k <= hi; ++k) {
+        chars.set(k);
+      }
+
+      j += 2;
+    }
+    else
+    {
+      chars |= singleChar(c);
+    }
+  }
+
+  if (j >= pattern.size()) {
+    // no closing bracket
+    return false;
+  }
+
+  if (negate) {
+    chars = ~chars & ~separators();
+  }
+
+  result = chars;
+  i = j;
+  return true;
+}
+
+} // namespace
+
+GlobMatcher::GlobMatcher(const std::vector<std::string>& patterns)
+{
+  for (const std::string& p : patterns) {
+    add(p);
+  }
+}
+
+/**
+ * \brief compiles a glob pattern and adds it to the matcher
+ * \param pattern  the pattern
+ */
+void GlobMatcher::add(const std::string& pattern)
 {
-  std::string r;
-  r.reserve(pattern.size() + 7);
+  const CharSet any = CharSet().set();
+  const CharSet any_but_sep = ~separators();
 
-  for (char c : pattern)
+  m_initial_states.push_back(m_states.size());
+
+  for (size_t i(0); i < pattern.size(); ++i)
   {
-    if (c == '.')
+    const char c = pattern[i];
+    State s;
+
+    if (c == '*')
     {
-      r.push_back('\\');
-      r.push_back('.');
+      s.loop = true;
+      s.skip = 1;
+
+      if (i + 1 < pattern.size() && pattern[i + 1] == '*')
+      {
+        s.chars = any;
+        ++i;
+
+        while (i + 1 < pattern.size() && pattern[i + 1] == '*') {
+          ++i;
+        }
+
+        if (i + 1 < pattern.size() && separators().test(idx(pattern[i + 1])))
+        {
+          // "**/" : the separator that follows can be skipped
+          s.skip = 2;
+        }
+      }
+      else
+      {
+        s.chars = any_but_sep;
+      }
     }
     else if (c == '?')
     {
-      r.push_back('.');
+      s.chars = any_but_sep;
     }
-    else if (c == '*')
+    else if (c == '[' && parseCharClass(pattern, i, s.chars))
     {
-      r.push_back('.');
-      r.push_back('*');
+      // i now points to the closing bracket
     }
-#ifdef WIN32
-    else if (c == '\\' || c == '/')
+#ifndef WIN32
+    else if (c == '\\' && i + 1 < pattern.size())
     {
-      r += "[\\\\\\/]";
+      s.chars = singleChar(pattern[++i]);
     }
-#endif // WIN32
+#endif // !WIN32
     else
     {
-      r.push_back(c);
+      s.chars = singleChar(c);
     }
+
+    m_states.push_back(s);
   }
 
-  return std::regex(r);
+  // the final state, which does not accept any char
+  m_states.push_back(State());
+
+  compile();
 }
 
-bool glob_match(const std::string& input, const std::string& pattern)
+bool GlobMatcher::empty() const
+{
+  return m_initial_states.empty();
+}
+
+/**
+ * \brief computes the transition tables used by match()
+ */
+void GlobMatcher::compile()
 {
-  std::regex r = glob2regex(pattern);
-  return std::regex_search(input, r);
+  const size_t n = m_states.size();
+  m_nb_words = (n + 63) / 64;
+
+  m_accept.assign(256 * m_nb_words, 0);
+  m_closures.assign(n * m_nb_words, 0);
+  m_initial.assign(m_nb_words, 0);
+  m_final.assign(m_nb_words, 0);
+
+  for (size_t i(0); i < n; ++i)
+  {
+    const State& s = m_states[i];
+
+    for (size_t c(0); c < 256; ++c)
+    {
+      if (s.chars.test(c)) {
+        m_accept[c * m_nb_words + i / 64] |= uint64_t(1) << (i % 64);
+      }
+    }
+
+    addClosure(m_closures.data() + i * m_nb_words, i);
+  }
+
+  for (size_t i : m_initial_states) {
+    addClosure(m_initial.data(), i);
+  }
+
+  for (size_t i(0); i < n; ++i)
+  {
+    // the final state of each pattern is the one preceding the initial
+    // state of the next pattern
+    const bool is_final = (i + 1 == n) || std::find(m_initial_states.begin(), m_initial_states.end(), i + 1) != m_initial_states.end();
+
+    if (is_final) {
+      m_final[i / 64] |= uint64_t(1) << (i % 64);
+    }
+  }
+}
+
+void GlobMatcher::addClosure(uint64_t* set, size_t state) const
+{
+  for (;;)
+  {
+    uint64_t& word = set[state / 64];
+    const uint64_t bit = uint64_t(1) << (state % 64);
+
+    if (word & bit) {
+      return;
+    }
+
+    word |= bit;
+
+    const State& s = m_states[state];
+
+    if (s.skip == 0) {
+      return;
+    }
+
+    if (s.skip > 1) {
+      addClosure(set, state + 1);
+    }
+
+    state += s.skip;
+  }
+}
+
+/**
+ * \brief returns whether any of the patterns matches the input
+ * \param input  the input string (usually a file path)
+ */
+bool GlobMatcher::match(std::string_view input) const
+{
+  if (m_initial_states.empty()) {
+    return false;
+  }
+
+  const size_t nb_words = m_nb_words;
+
+  // avoid allocating for the common case of a few short patterns
+  constexpr size_t SmallSize = 4;
+  uint64_t small_buffer[2 * SmallSize];
+  std::vector<uint64_t> large_buffer;
+  uint64_t* current = small_buffer;
+
+  if (nb_words > SmallSize)
+  {
+    large_buffer.resize(2 * nb_words);
+    current = large_buffer.data();
+  }
+
+  uint64_t* next = current + nb_words;
+
+  auto has_final = [this, nb_words](const uint64_t* set) -> bool {
+    for (size_t w(0); w < nb_words; ++w)
+    {
+      if (set[w] & m_final[w]) {
+        return true;
+      }
+    }
+
+    return false;
+  };
+
+  std::copy(m_initial.begin(), m_initial.end(), current);
+
+  if (has_final(current)) {
+    return true;
+  }
+
+  for (char c : input)
+  {
+    // a pattern may start matching at any position
+    std::copy(m_initial.begin(), m_initial.end(), next);
+
+    const uint64_t* accept = m_accept.data() + idx(c) * nb_words;
+
+    for (size_t w(0); w < nb_words; ++w)
+    {
+      uint64_t bits = current[w] & accept[w];
+
+      while (bits)
+      {
+        const size_t b = countTrailingZeros(bits);
+        bits &= bits - 1;
+
+        const size_t state = w * 64 + b;
+        const size_t target = m_states[state].loop ? state : state + 1;
+        const uint64_t* closure = m_closures.data() + target * nb_words;
+
+        for (size_t k(0); k < nb_words; ++k) {
+          next[k] |= closure[k];
+        }
+      }
+    }
+
+    if (has_final(next)) {
+      return true;
+    }
+
+    std::swap(current, next);
+  }
+
+  return false;
 }
 
 } // namespace cppscanner
@@ -5,7 +5,11 @@
 #ifndef CPPSCANNER_GLOB_H
 #define CPPSCANNER_GLOB_H
 
+#include <bitset>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace cppscanner
 {
@@ -13,6 +17,57 @@ namespace cppscanner
 bool is_glob_pattern(const std::string& string);
 bool glob_match(const std::string& input, const std::string& pattern);
 
+/**
+ * \brief a compiled set of glob patterns
+ *
+ * Supported syntax:
+ * - '?' matches any character except a path separator;
+ * - '*' matches any sequence of characters that does not contain a path separator;
+ * - '**' matches any sequence of characters ; when followed by a separator, 
+ *   it matches zero or more directories (the separator is then optional);
+ * - '[abc]', '[a-z]' match a character in a set, '[!abc]' (or '[^abc]') a
+ *   character that isn't in the set;
+ * - any other character matches itself (on Windows, '/' and '\' are equivalent).
+ *
+ * Like a regular expression search, a pattern matches a path if it matches
+ * any part of it (e.g., "src/" matches "/home/project/src/main.cpp").
+ *
+ * Patterns are compiled once into a nondeterministic automaton and all the
+ * patterns of a GlobMatcher are tested in a single pass over the input.
+ */
+class GlobMatcher
+{
+public:
+  GlobMatcher() = default;
+  explicit GlobMatcher(const std::vector<std::string>& patterns);
+
+  void add(const std::string& pattern);
+
+  bool empty() const;
+  bool match(std::string_view input) const;
+
+private:
+  struct State
+  {
+    std::bitset<256> chars; // characters accepted by this state
+    bool loop = false; // whether the state consumes chars in a loop (star) or exactly one char
+    uint8_t skip = 0; // number of states that can be skipped without consuming a char
+  };
+
+  void compile();
+  void addClosure(uint64_t* set, size_t state) const;
+
+private:
+  std::vector<State> m_states;
+  std::vector<size_t> m_initial_states;
+  // tables computed from the states, one bit per state
+  size_t m_nb_words = 0;
+  std::vector<uint64_t> m_accept; // states accepting a given char (256 sets)
+  std::vector<uint64_t> m_closures; // states reachable from a state without consuming a char
+  std::vector<uint64_t> m_initial;
+  std::vector<uint64_t> m_final;
+};
+
 } // namespace cppscanner
 
 #endif // CPPSCANNER_GLOB_H
@@ -0,0 +1,172 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "mappedfile.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace cppscanner
+{
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+  m_data(std::exchange(other.m_data, nullptr)),
+  m_size(std::exchange(other.m_size, 0)),
+  m_open(std::exchange(other.m_open, false))
+#ifdef _WIN32
+  , m_mapping(std::exchange(other.m_mapping, nullptr))
+#endif // _WIN32
+{
+
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+MappedFile::MappedFile(const std::filesystem::path& p)
+{
+  if (!open(p))
+  {
+    throw std::runtime_error("could not map file " + p.u8string());
+  }
+}
+
+/**
+ * \brief maps a file in memory
+ * \param p  the path of the file
+ * \return whether the file could be mapped
+ *
+ * An empty file is mapped as an empty range.
+ */
+bool MappedFile::open(const std::filesystem::path& p)
+{
+  close();
+
+#ifdef _WIN32
+  HANDLE file = ::CreateFileW(p.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!::GetFileSizeEx(file, &size))
+  {
+    ::CloseHandle(file);
+    return false;
+  }
+
+  if (size.QuadPart > 0)
+  {
+    HANDLE mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* addr = mapping ? ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+    if (!addr)
+    {
+      if (mapping) {
+        ::CloseHandle(mapping);
+      }
+
+      ::CloseHandle(file);
+      return false;
+    }
+
+    m_mapping = mapping;
+    m_data = static_cast<const char*>(addr);
+  }
+
+  ::CloseHandle(file);
+  m_size = static_cast<size_t>(size.QuadPart);
+#else
+  const int fd = ::open(p.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+  {
+    ::close(fd);
+    return false;
+  }
+
+  const size_t size = static_cast<size_t>(st.st_size);
+
+  if (size > 0)
+  {
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+    if (addr == MAP_FAILED)
+    {
+      ::close(fd);
+      return false;
+    }
+
+    m_data = static_cast<const char*>(addr);
+  }
+
+  ::close(fd);
+  m_size = size;
+#endif // _WIN32
+
+  m_open = true;
+  return true;
+}
+
+bool MappedFile::isOpen() const
+{
+  return m_open;
+}
+
+/**
+ * \brief unmaps the file, if any
+ */
+void MappedFile::close()
+{
+  if (m_data)
+  {
+#ifdef _WIN32
+    ::UnmapViewOfFile(m_data);
+    ::CloseHandle(m_mapping);
+    m_mapping = nullptr;
+#else
+    ::munmap(const_cast<char*>(m_data), m_size);
+#endif // _WIN32
+  }
+
+  m_data = nullptr;
+  m_size = 0;
+  m_open = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+  if (this != &other)
+  {
+    close();
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    m_open = std::exchange(other.m_open, false);
+#ifdef _WIN32
+    m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif // _WIN32
+  }
+
+  return *this;
+}
+
+} // namespace cppscanner
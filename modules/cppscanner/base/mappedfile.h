@@ -0,0 +1,67 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_MAPPEDFILE_H
+#define CPPSCANNER_MAPPEDFILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace cppscanner
+{
+
+/**
+ * \brief a file mapped read-only in memory
+ *
+ * The mapping is shared between all the processes that map the same file,
+ * so that its pages are only loaded once.
+ */
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  ~MappedFile();
+
+  explicit MappedFile(const std::filesystem::path& p);
+
+  bool open(const std::filesystem::path& p);
+  bool isOpen() const;
+  void close();
+
+  const char* data() const;
+  size_t size() const;
+  std::string_view bytes() const;
+
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+private:
+  const char* m_data = nullptr;
+  size_t m_size = 0;
+  bool m_open = false;
+#ifdef _WIN32
+  void* m_mapping = nullptr;
+#endif // _WIN32
+};
+
+inline const char* MappedFile::data() const
+{
+  return m_data;
+}
+
+inline size_t MappedFile::size() const
+{
+  return m_size;
+}
+
+inline std::string_view MappedFile::bytes() const
+{
+  return std::string_view(m_data, m_size);
+}
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_MAPPEDFILE_H
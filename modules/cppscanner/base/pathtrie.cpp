@@ -0,0 +1,411 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "pathtrie.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+namespace cppscanner
+{
+
+namespace
+{
+
+// returns the segment and the offset within the segment of an index;
+// segment k has size FirstSegmentSize * 2^k
+template<size_t FirstSegmentSize>
+std::pair<size_t, size_t> locate(size_t index)
+{
+  size_t j = index / FirstSegmentSize + 1;
+  size_t k = 0;
+
+  while (j >>= 1) {
+    ++k;
+  }
+
+  return { k, index - FirstSegmentSize * ((size_t(1) << k) - 1) };
+}
+
+inline size_t hashChild(PathTrie::NodeID parent, std::string_view name)
+{
+  const size_t h = std::hash<std::string_view>()(name);
+  return h ^ (size_t(parent) * 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2));
+}
+
+constexpr size_t NameChunkSize = 64 * 1024;
+
+// calls f() on each component of a non-empty path
+template<typename F>
+bool forEachComponent(std::string_view path, F&& f)
+{
+  size_t start = 0;
+
+  for (;;)
+  {
+    const size_t end = path.find('/', start);
+
+    if (end == std::string_view::npos) {
+      return f(path.substr(start));
+    }
+
+    if (!f(path.substr(start, end - start))) {
+      return false;
+    }
+
+    start = end + 1;
+  }
+}
+
+size_t countComponents(std::string_view path)
+{
+  if (path.empty()) {
+    return 0;
+  }
+
+  size_t n = 1;
+
+  for (char c : path) {
+    n += (c == '/');
+  }
+
+  return n;
+}
+
+} // namespace
+
+PathTrie::PathTrie()
+{
+  Node* segment = new Node[FirstSegmentSize];
+  segment[Root] = Node{ "", Root, 0, 0 };
+  m_segments[0].store(segment);
+  m_size.store(1);
+  m_table.resize(64, Root);
+}
+
+PathTrie::~PathTrie()
+{
+  for (std::atomic<Node*>& segment : m_segments) {
+    delete[] segment.load();
+  }
+}
+
+std::string_view PathTrie::nameOf(const Node& n) const
+{
+  return std::string_view(n.name, n.name_size);
+}
+
+std::optional<PathTrie::NodeID> PathTrie::findChild(NodeID parent, std::string_view name, size_t hash) const
+{
+  const size_t mask = m_table.size() - 1;
+
+  for (size_t i = hash & mask; ; i = (i + 1) & mask)
+  {
+    const NodeID id = m_table[i];
+
+    if (id == Root) {
+      return std::nullopt;
+    }
+
+    const Node& n = node(id);
+
+    if (n.parent == parent && nameOf(n) == name) {
+      return id;
+    }
+  }
+}
+
+const char* PathTrie::storeName(std::string_view name)
+{
+  if (name.size() > m_name_chunk_free || m_name_chunks.empty())
+  {
+    const size_t size = std::max(NameChunkSize, name.size());
+    m_name_chunks.push_back(std::make_unique<char[]>(size));
+    m_name_chunk_free = size;
+  }
+
+  // chunks are filled from the end
+  m_name_chunk_free -= name.size();
+  char* result = m_name_chunks.back().get() + m_name_chunk_free;
+  std::copy(name.begin(), name.end(), result);
+  return result;
+}
+
+void PathTrie::insertInTable(NodeID id, size_t hash)
+{
+  const size_t mask = m_table.size() - 1;
+  size_t i = hash & mask;
+
+  while (m_table[i] != Root) {
+    i = (i + 1) & mask;
+  }
+
+  m_table[i] = id;
+}
+
+void PathTrie::growTable()
+{
+  std::vector<NodeID> old = std::move(m_table);
+  m_table.assign(old.size() * 2, Root);
+
+  for (NodeID id : old)
+  {
+    if (id != Root)
+    {
+      const Node& n = node(id);
+      insertInTable(id, hashChild(n.parent, nameOf(n)));
+    }
+  }
+}
+
+/**
+ * \brief inserts a path in the trie
+ * \param path  the path
+ *
+ * Returns the node representing the path; if the path was already in the
+ * trie, its existing node is returned.
+ */
+PathTrie::NodeID PathTrie::insert(std::string_view path)
+{
+  if (path.empty()) {
+    return Root;
+  }
+
+  NodeID current = Root;
+
+  forEachComponent(path, [this, &current](std::string_view component) {
+    const size_t hash = hashChild(current, component);
+
+    if (std::optional<NodeID> child = findChild(current, component, hash))
+    {
+      current = *child;
+      return true;
+    }
+
+    const Node& parent = node(current);
+
+    if (component.size() > std::numeric_limits<uint16_t>::max() || parent.depth == std::numeric_limits<uint16_t>::max()) {
+      throw std::runtime_error("path is too long");
+    }
+
+    const size_t index = m_size.load(std::memory_order_relaxed);
+    auto [k, offset] = locate<FirstSegmentSize>(index);
+
+    if (k >= NbSegments || index > std::numeric_limits<NodeID>::max()) {
+      throw std::runtime_error("too many paths");
+    }
+
+    Node* segment = m_segments[k].load(std::memory_order_relaxed);
+
+    if (!segment)
+    {
+      segment = new Node[FirstSegmentSize << k];
+      m_segments[k].store(segment, std::memory_order_release);
+    }
+
+    segment[offset] = Node{ storeName(component), current, uint16_t(component.size()), uint16_t(parent.depth + 1) };
+    m_size.store(index + 1, std::memory_order_release);
+
+    // keep the load factor below 1/2
+    if (2 * (index + 1) > m_table.size()) {
+      growTable();
+    }
+
+    insertInTable(NodeID(index), hash);
+
+    current = NodeID(index);
+    return true;
+    });
+
+  return current;
+}
+
+/**
+ * \brief returns the node representing a path, if any
+ */
+std::optional<PathTrie::NodeID> PathTrie::find(std::string_view path) const
+{
+  NodeID current = Root;
+
+  if (path.empty()) {
+    return current;
+  }
+
+  const bool found = forEachComponent(path, [this, &current](std::string_view component) {
+    std::optional<NodeID> child = findChild(current, component, hashChild(current, component));
+
+    if (!child) {
+      return false;
+    }
+
+    current = *child;
+    return true;
+    });
+
+  return found ? std::optional<NodeID>(current) : std::nullopt;
+}
+
+/**
+ * \brief returns the number of nodes in the trie, including the root
+ */
+size_t PathTrie::size() const
+{
+  return m_size.load(std::memory_order_acquire);
+}
+
+const PathTrie::Node& PathTrie::node(NodeID id) const
+{
+  auto [k, offset] = locate<FirstSegmentSize>(id);
+  assert(k < NbSegments);
+  const Node* segment = m_segments[k].load(std::memory_order_acquire);
+  assert(segment);
+  return segment[offset];
+}
+
+PathTrie::NodeID PathTrie::parent(NodeID n) const
+{
+  return node(n).parent;
+}
+
+/**
+ * \brief returns the last component of the path represented by a node
+ */
+std::string_view PathTrie::name(NodeID n) const
+{
+  return nameOf(node(n));
+}
+
+/**
+ * \brief returns the number of components of the path represented by a node
+ */
+size_t PathTrie::depth(NodeID n) const
+{
+  return node(n).depth;
+}
+
+/**
+ * \brief returns the path represented by a node
+ */
+std::string PathTrie::path(NodeID n) const
+{
+  std::string result;
+  path(n, result);
+  return result;
+}
+
+/**
+ * \brief writes the path represented by a node into a string
+ * \param n    the node
+ * \param out  the output string, whose previous content is replaced
+ *
+ * This allows reusing the storage of \a out between calls.
+ */
+void PathTrie::path(NodeID n, std::string& out) const
+{
+  size_t len = 0;
+
+  for (NodeID it = n; it != Root; it = node(it).parent) {
+    len += node(it).name_size + 1;
+  }
+
+  if (len == 0) {
+    out.clear();
+    return;
+  }
+
+  // the first component is not preceded by a separator
+  out.assign(len - 1, '/');
+  size_t end = out.size();
+
+  for (NodeID it = n; it != Root; it = node(it).parent)
+  {
+    const std::string_view name = nameOf(node(it));
+    end -= name.size();
+    out.replace(end, name.size(), name.data(), name.size());
+
+    if (end > 0) {
+      --end;
+    }
+  }
+}
+
+/**
+ * \brief returns whether a node represents a given path
+ *
+ * This is equivalent to path(n) == p, without building the path.
+ */
+bool PathTrie::matches(NodeID n, std::string_view p) const
+{
+  size_t end = p.size();
+
+  while (n != Root)
+  {
+    const Node& current = node(n);
+    const std::string_view name = nameOf(current);
+
+    if (name.size() > end || p.compare(end - name.size(), name.size(), name) != 0) {
+      return false;
+    }
+
+    end -= name.size();
+    n = current.parent;
+
+    if (n != Root)
+    {
+      if (end == 0 || p[end - 1] != '/') {
+        return false;
+      }
+
+      --end;
+    }
+  }
+
+  return end == 0;
+}
+
+/**
+ * \brief returns whether a node is a (strict) ancestor of another one
+ */
+bool PathTrie::isAncestor(NodeID ancestor, NodeID n) const
+{
+  const size_t ancestor_depth = depth(ancestor);
+
+  if (depth(n) <= ancestor_depth) {
+    return false;
+  }
+
+  while (depth(n) > ancestor_depth) {
+    n = parent(n);
+  }
+
+  return n == ancestor;
+}
+
+/**
+ * \brief returns whether a node represents a path inside a directory
+ * \param n          the node
+ * \param directory  the path of the directory
+ *
+ * This does not require \a directory to be in the trie and does not
+ * modify the trie.
+ */
+bool PathTrie::isUnder(NodeID n, std::string_view directory) const
+{
+  const size_t dir_depth = countComponents(directory);
+
+  if (depth(n) <= dir_depth) {
+    return false;
+  }
+
+  while (depth(n) > dir_depth) {
+    n = parent(n);
+  }
+
+  return matches(n, directory);
+}
+
+} // namespace cppscanner
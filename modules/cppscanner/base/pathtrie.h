@@ -0,0 +1,96 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_PATHTRIE_H
+#define CPPSCANNER_PATHTRIE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cppscanner
+{
+
+/**
+ * \brief a trie storing file paths as a tree of directories
+ *
+ * Paths are split on '/' and each node of the trie stores one component
+ * of a path. Nodes are 16 bytes, names are stored in large character
+ * chunks and children are found through a single open-addressing table
+ * indexed by (parent, name).
+ * As most paths of a project share long directory prefixes, this uses
+ * much less memory than storing each path as a string.
+ *
+ * The empty path is represented by the root node (Root).
+ *
+ * Nodes are never moved nor modified once inserted, so that functions taking
+ * a NodeID (parent(), name(), path(), matches(), isUnder(), ...) can be called
+ * concurrently with insert(), provided that the NodeID was obtained with
+ * proper synchronization.
+ * insert() and find() must not be called concurrently.
+ */
+class PathTrie
+{
+public:
+  using NodeID = uint32_t;
+  static constexpr NodeID Root = 0;
+
+  PathTrie();
+  PathTrie(const PathTrie&) = delete;
+  ~PathTrie();
+
+  NodeID insert(std::string_view path);
+  std::optional<NodeID> find(std::string_view path) const;
+
+  size_t size() const;
+
+  NodeID parent(NodeID node) const;
+  std::string_view name(NodeID node) const;
+  size_t depth(NodeID node) const;
+
+  std::string path(NodeID node) const;
+  void path(NodeID node, std::string& out) const;
+  bool matches(NodeID node, std::string_view path) const;
+
+  bool isAncestor(NodeID ancestor, NodeID node) const;
+  bool isUnder(NodeID node, std::string_view directory) const;
+
+  PathTrie& operator=(const PathTrie&) = delete;
+
+private:
+  struct Node
+  {
+    const char* name;
+    NodeID parent;
+    uint16_t name_size;
+    uint16_t depth;
+  };
+
+  const Node& node(NodeID id) const;
+  std::string_view nameOf(const Node& n) const;
+  std::optional<NodeID> findChild(NodeID parent, std::string_view name, size_t hash) const;
+  const char* storeName(std::string_view name);
+  void insertInTable(NodeID id, size_t hash);
+  void growTable();
+
+private:
+  static constexpr size_t FirstSegmentSize = 1024;
+  static constexpr size_t NbSegments = 22;
+  std::array<std::atomic<Node*>, NbSegments> m_segments = {};
+  std::atomic<size_t> m_size{ 0 };
+  std::vector<std::unique_ptr<char[]>> m_name_chunks;
+  size_t m_name_chunk_free = 0;
+  // open-addressing hash table of the nodes, by (parent, name) ; 
+  // Root marks an empty slot
+  std::vector<NodeID> m_table;
+};
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_PATHTRIE_H
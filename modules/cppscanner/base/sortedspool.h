@@ -0,0 +1,295 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_SORTEDSPOOL_H
+#define CPPSCANNER_SORTEDSPOOL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace cppscanner
+{
+
+/**
+ * \brief a temporary file of records that can be read back sorted and without duplicates
+ *
+ * Records are buffered in memory; when the buffer is full, it is sorted and
+ * written to the file as a "run".
+ * consume() then performs a k-way merge of the runs, so that at most about
+ * twice the size of the buffer is held in memory at any time.
+ * Two records are duplicates if neither compares less than the other.
+ */
+template<typename T, typename Compare = std::less<T>>
+class SortedSpool
+{
+  static_assert(std::is_trivially_copyable_v<T>, "records are written as raw bytes");
+
+public:
+  static constexpr size_t DefaultBufferSize = 64 * 1024 * 1024;
+
+private:
+  struct Run
+  {
+    uint64_t offset;
+    size_t size;
+  };
+
+  std::filesystem::path m_path;
+  std::fstream m_file;
+  uint64_t m_file_size = 0;
+  std::vector<Run> m_runs;
+  std::vector<T> m_buffer;
+  size_t m_buffer_capacity;
+  size_t m_size = 0;
+  Compare m_comp;
+
+public:
+  explicit SortedSpool(std::filesystem::path path, size_t bufferSize = DefaultBufferSize, Compare comp = Compare()) :
+    m_path(std::move(path)),
+    m_buffer_capacity(std::max<size_t>(bufferSize / sizeof(T), 1)),
+    m_comp(comp)
+  {
+
+  }
+
+  SortedSpool(const SortedSpool&) = delete;
+
+  ~SortedSpool()
+  {
+    removeFile();
+  }
+
+  const std::filesystem::path& path() const { return m_path; }
+
+  /**
+   * \brief returns the number of records that were appended, including duplicates
+   */
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  /**
+   * \brief returns the number of runs written to the file so far
+   */
+  size_t runCount() const { return m_runs.size(); }
+
+  void append(const T& value)
+  {
+    if (m_buffer.size() == m_buffer_capacity) {
+      writeRun();
+    }
+
+    m_buffer.push_back(value);
+    ++m_size;
+  }
+
+  template<typename It>
+  void append(It begin, It end)
+  {
+    for (; begin != end; ++begin) {
+      append(*begin);
+    }
+  }
+
+  /**
+   * \brief calls f(const T* begin, const T* end) on consecutive batches of records
+   *
+   * Records are produced sorted and without duplicates.
+   * The spool is empty afterwards and its file is removed.
+   */
+  template<typename F>
+  void consume(F&& f)
+  {
+    if (m_runs.empty())
+    {
+      sortBuffer();
+
+      if (!m_buffer.empty()) {
+        f(m_buffer.data(), m_buffer.data() + m_buffer.size());
+      }
+    }
+    else
+    {
+      if (!m_buffer.empty()) {
+        writeRun();
+      }
+
+      std::vector<T>().swap(m_buffer);
+      mergeRuns(f);
+    }
+
+    clear();
+  }
+
+  void clear()
+  {
+    m_buffer.clear();
+    m_runs.clear();
+    m_size = 0;
+    removeFile();
+  }
+
+private:
+  bool equivalent(const T& a, const T& b) const
+  {
+    return !m_comp(a, b) && !m_comp(b, a);
+  }
+
+  void sortBuffer()
+  {
+    std::sort(m_buffer.begin(), m_buffer.end(), m_comp);
+    auto end = std::unique(m_buffer.begin(), m_buffer.end(), [this](const T& a, const T& b) {
+      return equivalent(a, b);
+      });
+    m_buffer.erase(end, m_buffer.end());
+  }
+
+  void writeRun()
+  {
+    if (!m_file.is_open())
+    {
+      m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+
+      if (!m_file.is_open()) {
+        throw std::runtime_error("could not create spool file " + m_path.u8string());
+      }
+    }
+
+    sortBuffer();
+
+    const size_t nbytes = m_buffer.size() * sizeof(T);
+    m_file.seekp(std::streamoff(m_file_size));
+    m_file.write(reinterpret_cast<const char*>(m_buffer.data()), std::streamsize(nbytes));
+
+    if (!m_file) {
+      throw std::runtime_error("could not write to spool file " + m_path.u8string());
+    }
+
+    m_runs.push_back(Run{ m_file_size, m_buffer.size() });
+    m_file_size += nbytes;
+    m_buffer.clear();
+  }
+
+  struct RunReader
+  {
+    Run run;
+    std::vector<T> buffer;
+    size_t pos = 0;
+
+    const T& current() const { return buffer[pos]; }
+  };
+
+  // refills the buffer of a run; returns false if the run is exhausted
+  bool read(RunReader& reader, size_t chunkSize)
+  {
+    reader.buffer.resize(std::min(chunkSize, reader.run.size));
+    reader.pos = 0;
+
+    if (reader.buffer.empty()) {
+      return false;
+    }
+
+    m_file.seekg(std::streamoff(reader.run.offset));
+    m_file.read(reinterpret_cast<char*>(reader.buffer.data()), std::streamsize(reader.buffer.size() * sizeof(T)));
+
+    if (!m_file) {
+      throw std::runtime_error("could not read spool file " + m_path.u8string());
+    }
+
+    reader.run.offset += reader.buffer.size() * sizeof(T);
+    reader.run.size -= reader.buffer.size();
+    return true;
+  }
+
+  template<typename F>
+  void mergeRuns(F& f)
+  {
+    m_file.flush();
+
+    // half of the memory budget is used to read the runs, the other half
+    // for the output
+    const size_t chunk_size = std::max<size_t>(m_buffer_capacity / 2 / m_runs.size(), 1);
+    const size_t batch_size = std::max<size_t>(m_buffer_capacity / 2, 1);
+
+    std::vector<RunReader> readers;
+    readers.reserve(m_runs.size());
+
+    for (const Run& run : m_runs)
+    {
+      RunReader reader;
+      reader.run = run;
+
+      if (read(reader, chunk_size)) {
+        readers.push_back(std::move(reader));
+      }
+    }
+
+    // min-heap of the readers, ordered by their current record
+    auto heap_comp = [this](const RunReader* a, const RunReader* b) {
+      return m_comp(b->current(), a->current());
+      };
+
+    std::vector<RunReader*> heap;
+    for (RunReader& reader : readers) {
+      heap.push_back(&reader);
+    }
+    std::make_heap(heap.begin(), heap.end(), heap_comp);
+
+    std::vector<T> batch;
+    batch.reserve(batch_size);
+    std::optional<T> last;
+
+    while (!heap.empty())
+    {
+      std::pop_heap(heap.begin(), heap.end(), heap_comp);
+      RunReader* reader = heap.back();
+
+      const T& value = reader->current();
+
+      if (!last || !equivalent(*last, value))
+      {
+        last = value;
+        batch.push_back(value);
+
+        if (batch.size() == batch_size)
+        {
+          f(batch.data(), batch.data() + batch.size());
+          batch.clear();
+        }
+      }
+
+      if (++reader->pos == reader->buffer.size() && !read(*reader, chunk_size)) {
+        heap.pop_back();
+      } else {
+        std::push_heap(heap.begin(), heap.end(), heap_comp);
+      }
+    }
+
+    if (!batch.empty()) {
+      f(batch.data(), batch.data() + batch.size());
+    }
+  }
+
+  void removeFile()
+  {
+    if (m_file.is_open())
+    {
+      m_file.close();
+      std::error_code ec;
+      std::filesystem::remove(m_path, ec);
+    }
+
+    m_file_size = 0;
+  }
+};
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_SORTEDSPOOL_H
@@ -84,6 +84,7 @@ public:
 
   bool nullColumn(int n) const;
   std::string column(int n) const;
+  std::string_view columnBlob(int n) const;
   int columnInt(int n) const;
   int64_t columnInt64(int n) const;
 };
@@ -184,7 +185,8 @@ inline void Statement::bind(int n, std::string&& text)
 
 inline void Statement::bind(int n, std::string_view text)
 {
-  sqlite3_bind_text(m_statement, n, text.data(), (int)text.size(), SQLITE_STATIC);
+  // a null pointer would bind NULL instead of an empty string
+  sqlite3_bind_text(m_statement, n, text.data() ? text.data() : "", (int)text.size(), SQLITE_STATIC);
 }
 
 inline void Statement::bind(int n, int value)
@@ -228,6 +230,18 @@ inline std::string Statement::column(int n) const
   return str ? std::string(str) : std::string();
 }
 
+/**
+ * \brief returns the bytes of a BLOB column
+ * 
+ * The returned view is invalidated by the next call to step() or reset().
+ */
+inline std::string_view Statement::columnBlob(int n) const
+{
+  const char* bytes = static_cast<const char*>(sqlite3_column_blob(m_statement, n));
+  const int len = sqlite3_column_bytes(m_statement, n);
+  return bytes ? std::string_view(bytes, static_cast<size_t>(len)) : std::string_view();
+}
+
 inline int Statement::columnInt(int n) const
 {
   return sqlite3_column_int(m_statement, n);
@@ -0,0 +1,138 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_STATEMENTCACHE_H
+#define CPPSCANNER_STATEMENTCACHE_H
+
+#include "sql.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace sql
+{
+
+/**
+ * \brief keeps prepared statements for the lifetime of a database connection
+ *
+ * Statements are prepared the first time they are requested and are then
+ * reused; callers must leave them reset (e.g., with Statement::insert()).
+ * Queries are identified by the address of their text, which must therefore
+ * have static storage duration (e.g., a string literal).
+ *
+ * The cache must be cleared, or destroyed, before the database is closed.
+ */
+class StatementCache
+{
+private:
+  Database& m_database;
+  std::map<std::pair<const char*, int>, std::unique_ptr<Statement>> m_statements;
+
+public:
+  explicit StatementCache(Database& db);
+  StatementCache(const StatementCache&) = delete;
+
+  static constexpr int MaxRowsPerInsert = 256;
+
+  Database& database() const;
+
+  Statement& get(const char* query);
+  Statement& getMultiRowInsert(const char* insertInto, int nbColumns, int nbRows);
+  int maxRowsPerInsert(int nbColumns) const;
+
+  void clear();
+};
+
+inline StatementCache::StatementCache(Database& db) :
+  m_database(db)
+{
+
+}
+
+inline Database& StatementCache::database() const
+{
+  return m_database;
+}
+
+/**
+ * \brief returns a prepared statement for a query
+ * \param query  the SQL query, with static storage duration
+ */
+inline Statement& StatementCache::get(const char* query)
+{
+  std::unique_ptr<Statement>& stmt = m_statements[std::make_pair(query, 0)];
+
+  if (!stmt) {
+    stmt = std::make_unique<Statement>(m_database, query);
+  }
+
+  return *stmt;
+}
+
+/**
+ * \brief returns a prepared statement inserting several rows at once
+ * \param insertInto  the beginning of the INSERT statement, up to and including VALUES
+ * \param nbColumns   the number of values in each row
+ * \param nbRows      the number of rows
+ *
+ * The parameter for the i-th column of the r-th row (both starting at zero)
+ * has index r * nbColumns + i + 1.
+ */
+inline Statement& StatementCache::getMultiRowInsert(const char* insertInto, int nbColumns, int nbRows)
+{
+  std::unique_ptr<Statement>& stmt = m_statements[std::make_pair(insertInto, nbRows)];
+
+  if (!stmt)
+  {
+    std::string row = "(?";
+    for (int i(1); i < nbColumns; ++i) {
+      row += ",?";
+    }
+    row += ")";
+
+    std::string query = insertInto;
+    query.reserve(query.size() + nbRows * (row.size() + 1));
+
+    for (int r(0); r < nbRows; ++r)
+    {
+      if (r > 0) {
+        query += ",";
+      }
+
+      query += row;
+    }
+
+    stmt = std::make_unique<Statement>(m_database, query.c_str());
+  }
+
+  return *stmt;
+}
+
+/**
+ * \brief returns the number of rows inserted by the multi-row statements
+ * \param nbColumns  the number of values in each row
+ *
+ * This is MaxRowsPerInsert, unless SQLite was compiled with a lower limit
+ * on the number of parameters of a statement.
+ */
+inline int StatementCache::maxRowsPerInsert(int nbColumns) const
+{
+  const int max_params = sqlite3_limit(m_database.sqliteHandle(), SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+  return std::max(1, std::min(MaxRowsPerInsert, max_params / nbColumns));
+}
+
+/**
+ * \brief finalizes all the statements
+ */
+inline void StatementCache::clear()
+{
+  m_statements.clear();
+}
+
+} // namespace sql
+
+#endif // CPPSCANNER_STATEMENTCACHE_H
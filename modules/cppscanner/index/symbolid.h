@@ -5,6 +5,7 @@
 #ifndef CPPSCANNER_SYMBOLID_H
 #define CPPSCANNER_SYMBOLID_H
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -75,6 +76,16 @@ inline bool operator<(const SymbolID & lhs, const SymbolID & rhs)
   return lhs.rawID() < rhs.rawID();
 }
 
+/**
+ * \brief returns a hash of a symbol id for use in open-addressing tables
+ */
+inline size_t hashSymbolId(const SymbolID& id)
+{
+  // symbol ids are already hashes but their low bits may not be well distributed
+  const uint64_t h = id.rawID() * 0x9E3779B97F4A7C15ull;
+  return size_t(h ^ (h >> 32));
+}
+
 } // namespace cppscanner
 
 #endif // CPPSCANNER_SYMBOLID_H
@@ -0,0 +1,259 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "filecontentcapture.h"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringExtras.h> // toHex
+#include <llvm/Support/SHA1.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <string_view>
+
+#ifdef _WIN32
+#include <cstring>
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace cppscanner
+{
+
+namespace
+{
+
+#ifdef _WIN32
+
+// memchr() is vectorized by the C library, which makes this much faster
+// than erasing the characters one by one.
+void assignWithoutCarriageReturns(std::string& out, std::string_view text)
+{
+  out.clear();
+  out.reserve(text.size());
+
+  while (!text.empty())
+  {
+    const void* cr = std::memchr(text.data(), '\r', text.size());
+    const size_t n = cr ? static_cast<const char*>(cr) - text.data() : text.size();
+    out.append(text.data(), n);
+    text.remove_prefix(cr ? n + 1 : n);
+  }
+}
+
+bool readFile(const std::string& path, std::string& content)
+{
+  std::ifstream stream{ path, std::ios::binary };
+  if (!stream.good()) {
+    return false;
+  }
+
+  const std::string bytes{ std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+  assignWithoutCarriageReturns(content, bytes);
+  return true;
+}
+
+#else
+
+bool readFile(const std::string& path, std::string& content)
+{
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+  {
+    ::close(fd);
+    return false;
+  }
+
+  const size_t size = static_cast<size_t>(st.st_size);
+
+  if (size == 0)
+  {
+    ::close(fd);
+    content.clear();
+    return true;
+  }
+
+  void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+
+  ::madvise(addr, size, MADV_SEQUENTIAL);
+  content.assign(static_cast<const char*>(addr), size);
+  ::munmap(addr, size);
+  return true;
+}
+
+#endif // _WIN32
+
+std::string computeSha1(const std::string& text)
+{
+  llvm::SHA1 hasher;
+  hasher.update(text);
+  std::array<uint8_t, 20> result = hasher.final();
+  constexpr bool to_lower_case = true;
+  return llvm::toHex(result, to_lower_case);
+}
+
+} // namespace
+
+FileContentCapture::FileContentCapture(size_t nbThreads)
+{
+  nbThreads = std::max<size_t>(nbThreads, 1);
+
+  for (size_t i(0); i < nbThreads; ++i) {
+    m_threads.emplace_back(&FileContentCapture::run, this);
+  }
+}
+
+FileContentCapture::~FileContentCapture()
+{
+  {
+    std::lock_guard lock{ m_mutex };
+    m_stop = true;
+  }
+
+  m_work_available.notify_all();
+
+  for (std::thread& t : m_threads) {
+    t.join();
+  }
+}
+
+/**
+ * \brief returns the number of threads used by default
+ *
+ * Reading files is mostly bound by I/O, so there is little benefit
+ * in using more than a few threads.
+ */
+size_t FileContentCapture::defaultThreadCount()
+{
+  return std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 4);
+}
+
+void FileContentCapture::submit(File file)
+{
+  {
+    std::lock_guard lock{ m_mutex };
+    m_pending.push_back(std::move(file));
+  }
+
+  m_work_available.notify_one();
+}
+
+/**
+ * \brief returns the files that have been processed since the last call
+ */
+std::vector<File> FileContentCapture::takeFinished()
+{
+  std::vector<File> result;
+  std::lock_guard lock{ m_mutex };
+  result.swap(m_finished);
+  return result;
+}
+
+/**
+ * \brief waits until all submitted files have been processed and returns them
+ */
+std::vector<File> FileContentCapture::waitAll()
+{
+  std::unique_lock lock{ m_mutex };
+
+  m_work_done.wait(lock, [this]() {
+    return m_pending.empty() && m_in_progress == 0;
+    });
+
+  std::vector<File> result;
+  result.swap(m_finished);
+  return result;
+}
+
+/**
+ * \brief reads the content of a file and computes its SHA-1
+ *
+ * Carriage returns are removed on Windows.
+ */
+void FileContentCapture::fill(File& f)
+{
+  if (!readFile(f.path, f.content)) {
+    f.content.clear();
+  }
+
+  if (!f.content.empty()) {
+    f.sha1 = computeSha1(f.content);
+  }
+}
+
+/**
+ * \brief fills the content of several files in parallel
+ */
+void FileContentCapture::fill(std::vector<File>& files, size_t nbThreads)
+{
+  std::atomic<size_t> next{ 0 };
+
+  auto work = [&files, &next]() {
+    for (size_t i = next++; i < files.size(); i = next++) {
+      fill(files[i]);
+    }
+    };
+
+  std::vector<std::thread> threads;
+  const size_t nb_threads = std::min(nbThreads, files.size());
+
+  // the calling thread also does some of the work
+  for (size_t i(1); i < nb_threads; ++i) {
+    threads.emplace_back(work);
+  }
+
+  work();
+
+  for (std::thread& t : threads) {
+    t.join();
+  }
+}
+
+void FileContentCapture::run()
+{
+  std::unique_lock lock{ m_mutex };
+
+  for (;;)
+  {
+    m_work_available.wait(lock, [this]() {
+      return m_stop || !m_pending.empty();
+      });
+
+    if (m_pending.empty()) {
+      return;
+    }
+
+    File file = std::move(m_pending.front());
+    m_pending.pop_front();
+    ++m_in_progress;
+
+    lock.unlock();
+    fill(file);
+    lock.lock();
+
+    m_finished.push_back(std::move(file));
+    --m_in_progress;
+
+    if (m_pending.empty() && m_in_progress == 0) {
+      m_work_done.notify_all();
+    }
+  }
+}
+
+} // namespace cppscanner
@@ -0,0 +1,58 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_FILECONTENTCAPTURE_H
+#define CPPSCANNER_FILECONTENTCAPTURE_H
+
+#include "cppscanner/index/file.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cppscanner
+{
+
+/**
+ * \brief reads the content of files and computes their SHA-1 on background threads
+ *
+ * Files are submitted with their id and path; they are returned by takeFinished()
+ * or waitAll() with their content and hash filled, in no particular order.
+ * Files that cannot be read are returned with an empty content.
+ */
+class FileContentCapture
+{
+public:
+  explicit FileContentCapture(size_t nbThreads = defaultThreadCount());
+  FileContentCapture(const FileContentCapture&) = delete;
+  ~FileContentCapture();
+
+  static size_t defaultThreadCount();
+
+  void submit(File file);
+  std::vector<File> takeFinished();
+  std::vector<File> waitAll();
+
+  static void fill(File& file);
+  static void fill(std::vector<File>& files, size_t nbThreads = defaultThreadCount());
+
+protected:
+  void run();
+
+private:
+  std::vector<std::thread> m_threads;
+  std::deque<File> m_pending;
+  std::vector<File> m_finished;
+  size_t m_in_progress = 0;
+  bool m_stop = false;
+  std::mutex m_mutex;
+  std::condition_variable m_work_available;
+  std::condition_variable m_work_done;
+};
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_FILECONTENTCAPTURE_H
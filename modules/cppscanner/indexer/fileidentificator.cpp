@@ -4,90 +4,247 @@
 
 #include "fileidentificator.h"
 
-#include <map>
+#include "cppscanner/base/atomicblockarray.h"
+#include "cppscanner/base/pathtrie.h"
+
+#include <array>
+#include <atomic>
+#include <functional>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
 namespace cppscanner
 {
 
-// TODO: use FileIdTable ?
 class BasicFileIdentificator : public FileIdentificator
 {
 private:
-  std::map<std::string, FileID> m_files;
+  PathTrie m_trie;
+  std::vector<PathTrie::NodeID> m_nodes; // FileID -> node
+  std::vector<FileID> m_ids; // node -> FileID (zero for directories)
 
 public:
-  explicit BasicFileIdentificator(std::map<std::string, FileID> files = {});
+  BasicFileIdentificator();
 
   FileID getIdentification(const std::string& file) final;
   std::vector<std::string> getFiles() const final;
+  void getFilePath(FileID fid, std::string& path) const final;
+  bool isInDirectory(FileID fid, std::string_view directory) const final;
 };
 
-BasicFileIdentificator::BasicFileIdentificator(std::map<std::string, FileID> files)
-  : m_files(std::move(files))
+BasicFileIdentificator::BasicFileIdentificator()
 {
-  m_files[""] = 0;
+  m_nodes.push_back(PathTrie::Root);
+  m_ids.push_back(invalidFileID());
 }
 
 FileID BasicFileIdentificator::getIdentification(const std::string& file)
 {
-  auto it = m_files.find(file);
+  const PathTrie::NodeID node = m_trie.insert(file);
 
-  if (it != m_files.end()) {
-    return it->second;
+  if (node == PathTrie::Root) {
+    return invalidFileID();
   }
 
-  auto result = FileID(m_files.size());
-  m_files[file] = result;
-  return result;
+  if (m_ids.size() < m_trie.size()) {
+    m_ids.resize(m_trie.size(), invalidFileID());
+  }
+
+  if (m_ids[node] == invalidFileID())
+  {
+    m_ids[node] = FileID(m_nodes.size());
+    m_nodes.push_back(node);
+  }
+
+  return m_ids[node];
 }
 
 std::vector<std::string> BasicFileIdentificator::getFiles() const
 {
   std::vector<std::string> result;
-  result.resize(m_files.size());
+  result.reserve(m_nodes.size());
 
-  for (const auto& p : m_files) {
-    result[p.second] = p.first;
+  for (PathTrie::NodeID node : m_nodes) {
+    result.push_back(m_trie.path(node));
   }
 
   return result;
 }
 
+void BasicFileIdentificator::getFilePath(FileID fid, std::string& path) const
+{
+  m_trie.path(m_nodes.at(fid), path);
+}
+
+bool BasicFileIdentificator::isInDirectory(FileID fid, std::string_view directory) const
+{
+  return m_trie.isUnder(m_nodes.at(fid), directory);
+}
+
 } // namespace cppscanner
 
 namespace cppscanner
 {
 
+/**
+ * \brief a file identificator that can be used concurrently from multiple threads
+ *
+ * Files are distributed among several shards by the hash of their path,
+ * each shard with its own lock, so that threads identifying different
+ * files rarely contend.
+ * Shards only store hashes: a candidate FileID is confirmed by comparing
+ * the path with the node of the PathTrie, which does not require any lock.
+ * The trie is locked only when a new file is inserted.
+ * Looking up a file that is already known only requires a shared lock,
+ * and getFile() does not require any lock.
+ */
 class ThreadSafeFileIdentificator : public FileIdentificator
 {
 private:
-  BasicFileIdentificator m_files;
-  mutable std::mutex m_mutex;
+  static constexpr size_t NbShards = 64;
+
+  struct Shard
+  {
+    std::shared_mutex mutex;
+    std::unordered_multimap<size_t, FileID> ids; // hash of the path -> file
+  };
+
+  std::array<Shard, NbShards> m_shards;
+  std::mutex m_trie_mutex;
+  PathTrie m_trie;
+  // FileID -> node + 1 (zero means that the node has not been published yet)
+  AtomicBlockArray<PathTrie::NodeID, 16384, 4096> m_nodes;
+  std::atomic<FileID> m_next_id{ 1 };
 
 public:
-  explicit ThreadSafeFileIdentificator(std::map<std::string, FileID> files = {});
+  ThreadSafeFileIdentificator();
 
   FileID getIdentification(const std::string& file) final;
   std::vector<std::string> getFiles() const final;
+  void getFilePath(FileID fid, std::string& path) const final;
+  bool isInDirectory(FileID fid, std::string_view directory) const final;
+
+private:
+  std::optional<PathTrie::NodeID> findNode(FileID fid) const;
+  PathTrie::NodeID getNode(FileID fid) const;
+  std::optional<FileID> find(const Shard& shard, size_t hash, const std::string& file) const;
 };
 
-ThreadSafeFileIdentificator::ThreadSafeFileIdentificator(std::map<std::string, FileID> files)
-  : m_files(std::move(files))
+ThreadSafeFileIdentificator::ThreadSafeFileIdentificator()
 {
+  m_nodes.get(invalidFileID())->store(PathTrie::Root + 1);
+}
+
+std::optional<PathTrie::NodeID> ThreadSafeFileIdentificator::findNode(FileID fid) const
+{
+  const std::atomic<PathTrie::NodeID>* slot = m_nodes.find(fid);
+  const PathTrie::NodeID value = slot ? slot->load(std::memory_order_acquire) : 0;
+  return value ? std::optional<PathTrie::NodeID>(value - 1) : std::nullopt;
+}
+
+PathTrie::NodeID ThreadSafeFileIdentificator::getNode(FileID fid) const
+{
+  std::optional<PathTrie::NodeID> node = findNode(fid);
+
+  if (!node) {
+    throw std::out_of_range("invalid file id");
+  }
 
+  return *node;
+}
+
+std::optional<FileID> ThreadSafeFileIdentificator::find(const Shard& shard, size_t hash, const std::string& file) const
+{
+  auto [begin, end] = shard.ids.equal_range(hash);
+
+  for (auto it = begin; it != end; ++it)
+  {
+    if (m_trie.matches(getNode(it->second), file)) {
+      return it->second;
+    }
+  }
+
+  return std::nullopt;
 }
 
 FileID ThreadSafeFileIdentificator::getIdentification(const std::string& file)
 {
-  std::lock_guard lock{ m_mutex };
-  return m_files.getIdentification(file);
+  if (file.empty()) {
+    return invalidFileID();
+  }
+
+  const size_t hash = std::hash<std::string_view>()(file);
+  Shard& shard = m_shards[hash % NbShards];
+
+  {
+    std::shared_lock lock{ shard.mutex };
+    if (std::optional<FileID> id = find(shard, hash, file)) {
+      return *id;
+    }
+  }
+
+  std::unique_lock lock{ shard.mutex };
+
+  if (std::optional<FileID> id = find(shard, hash, file)) {
+    return *id;
+  }
+
+  PathTrie::NodeID node;
+
+  {
+    std::lock_guard trie_lock{ m_trie_mutex };
+    node = m_trie.insert(file);
+  }
+
+  const FileID id = m_next_id.fetch_add(1);
+  std::atomic<PathTrie::NodeID>* slot = m_nodes.get(id);
+
+  if (!slot) {
+    throw std::runtime_error("too many files");
+  }
+
+  slot->store(node + 1, std::memory_order_release);
+  shard.ids.emplace(hash, id);
+  return id;
 }
 
 std::vector<std::string> ThreadSafeFileIdentificator::getFiles() const
 {
-  std::lock_guard lock{ m_mutex };
-  return m_files.getFiles();
+  const FileID n = m_next_id.load();
+
+  std::vector<std::string> result;
+  result.reserve(n);
+
+  for (FileID i(0); i < n; ++i)
+  {
+    std::optional<PathTrie::NodeID> node = findNode(i);
+
+    // the id may have been allocated but not yet published by
+    // another thread; it will be very soon.
+    while (!node)
+    {
+      std::this_thread::yield();
+      node = findNode(i);
+    }
+
+    result.push_back(m_trie.path(*node));
+  }
+
+  return result;
+}
+
+void ThreadSafeFileIdentificator::getFilePath(FileID fid, std::string& path) const
+{
+  m_trie.path(getNode(fid), path);
+}
+
+bool ThreadSafeFileIdentificator::isInDirectory(FileID fid, std::string_view directory) const
+{
+  return m_trie.isUnder(getNode(fid), directory);
 }
 
 } // namespace cppscanner
@@ -100,9 +257,33 @@ FileIdentificator::~FileIdentificator()
 
 }
 
+/**
+ * \brief returns the path of a file
+ * \param fid  the file id
+ *
+ * Use getFilePath() to reuse the storage of an existing string.
+ */
 std::string FileIdentificator::getFile(FileID fid) const
 {
-  return getFiles().at(fid);
+  std::string path;
+  getFilePath(fid, path);
+  return path;
+}
+
+/**
+ * \brief returns whether a file is inside a directory
+ * \param fid        the file id
+ * \param directory  the path of the directory, without a trailing separator
+ *
+ * Paths are compared as is, they are not made absolute nor normalized.
+ */
+bool FileIdentificator::isInDirectory(FileID fid, std::string_view directory) const
+{
+  const std::string& path = getFile(fid);
+
+  return path.size() > directory.size() &&
+    path.at(directory.size()) == '/' &&
+    path.compare(0, directory.size(), directory) == 0;
 }
 
 std::unique_ptr<FileIdentificator> FileIdentificator::createFileIdentificator()
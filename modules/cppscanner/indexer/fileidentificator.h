@@ -9,6 +9,7 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace cppscanner
@@ -16,6 +17,13 @@ namespace cppscanner
 
 /**
  * \brief provides an integer-based identifier for files
+ * 
+ * Identifiers are allocated sequentially, starting at 1 (0 is reserved for 
+ * the empty path, i.e., an invalid file).
+ * 
+ * Paths are stored in a PathTrie, so getFile() rebuilds the path from
+ * its components; getFilePath() does the same into an existing string,
+ * which avoids an allocation when the string is reused.
  */
 class FileIdentificator
 {
@@ -24,7 +32,9 @@ public:
 
   virtual FileID getIdentification(const std::string& file) = 0;
   virtual std::vector<std::string> getFiles() const = 0;
-  virtual std::string getFile(FileID fid) const;
+  std::string getFile(FileID fid) const;
+  virtual void getFilePath(FileID fid, std::string& path) const = 0;
+  virtual bool isInDirectory(FileID fid, std::string_view directory) const;
 
   static std::unique_ptr<FileIdentificator> createFileIdentificator();
   static std::unique_ptr<FileIdentificator> createThreadSafeFileIdentificator();
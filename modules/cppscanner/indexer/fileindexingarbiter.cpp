@@ -6,13 +6,19 @@
 
 #include "fileidentificator.h"
 
+#include "cppscanner/base/atomicblockarray.h"
 #include "cppscanner/base/glob.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <filesystem>
 #include <mutex>
+#include <optional>
+#include <stdexcept>
 
 namespace cppscanner
 {
@@ -43,6 +49,13 @@ public:
       return arbiter->shouldIndex(file, tu);
       });
   }
+
+  bool isThreadSafe() const final
+  {
+    return std::all_of(m_arbiters.begin(), m_arbiters.end(), [](const ArbiterPtr& arbiter) {
+      return arbiter->isThreadSafe();
+      });
+  }
 };
 
 
@@ -56,6 +69,7 @@ public:
   explicit ThreadSafeFileIndexingArbiter(std::unique_ptr<FileIndexingArbiter> arbiter);
 
   bool shouldIndex(FileID file, const TranslationUnitIndex* context) final;
+  bool isThreadSafe() const final;
 };
 
 ThreadSafeFileIndexingArbiter::ThreadSafeFileIndexingArbiter(std::unique_ptr<FileIndexingArbiter> arbiter) :
@@ -71,6 +85,11 @@ bool ThreadSafeFileIndexingArbiter::shouldIndex(FileID file, const TranslationUn
   return m_arbiter->shouldIndex(file, context);
 }
 
+bool ThreadSafeFileIndexingArbiter::isThreadSafe() const
+{
+  return true;
+}
+
 FileIndexingArbiter::FileIndexingArbiter(FileIdentificator& fIdentificator) :
   m_fileIdentificator(fIdentificator)
 {
@@ -97,6 +116,17 @@ bool FileIndexingArbiter::shouldIndex(FileID /* file */, const TranslationUnitIn
   return true;
 }
 
+/**
+ * \brief returns whether shouldIndex() can be called concurrently from multiple threads
+ * 
+ * The default implementation returns false; arbiters that are stateless or
+ * that synchronize access to their state should override this function.
+ */
+bool FileIndexingArbiter::isThreadSafe() const
+{
+  return false;
+}
+
 /**
  * \brief creates a file indexing arbiter from a list of arbiters
  * \param arbiters  a list of file indexing arbiters
@@ -119,21 +149,152 @@ std::unique_ptr<FileIndexingArbiter> FileIndexingArbiter::createCompositeArbiter
  * \brief creates a thread-safe file indexing arbiter from an existing one
  * \param arbiter  a non-null arbiter
  * 
- * This creates an arbiter that protects access to \a arbiter with a mutex.
+ * If \a arbiter is already thread-safe (see isThreadSafe()), it is returned as is.
+ * Otherwise, this creates an arbiter that protects access to \a arbiter with a mutex.
  * Using a thread-safe arbiter is required when using an arbiter that maintains 
- * state (such as IndexOnceFileIndexingArbiter) in multiple threads.
+ * state in multiple threads.
  */
 std::unique_ptr<FileIndexingArbiter> FileIndexingArbiter::createThreadSafeArbiter(std::unique_ptr<FileIndexingArbiter> arbiter)
 {
+  if (arbiter->isThreadSafe()) {
+    return arbiter;
+  }
+
   return std::make_unique<ThreadSafeFileIndexingArbiter>(std::move(arbiter));
 }
 
+/**
+ * \brief a thread-safe bitmap storing a yes/no decision per file
+ * 
+ * Two bits are used per file: one to tell whether the decision is known
+ * and one for the decision itself.
+ * Memory is allocated by blocks, as files are encountered; only the 
+ * allocation of a block requires a lock.
+ */
+class FileDecisionBitmap
+{
+public:
+  static constexpr size_t FilesPerWord = 32;
+
+private:
+  AtomicBlockArray<uint64_t, 1024, 4096> m_words;
+
+public:
+  FileDecisionBitmap() = default;
+  FileDecisionBitmap(const FileDecisionBitmap&) = delete;
+
+  std::optional<bool> get(FileID file) const
+  {
+    const std::atomic<uint64_t>* word = m_words.find(file / FilesPerWord);
+
+    if (!word) {
+      return std::nullopt;
+    }
+
+    const uint64_t bits = word->load(std::memory_order_acquire) >> (2 * (file % FilesPerWord));
+    
+    if (!(bits & 1)) {
+      return std::nullopt;
+    }
+
+    return (bits & 2) != 0;
+  }
+
+  void set(FileID file, bool value)
+  {
+    std::atomic<uint64_t>* word = m_words.get(file / FilesPerWord);
+
+    if (!word) {
+      return;
+    }
+
+    const uint64_t bits = value ? 3 : 1;
+    word->fetch_or(bits << (2 * (file % FilesPerWord)), std::memory_order_release);
+  }
+};
+
+CachingFileIndexingArbiter::CachingFileIndexingArbiter(std::unique_ptr<FileIndexingArbiter> arbiter) :
+  FileIndexingArbiter(arbiter->fileIdentificator()),
+  m_arbiter(std::move(arbiter)),
+  m_decisions(std::make_unique<FileDecisionBitmap>())
+{
+
+}
+
+CachingFileIndexingArbiter::~CachingFileIndexingArbiter() = default;
+
+bool CachingFileIndexingArbiter::shouldIndex(FileID file, const TranslationUnitIndex* tu)
+{
+  (void)tu;
+
+  if (!file) {
+    return false;
+  }
+
+  if (std::optional<bool> decision = m_decisions->get(file)) {
+    return *decision;
+  }
+
+  // note: two threads may compute the decision for the same file concurrently,
+  // this is fine as they will reach the same result.
+  const bool result = m_arbiter->shouldIndex(file, nullptr);
+  m_decisions->set(file, result);
+  return result;
+}
+
+bool CachingFileIndexingArbiter::isThreadSafe() const
+{
+  return m_arbiter->isThreadSafe();
+}
+
+/**
+ * \brief stores, for each file, the translation unit that claimed it
+ */
+class FileClaimTable
+{
+private:
+  AtomicBlockArray<const TranslationUnitIndex*, 16384, 4096> m_slots;
+
+public:
+  FileClaimTable() = default;
+  FileClaimTable(const FileClaimTable&) = delete;
+
+  /**
+   * \brief claims a file for a translation unit
+   * \param file  the file
+   * \param tu    the non-null translation unit
+   * 
+   * Returns the translation unit that owns the file, which is \a tu if
+   * the file was not claimed before.
+   */
+  const TranslationUnitIndex* claim(FileID file, const TranslationUnitIndex* tu)
+  {
+    std::atomic<const TranslationUnitIndex*>* slot = m_slots.get(file);
+
+    if (!slot) {
+      throw std::runtime_error("too many files");
+    }
+
+    const TranslationUnitIndex* owner = slot->load(std::memory_order_acquire);
+
+    if (!owner && slot->compare_exchange_strong(owner, tu, std::memory_order_acq_rel, std::memory_order_acquire)) {
+      return tu;
+    }
+
+    // on failure, compare_exchange_strong() loaded the current owner
+    return owner;
+  }
+};
+
 IndexOnceFileIndexingArbiter::IndexOnceFileIndexingArbiter(FileIdentificator& fIdentificator) :
-  FileIndexingArbiter(fIdentificator)
+  FileIndexingArbiter(fIdentificator),
+  m_claims(std::make_unique<FileClaimTable>())
 {
 
 }
 
+IndexOnceFileIndexingArbiter::~IndexOnceFileIndexingArbiter() = default;
+
 /**
  * \brief returns whether the file should be indexed in a given translation unit
  * 
@@ -151,13 +312,11 @@ bool IndexOnceFileIndexingArbiter::shouldIndex(FileID file, const TranslationUni
     return true;
   }
 
-  auto it = m_translation_units.find(file);
-
-  if (it != m_translation_units.end()) {
-    return it->second == tu;
-  }
+  return m_claims->claim(file, tu) == tu;
+}
 
-  m_translation_units[file] = tu;
+bool IndexOnceFileIndexingArbiter::isThreadSafe() const
+{
   return true;
 }
 
@@ -172,17 +331,28 @@ bool IndexDirectoryFileIndexingArbiter::shouldIndex(FileID file, const Translati
 {
   (void)tu;
 
-  std::string path = fileIdentificator().getFile(file);
-  path = std::filesystem::absolute(path).generic_u8string();
+#ifndef WIN32
+  // paths are stored in a PathTrie: this is a node-ancestor check
+  if (fileIdentificator().isInDirectory(file, m_dir_path)) {
+    return true;
+  }
+#endif // !WIN32
+
+  const std::string path = std::filesystem::absolute(fileIdentificator().getFile(file)).generic_u8string();
 
   return path.size() > m_dir_path.size() &&
     path.at(m_dir_path.size()) == '/' &&
     std::strncmp(path.c_str(), m_dir_path.c_str(), m_dir_path.size()) == 0;
 }
 
+bool IndexDirectoryFileIndexingArbiter::isThreadSafe() const
+{
+  return true;
+}
+
 IndexFilesMatchingPatternIndexingArbiter::IndexFilesMatchingPatternIndexingArbiter(FileIdentificator& fIdentificator, const std::vector<std::string>& patterns) :
   FileIndexingArbiter(fIdentificator),
-  m_patterns(patterns)
+  m_matcher(patterns)
 {
 
 }
@@ -193,23 +363,62 @@ bool filename_match(const std::string& filePath, const std::string& fileName)
     filePath.find(fileName, filePath.size() - fileName.size()) != std::string::npos;
 }
 
+FilePathMatcher::FilePathMatcher(const std::vector<std::string>& patterns)
+{
+  for (const std::string& p : patterns)
+  {
+    if (is_glob_pattern(p)) {
+      m_globs.add(p);
+    } else {
+      m_filenames.push_back(p);
+    }
+  }
+}
+
+bool FilePathMatcher::empty() const
+{
+  return m_globs.empty() && m_filenames.empty();
+}
+
+/**
+ * \brief returns whether a file path matches at least one of the patterns
+ */
+bool FilePathMatcher::match(const std::string& filePath) const
+{
+  return std::any_of(m_filenames.begin(), m_filenames.end(), [&filePath](const std::string& e) {
+    return filename_match(filePath, e);
+    }) || m_globs.match(filePath);
+}
+
 bool IndexFilesMatchingPatternIndexingArbiter::shouldIndex(FileID file, const TranslationUnitIndex* tu)
 {
   (void)tu;
 
-  std::string path = fileIdentificator().getFile(file);
+  // this is called for every file, possibly from several threads
+  thread_local std::string path;
+  fileIdentificator().getFilePath(file, path);
 
-  return std::any_of(m_patterns.begin(), m_patterns.end(), [&path](const std::string& e) {
-    return is_glob_pattern(e) ? glob_match(path, e) : filename_match(path, e);
-    });
+  return m_matcher.match(path);
 }
 
+bool IndexFilesMatchingPatternIndexingArbiter::isThreadSafe() const
+{
+  return true;
+}
+
+/**
+ * \brief creates the arbiter used by the scanner
+ * \param fileIdentificator  the file identificator
+ * \param opts               the options
+ * 
+ * The decisions of the arbiters that do not depend on the translation unit 
+ * (directory and patterns) are computed once per file and cached ; 
+ * only files passing these tests go through the IndexOnceFileIndexingArbiter.
+ */
 std::unique_ptr<FileIndexingArbiter> createIndexingArbiter(FileIdentificator& fileIdentificator, const CreateIndexingArbiterOptions& opts)
 {
   std::vector<std::unique_ptr<FileIndexingArbiter>> arbiters;
 
-  arbiters.push_back(std::make_unique<IndexOnceFileIndexingArbiter>(fileIdentificator));
-
   if (opts.indexExternalFiles) {
     if (!opts.rootDirectory.empty()) {
       arbiters.push_back(std::make_unique<IndexDirectoryFileIndexingArbiter>(fileIdentificator, opts.rootDirectory));
@@ -222,7 +431,16 @@ std::unique_ptr<FileIndexingArbiter> createIndexingArbiter(FileIdentificator& fi
     arbiters.push_back(std::make_unique<IndexFilesMatchingPatternIndexingArbiter>(fileIdentificator, opts.filters));
   }
 
-  return FileIndexingArbiter::createCompositeArbiter(std::move(arbiters));
+  std::vector<std::unique_ptr<FileIndexingArbiter>> result;
+
+  if (!arbiters.empty()) {
+    auto tu_independent_arbiter = FileIndexingArbiter::createCompositeArbiter(std::move(arbiters));
+    result.push_back(std::make_unique<CachingFileIndexingArbiter>(std::move(tu_independent_arbiter)));
+  }
+
+  result.push_back(std::make_unique<IndexOnceFileIndexingArbiter>(fileIdentificator));
+
+  return FileIndexingArbiter::createCompositeArbiter(std::move(result));
 }
 
 } // namespace cppscanner
@@ -5,9 +5,9 @@
 #ifndef CPPSCANNER_FILEINDEXINGARBITER_H
 #define CPPSCANNER_FILEINDEXINGARBITER_H
 
+#include "cppscanner/base/glob.h"
 #include "cppscanner/index/fileid.h"
 
-#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -33,6 +33,7 @@ public:
   FileIdentificator& fileIdentificator() const;
 
   virtual bool shouldIndex(FileID file, const TranslationUnitIndex* tu = nullptr);
+  virtual bool isThreadSafe() const;
 
   static std::unique_ptr<FileIndexingArbiter> createCompositeArbiter(std::vector<std::unique_ptr<FileIndexingArbiter>> arbiters);
   static std::unique_ptr<FileIndexingArbiter> createThreadSafeArbiter(std::unique_ptr<FileIndexingArbiter> arbiter);
@@ -43,18 +44,54 @@ inline FileIdentificator& FileIndexingArbiter::fileIdentificator() const
   return m_fileIdentificator;
 }
 
+class FileDecisionBitmap;
+
+/**
+ * \brief arbiter that caches the decisions of another arbiter
+ * 
+ * The cached arbiter must not depend on the translation unit (e.g., 
+ * IndexDirectoryFileIndexingArbiter or IndexFilesMatchingPatternIndexingArbiter)
+ * so that its decision can be computed once per file.
+ * 
+ * Decisions are stored in an atomic bitmap indexed by FileID, so that 
+ * after the first call for a given file, shouldIndex() costs a single bit test.
+ * This arbiter can be used from multiple threads without additional synchronization
+ * provided that the cached arbiter is stateless.
+ */
+class CachingFileIndexingArbiter : public FileIndexingArbiter
+{
+private:
+  std::unique_ptr<FileIndexingArbiter> m_arbiter;
+  std::unique_ptr<FileDecisionBitmap> m_decisions;
+
+public:
+  explicit CachingFileIndexingArbiter(std::unique_ptr<FileIndexingArbiter> arbiter);
+  ~CachingFileIndexingArbiter();
+
+  bool shouldIndex(FileID file, const TranslationUnitIndex* tu) final;
+  bool isThreadSafe() const final;
+};
+
+class FileClaimTable;
+
 /**
  * \brief arbiter for indexing a file only in the first translation unit it is encountered
+ * 
+ * Each file is claimed by a translation unit with a compare-and-swap on 
+ * an atomic slot indexed by FileID, so this arbiter can be used from 
+ * multiple threads without a lock.
  */
 class IndexOnceFileIndexingArbiter : public FileIndexingArbiter
 {
 private:
-  std::map<FileID, const TranslationUnitIndex*> m_translation_units;
+  std::unique_ptr<FileClaimTable> m_claims;
 
 public:
   explicit IndexOnceFileIndexingArbiter(FileIdentificator& fIdentificator);
+  ~IndexOnceFileIndexingArbiter();
 
   bool shouldIndex(FileID file, const TranslationUnitIndex* tu) final;
+  bool isThreadSafe() const final;
 };
 
 /**
@@ -72,10 +109,31 @@ public:
   explicit IndexDirectoryFileIndexingArbiter(FileIdentificator& fIdentificator, const std::string& dir);
 
   bool shouldIndex(FileID file, const TranslationUnitIndex* tu) final;
+  bool isThreadSafe() const final;
 };
 
 bool filename_match(const std::string& filePath, const std::string& fileName);
 
+/**
+ * \brief matches file paths against a list of patterns
+ * 
+ * Each pattern is either a filename or a glob expression (see is_glob_pattern()).
+ * Glob expressions are compiled once in a single GlobMatcher.
+ */
+class FilePathMatcher
+{
+private:
+  GlobMatcher m_globs;
+  std::vector<std::string> m_filenames;
+
+public:
+  FilePathMatcher() = default;
+  explicit FilePathMatcher(const std::vector<std::string>& patterns);
+
+  bool empty() const;
+  bool match(const std::string& filePath) const;
+};
+
 /**
  * \brief arbiter for indexing files matching a pattern
  * 
@@ -88,12 +146,13 @@ bool filename_match(const std::string& filePath, const std::string& fileName);
 class IndexFilesMatchingPatternIndexingArbiter : public FileIndexingArbiter
 {
 private:
-  std::vector<std::string> m_patterns;
+  FilePathMatcher m_matcher;
 
 public:
   explicit IndexFilesMatchingPatternIndexingArbiter(FileIdentificator& fIdentificator, const std::vector<std::string>& patterns);
 
   bool shouldIndex(FileID file, const TranslationUnitIndex* tu) final;
+  bool isThreadSafe() const final;
 };
 
 struct CreateIndexingArbiterOptions
@@ -6,18 +6,47 @@
 #define CPPSCANNER_FRONTENDACTIONFACTORY_H
 
 #include "indexer.h"
+#include "indexingprofile.h"
 
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendAction.h>
 #include <clang/Tooling/Tooling.h>
 #include <clang/Index/IndexingAction.h>
 
 namespace cppscanner
 {
 
+/**
+ * \brief a frontend action that instructs the parser to skip function bodies
+ * 
+ * This is used for indexing profiles that do not collect anything from function 
+ * bodies, making parsing significantly faster.
+ * Note that clang still parses the body of constexpr functions and functions
+ * with a deduced return type.
+ */
+class SkipFunctionBodiesFrontendAction : public clang::WrapperFrontendAction
+{
+public:
+  explicit SkipFunctionBodiesFrontendAction(std::unique_ptr<clang::FrontendAction> action) 
+    : clang::WrapperFrontendAction(std::move(action))
+  {
+
+  }
+
+protected:
+  bool BeginInvocation(clang::CompilerInstance& ci) override
+  {
+    ci.getFrontendOpts().SkipFunctionBodies = true;
+    return clang::WrapperFrontendAction::BeginInvocation(ci);
+  }
+};
+
 class IndexingFrontendActionFactory : public clang::tooling::FrontendActionFactory
 {
 private:
   std::shared_ptr<ForwardingIndexDataConsumer> m_IndexDataConsumer;
   bool m_indexLocalSymbols = false;
+  IndexingProfile m_profile = IndexingProfile::Full;
 
 public:
   IndexingFrontendActionFactory(std::shared_ptr<ForwardingIndexDataConsumer> dataConsumer)
@@ -30,20 +59,43 @@ public:
     m_indexLocalSymbols = on;
   }
 
+  void setIndexingProfile(IndexingProfile profile)
+  {
+    m_profile = profile;
+  }
+
+  IndexingProfile indexingProfile() const
+  {
+    return m_profile;
+  }
+
   std::unique_ptr<clang::FrontendAction> create() final
   {
     auto idc = m_IndexDataConsumer;
 
+    idc->indexer().setIndexingProfile(m_profile);
+
+    // local symbols only live in function bodies, which are not indexed 
+    // with the non-full profiles.
+    const bool index_locals = m_indexLocalSymbols && m_profile == IndexingProfile::Full;
+
     clang::index::IndexingOptions opts; // TODO: review which options we should enable
-    opts.IndexFunctionLocals = m_indexLocalSymbols;
+    opts.IndexFunctionLocals = index_locals;
     opts.IndexParametersInDeclarations = false;
-    opts.IndexTemplateParameters = m_indexLocalSymbols;
+    opts.IndexTemplateParameters = index_locals;
 
     opts.ShouldTraverseDecl = [idc](const clang::Decl* decl) -> bool {
       return idc->indexer().ShouldTraverseDecl(decl);
       };
 
-    return clang::index::createIndexingAction(idc, opts);
+    std::unique_ptr<clang::FrontendAction> action = clang::index::createIndexingAction(idc, opts);
+
+    if (m_profile != IndexingProfile::Full)
+    {
+      action = std::make_unique<SkipFunctionBodiesFrontendAction>(std::move(action));
+    }
+
+    return action;
   }
 };
 
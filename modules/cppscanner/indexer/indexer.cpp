@@ -63,6 +63,8 @@ public:
   const std::map<const clang::Decl*, SymbolID>& declarations() const;
 
 protected:
+  Arena& strings() const;
+  std::string_view store(std::string_view str) const;
   std::string getDeclSpelling(const clang::Decl* decl);
   void fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl);
   void fillSymbol(IndexerSymbol& symbol,const clang::IdentifierInfo* name, const clang::MacroInfo* macroInfo);
@@ -315,38 +317,38 @@ std::string computeName(const clang::FunctionDecl& decl, const Indexer& idxr)
   return ret;
 }
 
-void fillEmptyName(IndexerSymbol& symbol, const clang::Decl& decl)
+void fillEmptyName(IndexerSymbol& symbol, const clang::Decl& decl, Arena& arena)
 {
   (void)decl; // we are not going to use 'decl' for now
 
   switch (symbol.kind)
   {
   case SymbolKind::Namespace:
-    symbol.name = "__anonymous_namespace_" + symbol.id.toHex();
+    symbol.name = arena.copy("__anonymous_namespace_" + symbol.id.toHex());
     break;
   case SymbolKind::Lambda:
-    symbol.name = "__lambda_" + symbol.id.toHex();
+    symbol.name = arena.copy("__lambda_" + symbol.id.toHex());
     break;
   case SymbolKind::Struct:
-    symbol.name = "__anonymous_struct_" + symbol.id.toHex();
+    symbol.name = arena.copy("__anonymous_struct_" + symbol.id.toHex());
     break;
   case SymbolKind::Class:
-    symbol.name = "__anonymous_class_" + symbol.id.toHex();
+    symbol.name = arena.copy("__anonymous_class_" + symbol.id.toHex());
     break;
   case SymbolKind::Union:
-    symbol.name = "__anonymous_union_" + symbol.id.toHex();
+    symbol.name = arena.copy("__anonymous_union_" + symbol.id.toHex());
     break;
   case SymbolKind::Enum:
   case SymbolKind::EnumClass:
-    symbol.name = "__anonymous_enum_" + symbol.id.toHex();
+    symbol.name = arena.copy("__anonymous_enum_" + symbol.id.toHex());
     break;
   default:
     break;
   }
 }
-void fillEmptyRecordName(IndexerSymbol& symbol, const clang::RecordDecl& decl)
+void fillEmptyRecordName(IndexerSymbol& symbol, const clang::RecordDecl& decl, Arena& arena)
 {
-  fillEmptyName(symbol, decl);
+  fillEmptyName(symbol, decl, arena);
 }
 
 SymbolCollector::SymbolCollector(Indexer& idxr) : 
@@ -469,6 +471,22 @@ const std::map<const clang::Decl*, SymbolID>& SymbolCollector::declarations() co
   return m_symbolIdCache;
 }
 
+/**
+ * \brief returns the arena in which the strings of the symbols are stored
+ */
+Arena& SymbolCollector::strings() const
+{
+  return m_indexer.getCurrentIndex()->strings;
+}
+
+/**
+ * \brief copies a string in the arena of the current translation unit
+ */
+std::string_view SymbolCollector::store(std::string_view str) const
+{
+  return strings().copy(str);
+}
+
 std::string SymbolCollector::getDeclSpelling(const clang::Decl* decl)
 {
   auto* nd = llvm::dyn_cast<clang::NamedDecl>(decl);
@@ -483,7 +501,7 @@ std::string SymbolCollector::getDeclSpelling(const clang::Decl* decl)
 void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl)
 {
   if (symbol.name.empty()) {
-    symbol.name = getDeclSpelling(decl);
+    symbol.name = store(getDeclSpelling(decl));
   }
 
   clang::index::SymbolInfo info = clang::index::getSymbolInfo(decl);
@@ -507,7 +525,7 @@ void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl)
 
   if (const auto* fun = llvm::dyn_cast<clang::FunctionDecl>(decl)) 
   {
-    symbol.name = computeName(*fun, m_indexer);
+    symbol.name = store(computeName(*fun, m_indexer));
   }
 
   if (info.Properties & (clang::index::SymbolPropertySet)clang::index::SymbolProperty::Local) {
@@ -601,7 +619,7 @@ void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl)
     // so it is expected that fillEmptyRecordName() will always be called
     // for a lambda.
     if (symbol.name.empty()) {
-      fillEmptyRecordName(symbol, *rdecl);
+      fillEmptyRecordName(symbol, *rdecl, strings());
     }
   }
   break;
@@ -617,7 +635,7 @@ void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl)
 
     if (enum_decl->getIntegerTypeSourceInfo()) {
       const clang::QualType underlying_type = enum_decl->getIntegerType();
-      symbol.getExtraInfo<EnumInfo>().underlyingType = prettyPrint(underlying_type, m_indexer);
+      symbol.getExtraInfo<EnumExtraInfo>().underlyingType = store(prettyPrint(underlying_type, m_indexer));
     }
   }
   break;
@@ -625,10 +643,10 @@ void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl)
   {
     const auto* cst = llvm::dyn_cast<clang::EnumConstantDecl>(decl);
 
-    symbol.getExtraInfo<EnumConstantInfo>().value = cst->getInitVal().getExtValue();
+    symbol.getExtraInfo<EnumConstantExtraInfo>().value = cst->getInitVal().getExtValue();
 
     if (cst->getInitExpr()) {
-      symbol.getExtraInfo<EnumConstantInfo>().expression = prettyPrint(cst->getInitExpr(), m_indexer);
+      symbol.getExtraInfo<EnumConstantExtraInfo>().expression = store(prettyPrint(cst->getInitExpr(), m_indexer));
     }
   }
   break;
@@ -638,8 +656,8 @@ void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl)
     read_fdecl_flags(*fdecl);
     check_is_overloaded_operator(*fdecl);
 
-    symbol.getExtraInfo<FunctionInfo>().returnType = prettyPrint(fdecl->getReturnType(), m_indexer);
-    symbol.getExtraInfo<FunctionInfo>().declaration = prettyPrint(*fdecl, m_indexer);
+    symbol.getExtraInfo<FunctionExtraInfo>().returnType = store(prettyPrint(fdecl->getReturnType(), m_indexer));
+    symbol.getExtraInfo<FunctionExtraInfo>().declaration = store(prettyPrint(*fdecl, m_indexer));
   }
   break;
   case clang::Decl::Kind::Field:
@@ -649,28 +667,28 @@ void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl)
     auto* fdecl = llvm::dyn_cast<clang::FieldDecl>(decl);
     symbol.setFlag(VariableInfo::Const, fdecl->getTypeSourceInfo()->getType().isConstQualified());
 
-    auto& varinfo = symbol.getExtraInfo<VariableInfo>();
+    auto& varinfo = symbol.getExtraInfo<VariableExtraInfo>();
 
-    varinfo.type = prettyPrint(fdecl->getTypeSourceInfo(), m_indexer);
+    varinfo.type = store(prettyPrint(fdecl->getTypeSourceInfo(), m_indexer));
 
     if (fdecl->getInClassInitializer() && (symbol.flags & (VariableInfo::Const | VariableInfo::Constexpr))) {
-      varinfo.init = prettyPrint(fdecl->getInClassInitializer(), m_indexer);
+      varinfo.init = store(prettyPrint(fdecl->getInClassInitializer(), m_indexer));
     }
   }
   break;
   case clang::Decl::Kind::Var:
   {
     auto* vardecl = llvm::dyn_cast<clang::VarDecl>(decl);
-    auto& varinfo = symbol.getExtraInfo<VariableInfo>();
+    auto& varinfo = symbol.getExtraInfo<VariableExtraInfo>();
 
     symbol.setFlag(VariableInfo::Const, vardecl->getTypeSourceInfo()->getType().isConstQualified());
     symbol.setFlag(VariableInfo::Constexpr, vardecl->isConstexpr());
     symbol.setFlag(VariableInfo::Static, vardecl->isStaticDataMember());
 
-    varinfo.type = prettyPrint(vardecl->getTypeSourceInfo(), m_indexer);
+    varinfo.type = store(prettyPrint(vardecl->getTypeSourceInfo(), m_indexer));
 
     if (vardecl->getInit() && (symbol.flags & (VariableInfo::Const | VariableInfo::Constexpr))) {
-      varinfo.init = prettyPrint(vardecl->getInit(), m_indexer);
+      varinfo.init = store(prettyPrint(vardecl->getInit(), m_indexer));
     }
   }
   break;
@@ -695,7 +713,7 @@ void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl)
     symbol.setFlag(FunctionInfo::Override, attr_override);
 
     if (symbol.kind == SymbolKind::Method || symbol.kind == SymbolKind::StaticMethod || symbol.kind == SymbolKind::Operator) {
-      symbol.getExtraInfo<FunctionInfo>().returnType = prettyPrint(mdecl->getReturnType(), m_indexer);
+      symbol.getExtraInfo<FunctionExtraInfo>().returnType = store(prettyPrint(mdecl->getReturnType(), m_indexer));
     }
   }
   break;
@@ -704,13 +722,13 @@ void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl)
     auto* parmdecl = llvm::dyn_cast<clang::ParmVarDecl>(decl);
     symbol.setFlag(VariableInfo::Const, parmdecl->getTypeSourceInfo()->getType().isConstQualified());
 
-    auto& info = symbol.getExtraInfo<ParameterInfo>();
-    info.type = prettyPrint(parmdecl->getTypeSourceInfo()->getType(), m_indexer);
+    auto& info = symbol.getExtraInfo<ParameterExtraInfo>();
+    info.type = store(prettyPrint(parmdecl->getTypeSourceInfo()->getType(), m_indexer));
     info.parameterIndex = parmdecl->getFunctionScopeIndex(); 
     
     if (parmdecl->hasDefaultArg()) {
       if (!parmdecl->hasUninstantiatedDefaultArg()) {
-        info.defaultValue = prettyPrint(parmdecl->getDefaultArg(), m_indexer);
+        info.defaultValue = store(prettyPrint(parmdecl->getDefaultArg(), m_indexer));
       }
     }
   }
@@ -719,11 +737,11 @@ void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl)
   {
     auto* parmdecl = llvm::dyn_cast<clang::TemplateTypeParmDecl>(decl);
 
-    auto& info = symbol.getExtraInfo<ParameterInfo>();
+    auto& info = symbol.getExtraInfo<ParameterExtraInfo>();
     info.parameterIndex = parmdecl->getIndex();
 
     if (parmdecl->hasDefaultArgument()) {
-      info.defaultValue = prettyPrint(parmdecl->getDefaultArgument(), m_indexer);
+      info.defaultValue = store(prettyPrint(parmdecl->getDefaultArgument(), m_indexer));
     }
   }
   break;
@@ -731,15 +749,15 @@ void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl)
   {
     auto* parmdecl = llvm::dyn_cast<clang::NonTypeTemplateParmDecl>(decl);
 
-    auto& info = symbol.getExtraInfo<ParameterInfo>();
+    auto& info = symbol.getExtraInfo<ParameterExtraInfo>();
     info.parameterIndex = parmdecl->getIndex();
 
     if (parmdecl->getTypeSourceInfo()) {
-      info.type = prettyPrint(parmdecl->getTypeSourceInfo(), m_indexer);
+      info.type = store(prettyPrint(parmdecl->getTypeSourceInfo(), m_indexer));
     }
 
     if (parmdecl->hasDefaultArgument()) {
-      info.defaultValue = prettyPrint(parmdecl->getDefaultArgument(), m_indexer);
+      info.defaultValue = store(prettyPrint(parmdecl->getDefaultArgument(), m_indexer));
     }
   }
   break;
@@ -755,13 +773,15 @@ void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl)
   {
     auto* nsalias = llvm::dyn_cast<clang::NamespaceAliasDecl>(decl);
 
-    auto& info = symbol.getExtraInfo<NamespaceAliasInfo>();
+    auto& info = symbol.getExtraInfo<NamespaceAliasExtraInfo>();
+    std::string value;
 
     if (auto* qual = nsalias->getQualifier()) {
-      info.value = prettyPrint(*qual, m_indexer);
+      value = prettyPrint(*qual, m_indexer);
     }
 
-    info.value += nsalias->getNamespace()->getName().str();
+    value += nsalias->getNamespace()->getName().str();
+    info.value = store(value);
     // TODO: ideally, we would like to save the id of the target namespace, 
     // not just the string representation of it.
   }
@@ -798,20 +818,20 @@ void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Decl* decl)
   }
 
   if (symbol.name.empty()) {
-    fillEmptyName(symbol, *decl);
+    fillEmptyName(symbol, *decl, strings());
   }
 }
 
 void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::IdentifierInfo* name, const clang::MacroInfo* macroInfo)
 {
-  symbol.name = name->getName().str();
+  symbol.name = store(name->getName());
   symbol.kind = SymbolKind::Macro;
 }
 
 void SymbolCollector::fillSymbol(IndexerSymbol& symbol, const clang::Module* moduleInfo)
 {
   symbol.kind = SymbolKind::Module;
-  symbol.name = moduleInfo->Name;
+  symbol.name = store(moduleInfo->Name);
 }
 
 IndexerSymbol* SymbolCollector::getParentSymbol(const IndexerSymbol& symbol, const clang::Decl* decl)
@@ -1109,6 +1129,24 @@ FileIdentificator& Indexer::fileIdentificator()
   return m_fileIdentificator;
 }
 
+/**
+ * \brief sets the indexing profile
+ * \param profile  the profile
+ * 
+ * The profile must be set before the translation unit is indexed.
+ * Note that the Indexer only filters the symbol references it receives, 
+ * IndexingFrontendActionFactory is responsible for skipping function bodies.
+ */
+void Indexer::setIndexingProfile(IndexingProfile profile)
+{
+  m_profile = profile;
+}
+
+IndexingProfile Indexer::indexingProfile() const
+{
+  return m_profile;
+}
+
 SymbolCollector& Indexer::symbolCollector() const
 {
   return *m_symbolCollector;
@@ -1156,7 +1194,7 @@ bool Indexer::shouldIndexFile(clang::FileID fileId)
   m_ShouldIndexFileCache[fileId] = ok;
 
   if (ok) {
-    getCurrentIndex()->indexedFiles.insert(fid);
+    getCurrentIndex()->indexedFiles.push_back(fid);
   }
 
   return ok;
@@ -1268,6 +1306,20 @@ bool Indexer::handleDeclOccurrence(const clang::Decl* decl, clang::index::Symbol
     return true;
   }
 
+  if (!shouldRecordReference(roles, astNode)) 
+  {
+    // the reference itself is not recorded, but base classes and overrides
+    // are part of the outline of a class.
+    if (!relations.empty()) 
+    {
+      if (IndexerSymbol* symbol = symbolCollector().process(decl)) {
+        processRelations(std::pair(decl, symbol), loc, relations);
+      }
+    }
+
+    return true;
+  }
+
   IndexerSymbol* symbol = symbolCollector().process(decl);
 
   if (!symbol)
@@ -1355,6 +1407,17 @@ bool Indexer::handleMacroOccurrence(const clang::IdentifierInfo* name,
     return true;
   }
 
+  if (m_profile == IndexingProfile::Outline) 
+  {
+    // macro expansions are not part of the outline.
+    // note: the declarations profile keeps all the expansions, as macros
+    // are reported by the preprocessor, without any enclosing DeclContext
+    // to tell whether they are in the scope of a function.
+    if (!(roles & ((int)clang::index::SymbolRole::Declaration | (int)clang::index::SymbolRole::Definition))) {
+      return true;
+    }
+  }
+
   IndexerSymbol* symbol = symbolCollector().process(name, macroInfo);
 
   if (!symbol)
@@ -1365,7 +1428,8 @@ bool Indexer::handleMacroOccurrence(const clang::IdentifierInfo* name,
       const clang::Token& first_token = macroInfo->tokens().front();
       const clang::Token& last_token = macroInfo->tokens().back();
       auto range = clang::CharSourceRange::getCharRange(first_token.getLocation(), last_token.getEndLoc());
-      symbol->getExtraInfo<MacroInfo>().definition = clang::Lexer::getSourceText(range, getSourceManager(), getAstContext()->getLangOpts()).str();
+      llvm::StringRef definition = clang::Lexer::getSourceText(range, getSourceManager(), getAstContext()->getLangOpts());
+      symbol->getExtraInfo<MacroExtraInfo>().definition = getCurrentIndex()->strings.copy(definition);
     }
   }
 
@@ -1546,7 +1610,7 @@ static void markImplicitReferences(TranslationUnitIndex& index, std::vector<Symb
   // - if only one symbol name matches, we mark all other references
   //   as implicit.
 
-  std::string file = indexer.fileIdentificator().getFile(begin->fileID);
+  const std::string file = indexer.fileIdentificator().getFile(begin->fileID);
   int line = begin->position.line();
   int col = begin->position.column();
 
@@ -1582,23 +1646,30 @@ static void markImplicitReferences(TranslationUnitIndex& index, std::vector<Symb
 
 static void markImplicitReferences(TranslationUnitIndex& index, Indexer& indexer)
 {
-  std::vector<SymbolReference>& refs = index.symReferences;
-
-  auto same_loc = [](const SymbolReference& a, const SymbolReference& b) {
-    return a.fileID == b.fileID && a.position == b.position;
-    };
+  SymbolReferenceTable& refs = index.symReferences;
+  std::vector<SymbolReference> group;
 
-  auto it = std::adjacent_find(refs.begin(), refs.end(), same_loc);
+  size_t i = 0;
 
-  while (it != refs.end())
+  while (i < refs.size())
   {
-    auto end = std::find_if(it, refs.end(), [&it, &same_loc](const SymbolReference& other) {
-      return !same_loc(*it, other);
-      });
+    // references at the same location have the same key
+    size_t end = i + 1;
+    while (end < refs.size() && refs.key(end) == refs.key(i)) {
+      ++end;
+    }
 
-    markImplicitReferences(index, it, end, indexer);
+    if (end - i > 1)
+    {
+      group = refs.toVector(i, end);
+      markImplicitReferences(index, group.begin(), group.end(), indexer);
 
-    it = std::adjacent_find(end, refs.end(), same_loc);
+      for (size_t k(0); k < group.size(); ++k) {
+        refs.set(i + k, group[k]);
+      }
+    }
+
+    i = end;
   }
 }
 
@@ -1609,6 +1680,9 @@ void Indexer::finish()
   }
 
   // collect ref args
+  // note: arguments are (almost) only passed in function bodies, so we only 
+  // do this with the full profile.
+  if (m_profile == IndexingProfile::Full)
   {
     ClangAstVisitor visitor{ *this };
     visitor.TraverseDecl(getAstContext()->getTranslationUnitDecl());
@@ -1620,8 +1694,14 @@ void Indexer::finish()
   clang::DiagnosticConsumer* dc = de.getClient();
   (void)dc;
 
-  sortAndRemoveDuplicates(m_index->symReferences);
-  markImplicitReferences(*m_index, *this);
+  sortAndRemoveDuplicates(m_index->indexedFiles);
+  m_index->symReferences.sortAndRemoveDuplicates();
+
+  // with the outline profile, only declarations are recorded so there
+  // isn't much to disambiguate.
+  if (m_profile != IndexingProfile::Outline) {
+    markImplicitReferences(*m_index, *this);
+  }
 
   recordSymbolDeclarations();
 
@@ -1709,6 +1789,46 @@ AccessSpecifier tr(const clang::AccessSpecifier access)
 
 } // namespace
 
+static bool isInFunctionScope(const clang::DeclContext* dc)
+{
+  for (; dc; dc = dc->getParent())
+  {
+    if (dc->isFunctionOrMethod()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * \brief returns whether a decl occurrence should produce a SymbolReference
+ * \param roles    the roles of the occurrence
+ * \param astNode  the ast node info of the occurrence
+ * 
+ * This depends on the indexing profile:
+ * - Full: all occurrences are recorded;
+ * - Declarations: occurrences within the scope of a function are discarded;
+ * - Outline: only declarations and definitions are recorded.
+ * Macro occurrences are filtered by handleMacroOccurrence().
+ */
+bool Indexer::shouldRecordReference(clang::index::SymbolRoleSet roles, const clang::index::IndexDataConsumer::ASTNodeInfo& astNode) const
+{
+  constexpr auto declOrDef = (clang::index::SymbolRoleSet)clang::index::SymbolRole::Declaration 
+    | (clang::index::SymbolRoleSet)clang::index::SymbolRole::Definition;
+
+  switch (m_profile)
+  {
+  case IndexingProfile::Outline:
+    return roles & declOrDef;
+  case IndexingProfile::Declarations:
+    return (roles & declOrDef) || !isInFunctionScope(astNode.ContainerDC);
+  case IndexingProfile::Full:
+  default:
+    return true;
+  }
+}
+
 void Indexer::processRelations(std::pair<const clang::Decl*, IndexerSymbol*> declAndSymbol, clang::SourceLocation refLocation, llvm::ArrayRef<clang::index::SymbolRelation> relations)
 {
   for (const clang::index::SymbolRelation& rel : relations)
@@ -5,6 +5,7 @@
 #ifndef CPPSCANNER_INDEXER_H
 #define CPPSCANNER_INDEXER_H
 
+#include "indexingprofile.h"
 #include "translationunitindex.h"
 
 #include "cppscanner/index/fileid.h"
@@ -74,6 +75,9 @@ class SymbolCollector;
  * - visit the ast to list places where arguments are passed by reference,
  * - and collect the precise location of some symbol's declarations.
  *
+ * The amount of information that is collected depends on the IndexingProfile
+ * (see setIndexingProfile()).
+ *
  * Compiler diagnostics can be passed to the HandleDiagnostic() function.
  * The getOrCreateDiagnosticConsumer() function returns a diagnostic consumer
  * that forwards diagnostics to the Indexer.
@@ -88,6 +92,7 @@ private:
   clang::ASTContext* mAstContext = nullptr;
   std::shared_ptr<clang::Preprocessor> m_pp;
   std::unique_ptr<TranslationUnitIndex> m_index;
+  IndexingProfile m_profile = IndexingProfile::Full;
   std::map<clang::FileID, bool> m_ShouldIndexFileCache;
   std::map<clang::FileID, cppscanner::FileID> m_FileIdCache;
 
@@ -98,6 +103,9 @@ public:
 
   FileIdentificator& fileIdentificator();
 
+  void setIndexingProfile(IndexingProfile profile);
+  IndexingProfile indexingProfile() const;
+
   clang::DiagnosticConsumer* getOrCreateDiagnosticConsumer();
 
   TranslationUnitIndex* getCurrentIndex() const;
@@ -139,6 +147,7 @@ protected:
   clang::SourceManager& getSourceManager() const;
 
 protected:
+  bool shouldRecordReference(clang::index::SymbolRoleSet roles, const clang::index::IndexDataConsumer::ASTNodeInfo& astNode) const;
   void processRelations(std::pair<const clang::Decl*, IndexerSymbol*> declAndSymbol, clang::SourceLocation refLocation, llvm::ArrayRef<clang::index::SymbolRelation> relations);
   void indexPreprocessingRecord(clang::Preprocessor& pp);
   void recordSymbolDeclarations();
@@ -0,0 +1,116 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "indexersymboltable.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace cppscanner
+{
+
+void IndexerSymbolTable::clear()
+{
+  m_chunks.clear();
+  m_ids.clear();
+  m_table.clear();
+}
+
+size_t IndexerSymbolTable::findSlot(const SymbolID& id) const
+{
+  const size_t mask = m_table.size() - 1;
+
+  for (size_t i = hashSymbolId(id) & mask; ; i = (i + 1) & mask)
+  {
+    const uint32_t entry = m_table[i];
+
+    if (entry == 0 || m_ids[entry - 1] == id) {
+      return i;
+    }
+  }
+}
+
+/**
+ * \brief returns the symbol with the given id, if any
+ */
+IndexerSymbol* IndexerSymbolTable::find(const SymbolID& id)
+{
+  return const_cast<IndexerSymbol*>(static_cast<const IndexerSymbolTable*>(this)->find(id));
+}
+
+const IndexerSymbol* IndexerSymbolTable::find(const SymbolID& id) const
+{
+  if (m_table.empty()) {
+    return nullptr;
+  }
+
+  const uint32_t entry = m_table[findSlot(id)];
+  return entry ? &at(entry - 1) : nullptr;
+}
+
+/**
+ * \brief returns the index of the symbol with the given id, if any
+ *
+ * Symbols are indexed in insertion order, see at().
+ */
+std::optional<size_t> IndexerSymbolTable::indexOf(const SymbolID& id) const
+{
+  if (m_table.empty()) {
+    return std::nullopt;
+  }
+
+  const uint32_t entry = m_table[findSlot(id)];
+  return entry ? std::optional<size_t>(entry - 1) : std::nullopt;
+}
+
+void IndexerSymbolTable::grow()
+{
+  m_table.assign(m_table.empty() ? 2 * FirstChunkSize : 2 * m_table.size(), 0);
+
+  for (size_t i(0); i < m_ids.size(); ++i) {
+    m_table[findSlot(m_ids[i])] = uint32_t(i + 1);
+  }
+}
+
+/**
+ * \brief returns the symbol with the given id, creating it if needed
+ * \param id  the id of the symbol
+ *
+ * Returns a pointer to the symbol and whether it was inserted.
+ * A newly inserted symbol is default-constructed, except for its id.
+ */
+std::pair<IndexerSymbol*, bool> IndexerSymbolTable::insert(const SymbolID& id)
+{
+  // keep the load factor below 1/2
+  if (2 * (size() + 1) > m_table.size()) {
+    grow();
+  }
+
+  const size_t slot = findSlot(id);
+
+  if (m_table[slot]) {
+    return { &at(m_table[slot] - 1), false };
+  }
+
+  const size_t index = size();
+
+  if (index >= std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("too many symbols");
+  }
+
+  auto [k, offset] = locate(index);
+
+  if (k == m_chunks.size()) {
+    m_chunks.push_back(std::make_unique<IndexerSymbol[]>(FirstChunkSize << k));
+  }
+
+  IndexerSymbol& symbol = m_chunks[k][offset];
+  symbol.id = id;
+  m_ids.push_back(id);
+  m_table[slot] = uint32_t(index + 1);
+
+  return { &symbol, true };
+}
+
+} // namespace cppscanner
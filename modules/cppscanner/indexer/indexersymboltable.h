@@ -0,0 +1,109 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_INDEXERSYMBOLTABLE_H
+#define CPPSCANNER_INDEXERSYMBOLTABLE_H
+
+#include "cppscanner/snapshot/indexersymbol.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace cppscanner
+{
+
+/**
+ * \brief a hash table of IndexerSymbol, indexed by id
+ *
+ * Symbols are stored in insertion order in chunks of increasing size
+ * that are never reallocated, so that pointers to symbols stay valid
+ * when new symbols are inserted.
+ * Symbols are found through an open-addressing table of indices, which
+ * avoids the per-entry allocation and the pointer chasing of a std::map.
+ *
+ * Moving a table only moves a few pointers; tables cannot be copied as
+ * the strings of the symbols are owned by an Arena.
+ */
+class IndexerSymbolTable
+{
+public:
+  IndexerSymbolTable() = default;
+  IndexerSymbolTable(const IndexerSymbolTable&) = delete;
+  IndexerSymbolTable(IndexerSymbolTable&&) noexcept = default;
+  ~IndexerSymbolTable() = default;
+
+  size_t size() const;
+  bool empty() const;
+  void clear();
+
+  IndexerSymbol* find(const SymbolID& id);
+  const IndexerSymbol* find(const SymbolID& id) const;
+  std::optional<size_t> indexOf(const SymbolID& id) const;
+
+  std::pair<IndexerSymbol*, bool> insert(const SymbolID& id);
+  IndexerSymbol& operator[](const SymbolID& id);
+
+  IndexerSymbol& at(size_t i);
+  const IndexerSymbol& at(size_t i) const;
+
+  IndexerSymbolTable& operator=(const IndexerSymbolTable&) = delete;
+  IndexerSymbolTable& operator=(IndexerSymbolTable&&) noexcept = default;
+
+private:
+  static constexpr size_t FirstChunkSize = 64;
+  static std::pair<size_t, size_t> locate(size_t i);
+  size_t findSlot(const SymbolID& id) const;
+  void grow();
+
+private:
+  std::vector<std::unique_ptr<IndexerSymbol[]>> m_chunks; // chunk k has size FirstChunkSize * 2^k
+  std::vector<SymbolID> m_ids; // index -> id
+  std::vector<uint32_t> m_table; // index + 1, zero marks an empty slot
+};
+
+inline size_t IndexerSymbolTable::size() const
+{
+  return m_ids.size();
+}
+
+inline bool IndexerSymbolTable::empty() const
+{
+  return m_ids.empty();
+}
+
+inline std::pair<size_t, size_t> IndexerSymbolTable::locate(size_t i)
+{
+  size_t j = i / FirstChunkSize + 1;
+  size_t k = 0;
+
+  while (j >>= 1) {
+    ++k;
+  }
+
+  return { k, i - FirstChunkSize * ((size_t(1) << k) - 1) };
+}
+
+inline IndexerSymbol& IndexerSymbolTable::operator[](const SymbolID& id)
+{
+  return *insert(id).first;
+}
+
+inline IndexerSymbol& IndexerSymbolTable::at(size_t i)
+{
+  auto [k, offset] = locate(i);
+  return m_chunks[k][offset];
+}
+
+inline const IndexerSymbol& IndexerSymbolTable::at(size_t i) const
+{
+  auto [k, offset] = locate(i);
+  return m_chunks[k][offset];
+}
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_INDEXERSYMBOLTABLE_H
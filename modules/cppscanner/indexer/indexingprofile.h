@@ -0,0 +1,63 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_INDEXINGPROFILE_H
+#define CPPSCANNER_INDEXINGPROFILE_H
+
+#include <initializer_list>
+#include <optional>
+#include <string_view>
+
+namespace cppscanner
+{
+
+/**
+ * \brief controls how much information is collected while indexing a translation unit
+ */
+enum class IndexingProfile
+{
+  /**
+   * only declarations and definitions are recorded ; function bodies are
+   * skipped by the parser, no cross-references and no "argument passed by reference"
+   * annotations are produced.
+   */
+  Outline,
+  /**
+   * same as Outline, but cross-references at namespace and class scope
+   * (e.g., base classes, types of fields and function signatures) are recorded.
+   * Macro expansions are recorded wherever they occur.
+   */
+  Declarations,
+  /**
+   * everything is indexed (this is the default)
+   */
+  Full,
+};
+
+inline std::string_view getIndexingProfileString(IndexingProfile p)
+{
+  switch (p)
+  {
+  case IndexingProfile::Outline:      return "outline";
+  case IndexingProfile::Declarations: return "declarations";
+  case IndexingProfile::Full:         return "full";
+  default:                            return "full";
+  }
+}
+
+inline std::optional<IndexingProfile> parseIndexingProfile(std::string_view str)
+{
+  for (IndexingProfile p : { IndexingProfile::Outline, IndexingProfile::Declarations, IndexingProfile::Full })
+  {
+    if (getIndexingProfileString(p) == str) {
+      return p;
+    }
+  }
+
+  return std::nullopt;
+}
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_INDEXINGPROFILE_H
@@ -17,7 +17,6 @@
 
 #include "cppscanner/database/transaction.h"
 
-#include "cppscanner/base/glob.h"
 #include "cppscanner/base/os.h"
 #include "cppscanner/base/version.h"
 
@@ -64,10 +63,20 @@ struct ScannerData
   std::optional<std::string> rootDirectory;
   bool indexExternalFiles = false;
   bool indexLocalSymbols = false;
+  IndexingProfile indexingProfile = IndexingProfile::Full;
   size_t nbThreads = 0;
   std::vector<std::string> filters;
   std::vector<std::string> translationUnitFilters;
+  FilePathMatcher translationUnitMatcher;
   bool captureFileContent = true;
+  bool bulkLoad = false;
+  GroupCommitPolicy groupCommit;
+  DatabaseProfile databaseProfile = DatabaseProfile::Default;
+  FileContentCodec fileContentCodec = FileContentCodec::None;
+  std::filesystem::path blobStorePath;
+  bool createSymbolSearchIndex = false;
+  bool createFileAnnotations = false;
+  bool createReferencePostings = false;
   bool remapFileIds = false;
   Snapshot::Properties extraSnapshotProperties;
 
@@ -79,7 +88,6 @@ struct ScannerData
   std::unique_ptr<FileIdentificator> fileIdentificator;
   std::vector<bool> filePathsInserted;
   std::vector<bool> indexedFiles;
-  std::map<SymbolID, IndexerSymbol> symbols;
 };
 
 static std::unique_ptr<FileIndexingArbiter> createIndexingArbiter(ScannerData& d)
@@ -167,6 +175,11 @@ void Scanner::setIndexLocalSymbols(bool on)
   d->indexLocalSymbols = on;
 }
 
+void Scanner::setIndexingProfile(IndexingProfile profile)
+{
+  d->indexingProfile = profile;
+}
+
 void Scanner::setFilters(const std::vector<std::string>& filters)
 {
   d->filters = filters;
@@ -175,6 +188,7 @@ void Scanner::setFilters(const std::vector<std::string>& filters)
 void Scanner::setTranslationUnitFilters(const std::vector<std::string>& filters)
 {
   d->translationUnitFilters = filters;
+  d->translationUnitMatcher = FilePathMatcher(filters);
 }
 
 void Scanner::setNumberOfParsingThread(size_t n)
@@ -187,6 +201,46 @@ void Scanner::setCaptureFileContent(bool on)
   d->captureFileContent = on;
 }
 
+void Scanner::setBulkLoad(bool on)
+{
+  d->bulkLoad = on;
+}
+
+void Scanner::setGroupCommitPolicy(const GroupCommitPolicy& policy)
+{
+  d->groupCommit = policy;
+}
+
+void Scanner::setDatabaseProfile(DatabaseProfile profile)
+{
+  d->databaseProfile = profile;
+}
+
+void Scanner::setFileContentCodec(FileContentCodec codec)
+{
+  d->fileContentCodec = codec;
+}
+
+void Scanner::setBlobStore(const std::filesystem::path& p)
+{
+  d->blobStorePath = p;
+}
+
+void Scanner::setCreateSymbolSearchIndex(bool on)
+{
+  d->createSymbolSearchIndex = on;
+}
+
+void Scanner::setCreateFileAnnotations(bool on)
+{
+  d->createFileAnnotations = on;
+}
+
+void Scanner::setCreateReferencePostings(bool on)
+{
+  d->createReferencePostings = on;
+}
+
 void Scanner::setRemapFileIds(bool on)
 {
   d->remapFileIds = on;
@@ -214,12 +268,34 @@ void Scanner::initSnapshot()
 
   m_snapshot_creator->setHomeDir(d->homeDirectory);
   m_snapshot_creator->setCaptureFileContent(d->captureFileContent);
+  m_snapshot_creator->setBulkLoad(d->bulkLoad);
+  m_snapshot_creator->setGroupCommitPolicy(d->groupCommit);
+  m_snapshot_creator->setFileContentCodec(d->fileContentCodec);
+
+  if (!d->blobStorePath.empty()) {
+    m_snapshot_creator->setBlobStore(d->blobStorePath);
+  }
+
+  // with remapped file ids, the snapshot is published by the merge that 
+  // produces the final output
+  if (d->remapFileIds && d->databaseProfile == DatabaseProfile::Publish) {
+    m_snapshot_creator->setDatabaseProfile(DatabaseProfile::Build);
+  } else {
+    m_snapshot_creator->setDatabaseProfile(d->databaseProfile);
+  }
+
+  // likewise, the search index, the file annotations and the posting lists 
+  // are only needed in the final output
+  m_snapshot_creator->setCreateSymbolSearchIndex(d->createSymbolSearchIndex && !d->remapFileIds);
+  m_snapshot_creator->setCreateFileAnnotations(d->createFileAnnotations && !d->remapFileIds);
+  m_snapshot_creator->setCreateReferencePostings(d->createReferencePostings && !d->remapFileIds);
 
   m_snapshot_creator->init(dbPath);
 
   // TODO: revoir le passage de la valeur
   m_snapshot_creator->writeProperty("scanner.indexExternalFiles", d->indexExternalFiles ? "true" : "false");
   m_snapshot_creator->writeProperty("scanner.indexLocalSymbols", d->indexLocalSymbols ? "true" : "false");
+  m_snapshot_creator->writeProperty("scanner.indexingProfile", std::string(getIndexingProfileString(d->indexingProfile)));
   m_snapshot_creator->writeProperty("scanner.root", Snapshot::Path(d->rootDirectory.value_or(std::string())).str());
   m_snapshot_creator->writeProperty("scanner.workingDirectory", Snapshot::Path(std::filesystem::current_path().generic_u8string()).str());
 
@@ -241,13 +317,9 @@ SnapshotCreator* Scanner::snapshotCreator() const
 
 bool Scanner::passTranslationUnitFilters(const std::string& filename) const
 {
-  if (!d->translationUnitFilters.empty())
+  if (!d->translationUnitMatcher.empty())
   {
-    bool exclude = std::none_of(d->translationUnitFilters.begin(), d->translationUnitFilters.end(), [&filename](const std::string& e) {
-      return is_glob_pattern(e) ? glob_match(filename, e) : filename_match(filename, e);
-      });
-
-    return !exclude;
+    return d->translationUnitMatcher.match(filename);
   }
 
   return true;
@@ -677,6 +749,7 @@ void parsing_thread_proc(ScannerData* data, FileIndexingArbiter* arbiter, WorkQu
   auto index_data_consumer = std::make_shared<ThreadProcIndexDataConsumer>(indexer, *resultQueue);
   IndexingFrontendActionFactory actionfactory{ index_data_consumer };
   actionfactory.setIndexLocalSymbols(data->indexLocalSymbols);
+  actionfactory.setIndexingProfile(data->indexingProfile);
 
   for (;;)
   {
@@ -770,6 +843,7 @@ void Scanner::scanMultiThreaded()
 
   if (d->nbThreads > 1)
   {
+    // note: the default arbiter is already thread-safe, no lock is added
     indexing_arbiter = FileIndexingArbiter::createThreadSafeArbiter(std::move(indexing_arbiter));
   }
 
@@ -864,6 +938,15 @@ void Scanner::runScanSingleOrMultiThreaded()
     merger.setOutputPath(d->outputPath);
     merger.setProjectHome(d->homeDirectory);
     merger.addInputPath(tmp_path);
+    merger.setDatabaseProfile(d->databaseProfile);
+    merger.setFileContentCodec(d->fileContentCodec);
+    merger.setCreateSymbolSearchIndex(d->createSymbolSearchIndex);
+    merger.setCreateFileAnnotations(d->createFileAnnotations);
+    merger.setCreateReferencePostings(d->createReferencePostings);
+
+    if (!d->blobStorePath.empty()) {
+      merger.setBlobStore(d->blobStorePath);
+    }
 
     m_snapshot_creator.reset();
 
@@ -871,6 +954,12 @@ void Scanner::runScanSingleOrMultiThreaded()
 
     std::filesystem::remove(tmp_path);
   }
+  else
+  {
+    // closing explicitly rather than in the destructor lets errors
+    // that occur while publishing the snapshot propagate
+    m_snapshot_creator->close();
+  }
 }
 
 void Scanner::processCommands(const std::vector<ScannerCompileCommand>& commands, FileIndexingArbiter& arbiter, clang::FileManager& fileManager)
@@ -880,6 +969,7 @@ void Scanner::processCommands(const std::vector<ScannerCompileCommand>& commands
   Indexer indexer{ arbiter };
   IndexingFrontendActionFactory actionfactory{ std::make_shared<ForwardingIndexDataConsumer>(&indexer) };
   actionfactory.setIndexLocalSymbols(d->indexLocalSymbols);
+  actionfactory.setIndexingProfile(d->indexingProfile);
 
   for (const ScannerCompileCommand& cc : commands)
   {
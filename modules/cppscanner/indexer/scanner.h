@@ -5,6 +5,7 @@
 #ifndef CPPSCANNER_SCANNER_H
 #define CPPSCANNER_SCANNER_H
 
+#include "indexingprofile.h"
 #include "snapshotcreator.h"
 
 #include <filesystem>
@@ -54,6 +55,7 @@ public:
 
   void setIndexExternalFiles(bool on = true);
   void setIndexLocalSymbols(bool on = true);
+  void setIndexingProfile(IndexingProfile profile);
 
   void setFilters(const std::vector<std::string>& filters);
   void setTranslationUnitFilters(const std::vector<std::string>& filters);
@@ -61,6 +63,14 @@ public:
   void setNumberOfParsingThread(size_t n);
 
   void setCaptureFileContent(bool on = true);
+  void setBulkLoad(bool on = true);
+  void setGroupCommitPolicy(const GroupCommitPolicy& policy);
+  void setDatabaseProfile(DatabaseProfile profile);
+  void setFileContentCodec(FileContentCodec codec);
+  void setBlobStore(const std::filesystem::path& p);
+  void setCreateSymbolSearchIndex(bool on = true);
+  void setCreateFileAnnotations(bool on = true);
+  void setCreateReferencePostings(bool on = true);
   void setRemapFileIds(bool on);
 
   void setExtraProperty(const std::string& name, const std::string& value);
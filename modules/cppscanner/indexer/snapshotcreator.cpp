@@ -4,46 +4,113 @@
 
 #include "snapshotcreator.h"
 
+#include "filecontentcapture.h"
 #include "fileidentificator.h"
 #include "fileindexingarbiter.h"
+#include "symbolflagstable.h"
 #include "translationunitindex.h"
 #include "vector-of-bool.h"
 
 #include "cppscanner/database/transaction.h"
 
-#include "cppscanner/base/glob.h"
 #include "cppscanner/base/os.h"
+#include "cppscanner/base/sortedspool.h"
 #include "cppscanner/base/version.h"
 
-#include <llvm/ADT/ArrayRef.h>
-#include <llvm/ADT/StringExtras.h> // toHex
-#include <llvm/Support/SHA1.h>
-
 #include <algorithm>
-#include <fstream>
+#include <cassert>
 #include <iostream>
 #include <optional>
+#include <tuple>
 #include <vector>
 
 namespace cppscanner
 {
 
+// The following orders match the primary key or UNIQUE constraints of the
+// corresponding tables so that spooled rows are inserted in index order.
+
+struct SymbolReferenceLess
+{
+  bool operator()(const SymbolReference& a, const SymbolReference& b) const
+  {
+    return std::forward_as_tuple(a.fileID, a.position, a.symbolID) < std::forward_as_tuple(b.fileID, b.position, b.symbolID);
+  }
+};
+
+struct SymbolDeclarationLess
+{
+  bool operator()(const SymbolDeclaration& a, const SymbolDeclaration& b) const
+  {
+    return std::forward_as_tuple(a.fileID, a.symbolID, a.startPosition.bits(), a.endPosition.bits(), a.isDefinition) <
+      std::forward_as_tuple(b.fileID, b.symbolID, b.startPosition.bits(), b.endPosition.bits(), b.isDefinition);
+  }
+};
+
+/**
+ * \brief spool files used in bulk-load mode
+ * 
+ * The largest tables are not written to the database while scanning but 
+ * appended to these files, then sorted, deduplicated and inserted in a single
+ * ordered pass when the snapshot is closed.
+ */
+struct SnapshotSpools
+{
+  SortedSpool<SymbolReference, SymbolReferenceLess> references;
+  SortedSpool<SymbolDeclaration, SymbolDeclarationLess> declarations;
+  SortedSpool<ArgumentPassedByReference> refargs;
+
+  explicit SnapshotSpools(const std::filesystem::path& dbPath) :
+    references(dbPath.u8string() + ".references.spool"),
+    declarations(dbPath.u8string() + ".declarations.spool"),
+    refargs(dbPath.u8string() + ".refargs.spool")
+  {
+
+  }
+};
+
 struct SnapshotCreatorData
 {
   std::string homeDirectory;
   bool captureFileContent = true;
+  std::unique_ptr<FileContentCapture> contentCapture;
+  bool bulkLoad = false;
+  std::unique_ptr<SnapshotSpools> spools;
+
+  DatabaseProfile databaseProfile = DatabaseProfile::Default;
+  FileContentCodec fileContentCodec = FileContentCodec::None;
+  std::filesystem::path blobStorePath;
+  bool createSymbolSearchIndex = false;
+  bool createFileAnnotations = false;
+  bool createReferencePostings = false;
+  GroupCommitPolicy groupCommit;
+  size_t nbUncommittedTranslationUnits = 0;
+  std::chrono::steady_clock::time_point transactionStart;
 
   std::vector<bool> filePathsInserted;
   std::vector<bool> indexedFiles;
-  std::map<SymbolID, IndexerSymbol> symbols;
+  SymbolFlagsTable symbols; // the symbols already in the database
 };
 
 
+/**
+ * \brief closes the snapshot if close() was not called
+ * 
+ * Errors cannot be reported from the destructor: they are printed on 
+ * the standard error output. Call close() to handle them.
+ */
 SnapshotCreator::~SnapshotCreator()
 {
   if (m_snapshot)
   {
-    close();
+    try
+    {
+      close();
+    }
+    catch (const std::exception& ex)
+    {
+      std::cerr << "error while closing the snapshot: " << ex.what() << std::endl;
+    }
   }
 }
 
@@ -69,209 +136,164 @@ void SnapshotCreator::setCaptureFileContent(bool on)
   d->captureFileContent = on;
 }
 
-
 /**
- * \brief creates an empty snapshot
- * \param dbPath  the path of the database
+ * \brief enables or disables the bulk-load mode
+ * 
+ * In bulk-load mode, symbol references, declarations and arguments passed 
+ * by reference are spooled to temporary files next to the database and only
+ * inserted when the snapshot is closed.
+ * This is much faster for large snapshots, but the database is incomplete
+ * until close() is called.
+ * This must be called before init().
  */
-void SnapshotCreator::init(const std::filesystem::path& dbPath)
+void SnapshotCreator::setBulkLoad(bool on)
 {
-  m_snapshot = std::make_unique<SnapshotWriter>(dbPath);
-
-  m_snapshot->setProperty("cppscanner.version", cppscanner::versioncstr());
-  m_snapshot->setProperty("cppscanner.os", cppscanner::system_name());
-  writeHomeProperty();
+  assert(!m_snapshot);
+  d->bulkLoad = on;
 }
 
-SnapshotWriter* SnapshotCreator::snapshotWriter() const
-{
-  return m_snapshot.get();
-}
 
-void SnapshotCreator::writeProperty(const std::string& name, const std::string& value)
+/**
+ * \brief sets how many translation units are written in a single transaction
+ * 
+ * Each commit waits for the data to reach the disk, so committing after 
+ * every translation unit makes the insertions bound by I/O rather than CPU.
+ * A transaction is committed once it contains policy.maxTranslationUnits 
+ * translation units or has been open for policy.maxDelay, whichever comes
+ * first, and when the snapshot is closed.
+ */
+void SnapshotCreator::setGroupCommitPolicy(const GroupCommitPolicy& policy)
 {
-  m_snapshot->setProperty(name, value);
+  d->groupCommit = policy;
 }
 
-namespace
-{
-
-std::set<FileID> listIncludedFiles(const std::vector<Include>& includes)
-{
-  std::set<FileID> ids;
-  
-  for (const Include& incl : includes) {
-    ids.insert(incl.includedFileID);
-  }
-
-  return ids;
-}
-
-std::vector<Include> merge(
-  std::vector<Include>&& existingIncludes, 
-  std::vector<Include>::const_iterator newIncludesBegin, 
-  std::vector<Include>::const_iterator newIncludesEnd)
+/**
+ * \brief sets the profile used to write the database
+ * 
+ * With DatabaseProfile::Publish, the snapshot is published by close().
+ * This must be called before init().
+ */
+void SnapshotCreator::setDatabaseProfile(DatabaseProfile profile)
 {
-  existingIncludes.insert(existingIncludes.end(), newIncludesBegin, newIncludesEnd);
-
-  auto comp = [](const Include& a, const Include& b) -> bool {
-    return std::forward_as_tuple(a.fileID, a.line) < std::forward_as_tuple(b.fileID, b.line);
-    };
-
-  std::sort(existingIncludes.begin(),  existingIncludes.end(), comp);
-
-  auto eq = [](const Include& a, const Include& b) -> bool {
-    return std::forward_as_tuple(a.fileID, a.line) == std::forward_as_tuple(b.fileID, b.line);
-    };
-
-  auto new_logical_end = std::unique(existingIncludes.begin(), existingIncludes.end(), eq);
-  existingIncludes.erase(new_logical_end, existingIncludes.end());
-
-  return existingIncludes;
+  assert(!m_snapshot);
+  d->databaseProfile = profile;
 }
 
-std::vector<SymbolReference>& insertOrIgnore(
-  std::vector<SymbolReference>& references, 
-  std::vector<SymbolReference>::const_iterator newReferencesBegin, 
-  std::vector<SymbolReference>::const_iterator newReferencesEnd)
+/**
+ * \brief sets the codec used to store the content of files
+ * 
+ * This must be called before init().
+ */
+void SnapshotCreator::setFileContentCodec(FileContentCodec codec)
 {
-  references.insert(references.end(), newReferencesBegin, newReferencesEnd);
-
-  auto ref_comp = [](const SymbolReference& a, const SymbolReference& b) -> bool {
-    return std::forward_as_tuple(a.fileID, a.position, a.symbolID) < std::forward_as_tuple(b.fileID, b.position, b.symbolID);
-    };
-
-  std::sort(references.begin(),  references.end(), ref_comp);
-
-  auto ref_eq = [](const SymbolReference& a, const SymbolReference& b) -> bool {
-    return std::forward_as_tuple(a.fileID, a.position, a.symbolID) == std::forward_as_tuple(b.fileID, b.position, b.symbolID);
-    };
-
-  auto new_logical_end = std::unique(references.begin(), references.end(), ref_eq);
-  references.erase(new_logical_end, references.end());
-
-  return references;
+  assert(!m_snapshot);
+  d->fileContentCodec = codec;
 }
 
-inline FileID fileOf(const Diagnostic& d)
+/**
+ * \brief sets a blob store in which the content of files is written
+ * 
+ * See SnapshotWriter::setBlobStore().
+ * This must be called before init().
+ */
+void SnapshotCreator::setBlobStore(const std::filesystem::path& p)
 {
-  return d.fileID;
+  assert(!m_snapshot);
+  d->blobStorePath = p;
 }
 
-inline FileID fileOf(const SymbolDeclaration& d)
+/**
+ * \brief sets whether the symbol search index is created when the snapshot is closed
+ * 
+ * See SnapshotWriter::createSymbolSearchIndex().
+ */
+void SnapshotCreator::setCreateSymbolSearchIndex(bool on)
 {
-  return d.fileID;
+  d->createSymbolSearchIndex = on;
 }
 
-template<typename T>
-void sortByFile(std::vector<T>& elements)
+/**
+ * \brief sets whether the per-file annotation blobs are created when the snapshot is closed
+ * 
+ * See SnapshotWriter::createFileAnnotations().
+ */
+void SnapshotCreator::setCreateFileAnnotations(bool on)
 {
-  std::sort(
-    elements.begin(), 
-    elements.end(), 
-    [](const T& a, const T& b) -> bool {
-      return fileOf(a) < fileOf(b);
-    }
-  );
+  d->createFileAnnotations = on;
 }
 
-template<typename T>
-typename std::vector<T>::iterator fileRangeEnd(std::vector<T>& elements, typename std::vector<T>::iterator begin)
+/**
+ * \brief sets whether the per-symbol reference posting lists are created when the snapshot is closed
+ * 
+ * See SnapshotWriter::createReferencePostings().
+ */
+void SnapshotCreator::setCreateReferencePostings(bool on)
 {
-  FileID cur_file_id = fileOf(*begin);
-  return std::find_if(std::next(begin), elements.end(),
-    [cur_file_id](const T& element) {
-      return fileOf(element) != cur_file_id;
-    }
-  );
+  d->createReferencePostings = on;
 }
 
-bool mergeComp(const Diagnostic& a, const Diagnostic& b)
+/**
+ * \brief creates an empty snapshot
+ * \param dbPath  the path of the database
+ */
+void SnapshotCreator::init(const std::filesystem::path& dbPath)
 {
-  return std::forward_as_tuple(a.level, a.position, a.message) <
-    std::forward_as_tuple(b.level, b.position, b.message);
-}
+  m_snapshot = std::make_unique<SnapshotWriter>(dbPath, d->databaseProfile);
+  m_snapshot->setFileContentCodec(d->fileContentCodec);
 
-bool mergeComp(const SymbolDeclaration& a, const SymbolDeclaration& b)
-{
-  // we ignore file id because it is assumed they are the same
-  assert(a.fileID == b.fileID);
-  return std::forward_as_tuple(a.symbolID, a.startPosition, a.endPosition, a.isDefinition) <
-    std::forward_as_tuple(b.symbolID, b.startPosition, b.endPosition, b.isDefinition);
-}
+  if (!d->blobStorePath.empty()) {
+    m_snapshot->setBlobStore(d->blobStorePath);
+  }
 
-template<typename T>
-bool mergeEq(const T& a, const T& b)
-{
-  return !mergeComp(a, b) && !mergeComp(b, a);
-}
+  if (d->bulkLoad) {
+    d->spools = std::make_unique<SnapshotSpools>(dbPath);
+  }
 
-template<typename T>
-std::vector<T> merge(
-  std::vector<T>&& existingElements, 
-  typename std::vector<T>::const_iterator newElementsBegin, 
-  typename std::vector<T>::const_iterator newElementsEnd)
-{
-  existingElements.insert(existingElements.end(), newElementsBegin, newElementsEnd);
-  std::sort(existingElements.begin(), existingElements.end(), [](const T& a, const T& b) { return mergeComp(a, b); });
-  auto new_logical_end = std::unique(existingElements.begin(), existingElements.end(), [](const T& a, const T& b) { return mergeEq(a, b); });
-  existingElements.erase(new_logical_end, existingElements.end());
-  return existingElements;
+  m_snapshot->setProperty("cppscanner.version", cppscanner::versioncstr());
+  m_snapshot->setProperty("cppscanner.os", cppscanner::system_name());
+  writeHomeProperty();
 }
 
-void removeCarriageReturns(std::string& text)
+SnapshotWriter* SnapshotCreator::snapshotWriter() const
 {
-#ifndef _WIN32
-  return;
-#endif // !_WIN32
-
-  auto it = std::remove_if(text.begin(), text.end(), [](char c) {
-    return c == '\r';
-    });
-
-  text.erase(it, text.end());
+  return m_snapshot.get();
 }
 
-std::string computeSha1(const std::string& text)
+void SnapshotCreator::writeProperty(const std::string& name, const std::string& value)
 {
-  llvm::SHA1 hasher;
-  hasher.update(text);
-  std::array<uint8_t, 20> result = hasher.final();
-  constexpr bool to_lower_case = true;
-  return llvm::toHex(result, to_lower_case);
+  m_snapshot->setProperty(name, value);
 }
 
-} // namespace
+namespace
+{
 
-void SnapshotCreator::fillContent(File& f)
+std::vector<FileID> listIncludedFiles(const std::vector<Include>& includes)
 {
-  {
-    std::ifstream stream{ f.path };
-    if (stream.good()) 
-    {
-      stream.seekg(0, std::ios::end);
-      f.content.reserve(stream.tellg());
-      stream.seekg(0, std::ios::beg);
-      f.content.assign((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
-    }
+  std::vector<FileID> ids;
+  ids.reserve(includes.size());
+  
+  for (const Include& incl : includes) {
+    ids.push_back(incl.includedFileID);
   }
 
-  if (!f.content.empty())
-  {
-    removeCarriageReturns(f.content);
-    f.sha1 = computeSha1(f.content);
-  }
+  sortAndRemoveDuplicates(ids);
+  return ids;
 }
 
-void SnapshotCreator::feed(const TranslationUnitIndex& tuIndex)
+} // namespace
+
+void SnapshotCreator::fillContent(File& f)
 {
-  TranslationUnitIndex copy = tuIndex;
-  feed(std::move(copy));
+  FileContentCapture::fill(f);
 }
 
 void SnapshotCreator::feed(TranslationUnitIndex&& tuIndex)
 {
-  const std::vector<std::string> known_files = fileIdentificator().getFiles();
+  if (!m_snapshot->inTransaction())
+  {
+    m_snapshot->beginTransaction();
+    d->transactionStart = std::chrono::steady_clock::now();
+  }
 
   std::vector<File> newfiles;
 
@@ -284,19 +306,31 @@ void SnapshotCreator::feed(TranslationUnitIndex&& tuIndex)
 
       File f;
       f.id = fid;
-      f.path = known_files.at(fid);
+      fileIdentificator().getFilePath(fid, f.path);
+      newfiles.push_back(std::move(f));
+    }
 
+    {
       if (d->captureFileContent)
       {
-        fillContent(f);
-      }
+        // the content is read on other threads and written by a later call 
+        // to feed() or by close()
+        m_snapshot->insertFilePaths(newfiles);
 
-      newfiles.push_back(std::move(f));
-    }
+        if (!d->contentCapture) {
+          d->contentCapture = std::make_unique<FileContentCapture>();
+        }
 
-    {
-      sql::TransactionScope transaction{ m_snapshot->database() };
-      m_snapshot->insertFiles(newfiles);
+        for (const File& f : newfiles) {
+          d->contentCapture->submit(f);
+        }
+
+        m_snapshot->insertFiles(d->contentCapture->takeFinished());
+      }
+      else
+      {
+        m_snapshot->insertFiles(newfiles);
+      }
     }
 
     for (const File& f : newfiles) {
@@ -307,7 +341,7 @@ void SnapshotCreator::feed(TranslationUnitIndex&& tuIndex)
   {
     // ensure that included files are listed in the database
     {
-      std::set<FileID> included = listIncludedFiles(tuIndex.ppIncludes);
+      std::vector<FileID> included = listIncludedFiles(tuIndex.ppIncludes);
       std::vector<File> newincludes;
 
       for (FileID fid : included)
@@ -318,189 +352,166 @@ void SnapshotCreator::feed(TranslationUnitIndex&& tuIndex)
 
         File f;
         f.id = fid;
-        f.path = known_files.at(fid);
+        fileIdentificator().getFilePath(fid, f.path);
         newincludes.push_back(std::move(f));
       }
 
-      sql::runTransacted(m_snapshot->database(), [this, &newincludes]() {
-        m_snapshot->insertFilePaths(newincludes);
-        });
+      m_snapshot->insertFilePaths(newincludes);
 
       for (const File& f : newincludes) {
         set_flag(d->filePathsInserted, f.id);
       }
     }
     
-    std::sort(tuIndex.ppIncludes.begin(), tuIndex.ppIncludes.end(), [](const Include& a, const Include& b) {
-      return a.fileID < b.fileID;
-      });
-
-    auto it = tuIndex.ppIncludes.begin();
-
-    while (it != tuIndex.ppIncludes.end()) {
-      FileID cur_file_id = it->fileID;
-      auto end = std::find_if(std::next(it), tuIndex.ppIncludes.end(),
-        [cur_file_id](const Include& element) {
-          return element.fileID != cur_file_id;
-        }
-      );
-
-      if (fileAlreadyIndexed(cur_file_id)) {
-        std::vector<Include> includes = merge(m_snapshot->loadAllIncludesInFile(cur_file_id), it, end);
-
-        sql::runTransacted(m_snapshot->database(), [this, cur_file_id, &includes]() {
-          m_snapshot->removeAllIncludesInFile(cur_file_id);
-          m_snapshot->insertIncludes(includes);
-          });
-      } else {
-        sql::runTransacted(m_snapshot->database(), [this, it, end]() {
-          m_snapshot->insertIncludes(std::vector<Include>(it, end));
-          });
-      }
-
-      it = end;
-    }
+    m_snapshot->insertIncludes(tuIndex.ppIncludes);
   }
 
   // insert new symbols, update the others that need it
   {
+    // only the flags of a symbol are kept once it is written: new symbols
+    // are inserted directly from the translation unit.
     std::vector<const IndexerSymbol*> symbols_to_insert;
-    std::vector<const IndexerSymbol*> symbols_with_flags_to_update;
-
-    for (auto& p : tuIndex.symbols) {
-      auto it = d->symbols.find(p.first);
-      if (it == d->symbols.end()) {
-        IndexerSymbol& newsymbol = d->symbols[p.first];
-        newsymbol = std::move(p.second);
-        symbols_to_insert.push_back(&newsymbol);
-      } else {
-        IndexerSymbol& existing_symbol = it->second;
-        int what_updated = update(existing_symbol, p.second);
-        if (what_updated & IndexerSymbol::FlagUpdate)
-        {
-          symbols_with_flags_to_update.push_back(&existing_symbol);
-        }
+    std::vector<std::pair<SymbolID, int>> symbols_with_flags_to_update;
+
+    for (size_t i(0); i < tuIndex.symbols.size(); ++i) {
+      const IndexerSymbol& symbol = tuIndex.symbols.at(i);
+      auto [flags, inserted] = d->symbols.insert(symbol.id, symbol.flags);
+      if (inserted) {
+        symbols_to_insert.push_back(&symbol);
+      } else if ((*flags | symbol.flags) != *flags) {
+        // TODO: this may not be the right way to update the flags
+        *flags |= symbol.flags;
+        symbols_with_flags_to_update.emplace_back(symbol.id, *flags);
       }
     }
 
-    sql::runTransacted(m_snapshot->database(), [this, &symbols_to_insert, &symbols_with_flags_to_update]() {
-      m_snapshot->insertSymbols(symbols_to_insert);
-      m_snapshot->updateSymbolsFlags(symbols_with_flags_to_update);
-      });
+    m_snapshot->insertSymbols(symbols_to_insert);
+    m_snapshot->updateSymbolsFlags(symbols_with_flags_to_update);
   }
 
-  // Process symbol references
+  if (d->spools)
   {
-    auto it = tuIndex.symReferences.begin();
-
-    while (it != tuIndex.symReferences.end()) {
-      FileID cur_file_id = it->fileID;
-
-      auto end = std::find_if(std::next(it), tuIndex.symReferences.end(),
-        [cur_file_id](const SymbolReference& ref) {
-          return ref.fileID != cur_file_id;
-        }
-      );
-
-      if (fileAlreadyIndexed(cur_file_id)) 
-      {
-        std::vector<SymbolReference> references = m_snapshot->loadSymbolReferencesInFile(cur_file_id);
-        insertOrIgnore(references, it, end);
-
-        {
-          sql::TransactionScope transaction{ m_snapshot->database() };
-          m_snapshot->removeAllSymbolReferencesInFile(cur_file_id);
-          m_snapshot->insert(references);
-        }
-      } 
-      else 
-      {
-        sql::TransactionScope transaction{ m_snapshot->database() };
-        m_snapshot->insert(std::vector<SymbolReference>(it, end));
-      }
-
-      it = end;
+    const SymbolReferenceTable& refs = tuIndex.symReferences;
+    for (size_t i(0); i < refs.size(); ++i) {
+      d->spools->references.append(refs.at(i));
     }
+
+    d->spools->declarations.append(tuIndex.declarations.begin(), tuIndex.declarations.end());
+    d->spools->refargs.append(tuIndex.fileAnnotations.refargs.begin(), tuIndex.fileAnnotations.refargs.end());
   }
 
-  // Process relations
+  // Rows that were already inserted by another translation unit are ignored
+  // by SQLite, see the UNIQUE constraints in the schema.
   {
+    if (!d->spools)
+    {
+      m_snapshot->insert(tuIndex.symReferences.toVector());
+      m_snapshot->insert(tuIndex.fileAnnotations.refargs);
+      m_snapshot->insert(tuIndex.declarations);
+    }
+
     m_snapshot->insertBaseOfs(tuIndex.relations.baseOfs);
     m_snapshot->insertOverrides(tuIndex.relations.overrides);
+    m_snapshot->insertDiagnostics(tuIndex.diagnostics);
   }
 
-  // Process diagnostics
-  {
-    sortByFile(tuIndex.diagnostics);
-
-    for (auto it = tuIndex.diagnostics.begin(); it != tuIndex.diagnostics.end(); ) {
-      FileID cur_file_id = it->fileID;
-      auto end = fileRangeEnd(tuIndex.diagnostics, it);
-
-      if (fileAlreadyIndexed(cur_file_id)) {
-        std::vector<Diagnostic> diagnostics = merge(m_snapshot->loadDiagnosticsInFile(cur_file_id), it, end);
-
-        sql::runTransacted(m_snapshot->database(), [this, cur_file_id, &diagnostics]() {
-          m_snapshot->removeAllDiagnosticsInFile(cur_file_id);
-          m_snapshot->insertDiagnostics(diagnostics);
-          });
-      } else {
-        sql::runTransacted(m_snapshot->database(), [this, it, end]() {
-          m_snapshot->insertDiagnostics(std::vector<Diagnostic>(it, end));
-          });
-      }
-
-      it = end;
-    }
+  // Update list of already indexed files
+  for (const File& f : newfiles) {
+    setFileIndexed(f.id);
   }
 
-  // Process refargs
+  ++d->nbUncommittedTranslationUnits;
+
+  if (d->nbUncommittedTranslationUnits >= d->groupCommit.maxTranslationUnits ||
+    std::chrono::steady_clock::now() - d->transactionStart >= d->groupCommit.maxDelay)
   {
-    sql::TransactionScope transaction{ m_snapshot->database() };
-    m_snapshot->insert(tuIndex.fileAnnotations.refargs);
+    commit();
   }
+}
 
-  // Process symbol declarations
+/**
+ * \brief commits the translation units that were fed since the last commit
+ */
+void SnapshotCreator::commit()
+{
+  if (m_snapshot && m_snapshot->inTransaction())
   {
-    // declarations are sorted by file.
-#ifndef  NDEBUG
-    bool sorted = std::is_sorted(tuIndex.declarations.begin(), tuIndex.declarations.end(), 
-      [](const SymbolDeclaration& a, const SymbolDeclaration& b) {
-        return a.fileID < b.fileID; 
-      });
-    assert(sorted);
-#endif // !NDEBUG
-
-    for (auto it = tuIndex.declarations.begin(); it != tuIndex.declarations.end(); ) {
-      FileID cur_file_id = it->fileID;
-      auto end = fileRangeEnd(tuIndex.declarations, it);
-
-      if (fileAlreadyIndexed(cur_file_id)) {
-        std::vector<SymbolDeclaration> declarations = merge(m_snapshot->loadDeclarationsInFile(cur_file_id), it, end);
-
-        sql::TransactionScope transaction{ m_snapshot->database() };
-        m_snapshot->removeAllDeclarationsInFile(cur_file_id);
-        m_snapshot->insert(declarations);
-      } else {
-        sql::TransactionScope transaction{ m_snapshot->database() };
-        m_snapshot->insert(std::vector<SymbolDeclaration>(it, end));
-      }
-
-      it = end;
-    }    
+    m_snapshot->endTransaction();
+    d->nbUncommittedTranslationUnits = 0;
   }
+}
 
-  // Update list of already indexed files
-  for (const File& f : newfiles) {
-    setFileIndexed(f.id);
+namespace
+{
+
+template<typename T, typename C>
+void insertSpooledRows(SnapshotWriter& snapshot, SortedSpool<T, C>& spool)
+{
+  sql::TransactionScope transaction{ snapshot.database() };
+
+  spool.consume([&snapshot](const T* begin, const T* end) {
+    snapshot.insert(std::vector<T>(begin, end));
+    });
+}
+
+} // namespace
+
+/**
+ * \brief writes the spooled rows to the database, if in bulk-load mode
+ */
+void SnapshotCreator::loadSpooledRows()
+{
+  if (!d->spools) {
+    return;
   }
+
+  insertSpooledRows(*m_snapshot, d->spools->references);
+  insertSpooledRows(*m_snapshot, d->spools->declarations);
+  insertSpooledRows(*m_snapshot, d->spools->refargs);
+  d->spools.reset();
 }
 
+/**
+ * \brief finalizes the snapshot and closes the database
+ * 
+ * Throws std::runtime_error if the snapshot could not be finalized.
+ */
 void SnapshotCreator::close()
 {
   if (m_snapshot)
   {
+    commit();
+
+    if (d->contentCapture)
+    {
+      sql::runTransacted(m_snapshot->database(), [this]() {
+        m_snapshot->insertFiles(d->contentCapture->waitAll());
+        });
+
+      d->contentCapture.reset();
+    }
+
+    loadSpooledRows();
+    m_snapshot->createIndexes();
+
+    if (d->createSymbolSearchIndex) {
+      m_snapshot->createSymbolSearchIndex();
+    }
+
+    if (d->createFileAnnotations) {
+      m_snapshot->createFileAnnotations();
+    }
+
+    if (d->createReferencePostings) {
+      m_snapshot->createReferencePostings();
+    }
+
+    const std::filesystem::path db_path = m_snapshot->filePath();
     m_snapshot.reset();
+
+    if (d->databaseProfile == DatabaseProfile::Publish) {
+      SnapshotWriter::publish(db_path);
+    }
   }
 }
 
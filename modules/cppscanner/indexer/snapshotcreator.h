@@ -7,6 +7,7 @@
 
 #include "cppscanner/snapshot/snapshotwriter.h"
 
+#include <chrono>
 #include <filesystem>
 #include <string>
 #include <vector>
@@ -19,6 +20,15 @@ class TranslationUnitIndex;
 
 struct SnapshotCreatorData;
 
+/**
+ * \brief controls how often the SnapshotCreator commits its transaction
+ */
+struct GroupCommitPolicy
+{
+  size_t maxTranslationUnits = 64;
+  std::chrono::milliseconds maxDelay{ 2000 };
+};
+
 class SnapshotCreator
 {
 public:
@@ -32,6 +42,14 @@ public:
 
   void setHomeDir(const std::filesystem::path& p);
   void setCaptureFileContent(bool on = true);
+  void setBulkLoad(bool on = true);
+  void setGroupCommitPolicy(const GroupCommitPolicy& policy);
+  void setDatabaseProfile(DatabaseProfile profile);
+  void setFileContentCodec(FileContentCodec codec);
+  void setBlobStore(const std::filesystem::path& p);
+  void setCreateSymbolSearchIndex(bool on = true);
+  void setCreateFileAnnotations(bool on = true);
+  void setCreateReferencePostings(bool on = true);
 
   void init(const std::filesystem::path& dbPath);
 
@@ -39,8 +57,8 @@ public:
 
   void writeProperty(const std::string& name, const std::string& value);
 
-  void feed(const TranslationUnitIndex& tuIndex);
   void feed(TranslationUnitIndex&& tuIndex);
+  void commit();
 
   void close();
 
@@ -48,6 +66,7 @@ public:
 
 protected:
   void writeHomeProperty();
+  void loadSpooledRows();
   bool fileAlreadyIndexed(FileID f) const;
   void setFileIndexed(FileID f);
 
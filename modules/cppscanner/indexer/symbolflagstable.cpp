@@ -0,0 +1,97 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "symbolflagstable.h"
+
+#include <cassert>
+
+namespace cppscanner
+{
+
+void SymbolFlagsTable::clear()
+{
+  m_ids.clear();
+  m_flags.clear();
+  m_size = 0;
+}
+
+/**
+ * \brief returns the number of bytes used by the table
+ */
+size_t SymbolFlagsTable::memoryUsage() const
+{
+  return m_ids.capacity() * sizeof(uint64_t) + m_flags.capacity() * sizeof(int32_t);
+}
+
+size_t SymbolFlagsTable::findSlot(uint64_t rawId) const
+{
+  const size_t mask = m_ids.size() - 1;
+
+  for (size_t i = hashSymbolId(SymbolID::fromRawID(rawId)) & mask; ; i = (i + 1) & mask)
+  {
+    if (m_ids[i] == 0 || m_ids[i] == rawId) {
+      return i;
+    }
+  }
+}
+
+void SymbolFlagsTable::grow()
+{
+  std::vector<uint64_t> ids = std::move(m_ids);
+  std::vector<int32_t> flags = std::move(m_flags);
+
+  const size_t capacity = ids.empty() ? 1024 : 2 * ids.size();
+  m_ids.assign(capacity, 0);
+  m_flags.assign(capacity, 0);
+
+  for (size_t i(0); i < ids.size(); ++i)
+  {
+    if (ids[i] != 0)
+    {
+      const size_t slot = findSlot(ids[i]);
+      m_ids[slot] = ids[i];
+      m_flags[slot] = flags[i];
+    }
+  }
+}
+
+const int* SymbolFlagsTable::find(const SymbolID& id) const
+{
+  if (m_ids.empty() || !id.isValid()) {
+    return nullptr;
+  }
+
+  const size_t slot = findSlot(id.rawID());
+  return m_ids[slot] != 0 ? &m_flags[slot] : nullptr;
+}
+
+/**
+ * \brief inserts a symbol if it is not already in the table
+ * \param id     the id of the symbol, must be valid
+ * \param flags  the flags of the symbol if it is inserted
+ *
+ * Returns a pointer to the flags of the symbol and whether it was inserted.
+ */
+std::pair<int*, bool> SymbolFlagsTable::insert(const SymbolID& id, int flags)
+{
+  assert(id.isValid());
+
+  // the load factor is kept below 3/4 so that probe sequences stay short
+  if (4 * (m_size + 1) > 3 * m_ids.size()) {
+    grow();
+  }
+
+  const size_t slot = findSlot(id.rawID());
+
+  if (m_ids[slot] != 0) {
+    return { &m_flags[slot], false };
+  }
+
+  m_ids[slot] = id.rawID();
+  m_flags[slot] = flags;
+  ++m_size;
+  return { &m_flags[slot], true };
+}
+
+} // namespace cppscanner
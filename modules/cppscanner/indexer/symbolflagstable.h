@@ -0,0 +1,61 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_SYMBOLFLAGSTABLE_H
+#define CPPSCANNER_SYMBOLFLAGSTABLE_H
+
+#include "cppscanner/index/symbolid.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace cppscanner
+{
+
+/**
+ * \brief an open-addressing hash table mapping symbol ids to their flags
+ *
+ * This is all the SnapshotCreator needs to remember about a symbol once it
+ * has been written to the database.
+ * Keys and values are stored in separate arrays, so that a slot only takes
+ * 12 bytes; the invalid id marks empty slots and cannot be inserted.
+ */
+class SymbolFlagsTable
+{
+public:
+  SymbolFlagsTable() = default;
+
+  size_t size() const;
+  bool empty() const;
+  void clear();
+
+  size_t memoryUsage() const;
+
+  const int* find(const SymbolID& id) const;
+  std::pair<int*, bool> insert(const SymbolID& id, int flags);
+
+private:
+  size_t findSlot(uint64_t rawId) const;
+  void grow();
+
+private:
+  std::vector<uint64_t> m_ids; // raw ids, zero marks an empty slot
+  std::vector<int32_t> m_flags;
+  size_t m_size = 0;
+};
+
+inline size_t SymbolFlagsTable::size() const
+{
+  return m_size;
+}
+
+inline bool SymbolFlagsTable::empty() const
+{
+  return m_size == 0;
+}
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_SYMBOLFLAGSTABLE_H
@@ -0,0 +1,277 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "symbolreferencetable.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <tuple>
+
+namespace cppscanner
+{
+
+static_assert(SymbolReference::Implicit <= 0xFF, "flags must fit in a byte");
+
+void SymbolReferenceTable::reserve(size_t n)
+{
+  m_keys.reserve(n);
+  m_symbols.reserve(n);
+  m_referenced_by.reserve(n);
+  m_flags.reserve(n);
+}
+
+void SymbolReferenceTable::clear()
+{
+  m_keys.clear();
+  m_symbols.clear();
+  m_referenced_by.clear();
+  m_flags.clear();
+}
+
+SymbolReference SymbolReferenceTable::at(size_t i) const
+{
+  SymbolReference ref;
+  ref.fileID = fileID(i);
+  ref.position = position(i);
+  ref.symbolID = m_symbols[i];
+  ref.referencedBySymbolID = m_referenced_by[i];
+  ref.flags = m_flags[i];
+  return ref;
+}
+
+void SymbolReferenceTable::set(size_t i, const SymbolReference& ref)
+{
+  m_keys[i] = makeKey(ref.fileID, ref.position);
+  m_symbols[i] = ref.symbolID;
+  m_referenced_by[i] = ref.referencedBySymbolID;
+  m_flags[i] = static_cast<uint8_t>(ref.flags);
+}
+
+/**
+ * \brief returns the end of the range of references in the same file as the reference at \a begin
+ *
+ * The table must be sorted.
+ */
+size_t SymbolReferenceTable::findFileEnd(size_t begin) const
+{
+  const FileID file = fileID(begin);
+
+  if (file == std::numeric_limits<FileID>::max()) {
+    return size();
+  }
+
+  const uint64_t end_key = uint64_t(file + 1) << 32;
+  return std::lower_bound(m_keys.begin() + begin, m_keys.end(), end_key) - m_keys.begin();
+}
+
+std::vector<SymbolReference> SymbolReferenceTable::toVector(size_t begin, size_t end) const
+{
+  std::vector<SymbolReference> result;
+  result.reserve(end - begin);
+
+  for (size_t i(begin); i < end; ++i) {
+    result.push_back(at(i));
+  }
+
+  return result;
+}
+
+std::vector<SymbolReference> SymbolReferenceTable::toVector() const
+{
+  return toVector(0, size());
+}
+
+namespace
+{
+
+constexpr size_t RadixBits = 11;
+constexpr size_t RadixSize = size_t(1) << RadixBits;
+constexpr size_t NbRadixPasses = (64 + RadixBits - 1) / RadixBits;
+
+inline size_t digit(uint64_t key, size_t pass)
+{
+  return (key >> (RadixBits * pass)) & (RadixSize - 1);
+}
+
+/**
+ * \brief sorts keys and returns the permutation that sorts them
+ * \param keys  the keys, sorted in place
+ *
+ * This is a LSD radix sort processing 11 bits per pass; keys and indices
+ * are moved together so that memory is accessed sequentially.
+ * Passes on digits that are the same for all keys are skipped
+ * (e.g., the high bits of the file id).
+ */
+std::vector<uint32_t> radixSort(std::vector<uint64_t>& keys)
+{
+  const size_t n = keys.size();
+
+  std::vector<std::array<uint32_t, RadixSize>> histograms(NbRadixPasses);
+
+  for (auto& h : histograms) {
+    h.fill(0);
+  }
+
+  for (uint64_t k : keys)
+  {
+    for (size_t pass(0); pass < NbRadixPasses; ++pass) {
+      ++histograms[pass][digit(k, pass)];
+    }
+  }
+
+  std::vector<uint32_t> perm(n);
+  std::vector<uint32_t> tmp_perm(n);
+  std::vector<uint64_t> tmp_keys(n);
+
+  for (size_t i(0); i < n; ++i) {
+    perm[i] = uint32_t(i);
+  }
+
+  for (size_t pass(0); pass < NbRadixPasses; ++pass)
+  {
+    std::array<uint32_t, RadixSize>& histogram = histograms[pass];
+
+    if (histogram[digit(keys.front(), pass)] == n) {
+      // all keys have the same digit
+      continue;
+    }
+
+    uint32_t offset = 0;
+
+    for (uint32_t& count : histogram)
+    {
+      const uint32_t c = count;
+      count = offset;
+      offset += c;
+    }
+
+    for (size_t i(0); i < n; ++i)
+    {
+      const uint32_t dest = histogram[digit(keys[i], pass)]++;
+      tmp_keys[dest] = keys[i];
+      tmp_perm[dest] = perm[i];
+    }
+
+    std::swap(keys, tmp_keys);
+    std::swap(perm, tmp_perm);
+  }
+
+  return perm;
+}
+
+template<typename T>
+void applyPermutation(std::vector<T>& column, const std::vector<uint32_t>& perm)
+{
+  std::vector<T> result;
+  result.reserve(perm.size());
+
+  for (uint32_t i : perm) {
+    result.push_back(column[i]);
+  }
+
+  column = std::move(result);
+}
+
+} // namespace
+
+/**
+ * \brief sorts the references and removes duplicates
+ *
+ * References are sorted by (fileID, position, symbolID), references having
+ * a referencing symbol coming first.
+ * Two references are considered duplicates if they have the same
+ * (fileID, position, symbolID); only the first one is kept.
+ */
+void SymbolReferenceTable::sortAndRemoveDuplicates()
+{
+  if (empty()) {
+    return;
+  }
+
+  // note: m_keys is sorted in place, the other columns are permuted afterwards
+  std::vector<uint32_t> perm = radixSort(m_keys);
+
+  applyPermutation(m_symbols, perm);
+  applyPermutation(m_referenced_by, perm);
+  applyPermutation(m_flags, perm);
+
+  // sort references with the same key, i.e., references at the same location.
+  // there are usually very few of them.
+  {
+    auto less = [this](size_t a, size_t b) {
+      const bool a_missing = !m_referenced_by[a].isValid();
+      const bool b_missing = !m_referenced_by[b].isValid();
+      return std::forward_as_tuple(m_symbols[a], a_missing) < std::forward_as_tuple(m_symbols[b], b_missing);
+    };
+
+    std::vector<size_t> order;
+    size_t i = 0;
+
+    while (i < size())
+    {
+      size_t end = i + 1;
+      while (end < size() && m_keys[end] == m_keys[i]) {
+        ++end;
+      }
+
+      if (end - i > 1)
+      {
+        order.resize(end - i);
+        for (size_t k(0); k < order.size(); ++k) {
+          order[k] = i + k;
+        }
+
+        std::sort(order.begin(), order.end(), less);
+
+        std::vector<SymbolReference> group;
+        for (size_t k : order) {
+          group.push_back(at(k));
+        }
+
+        for (size_t k(0); k < group.size(); ++k) {
+          set(i + k, group[k]);
+        }
+      }
+
+      i = end;
+    }
+  }
+
+  // remove duplicates
+  {
+    size_t out = 0;
+
+    for (size_t i(0); i < size(); ++i)
+    {
+      if (out > 0 && m_keys[out - 1] == m_keys[i] && m_symbols[out - 1] == m_symbols[i]) {
+        continue;
+      }
+
+      m_keys[out] = m_keys[i];
+      m_symbols[out] = m_symbols[i];
+      m_referenced_by[out] = m_referenced_by[i];
+      m_flags[out] = m_flags[i];
+      ++out;
+    }
+
+    m_keys.resize(out);
+    m_symbols.resize(out);
+    m_referenced_by.resize(out);
+    m_flags.resize(out);
+  }
+}
+
+/**
+ * \brief returns the number of bytes used by the references
+ */
+size_t SymbolReferenceTable::memoryUsage() const
+{
+  return m_keys.capacity() * sizeof(uint64_t) +
+    m_symbols.capacity() * sizeof(SymbolID) +
+    m_referenced_by.capacity() * sizeof(SymbolID) +
+    m_flags.capacity() * sizeof(uint8_t);
+}
+
+} // namespace cppscanner
@@ -0,0 +1,123 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_SYMBOLREFERENCETABLE_H
+#define CPPSCANNER_SYMBOLREFERENCETABLE_H
+
+#include "cppscanner/index/reference.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace cppscanner
+{
+
+/**
+ * \brief a columnar list of symbol references
+ *
+ * Instead of an array of SymbolReference (32 bytes each, with padding),
+ * references are stored as a structure of arrays:
+ * - a 64-bit key packing the file id (high bits) and the position (low bits);
+ * - the id of the referenced symbol;
+ * - the id of the referencing symbol;
+ * - the flags, on a single byte.
+ *
+ * Ordering references by key is the same as ordering them by (fileID, position),
+ * which allows sortAndRemoveDuplicates() to use a radix sort.
+ */
+class SymbolReferenceTable
+{
+private:
+  std::vector<uint64_t> m_keys;
+  std::vector<SymbolID> m_symbols;
+  std::vector<SymbolID> m_referenced_by;
+  std::vector<uint8_t> m_flags;
+
+public:
+  SymbolReferenceTable() = default;
+
+  static uint64_t makeKey(FileID file, FilePosition position);
+
+  size_t size() const;
+  bool empty() const;
+  void reserve(size_t n);
+  void clear();
+
+  void push_back(const SymbolReference& ref);
+
+  SymbolReference at(size_t i) const;
+  void set(size_t i, const SymbolReference& ref);
+
+  uint64_t key(size_t i) const;
+  FileID fileID(size_t i) const;
+  FilePosition position(size_t i) const;
+  SymbolID symbolID(size_t i) const;
+  SymbolID referencedBySymbolID(size_t i) const;
+  int flags(size_t i) const;
+
+  size_t findFileEnd(size_t begin) const;
+  std::vector<SymbolReference> toVector(size_t begin, size_t end) const;
+  std::vector<SymbolReference> toVector() const;
+
+  void sortAndRemoveDuplicates();
+
+  size_t memoryUsage() const;
+};
+
+inline uint64_t SymbolReferenceTable::makeKey(FileID file, FilePosition position)
+{
+  return (uint64_t(file) << 32) | position.bits();
+}
+
+inline size_t SymbolReferenceTable::size() const
+{
+  return m_keys.size();
+}
+
+inline bool SymbolReferenceTable::empty() const
+{
+  return m_keys.empty();
+}
+
+inline void SymbolReferenceTable::push_back(const SymbolReference& ref)
+{
+  m_keys.push_back(makeKey(ref.fileID, ref.position));
+  m_symbols.push_back(ref.symbolID);
+  m_referenced_by.push_back(ref.referencedBySymbolID);
+  m_flags.push_back(static_cast<uint8_t>(ref.flags));
+}
+
+inline uint64_t SymbolReferenceTable::key(size_t i) const
+{
+  return m_keys[i];
+}
+
+inline FileID SymbolReferenceTable::fileID(size_t i) const
+{
+  return FileID(m_keys[i] >> 32);
+}
+
+inline FilePosition SymbolReferenceTable::position(size_t i) const
+{
+  return FilePosition::fromBits(uint32_t(m_keys[i]));
+}
+
+inline SymbolID SymbolReferenceTable::symbolID(size_t i) const
+{
+  return m_symbols[i];
+}
+
+inline SymbolID SymbolReferenceTable::referencedBySymbolID(size_t i) const
+{
+  return m_referenced_by[i];
+}
+
+inline int SymbolReferenceTable::flags(size_t i) const
+{
+  return m_flags[i];
+}
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_SYMBOLREFERENCETABLE_H
@@ -10,31 +10,10 @@
 namespace cppscanner
 {
 
-int nbMissingFields(const SymbolReference& symref)
+void sortAndRemoveDuplicates(std::vector<FileID>& files)
 {
-  return symref.referencedBySymbolID.isValid() ? 0 : 1;
-}
-
-void sortAndRemoveDuplicates(std::vector<SymbolReference>& refs)
-{
-  std::sort(
-    refs.begin(), 
-    refs.end(), 
-    [](const SymbolReference& a, const SymbolReference& b) -> bool {
-      return std::forward_as_tuple(a.fileID, a.position, a.symbolID, nbMissingFields(a)) < 
-        std::forward_as_tuple(b.fileID, b.position, b.symbolID, nbMissingFields(b));
-    }
-  );
-
-  // remove duplicates
-  {
-    auto equiv = [](const SymbolReference& a, const SymbolReference& b) -> bool {
-      return std::forward_as_tuple(a.fileID, a.position, a.symbolID) == std::forward_as_tuple(b.fileID, b.position, b.symbolID);
-      };
-
-    auto it = std::unique(refs.begin(), refs.end(), equiv);
-    refs.erase(it, refs.end());
-  }
+  std::sort(files.begin(), files.end());
+  files.erase(std::unique(files.begin(), files.end()), files.end());
 }
 
 void sortAndRemoveDuplicates(std::vector<ArgumentPassedByReference>& refargs)
@@ -5,7 +5,8 @@
 #ifndef CPPSCANNER_TRANSLATIONUNITINDEX_H
 #define CPPSCANNER_TRANSLATIONUNITINDEX_H
 
-#include "cppscanner/snapshot/indexersymbol.h"
+#include "indexersymboltable.h"
+#include "symbolreferencetable.h"
 
 #include "cppscanner/index/baseof.h"
 #include "cppscanner/index/declaration.h"
@@ -15,8 +16,9 @@
 #include "cppscanner/index/refarg.h"
 #include "cppscanner/index/reference.h"
 
-#include <map>
-#include <set>
+#include "cppscanner/base/arena.h"
+
+#include <type_traits>
 #include <vector>
 
 #include <variant>
@@ -38,13 +40,14 @@ public:
   FileID mainFileId; // id of the main file of the translation unit
   bool isError = false; // whether this index is empty because an error occurred
 
-  std::set<FileID> indexedFiles;
+  std::vector<FileID> indexedFiles; // sorted by Indexer::finish()
 
   std::vector<Include> ppIncludes;
 
-  std::map<SymbolID, IndexerSymbol> symbols;
+  IndexerSymbolTable symbols;
+  Arena strings; // storage for the strings of the symbols
 
-  std::vector<SymbolReference> symReferences; // TODO: move to fileAnnotations ?
+  SymbolReferenceTable symReferences; // TODO: move to fileAnnotations ?
 
   struct {
     std::vector<BaseOf> baseOfs;
@@ -112,11 +115,13 @@ inline void TranslationUnitIndex::add(SymbolDeclaration declaration)
 
 inline IndexerSymbol* TranslationUnitIndex::getSymbolById(const SymbolID& id)
 {
-  auto it = this->symbols.find(id);
-  return it != this->symbols.end() ? &(it->second) : nullptr;
+  return this->symbols.find(id);
 }
 
-void sortAndRemoveDuplicates(std::vector<SymbolReference>& refs);
+// results are moved through the IndexingResultQueue
+static_assert(std::is_nothrow_move_constructible<TranslationUnitIndex>::value, "TranslationUnitIndex must be cheap to move");
+
+void sortAndRemoveDuplicates(std::vector<FileID>& files);
 void sortAndRemoveDuplicates(std::vector<ArgumentPassedByReference>& refargs);
 void sortAndRemoveDuplicates(std::vector<SymbolDeclaration>& declarations);
 
@@ -0,0 +1,637 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "translationunitindexserialization.h"
+
+#include "fileidentificator.h"
+
+#include "cppscanner/base/bytestream.h"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+// Layout of the data (all integers are varints unless specified otherwise):
+//   magic ("CSTU", 4 bytes), version
+//   file table: count, then the path of each file
+//   string table: size, then the bytes of all the strings
+//   translation unit: see Encoder::writeIndex()
+//
+// Files are identified by their index in the file table plus one (zero is
+// the invalid file) so that ids can be remapped by another FileIdentificator.
+// Strings are identified by an (offset, size) pair into the string table,
+// in which identical strings are only stored once.
+// Symbols are referenced by their index in the symbol table when possible.
+// References, declarations and refargs are delta-coded on a (file, position)
+// key, which is most compact when they are sorted by file and position.
+
+namespace cppscanner
+{
+
+namespace
+{
+
+constexpr std::string_view Magic = "CSTU";
+
+// encoding of a SymbolID
+enum SymbolRefTag
+{
+  InvalidSymbol = 0,
+  RawSymbolID = 1, // followed by the id as a fixed 64-bit integer
+  FirstSymbolIndex = 2, // index in the symbol table + FirstSymbolIndex
+};
+
+class Encoder
+{
+private:
+  const TranslationUnitIndex& m_index;
+  std::vector<FileID> m_files; // sorted, excluding the invalid file
+  std::vector<uint32_t> m_local_file_ids; // FileID -> local id
+  std::unordered_map<std::string_view, uint64_t> m_string_offsets;
+  ByteWriter m_strings;
+  ByteWriter m_body;
+  uint64_t m_prev_key = 0;
+
+public:
+  explicit Encoder(const TranslationUnitIndex& index) :
+    m_index(index)
+  {
+    listFiles();
+  }
+
+  std::string encode(const FileIdentificator& fileIdentificator)
+  {
+    writeIndex();
+
+    ByteWriter result;
+    result.reserve(m_body.size() + m_strings.size() + 64 * m_files.size());
+    result.writeBytes(Magic);
+    result.writeVarint(TranslationUnitIndexFormatVersion);
+
+    result.writeVarint(m_files.size());
+    std::string path;
+    for (FileID fid : m_files) {
+      fileIdentificator.getFilePath(fid, path);
+      result.writeString(path);
+    }
+
+    result.writeString(m_strings.bytes());
+    result.writeBytes(m_body.bytes());
+
+    return result.release();
+  }
+
+private:
+  void listFiles()
+  {
+    // FileIDs are small and dense so a lookup table is used instead of
+    // sorting the file of every reference
+    auto add = [this](FileID fid) {
+      if (fid >= m_local_file_ids.size()) {
+        m_local_file_ids.resize(fid + 1, 0);
+      }
+      m_local_file_ids[fid] = 1;
+      };
+
+    add(m_index.mainFileId);
+    std::for_each(m_index.indexedFiles.begin(), m_index.indexedFiles.end(), add);
+
+    for (const Include& incl : m_index.ppIncludes)
+    {
+      add(incl.fileID);
+      add(incl.includedFileID);
+    }
+
+    for (size_t i(0); i < m_index.symReferences.size(); ++i) {
+      add(m_index.symReferences.fileID(i));
+    }
+
+    for (const Diagnostic& d : m_index.diagnostics) {
+      add(d.fileID);
+    }
+
+    for (const ArgumentPassedByReference& refarg : m_index.fileAnnotations.refargs) {
+      add(refarg.fileID);
+    }
+
+    for (const SymbolDeclaration& decl : m_index.declarations) {
+      add(decl.fileID);
+    }
+
+    for (FileID fid(1); fid < m_local_file_ids.size(); ++fid)
+    {
+      if (m_local_file_ids[fid])
+      {
+        m_files.push_back(fid);
+        m_local_file_ids[fid] = uint32_t(m_files.size());
+      }
+    }
+
+    if (!m_local_file_ids.empty()) {
+      m_local_file_ids[0] = 0;
+    }
+  }
+
+  uint64_t localFileId(FileID fid) const
+  {
+    return fid < m_local_file_ids.size() ? m_local_file_ids[fid] : 0;
+  }
+
+  void writeFile(FileID fid)
+  {
+    m_body.writeVarint(localFileId(fid));
+  }
+
+  // the key preserves the (fileID, position) order as local file ids are
+  // allocated in increasing order of FileID
+  uint64_t key(FileID fid, FilePosition pos) const
+  {
+    return (localFileId(fid) << 32) | pos.bits();
+  }
+
+  void writeKey(FileID fid, FilePosition pos)
+  {
+    const uint64_t k = key(fid, pos);
+    m_body.writeSignedVarint(int64_t(k - m_prev_key));
+    m_prev_key = k;
+  }
+
+  void writeString(std::string_view str)
+  {
+    if (str.empty())
+    {
+      m_body.writeVarint(0);
+      m_body.writeVarint(0);
+      return;
+    }
+
+    auto [it, inserted] = m_string_offsets.try_emplace(str, m_strings.size());
+
+    if (inserted) {
+      m_strings.writeBytes(str);
+    }
+
+    m_body.writeVarint(it->second);
+    m_body.writeVarint(str.size());
+  }
+
+  void writeSymbol(const SymbolID& id)
+  {
+    if (!id.isValid())
+    {
+      m_body.writeVarint(InvalidSymbol);
+    }
+    else if (std::optional<size_t> index = m_index.symbols.indexOf(id))
+    {
+      m_body.writeVarint(*index + FirstSymbolIndex);
+    }
+    else
+    {
+      m_body.writeVarint(RawSymbolID);
+      m_body.writeFixed64(id.rawID());
+    }
+  }
+
+  void writeExtraInfo(const SymbolExtraInfo& extraInfo)
+  {
+    m_body.writeByte(extraInfo.kind());
+
+    extraInfo.visit([this](const auto& info) {
+      write(info);
+      });
+  }
+
+  void write(const MacroExtraInfo& info)
+  {
+    writeString(info.definition);
+  }
+
+  void write(const FunctionExtraInfo& info)
+  {
+    writeString(info.returnType);
+    writeString(info.declaration);
+  }
+
+  void write(const ParameterExtraInfo& info)
+  {
+    m_body.writeSignedVarint(info.parameterIndex);
+    writeString(info.type);
+    writeString(info.defaultValue);
+  }
+
+  void write(const EnumExtraInfo& info)
+  {
+    writeString(info.underlyingType);
+  }
+
+  void write(const EnumConstantExtraInfo& info)
+  {
+    m_body.writeSignedVarint(info.value);
+    writeString(info.expression);
+  }
+
+  void write(const VariableExtraInfo& info)
+  {
+    writeString(info.type);
+    writeString(info.init);
+  }
+
+  void write(const NamespaceAliasExtraInfo& info)
+  {
+    writeString(info.value);
+  }
+
+  void writeIndex()
+  {
+    m_body.writeByte(m_index.isError ? 1 : 0);
+    writeFile(m_index.mainFileId);
+
+    m_body.writeVarint(m_index.indexedFiles.size());
+    for (FileID fid : m_index.indexedFiles) {
+      writeFile(fid);
+    }
+
+    m_body.writeVarint(m_index.ppIncludes.size());
+    for (const Include& incl : m_index.ppIncludes)
+    {
+      writeFile(incl.fileID);
+      writeFile(incl.includedFileID);
+      m_body.writeSignedVarint(incl.line);
+    }
+
+    // ids come first so that symbols can reference symbols that come after them
+    const IndexerSymbolTable& symbols = m_index.symbols;
+    m_body.writeVarint(symbols.size());
+    for (size_t i(0); i < symbols.size(); ++i) {
+      m_body.writeFixed64(symbols.at(i).id.rawID());
+    }
+
+    for (size_t i(0); i < symbols.size(); ++i)
+    {
+      const IndexerSymbol& symbol = symbols.at(i);
+      m_body.writeVarint(static_cast<uint64_t>(symbol.kind));
+      writeString(symbol.name);
+      writeSymbol(symbol.parentId);
+      m_body.writeVarint(uint32_t(symbol.flags));
+      writeExtraInfo(symbol.extraInfo);
+    }
+
+    const SymbolReferenceTable& refs = m_index.symReferences;
+    m_body.writeVarint(refs.size());
+    m_prev_key = 0;
+    for (size_t i(0); i < refs.size(); ++i)
+    {
+      writeKey(refs.fileID(i), refs.position(i));
+      writeSymbol(refs.symbolID(i));
+      writeSymbol(refs.referencedBySymbolID(i));
+      m_body.writeVarint(uint32_t(refs.flags(i)));
+    }
+
+    m_body.writeVarint(m_index.relations.baseOfs.size());
+    for (const BaseOf& bof : m_index.relations.baseOfs)
+    {
+      writeSymbol(bof.baseClassID);
+      writeSymbol(bof.derivedClassID);
+      m_body.writeVarint(static_cast<uint64_t>(bof.accessSpecifier));
+    }
+
+    m_body.writeVarint(m_index.relations.overrides.size());
+    for (const Override& ov : m_index.relations.overrides)
+    {
+      writeSymbol(ov.baseMethodID);
+      writeSymbol(ov.overrideMethodID);
+    }
+
+    m_body.writeVarint(m_index.diagnostics.size());
+    for (const Diagnostic& d : m_index.diagnostics)
+    {
+      m_body.writeVarint(static_cast<uint64_t>(d.level));
+      writeString(d.message);
+      writeFile(d.fileID);
+      m_body.writeVarint(d.position.bits());
+    }
+
+    m_body.writeVarint(m_index.fileAnnotations.refargs.size());
+    m_prev_key = 0;
+    for (const ArgumentPassedByReference& refarg : m_index.fileAnnotations.refargs) {
+      writeKey(refarg.fileID, refarg.position);
+    }
+
+    m_body.writeVarint(m_index.declarations.size());
+    m_prev_key = 0;
+    for (const SymbolDeclaration& decl : m_index.declarations)
+    {
+      writeKey(decl.fileID, decl.startPosition);
+      m_body.writeVarint(decl.endPosition.bits());
+      writeSymbol(decl.symbolID);
+      m_body.writeByte(decl.isDefinition ? 1 : 0);
+    }
+  }
+};
+
+class Decoder
+{
+private:
+  ByteReader m_reader;
+  TranslationUnitIndex m_index;
+  std::vector<FileID> m_files; // local id -> FileID
+  std::string_view m_strings;
+  std::vector<SymbolID> m_symbols;
+  uint64_t m_prev_key = 0;
+
+public:
+  explicit Decoder(std::string_view data) :
+    m_reader(data)
+  {
+
+  }
+
+  TranslationUnitIndex decode(FileIdentificator& fileIdentificator)
+  {
+    if (m_reader.remaining() < Magic.size() || m_reader.readBytes(Magic.size()) != Magic) {
+      throw std::runtime_error("data is not a serialized translation unit index");
+    }
+
+    if (m_reader.readVarint() != TranslationUnitIndexFormatVersion) {
+      throw std::runtime_error("unsupported translation unit index format version");
+    }
+
+    const size_t nb_files = readCount();
+    m_files.reserve(nb_files + 1);
+    m_files.push_back(FileID(0));
+    for (size_t i(0); i < nb_files; ++i) {
+      m_files.push_back(fileIdentificator.getIdentification(std::string(m_reader.readString())));
+    }
+
+    // the strings of the symbols are views into a single copy of the table
+    m_strings = m_index.strings.copy(m_reader.readString());
+
+    readIndex();
+
+    if (!m_reader.atEnd()) {
+      throw std::runtime_error("unexpected data after translation unit index");
+    }
+
+    return std::move(m_index);
+  }
+
+private:
+  // reads a number of elements, each of which takes at least one byte
+  size_t readCount()
+  {
+    const uint64_t n = m_reader.readVarint();
+
+    if (n > m_reader.remaining()) {
+      throw std::runtime_error("invalid element count");
+    }
+
+    return size_t(n);
+  }
+
+  FileID readFile()
+  {
+    const uint64_t i = m_reader.readVarint();
+
+    if (i >= m_files.size()) {
+      throw std::runtime_error("invalid file index");
+    }
+
+    return m_files[i];
+  }
+
+  std::pair<FileID, FilePosition> readKey()
+  {
+    m_prev_key += uint64_t(m_reader.readSignedVarint());
+    const uint64_t i = m_prev_key >> 32;
+
+    if (i >= m_files.size()) {
+      throw std::runtime_error("invalid file index");
+    }
+
+    return { m_files[i], FilePosition::fromBits(uint32_t(m_prev_key)) };
+  }
+
+  std::string_view readString()
+  {
+    const uint64_t offset = m_reader.readVarint();
+    const uint64_t size = m_reader.readVarint();
+
+    if (offset > m_strings.size() || size > m_strings.size() - offset) {
+      throw std::runtime_error("invalid string");
+    }
+
+    return m_strings.substr(offset, size);
+  }
+
+  SymbolID readSymbol()
+  {
+    const uint64_t tag = m_reader.readVarint();
+
+    if (tag == InvalidSymbol) {
+      return SymbolID();
+    } else if (tag == RawSymbolID) {
+      return SymbolID::fromRawID(m_reader.readFixed64());
+    } else if (tag - FirstSymbolIndex < m_symbols.size()) {
+      return m_symbols[tag - FirstSymbolIndex];
+    } else {
+      throw std::runtime_error("invalid symbol index");
+    }
+  }
+
+  void readExtraInfo(IndexerSymbol& symbol)
+  {
+    switch (m_reader.readByte())
+    {
+    case SymbolExtraInfo::None:
+      break;
+    case SymbolExtraInfo::Macro:
+    {
+      auto& info = symbol.getExtraInfo<MacroExtraInfo>();
+      info.definition = readString();
+    }
+    break;
+    case SymbolExtraInfo::Function:
+    {
+      auto& info = symbol.getExtraInfo<FunctionExtraInfo>();
+      info.returnType = readString();
+      info.declaration = readString();
+    }
+    break;
+    case SymbolExtraInfo::Parameter:
+    {
+      auto& info = symbol.getExtraInfo<ParameterExtraInfo>();
+      info.parameterIndex = int(m_reader.readSignedVarint());
+      info.type = readString();
+      info.defaultValue = readString();
+    }
+    break;
+    case SymbolExtraInfo::Enum:
+    {
+      auto& info = symbol.getExtraInfo<EnumExtraInfo>();
+      info.underlyingType = readString();
+    }
+    break;
+    case SymbolExtraInfo::EnumConstant:
+    {
+      auto& info = symbol.getExtraInfo<EnumConstantExtraInfo>();
+      info.value = m_reader.readSignedVarint();
+      info.expression = readString();
+    }
+    break;
+    case SymbolExtraInfo::Variable:
+    {
+      auto& info = symbol.getExtraInfo<VariableExtraInfo>();
+      info.type = readString();
+      info.init = readString();
+    }
+    break;
+    case SymbolExtraInfo::NamespaceAlias:
+    {
+      auto& info = symbol.getExtraInfo<NamespaceAliasExtraInfo>();
+      info.value = readString();
+    }
+    break;
+    default:
+      throw std::runtime_error("invalid symbol extra info");
+    }
+  }
+
+  void readIndex()
+  {
+    m_index.isError = m_reader.readByte() != 0;
+    m_index.mainFileId = readFile();
+
+    m_index.indexedFiles.resize(readCount());
+    for (FileID& fid : m_index.indexedFiles) {
+      fid = readFile();
+    }
+
+    m_index.ppIncludes.resize(readCount());
+    for (Include& incl : m_index.ppIncludes)
+    {
+      incl.fileID = readFile();
+      incl.includedFileID = readFile();
+      incl.line = int(m_reader.readSignedVarint());
+    }
+
+    const size_t nb_symbols = readCount();
+    m_symbols.reserve(nb_symbols);
+    for (size_t i(0); i < nb_symbols; ++i) {
+      m_symbols.push_back(SymbolID::fromRawID(m_reader.readFixed64()));
+    }
+
+    for (const SymbolID& id : m_symbols)
+    {
+      auto [entry, inserted] = m_index.symbols.insert(id);
+
+      if (!inserted) {
+        throw std::runtime_error("duplicate symbol id");
+      }
+
+      IndexerSymbol& symbol = *entry;
+      symbol.kind = static_cast<SymbolKind>(m_reader.readVarint());
+      symbol.name = readString();
+      symbol.parentId = readSymbol();
+      symbol.flags = int(m_reader.readVarint());
+      readExtraInfo(symbol);
+    }
+
+    const size_t nb_refs = readCount();
+    SymbolReferenceTable& refs = m_index.symReferences;
+    refs.reserve(nb_refs);
+    m_prev_key = 0;
+    for (size_t i(0); i < nb_refs; ++i)
+    {
+      SymbolReference ref;
+      std::tie(ref.fileID, ref.position) = readKey();
+      ref.symbolID = readSymbol();
+      ref.referencedBySymbolID = readSymbol();
+      ref.flags = int(m_reader.readVarint());
+      refs.push_back(ref);
+    }
+
+    m_index.relations.baseOfs.resize(readCount());
+    for (BaseOf& bof : m_index.relations.baseOfs)
+    {
+      bof.baseClassID = readSymbol();
+      bof.derivedClassID = readSymbol();
+      bof.accessSpecifier = static_cast<AccessSpecifier>(m_reader.readVarint());
+    }
+
+    m_index.relations.overrides.resize(readCount());
+    for (Override& ov : m_index.relations.overrides)
+    {
+      ov.baseMethodID = readSymbol();
+      ov.overrideMethodID = readSymbol();
+    }
+
+    m_index.diagnostics.resize(readCount());
+    for (Diagnostic& d : m_index.diagnostics)
+    {
+      d.level = static_cast<DiagnosticLevel>(m_reader.readVarint());
+      d.message = std::string(readString());
+      d.fileID = readFile();
+      d.position = FilePosition::fromBits(uint32_t(m_reader.readVarint()));
+    }
+
+    m_index.fileAnnotations.refargs.resize(readCount());
+    m_prev_key = 0;
+    for (ArgumentPassedByReference& refarg : m_index.fileAnnotations.refargs) {
+      std::tie(refarg.fileID, refarg.position) = readKey();
+    }
+
+    m_index.declarations.resize(readCount());
+    m_prev_key = 0;
+    for (SymbolDeclaration& decl : m_index.declarations)
+    {
+      std::tie(decl.fileID, decl.startPosition) = readKey();
+      decl.endPosition = FilePosition::fromBits(uint32_t(m_reader.readVarint()));
+      decl.symbolID = readSymbol();
+      decl.isDefinition = m_reader.readByte() != 0;
+    }
+
+    // the lists were sorted by the file ids of the source identificator,
+    // which may be ordered differently in the target identificator.
+    sortAndRemoveDuplicates(m_index.indexedFiles);
+    sortAndRemoveDuplicates(m_index.fileAnnotations.refargs);
+    m_index.symReferences.sortAndRemoveDuplicates();
+    sortAndRemoveDuplicates(m_index.declarations);
+  }
+};
+
+} // namespace
+
+/**
+ * \brief serializes a translation unit index into a compact binary format
+ * \param index              the index
+ * \param fileIdentificator  the file identificator that produced the file ids of the index
+ *
+ * The paths of the files are stored in the output, so that the data can be
+ * deserialized with another FileIdentificator, e.g., in another process.
+ */
+std::string serializeTranslationUnitIndex(const TranslationUnitIndex& index, const FileIdentificator& fileIdentificator)
+{
+  Encoder encoder{ index };
+  return encoder.encode(fileIdentificator);
+}
+
+/**
+ * \brief reads a translation unit index produced by serializeTranslationUnitIndex()
+ * \param data               the serialized index
+ * \param fileIdentificator  the file identificator used to compute the file ids of the result
+ *
+ * All strings of the symbols share a single allocation in the arena of
+ * the result.
+ * Throws std::runtime_error if the data is invalid or was produced by
+ * an incompatible version.
+ */
+TranslationUnitIndex deserializeTranslationUnitIndex(std::string_view data, FileIdentificator& fileIdentificator)
+{
+  Decoder decoder{ data };
+  return decoder.decode(fileIdentificator);
+}
+
+} // namespace cppscanner
@@ -0,0 +1,30 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_TRANSLATIONUNITINDEXSERIALIZATION_H
+#define CPPSCANNER_TRANSLATIONUNITINDEXSERIALIZATION_H
+
+#include "translationunitindex.h"
+
+#include <string>
+#include <string_view>
+
+namespace cppscanner
+{
+
+class FileIdentificator;
+
+/**
+ * \brief version of the binary format produced by serializeTranslationUnitIndex()
+ *
+ * Must be incremented whenever the format changes.
+ */
+constexpr int TranslationUnitIndexFormatVersion = 1;
+
+std::string serializeTranslationUnitIndex(const TranslationUnitIndex& index, const FileIdentificator& fileIdentificator);
+TranslationUnitIndex deserializeTranslationUnitIndex(std::string_view data, FileIdentificator& fileIdentificator);
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_TRANSLATIONUNITINDEXSERIALIZATION_H
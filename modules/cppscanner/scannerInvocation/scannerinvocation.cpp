@@ -4,8 +4,10 @@
 #include "cppscanner/base/config.h"
 #include "cppscanner/base/env.h"
 
+#include "cppscanner/snapshot/columnarsnapshot.h"
 #include "cppscanner/snapshot/merge.h"
 
+#include "cppscanner/indexer/filecontentcapture.h"
 #include "cppscanner/indexer/scanner.h"
 
 #include <algorithm>
@@ -62,11 +64,48 @@ public:
     if (opts.root.has_value() && !std::filesystem::is_directory(*opts.root)) {
       throw std::runtime_error("Root path must be a directory");
     }
+
+    if (opts.profile.has_value() && !parseIndexingProfile(*opts.profile).has_value()) {
+      throw std::runtime_error("invalid indexing profile: " + *opts.profile);
+    }
+
+    if (opts.db_profile.has_value() && !parseDatabaseProfile(*opts.db_profile).has_value()) {
+      throw std::runtime_error("invalid database profile: " + *opts.db_profile);
+    }
+
+    if (opts.compress_file_content && !isCodecAvailable(FileContentCodec::Zstd)) {
+      throw std::runtime_error("cppscanner was built without zstd, file content cannot be compressed");
+    }
+
+    if (opts.symbol_search_index && !SnapshotWriter::isSymbolSearchIndexAvailable()) {
+      throw std::runtime_error("the SQLite library does not support FTS5 trigram indexes, the symbol search index cannot be created");
+    }
+  }
+
+  void operator()(const ScannerInvocation::MergeOptions& opts)
+  {
+    if (opts.databaseProfile.has_value() && !parseDatabaseProfile(*opts.databaseProfile).has_value()) {
+      throw std::runtime_error("invalid database profile: " + *opts.databaseProfile);
+    }
+
+    if (opts.compressFileContent && !isCodecAvailable(FileContentCodec::Zstd)) {
+      throw std::runtime_error("cppscanner was built without zstd, file content cannot be compressed");
+    }
+
+    if (opts.symbolSearchIndex && !SnapshotWriter::isSymbolSearchIndexAvailable()) {
+      throw std::runtime_error("the SQLite library does not support FTS5 trigram indexes, the symbol search index cannot be created");
+    }
   }
 
-  void operator()(const ScannerInvocation::MergeOptions&)
+  void operator()(const ScannerInvocation::ConvertOptions& opts)
   {
+    if (!opts.input.has_value() || !opts.output.has_value()) {
+      throw std::runtime_error("convert requires an input and an output");
+    }
 
+    if (opts.databaseProfile.has_value() && !parseDatabaseProfile(*opts.databaseProfile).has_value()) {
+      throw std::runtime_error("invalid database profile: " + *opts.databaseProfile);
+    }
   }
 };
 
@@ -103,6 +142,7 @@ public:
   bool operator()(std::monostate);
   bool operator()(const ScannerInvocation::RunOptions& opts);
   bool operator()(const ScannerInvocation::MergeOptions& opts);
+  bool operator()(const ScannerInvocation::ConvertOptions& opts);
 };
 
 bool InvocationRunner::operator()(std::monostate)
@@ -143,6 +183,32 @@ bool InvocationRunner::operator()(const ScannerInvocation::RunOptions& opts)
     return true;
   }
 
+  std::optional<IndexingProfile> indexing_profile;
+
+  if (opts.profile.has_value())
+  {
+    indexing_profile = parseIndexingProfile(*opts.profile);
+
+    if (!indexing_profile.has_value())
+    {
+      m_errors.push_back("invalid indexing profile: " + *opts.profile);
+      return false;
+    }
+  }
+
+  std::optional<DatabaseProfile> database_profile;
+
+  if (opts.db_profile.has_value())
+  {
+    database_profile = parseDatabaseProfile(*opts.db_profile);
+
+    if (!database_profile.has_value())
+    {
+      m_errors.push_back("invalid database profile: " + *opts.db_profile);
+      return false;
+    }
+  }
+
   std::filesystem::path output_path = computeOutputPath(opts.output, opts.project_name);
 
   if (std::filesystem::exists(output_path))
@@ -176,14 +242,38 @@ bool InvocationRunner::operator()(const ScannerInvocation::RunOptions& opts)
     scanner.setIndexLocalSymbols();
   }
 
+  if (indexing_profile.has_value()) {
+    scanner.setIndexingProfile(*indexing_profile);
+  }
+
   if (opts.ignore_file_content) {
     scanner.setCaptureFileContent(false);
   }
 
+  if (opts.compress_file_content) {
+    scanner.setFileContentCodec(FileContentCodec::Zstd);
+  }
+
+  if (opts.blob_store.has_value()) {
+    scanner.setBlobStore(*opts.blob_store);
+  }
+
+  scanner.setCreateSymbolSearchIndex(opts.symbol_search_index);
+  scanner.setCreateFileAnnotations(opts.file_annotations);
+  scanner.setCreateReferencePostings(opts.reference_postings);
+
   if (opts.remap_file_ids) {
     scanner.setRemapFileIds(true);
   }
 
+  if (opts.bulk_load) {
+    scanner.setBulkLoad(true);
+  }
+
+  if (database_profile.has_value()) {
+    scanner.setDatabaseProfile(*database_profile);
+  }
+
   if (!opts.filters.empty()) {
     scanner.setFilters(opts.filters);
   }
@@ -318,6 +408,15 @@ public:
     convertToLocalPath(file.path);
     Scanner::fillContent(file);
   }
+
+  void fill(std::vector<File>& files) override
+  {
+    for (File& f : files) {
+      convertToLocalPath(f.path);
+    }
+
+    FileContentCapture::fill(files);
+  }
 };
 
 bool InvocationRunner::operator()(const ScannerInvocation::MergeOptions& opts)
@@ -328,6 +427,19 @@ bool InvocationRunner::operator()(const ScannerInvocation::MergeOptions& opts)
     return true;
   }
 
+  std::optional<DatabaseProfile> database_profile;
+
+  if (opts.databaseProfile.has_value())
+  {
+    database_profile = parseDatabaseProfile(*opts.databaseProfile);
+
+    if (!database_profile.has_value())
+    {
+      m_errors.push_back("invalid database profile: " + *opts.databaseProfile);
+      return false;
+    }
+  }
+
   SnapshotMerger merger;
 
   std::vector<std::filesystem::path> scanner_directories;
@@ -379,6 +491,22 @@ bool InvocationRunner::operator()(const ScannerInvocation::MergeOptions& opts)
     merger.setFileContentWriter(std::make_unique<FileContentWriterImpl>());
   }
 
+  if (database_profile.has_value()) {
+    merger.setDatabaseProfile(*database_profile);
+  }
+
+  if (opts.compressFileContent) {
+    merger.setFileContentCodec(FileContentCodec::Zstd);
+  }
+
+  if (opts.blobStore.has_value()) {
+    merger.setBlobStore(*opts.blobStore);
+  }
+
+  merger.setCreateSymbolSearchIndex(opts.symbolSearchIndex);
+  merger.setCreateFileAnnotations(opts.fileAnnotations);
+  merger.setCreateReferencePostings(opts.referencePostings);
+
   if (opts.home.has_value())
   {
     std::cout << "Project home: " << *opts.home << std::endl;
@@ -416,6 +544,67 @@ bool InvocationRunner::operator()(const ScannerInvocation::MergeOptions& opts)
   return true;
 }
 
+bool InvocationRunner::operator()(const ScannerInvocation::ConvertOptions& opts)
+{
+  if (globalOptions().helpFlag)
+  {
+    ScannerInvocation::printHelp(ScannerInvocation::Command::Convert);
+    return true;
+  }
+
+  if (!opts.input.has_value() || !opts.output.has_value())
+  {
+    m_errors.push_back("convert requires an input and an output");
+    return false;
+  }
+
+  std::optional<DatabaseProfile> database_profile;
+
+  if (opts.databaseProfile.has_value())
+  {
+    database_profile = parseDatabaseProfile(*opts.databaseProfile);
+
+    if (!database_profile.has_value())
+    {
+      m_errors.push_back("invalid database profile: " + *opts.databaseProfile);
+      return false;
+    }
+  }
+
+  const std::filesystem::path& input = *opts.input;
+  const std::filesystem::path& output = *opts.output;
+
+  if (!std::filesystem::exists(input))
+  {
+    std::cerr << "input file does not exist: " << input << std::endl;
+    return false;
+  }
+
+  if (std::filesystem::exists(output))
+  {
+    if (!opts.overwrite)
+    {
+      std::cerr << "output file already exists: " << output << std::endl;
+      return false;
+    }
+
+    std::filesystem::remove(output);
+  }
+
+  if (ColumnarSnapshotReader::isColumnarSnapshot(input))
+  {
+    std::cout << "Converting columnar snapshot to SQLite..." << std::endl;
+    convertToSQLiteSnapshot(input, output, database_profile.value_or(DatabaseProfile::Default));
+  }
+  else
+  {
+    std::cout << "Converting SQLite snapshot to columnar..." << std::endl;
+    convertToColumnarSnapshot(input, output);
+  }
+
+  return true;
+}
+
 } // namespace
 
 constexpr const char* RUN_OPTIONS = R"(Options:
@@ -425,11 +614,21 @@ constexpr const char* RUN_OPTIONS = R"(Options:
   --root <directory>      specifies a root directory
   --index-external-files  specifies that files outside of the home directory should be indexed
   --index-local-symbols   specifies that local symbols should be indexed
+  --profile <name>        specifies an indexing profile (outline, declarations or full)
   -f <pattern>
   --filter <pattern>      specifies a pattern for the file to index
   --filter_tu <pattern>
   -f:tu <pattern>         specifies a pattern for the translation units to index
   --threads <count>       number of threads dedicated to parsing translation units
+  --bulk-load             defers the insertion of references into the snapshot 
+                          until all translation units are processed
+  --db-profile <name>     specifies how the database is written (default, build
+                          or publish)
+  --compress-file-content stores the content of files compressed with zstd
+  --blob-store <file>     stores the content of files in a shared blob store
+  --symbol-search-index   creates a full-text index of the names of the symbols
+  --file-annotations      stores the annotations of each file in a single blob
+  --reference-postings    stores the references to each symbol in a single blob
   --project-name <name>   specifies the name of the project
   --project-version <v>   specifies a version for the project)";
 
@@ -448,8 +647,39 @@ constexpr const char* RUN_DESCRIPTION = R"(Description:
   specified, it defaults to the current working directory.
   If --index-local-symbols is specified, locals symbol (e.g., variables defined 
   in function bodies) will be indexed.
+  The indexing profile controls how much is indexed: "outline" only records 
+  declarations and definitions, "declarations" also records references outside
+  of function bodies, and "full" (the default) indexes everything.
   Unless a non-zero number of parsing threads is specified, the scanner runs in a
   single-threaded mode.
+  With --bulk-load, symbol references and declarations are written to temporary
+  files next to the output and inserted in the snapshot, sorted and without 
+  duplicates, once all translation units have been processed. This is faster 
+  for large projects but requires additional disk space while scanning.
+  The database profile controls the SQLite settings: "default" keeps the 
+  snapshot consistent on disk at all times, "build" disables the journal and 
+  disk synchronization, which is much faster but leaves a corrupted snapshot 
+  if the scanner is interrupted, and "publish" does the same and then rewrites
+  the complete snapshot in a form optimized for reading.
+  With --compress-file-content, the content of files is stored in the
+  "compressedContent" column of the "file" table instead of "content"; the
+  "fileContent" view, only created with this option, decompresses it, 
+  provided that the zstd_decompress() SQL function is available.
+  With --blob-store, the content of files is stored in a separate SQLite 
+  database, keyed by SHA-1, that can be shared by several snapshots; content
+  already in the store is not written again and the snapshot only keeps the 
+  path and SHA-1 of the files.
+  With --symbol-search-index, an FTS5 index over the names and qualified names
+  of the symbols is created once the snapshot is complete; it speeds up symbol
+  searches at the cost of a larger snapshot.
+  With --file-annotations, the references, declarations, diagnostics and 
+  include directives of each file are also written as a single compact blob 
+  in the "fileAnnotations" table, so that a file can be rendered with one 
+  lookup.
+  With --reference-postings, the references to each symbol are also written 
+  as a single posting list, grouped by file, in the "symbolReferencePostings"
+  table together with their number by role (read, write, call, definition);
+  finding all the references to a symbol then reads a single row.
   The name and version of the project are written as metadata in the snapshot
   if they are provided but are otherwise not used while indexing.)";
 
@@ -458,7 +688,24 @@ constexpr const char* RUN_EXAMPLES = R"(Example:
     cppscanner run -i source.cpp -o snapshot.db -- -std=c++17)";
 
 constexpr const char* MERGE_DESCRIPTION = R"(Description:
-  Merge two or more snapshots into one.)";
+  Merge two or more snapshots into one.
+  The --db-profile <name> option controls the SQLite settings used to write
+  the output, --compress-file-content stores the content of files compressed,
+  --blob-store <file> stores it in a shared blob store and 
+  --symbol-search-index creates a full-text index of the names of the symbols,
+  --file-annotations writes the per-file annotation blobs and 
+  --reference-postings writes the per-symbol reference posting lists,
+  see "cppscanner run -h".)";
+
+constexpr const char* CONVERT_DESCRIPTION = R"(Description:
+  Converts a snapshot between the SQLite format and the columnar format.
+  The format of the input is detected automatically and the output is written
+  in the other format.
+  The columnar format is a single file with sorted, fixed-width records that
+  is meant to be memory-mapped by read-only servers; it stores the content of
+  files uncompressed.
+  When converting to SQLite, --db-profile <name> controls the SQLite settings
+  used to write the output, see "cppscanner run -h".)";
 
 void ScannerInvocation::printHelp()
 {
@@ -467,6 +714,7 @@ void ScannerInvocation::printHelp()
   std::cout << "Commands:" << std::endl;
   std::cout << "  run: runs the scanner to create a snapshot" << std::endl;
   std::cout << "  merge: merge two or more snapshots" << std::endl;
+  std::cout << "  convert: convert a snapshot to or from the columnar format" << std::endl;
   std::cout << std::endl;
   std::cout << "Use the '-h' option to get more information about each command." << std::endl;
   std::cout << "Example: cppscanner run -h" << std::endl;
@@ -494,6 +742,13 @@ void ScannerInvocation::printHelp(Command c)
     std::cout << "" << std::endl;
     std::cout << MERGE_DESCRIPTION << std::endl;
   }
+  else if (c == Command::Convert)
+  {
+    std::cout << "Syntax:" << std::endl;
+    std::cout << "  cppscanner convert [-y] [--db-profile <name>] -o <output> <input>" << std::endl;
+    std::cout << "" << std::endl;
+    std::cout << CONVERT_DESCRIPTION << std::endl;
+  }
   else if (c == Command::None)
   {
     printHelp();
@@ -504,10 +759,8 @@ ScannerInvocation::ScannerInvocation(const std::vector<std::string>& commandLine
 {
   if (!parseCommandLine(commandLine))
   {
-    throw std::runtime_error("bad command line");
+    throw std::runtime_error("bad command line: " + (m_errors.empty() ? std::string() : m_errors.back()));
   }
-
-  checkConsistency(m_options);
 }
 
 ScannerInvocation::ScannerInvocation()
@@ -533,6 +786,12 @@ bool ScannerInvocation::parseCommandLine(const std::vector<std::string>& command
       parseCommandLine(result, commandLine);
       m_options.command = std::move(result);
     }
+    else if (commandLine.at(0) == "convert")
+    {
+      ConvertOptions result;
+      parseCommandLine(result, commandLine);
+      m_options.command = std::move(result);
+    }
     else
     {
       if (!setHelpFlag(commandLine.at(0)))
@@ -561,6 +820,19 @@ bool ScannerInvocation::parseCommandLine(const std::vector<std::string>& command
     }
   }
 
+  if (!m_options.helpFlag)
+  {
+    try
+    {
+      checkConsistency(m_options);
+    }
+    catch (const std::exception& ex)
+    {
+      m_errors.push_back(ex.what());
+      return false;
+    }
+  }
+
   return true;
 }
 
@@ -668,14 +940,55 @@ void ScannerInvocation::parseCommandLine(RunOptions& result, const std::vector<s
     {
       result.index_local_symbols = true;
     }
+    else if (arg == "--profile")
+    {
+      if (i >= args.size())
+        throw std::runtime_error("missing argument after --profile");
+
+      result.profile = args.at(i++);
+    }
     else if (arg == "--ignore-file-content")
     {
       result.ignore_file_content = true;
     }
+    else if (arg == "--compress-file-content")
+    {
+      result.compress_file_content = true;
+    }
+    else if (arg == "--blob-store")
+    {
+      if (i >= args.size())
+        throw std::runtime_error("missing argument after --blob-store");
+
+      result.blob_store = std::filesystem::path(args.at(i++));
+    }
+    else if (arg == "--symbol-search-index")
+    {
+      result.symbol_search_index = true;
+    }
+    else if (arg == "--file-annotations")
+    {
+      result.file_annotations = true;
+    }
+    else if (arg == "--reference-postings")
+    {
+      result.reference_postings = true;
+    }
     else if (arg == "--remap-file-ids")
     {
       result.remap_file_ids = true;
     }
+    else if (arg == "--bulk-load")
+    {
+      result.bulk_load = true;
+    }
+    else if (arg == "--db-profile")
+    {
+      if (i >= args.size())
+        throw std::runtime_error("missing argument after --db-profile");
+
+      result.db_profile = args.at(i++);
+    }
     else if (arg == "--overwrite" || arg == "-y") 
     {
       result.overwrite = true;
@@ -746,10 +1059,40 @@ void ScannerInvocation::parseCommandLine(MergeOptions& result, const std::vector
     {
       result.linkMode = true;
     }
+    else if (arg == "--compress-file-content")
+    {
+      result.compressFileContent = true;
+    }
+    else if (arg == "--blob-store")
+    {
+      if (i >= args.size())
+        throw std::runtime_error("missing argument after --blob-store");
+
+      result.blobStore = std::filesystem::path(args.at(i++));
+    }
+    else if (arg == "--symbol-search-index")
+    {
+      result.symbolSearchIndex = true;
+    }
+    else if (arg == "--file-annotations")
+    {
+      result.fileAnnotations = true;
+    }
+    else if (arg == "--reference-postings")
+    {
+      result.referencePostings = true;
+    }
     else if (arg == "--keep-source-files") 
     {
       result.keepSourceFiles = true;
     }
+    else if (arg == "--db-profile")
+    {
+      if (i >= args.size())
+        throw std::runtime_error("missing argument after --db-profile");
+
+      result.databaseProfile = args.at(i++);
+    }
     else if (arg.rfind('-', 0) != 0)
     {
       result.inputs.push_back(arg);
@@ -761,6 +1104,48 @@ void ScannerInvocation::parseCommandLine(MergeOptions& result, const std::vector
   }
 }
 
+void ScannerInvocation::parseCommandLine(ConvertOptions& result, const std::vector<std::string>& commandLine)
+{
+  const auto& args = commandLine;
+
+  for (size_t i(1); i < args.size();)
+  {
+    const std::string& arg = args.at(i++);
+
+    if (setHelpFlag(arg))
+    {
+      continue;
+    }
+
+    if (arg == "-o" || arg == "--output")
+    {
+      if (i >= args.size())
+        throw std::runtime_error("missing argument after " + arg);
+
+      result.output = std::filesystem::path(args.at(i++));
+    }
+    else if (arg == "--overwrite" || arg == "-y")
+    {
+      result.overwrite = true;
+    }
+    else if (arg == "--db-profile")
+    {
+      if (i >= args.size())
+        throw std::runtime_error("missing argument after --db-profile");
+
+      result.databaseProfile = args.at(i++);
+    }
+    else if (arg.rfind('-', 0) != 0 && !result.input.has_value())
+    {
+      result.input = std::filesystem::path(arg);
+    }
+    else
+    {
+      throw std::runtime_error("unrecognized command line argument: " + arg);
+    }
+  }
+}
+
 void ScannerInvocation::parseEnv()
 {
   if (std::holds_alternative<ScannerInvocation::RunOptions>(m_options.command))
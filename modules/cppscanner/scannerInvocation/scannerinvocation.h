@@ -28,6 +28,7 @@ public:
     None,
     Run,
     Merge,
+    Convert,
   };
 
   static void printHelp();
@@ -46,7 +47,15 @@ public:
     bool overwrite = false;
     bool index_external_files = false;
     bool index_local_symbols = false;
+    std::optional<std::string> profile;
     bool ignore_file_content = false;
+    bool compress_file_content = false;
+    std::optional<std::filesystem::path> blob_store;
+    bool symbol_search_index = false;
+    bool file_annotations = false;
+    bool reference_postings = false;
+    bool bulk_load = false;
+    std::optional<std::string> db_profile;
     bool remap_file_ids = false;
     std::optional<int> nb_threads;
     std::vector<std::string> filters;
@@ -65,16 +74,33 @@ public:
     std::optional<std::filesystem::path> output;
     std::optional<std::filesystem::path> home;
     bool captureMissingFileContent = false;
+    bool compressFileContent = false;
+    std::optional<std::filesystem::path> blobStore;
+    bool symbolSearchIndex = false;
+    bool fileAnnotations = false;
+    bool referencePostings = false;
     bool linkMode = false;
     bool keepSourceFiles = false;
+    std::optional<std::string> databaseProfile;
     std::optional<std::string> projectName;
     std::optional<std::string> projectVersion;
   };
 
+  /**
+   * \brief options for the "convert" command
+   */
+  struct ConvertOptions
+  {
+    std::optional<std::filesystem::path> input;
+    std::optional<std::filesystem::path> output;
+    bool overwrite = false;
+    std::optional<std::string> databaseProfile;
+  };
+
   struct Options
   {
     bool helpFlag = false;
-    std::variant<std::monostate, RunOptions, MergeOptions> command;
+    std::variant<std::monostate, RunOptions, MergeOptions, ConvertOptions> command;
   };
 
   bool parseCommandLine(const std::vector<std::string>& commandLine);
@@ -90,6 +116,7 @@ private:
   bool setHelpFlag(const std::string& arg);
   void parseCommandLine(RunOptions& result, const std::vector<std::string>& commandLine);
   void parseCommandLine(MergeOptions& result, const std::vector<std::string>& commandLine);
+  void parseCommandLine(ConvertOptions& result, const std::vector<std::string>& commandLine);
 
   void parseEnv(RunOptions& result);
   void parseEnv(MergeOptions& result);
@@ -0,0 +1,190 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "blobstore.h"
+
+#include "cppscanner/database/sql.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace cppscanner
+{
+
+// The content is stored either as text or, if it was compressed, as
+// a zstd frame in "compressedContent" (like in the "file" table of snapshots).
+static const char* SQL_CREATE_BLOB_STORE = R"(
+CREATE TABLE IF NOT EXISTS "blob" (
+  "sha1"               TEXT NOT NULL PRIMARY KEY,
+  "content"            TEXT,
+  "compressedContent"  BLOB
+) WITHOUT ROWID;
+)";
+
+// Several scanners may write to the same store at the same time.
+constexpr int BlobStoreBusyTimeout = 60 * 1000;
+
+BlobStore::~BlobStore() = default;
+
+BlobStore::BlobStore(const std::filesystem::path& p)
+{
+  if (!open(p))
+  {
+    throw std::runtime_error("could not open blob store " + p.u8string());
+  }
+}
+
+/**
+ * \brief opens a blob store, creating it if it does not exist
+ * \param p  the path of the store
+ */
+bool BlobStore::open(const std::filesystem::path& p)
+{
+  m_path = p;
+  m_database = std::make_unique<Database>();
+
+  if (!m_database->open(p))
+  {
+    m_database.reset();
+    return false;
+  }
+
+  sqlite3_busy_timeout(m_database->sqliteHandle(), BlobStoreBusyTimeout);
+
+  if (!sql::exec(*m_database, SQL_CREATE_BLOB_STORE))
+  {
+    m_database.reset();
+    return false;
+  }
+
+  return true;
+}
+
+bool BlobStore::isOpen() const
+{
+  return m_database != nullptr;
+}
+
+const std::filesystem::path& BlobStore::filePath() const
+{
+  return m_path;
+}
+
+Database& BlobStore::database() const
+{
+  assert(isOpen());
+  return *m_database;
+}
+
+/**
+ * \brief returns whether the store contains a blob
+ * \param sha1  the SHA-1 of the content
+ */
+bool BlobStore::contains(const std::string& sha1) const
+{
+  sql::Statement stmt{ database(), "SELECT 1 FROM blob WHERE sha1 = ?" };
+  stmt.bind(1, std::string_view(sha1));
+  return stmt.fetchNextRow();
+}
+
+/**
+ * \brief adds a blob to the store, unless it is already present
+ * \param sha1     the SHA-1 of the content
+ * \param content  the content
+ * \param codec    the codec used to store the content
+ * \return whether the blob was added
+ *
+ * The content is only compressed if the blob is not already in the store.
+ */
+bool BlobStore::insert(const std::string& sha1, std::string_view content, FileContentCodec codec)
+{
+  if (contains(sha1)) {
+    return false;
+  }
+
+  sql::Statement stmt{ database(), "INSERT OR IGNORE INTO blob(sha1, content, compressedContent) VALUES(?,?,?)" };
+  stmt.bind(1, std::string_view(sha1));
+
+  if (codec == FileContentCodec::None)
+  {
+    stmt.bind(2, content);
+    stmt.bind(3, nullptr);
+    stmt.insert();
+  }
+  else
+  {
+    const std::string data = compress(codec, content);
+    stmt.bind(2, nullptr);
+    stmt.bind(3, sql::Blob(data));
+    stmt.insert();
+  }
+
+  return true;
+}
+
+/**
+ * \brief returns the content of a blob, decompressed if needed
+ * \param sha1  the SHA-1 of the content
+ */
+std::optional<std::string> BlobStore::get(const std::string& sha1) const
+{
+  sql::Statement stmt{ database(), "SELECT content, compressedContent FROM blob WHERE sha1 = ?" };
+  stmt.bind(1, std::string_view(sha1));
+
+  if (!stmt.fetchNextRow()) {
+    return std::nullopt;
+  }
+
+  if (stmt.nullColumn(0) && !stmt.nullColumn(1)) {
+    return decompress(FileContentCodec::Zstd, stmt.columnBlob(1));
+  }
+
+  return stmt.column(0);
+}
+
+/**
+ * \brief starts a write transaction
+ * 
+ * The write lock is taken immediately (and waited for if another process
+ * holds it), so that checking for a blob with contains() and inserting it
+ * cannot fail halfway because of a concurrent writer.
+ * Throws std::runtime_error if the transaction cannot be started, e.g.,
+ * if the lock could not be taken before the busy timeout.
+ */
+void BlobStore::beginTransaction()
+{
+  std::string error;
+
+  if (!sql::exec(database(), "BEGIN IMMEDIATE TRANSACTION", &error)) {
+    throw std::runtime_error("could not begin blob store transaction: " + error);
+  }
+}
+
+/**
+ * \brief commits the transaction started with beginTransaction()
+ * 
+ * Throws std::runtime_error if the transaction cannot be committed.
+ */
+void BlobStore::endTransaction()
+{
+  std::string error;
+
+  if (!sql::exec(database(), "COMMIT", &error)) {
+    throw std::runtime_error("could not commit blob store transaction: " + error);
+  }
+}
+
+/**
+ * \brief rolls back the transaction started with beginTransaction()
+ * 
+ * Unlike endTransaction(), this never throws so that it can be used while
+ * an exception is being propagated.
+ */
+void BlobStore::rollbackTransaction()
+{
+  std::string error;
+  sql::exec(database(), "ROLLBACK", &error);
+}
+
+} // namespace cppscanner
@@ -0,0 +1,99 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_BLOBSTORE_H
+#define CPPSCANNER_BLOBSTORE_H
+
+#include "compression.h"
+
+#include "cppscanner/database/database.h"
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace cppscanner
+{
+
+/**
+ * \brief a SQLite database storing the content of files by their SHA-1
+ *
+ * A blob store can be shared by several snapshots (e.g., one per release
+ * of a project), in which case each distinct content is only stored once.
+ * Snapshots using a blob store only keep the path and SHA-1 of their files,
+ * and the path of the store in their "file.content.store" property.
+ */
+class BlobStore
+{
+public:
+  BlobStore() = default;
+  BlobStore(const BlobStore&) = delete;
+  ~BlobStore();
+
+  explicit BlobStore(const std::filesystem::path& p);
+
+  bool open(const std::filesystem::path& p);
+  bool isOpen() const;
+
+  const std::filesystem::path& filePath() const;
+  Database& database() const;
+
+  bool contains(const std::string& sha1) const;
+  bool insert(const std::string& sha1, std::string_view content, FileContentCodec codec = FileContentCodec::None);
+  std::optional<std::string> get(const std::string& sha1) const;
+
+  void beginTransaction();
+  void endTransaction();
+  void rollbackTransaction();
+
+private:
+  std::filesystem::path m_path;
+  std::unique_ptr<Database> m_database;
+};
+
+/**
+ * \brief RAII guard for a write transaction on a blob store
+ *
+ * The transaction is started by the constructor and rolled back by the 
+ * destructor unless commit() was called, so that an exception thrown while
+ * inserting blobs does not leave the store locked.
+ */
+class BlobStoreTransaction
+{
+private:
+  BlobStore& m_store;
+  bool m_closed = false;
+
+public:
+  explicit BlobStoreTransaction(BlobStore& store);
+  BlobStoreTransaction(const BlobStoreTransaction&) = delete;
+  ~BlobStoreTransaction();
+
+  void commit();
+};
+
+inline BlobStoreTransaction::BlobStoreTransaction(BlobStore& store) :
+  m_store(store)
+{
+  m_store.beginTransaction();
+}
+
+inline BlobStoreTransaction::~BlobStoreTransaction()
+{
+  if (!m_closed) {
+    m_store.rollbackTransaction();
+  }
+}
+
+inline void BlobStoreTransaction::commit()
+{
+  m_store.endTransaction();
+  m_closed = true;
+}
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_BLOBSTORE_H
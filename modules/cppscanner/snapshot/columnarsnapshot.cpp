@@ -0,0 +1,1341 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "columnarsnapshot.h"
+
+#include "indexersymbol.h"
+#include "snapshotreader.h"
+#include "snapshotwriter.h"
+
+#include "cppscanner/database/readrows.h"
+#include "cppscanner/database/transaction.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+namespace cppscanner
+{
+
+namespace columnar
+{
+
+static_assert(sizeof(Header) == 24);
+static_assert(sizeof(SectionEntry) == 24);
+static_assert(sizeof(PropertyRow) == 16);
+static_assert(sizeof(FileRow) == 40);
+static_assert(sizeof(IncludeRow) == 12);
+static_assert(sizeof(SymbolRow) == 32);
+static_assert(sizeof(TextInfoRow) == 16);
+static_assert(sizeof(EnumConstantInfoRow) == 24);
+static_assert(sizeof(ParameterInfoRow) == 32);
+static_assert(sizeof(VariableInfoRow) == 24);
+static_assert(sizeof(ReferenceRow) == 32);
+static_assert(sizeof(DeclarationRow) == 24);
+static_assert(sizeof(BaseOfRow) == 24);
+static_assert(sizeof(OverrideRow) == 16);
+static_assert(sizeof(DiagnosticRow) == 24);
+static_assert(sizeof(ArgumentPassedByReferenceRow) == 8);
+
+} // namespace columnar
+
+using namespace columnar;
+
+namespace
+{
+
+// Properties that describe how a SQLite snapshot is stored rather than
+// what it contains; they are not carried over by the converters.
+const char* StorageProperties[] = {
+  "database.schema.version",
+  "file.content.codec",
+  "file.content.store",
+};
+
+bool isStorageProperty(const std::string& key)
+{
+  return std::find(std::begin(StorageProperties), std::end(StorageProperties), key) != std::end(StorageProperties);
+}
+
+uint32_t recordSizeOf(SectionID id)
+{
+  switch (id)
+  {
+  case SectionID::Strings:                    return 1;
+  case SectionID::FileContents:               return 1;
+  case SectionID::Properties:                 return sizeof(PropertyRow);
+  case SectionID::Files:                      return sizeof(FileRow);
+  case SectionID::Includes:                   return sizeof(IncludeRow);
+  case SectionID::Symbols:                    return sizeof(SymbolRow);
+  case SectionID::MacroInfos:                 return sizeof(TextInfoRow);
+  case SectionID::NamespaceAliasInfos:        return sizeof(TextInfoRow);
+  case SectionID::EnumInfos:                  return sizeof(TextInfoRow);
+  case SectionID::EnumConstantInfos:          return sizeof(EnumConstantInfoRow);
+  case SectionID::FunctionInfos:              return sizeof(TextInfoRow);
+  case SectionID::ParameterInfos:             return sizeof(ParameterInfoRow);
+  case SectionID::VariableInfos:              return sizeof(VariableInfoRow);
+  case SectionID::References:                 return sizeof(ReferenceRow);
+  case SectionID::ReferencesByFile:           return sizeof(uint64_t);
+  case SectionID::ReferencesBySymbol:         return sizeof(uint32_t);
+  case SectionID::Declarations:               return sizeof(DeclarationRow);
+  case SectionID::BaseOfs:                    return sizeof(BaseOfRow);
+  case SectionID::Overrides:                  return sizeof(OverrideRow);
+  case SectionID::Diagnostics:                return sizeof(DiagnosticRow);
+  case SectionID::ArgumentsPassedByReference: return sizeof(ArgumentPassedByReferenceRow);
+  default:                                    return 0;
+  }
+}
+
+/**
+ * \brief stores each distinct string once
+ *
+ * The strings themselves are not copied in the map: they must outlive the pool.
+ */
+class StringPool
+{
+private:
+  std::string m_bytes;
+  std::unordered_map<std::string_view, StringRef> m_refs;
+
+public:
+  StringRef add(std::string_view str)
+  {
+    if (str.empty()) {
+      return StringRef{ 0, 0 };
+    }
+
+    auto it = m_refs.find(str);
+
+    if (it != m_refs.end()) {
+      return it->second;
+    }
+
+    if (m_bytes.size() + str.size() > std::numeric_limits<uint32_t>::max()) {
+      throw std::runtime_error("too much text for a columnar snapshot");
+    }
+
+    const StringRef ref{ static_cast<uint32_t>(m_bytes.size()), static_cast<uint32_t>(str.size()) };
+    m_bytes.append(str.data(), str.size());
+    m_refs.emplace(str, ref);
+    return ref;
+  }
+
+  const std::string& bytes() const
+  {
+    return m_bytes;
+  }
+};
+
+struct SectionData
+{
+  SectionID id;
+  std::string bytes;
+};
+
+template<typename T>
+SectionData makeSection(SectionID id, const std::vector<T>& rows)
+{
+  SectionData section{ id, std::string() };
+  section.bytes.resize(rows.size() * sizeof(T));
+
+  if (!rows.empty()) {
+    std::memcpy(section.bytes.data(), rows.data(), section.bytes.size());
+  }
+
+  return section;
+}
+
+// Each kind of symbol extra info is stored in its own section, the traits
+// below convert between the records of the snapshot and these sections.
+
+template<typename T>
+struct InfoTraits;
+
+template<>
+struct InfoTraits<MacroInfo>
+{
+  using Row = TextInfoRow;
+  static constexpr SectionID section = SectionID::MacroInfos;
+
+  static void encode(StringPool& pool, const MacroInfo& info, Row& row) { row.text = pool.add(info.definition); }
+  static void decode(const ColumnarSnapshotReader& r, const Row& row, MacroInfo& info) { info.definition = r.string(row.text); }
+};
+
+template<>
+struct InfoTraits<NamespaceAliasInfo>
+{
+  using Row = TextInfoRow;
+  static constexpr SectionID section = SectionID::NamespaceAliasInfos;
+
+  static void encode(StringPool& pool, const NamespaceAliasInfo& info, Row& row) { row.text = pool.add(info.value); }
+  static void decode(const ColumnarSnapshotReader& r, const Row& row, NamespaceAliasInfo& info) { info.value = r.string(row.text); }
+};
+
+template<>
+struct InfoTraits<EnumInfo>
+{
+  using Row = TextInfoRow;
+  static constexpr SectionID section = SectionID::EnumInfos;
+
+  static void encode(StringPool& pool, const EnumInfo& info, Row& row) { row.text = pool.add(info.underlyingType); }
+  static void decode(const ColumnarSnapshotReader& r, const Row& row, EnumInfo& info) { info.underlyingType = r.string(row.text); }
+};
+
+template<>
+struct InfoTraits<EnumConstantInfo>
+{
+  using Row = EnumConstantInfoRow;
+  static constexpr SectionID section = SectionID::EnumConstantInfos;
+
+  static void encode(StringPool& pool, const EnumConstantInfo& info, Row& row)
+  {
+    row.value = info.value;
+    row.expression = pool.add(info.expression);
+  }
+
+  static void decode(const ColumnarSnapshotReader& r, const Row& row, EnumConstantInfo& info)
+  {
+    info.value = row.value;
+    info.expression = r.string(row.expression);
+  }
+};
+
+template<>
+struct InfoTraits<FunctionInfo>
+{
+  using Row = TextInfoRow;
+  static constexpr SectionID section = SectionID::FunctionInfos;
+
+  static void encode(StringPool& pool, const FunctionInfo& info, Row& row) { row.text = pool.add(info.returnType); }
+  static void decode(const ColumnarSnapshotReader& r, const Row& row, FunctionInfo& info) { info.returnType = r.string(row.text); }
+};
+
+template<>
+struct InfoTraits<ParameterInfo>
+{
+  using Row = ParameterInfoRow;
+  static constexpr SectionID section = SectionID::ParameterInfos;
+
+  static void encode(StringPool& pool, const ParameterInfo& info, Row& row)
+  {
+    row.parameterIndex = info.parameterIndex;
+    row.type = pool.add(info.type);
+    row.defaultValue = pool.add(info.defaultValue);
+  }
+
+  static void decode(const ColumnarSnapshotReader& r, const Row& row, ParameterInfo& info)
+  {
+    info.parameterIndex = row.parameterIndex;
+    info.type = r.string(row.type);
+    info.defaultValue = r.string(row.defaultValue);
+  }
+};
+
+template<>
+struct InfoTraits<VariableInfo>
+{
+  using Row = VariableInfoRow;
+  static constexpr SectionID section = SectionID::VariableInfos;
+
+  static void encode(StringPool& pool, const VariableInfo& info, Row& row)
+  {
+    row.type = pool.add(info.type);
+    row.init = pool.add(info.init);
+  }
+
+  static void decode(const ColumnarSnapshotReader& r, const Row& row, VariableInfo& info)
+  {
+    info.type = r.string(row.type);
+    info.init = r.string(row.init);
+  }
+};
+
+template<typename T>
+SectionData makeInfoSection(StringPool& pool, const std::map<SymbolID, T>& infomap)
+{
+  using Traits = InfoTraits<T>;
+
+  std::vector<typename Traits::Row> rows;
+  rows.reserve(infomap.size());
+
+  for (const auto& [id, info] : infomap)
+  {
+    typename Traits::Row row{};
+    row.id = id.rawID();
+    Traits::encode(pool, info, row);
+    rows.push_back(row);
+  }
+
+  return makeSection(Traits::section, rows);
+}
+
+// Sorts and removes the elements that have the same key, keeping the
+// first one inserted (like INSERT OR IGNORE does in the SQLite snapshot).
+template<typename T, typename K>
+void sortAndRemoveDuplicates(std::vector<T>& elements, K&& key)
+{
+  std::stable_sort(elements.begin(), elements.end(), [&key](const T& a, const T& b) {
+    return key(a) < key(b);
+    });
+
+  auto it = std::unique(elements.begin(), elements.end(), [&key](const T& a, const T& b) {
+    return key(a) == key(b);
+    });
+
+  elements.erase(it, elements.end());
+}
+
+FilePosition positionOf(const DiagnosticRow& row)
+{
+  return FilePosition(static_cast<int>(row.line), static_cast<int>(row.column));
+}
+
+SymbolReference toSymbolReference(const ReferenceRow& row)
+{
+  SymbolReference ref;
+  ref.symbolID = SymbolID::fromRawID(row.symbolID);
+  ref.fileID = row.fileID;
+  ref.position = FilePosition::fromBits(row.position);
+  ref.referencedBySymbolID = SymbolID::fromRawID(row.parentSymbolID);
+  ref.flags = row.flags;
+  return ref;
+}
+
+SymbolDeclaration toSymbolDeclaration(const DeclarationRow& row)
+{
+  SymbolDeclaration decl;
+  decl.symbolID = SymbolID::fromRawID(row.symbolID);
+  decl.fileID = row.fileID;
+  decl.startPosition = FilePosition::fromBits(row.startPosition);
+  decl.endPosition = FilePosition::fromBits(row.endPosition);
+  decl.isDefinition = row.isDefinition != 0;
+  return decl;
+}
+
+BaseOf toBaseOf(const BaseOfRow& row)
+{
+  BaseOf bof;
+  bof.baseClassID = SymbolID::fromRawID(row.baseClassID);
+  bof.derivedClassID = SymbolID::fromRawID(row.derivedClassID);
+  bof.accessSpecifier = static_cast<AccessSpecifier>(row.access);
+  return bof;
+}
+
+Override toOverride(const OverrideRow& row)
+{
+  Override ov;
+  ov.overrideMethodID = SymbolID::fromRawID(row.overrideMethodID);
+  ov.baseMethodID = SymbolID::fromRawID(row.baseMethodID);
+  return ov;
+}
+
+template<typename Row, typename T, typename F>
+std::vector<T> convertRows(const ArrayView<Row>& rows, F&& conv)
+{
+  std::vector<T> result;
+  result.reserve(rows.size());
+
+  for (const Row& row : rows) {
+    result.push_back(conv(row));
+  }
+
+  return result;
+}
+
+} // namespace
+
+ColumnarSnapshotWriter::ColumnarSnapshotWriter() = default;
+ColumnarSnapshotWriter::~ColumnarSnapshotWriter() = default;
+
+void ColumnarSnapshotWriter::setProperty(const std::string& key, const std::string& value)
+{
+  m_properties[key] = value;
+}
+
+void ColumnarSnapshotWriter::insert(const Snapshot::Properties& properties)
+{
+  for (const auto& [key, value] : properties) {
+    setProperty(key, value);
+  }
+}
+
+void ColumnarSnapshotWriter::insertFiles(const std::vector<File>& files)
+{
+  for (const File& f : files)
+  {
+    File& file = m_files[f.id];
+    file = f;
+    file.path = SnapshotWriter::normalizedPath(f.path);
+  }
+}
+
+void ColumnarSnapshotWriter::insertIncludes(const std::vector<Include>& includes)
+{
+  m_includes.insert(m_includes.end(), includes.begin(), includes.end());
+}
+
+void ColumnarSnapshotWriter::insertSymbols(const std::vector<SymbolRecord>& symbols)
+{
+  for (const SymbolRecord& s : symbols) {
+    m_symbols[s.id] = s;
+  }
+}
+
+void ColumnarSnapshotWriter::insertBaseOfs(const std::vector<BaseOf>& bofs)
+{
+  m_bases.insert(m_bases.end(), bofs.begin(), bofs.end());
+}
+
+void ColumnarSnapshotWriter::insertOverrides(const std::vector<Override>& overrides)
+{
+  m_overrides.insert(m_overrides.end(), overrides.begin(), overrides.end());
+}
+
+void ColumnarSnapshotWriter::insertDiagnostics(const std::vector<Diagnostic>& diagnostics)
+{
+  m_diagnostics.insert(m_diagnostics.end(), diagnostics.begin(), diagnostics.end());
+}
+
+void ColumnarSnapshotWriter::insert(const std::vector<ArgumentPassedByReference>& refargs)
+{
+  m_refargs.insert(m_refargs.end(), refargs.begin(), refargs.end());
+}
+
+void ColumnarSnapshotWriter::insert(const std::vector<SymbolReference>& refs)
+{
+  m_references.insert(m_references.end(), refs.begin(), refs.end());
+}
+
+void ColumnarSnapshotWriter::insert(const std::vector<SymbolDeclaration>& declarations)
+{
+  m_declarations.insert(m_declarations.end(), declarations.begin(), declarations.end());
+}
+
+void ColumnarSnapshotWriter::insert(const std::map<SymbolID, EnumConstantInfo>& infomap)
+{
+  m_enum_constant_infos.insert(infomap.begin(), infomap.end());
+}
+
+void ColumnarSnapshotWriter::insert(const std::map<SymbolID, EnumInfo>& infomap)
+{
+  m_enum_infos.insert(infomap.begin(), infomap.end());
+}
+
+void ColumnarSnapshotWriter::insert(const std::map<SymbolID, FunctionInfo>& infomap)
+{
+  m_function_infos.insert(infomap.begin(), infomap.end());
+}
+
+void ColumnarSnapshotWriter::insert(const std::map<SymbolID, MacroInfo>& infomap)
+{
+  m_macro_infos.insert(infomap.begin(), infomap.end());
+}
+
+void ColumnarSnapshotWriter::insert(const std::map<SymbolID, NamespaceAliasInfo>& infomap)
+{
+  m_namespace_alias_infos.insert(infomap.begin(), infomap.end());
+}
+
+void ColumnarSnapshotWriter::insert(const std::map<SymbolID, ParameterInfo>& infomap)
+{
+  m_parameter_infos.insert(infomap.begin(), infomap.end());
+}
+
+void ColumnarSnapshotWriter::insert(const std::map<SymbolID, VariableInfo>& infomap)
+{
+  m_variable_infos.insert(infomap.begin(), infomap.end());
+}
+
+/**
+ * \brief sorts the data and writes the snapshot
+ * \param p  the path of the output file, which is overwritten if it exists
+ *
+ * Throws std::runtime_error on failure.
+ */
+void ColumnarSnapshotWriter::write(const std::filesystem::path& p)
+{
+  StringPool strings;
+  std::string contents;
+  std::vector<SectionData> sections;
+
+  {
+    std::vector<PropertyRow> rows;
+    for (const auto& [key, value] : m_properties) {
+      rows.push_back(PropertyRow{ strings.add(key), strings.add(value) });
+    }
+    sections.push_back(makeSection(SectionID::Properties, rows));
+  }
+
+  {
+    std::vector<FileRow> rows;
+    for (const auto& [id, f] : m_files)
+    {
+      FileRow row{};
+      row.id = id;
+      row.path = strings.add(f.path);
+      row.sha1 = strings.add(f.sha1);
+
+      if (!f.content.empty())
+      {
+        row.flags |= FileRow::HasContent;
+        row.contentOffset = contents.size();
+        row.contentSize = f.content.size();
+        contents += f.content;
+      }
+
+      rows.push_back(row);
+    }
+    sections.push_back(makeSection(SectionID::Files, rows));
+  }
+
+  {
+    sortAndRemoveDuplicates(m_includes, [](const Include& inc) {
+      return std::make_tuple(inc.fileID, inc.line);
+      });
+
+    std::vector<IncludeRow> rows;
+    for (const Include& inc : m_includes) {
+      rows.push_back(IncludeRow{ inc.fileID, inc.line, inc.includedFileID });
+    }
+    sections.push_back(makeSection(SectionID::Includes, rows));
+  }
+
+  {
+    std::vector<SymbolRow> rows;
+    rows.reserve(m_symbols.size());
+    for (const auto& [id, s] : m_symbols)
+    {
+      SymbolRow row{};
+      row.id = id.rawID();
+      row.parentID = s.parentId.rawID();
+      row.name = strings.add(s.name);
+      row.kind = static_cast<uint32_t>(s.kind);
+      row.flags = s.flags;
+      rows.push_back(row);
+    }
+    sections.push_back(makeSection(SectionID::Symbols, rows));
+  }
+
+  sections.push_back(makeInfoSection(strings, m_macro_infos));
+  sections.push_back(makeInfoSection(strings, m_namespace_alias_infos));
+  sections.push_back(makeInfoSection(strings, m_enum_infos));
+  sections.push_back(makeInfoSection(strings, m_enum_constant_infos));
+  sections.push_back(makeInfoSection(strings, m_function_infos));
+  sections.push_back(makeInfoSection(strings, m_parameter_infos));
+  sections.push_back(makeInfoSection(strings, m_variable_infos));
+
+  {
+    sortAndRemoveDuplicates(m_references, [](const SymbolReference& ref) {
+      return std::make_tuple(ref.fileID, ref.position.bits(), ref.symbolID.rawID());
+      });
+
+    if (m_references.size() > std::numeric_limits<uint32_t>::max()) {
+      throw std::runtime_error("too many references for a columnar snapshot");
+    }
+
+    std::vector<ReferenceRow> rows;
+    rows.reserve(m_references.size());
+    for (const SymbolReference& ref : m_references)
+    {
+      ReferenceRow row{};
+      row.symbolID = ref.symbolID.rawID();
+      row.parentSymbolID = ref.referencedBySymbolID.rawID();
+      row.fileID = ref.fileID;
+      row.position = ref.position.bits();
+      row.flags = ref.flags;
+      rows.push_back(row);
+    }
+
+    // by_file[f] is the index of the first reference in file f, or later,
+    // and by_file[f + 1] is the end of the references in file f.
+    const FileID max_file_id = rows.empty() ? 0 : rows.back().fileID;
+    std::vector<uint64_t> by_file(static_cast<size_t>(max_file_id) + 2, 0);
+    for (size_t f(0), i(0); f < by_file.size(); ++f)
+    {
+      while (i < rows.size() && rows[i].fileID < f) {
+        ++i;
+      }
+
+      by_file[f] = i;
+    }
+
+    std::vector<uint32_t> by_symbol(rows.size());
+    std::iota(by_symbol.begin(), by_symbol.end(), 0);
+    std::stable_sort(by_symbol.begin(), by_symbol.end(), [&rows](uint32_t a, uint32_t b) {
+      return rows[a].symbolID < rows[b].symbolID;
+      });
+
+    sections.push_back(makeSection(SectionID::References, rows));
+    sections.push_back(makeSection(SectionID::ReferencesByFile, by_file));
+    sections.push_back(makeSection(SectionID::ReferencesBySymbol, by_symbol));
+  }
+
+  {
+    sortAndRemoveDuplicates(m_declarations, [](const SymbolDeclaration& decl) {
+      return std::make_tuple(decl.symbolID.rawID(), decl.fileID, decl.startPosition.bits(), decl.endPosition.bits(), decl.isDefinition);
+      });
+
+    std::vector<DeclarationRow> rows;
+    for (const SymbolDeclaration& decl : m_declarations)
+    {
+      DeclarationRow row{};
+      row.symbolID = decl.symbolID.rawID();
+      row.fileID = decl.fileID;
+      row.startPosition = decl.startPosition.bits();
+      row.endPosition = decl.endPosition.bits();
+      row.isDefinition = decl.isDefinition ? 1 : 0;
+      rows.push_back(row);
+    }
+    sections.push_back(makeSection(SectionID::Declarations, rows));
+  }
+
+  {
+    sortAndRemoveDuplicates(m_bases, [](const BaseOf& bof) {
+      return std::make_tuple(bof.derivedClassID.rawID(), bof.baseClassID.rawID());
+      });
+
+    std::vector<BaseOfRow> rows;
+    for (const BaseOf& bof : m_bases)
+    {
+      BaseOfRow row{};
+      row.baseClassID = bof.baseClassID.rawID();
+      row.derivedClassID = bof.derivedClassID.rawID();
+      row.access = static_cast<uint32_t>(bof.accessSpecifier);
+      rows.push_back(row);
+    }
+    sections.push_back(makeSection(SectionID::BaseOfs, rows));
+  }
+
+  {
+    // an override has a single base method
+    sortAndRemoveDuplicates(m_overrides, [](const Override& ov) {
+      return ov.overrideMethodID.rawID();
+      });
+
+    std::vector<OverrideRow> rows;
+    for (const Override& ov : m_overrides) {
+      rows.push_back(OverrideRow{ ov.overrideMethodID.rawID(), ov.baseMethodID.rawID() });
+    }
+
+    std::sort(rows.begin(), rows.end(), [](const OverrideRow& a, const OverrideRow& b) {
+      return std::tie(a.baseMethodID, a.overrideMethodID) < std::tie(b.baseMethodID, b.overrideMethodID);
+      });
+    sections.push_back(makeSection(SectionID::Overrides, rows));
+  }
+
+  {
+    sortAndRemoveDuplicates(m_diagnostics, [](const Diagnostic& d) {
+      return std::make_tuple(d.fileID, d.position.line(), d.position.column(), static_cast<int>(d.level), std::string_view(d.message));
+      });
+
+    std::vector<DiagnosticRow> rows;
+    for (const Diagnostic& d : m_diagnostics)
+    {
+      DiagnosticRow row{};
+      row.level = static_cast<uint32_t>(d.level);
+      row.fileID = d.fileID;
+      row.line = static_cast<uint32_t>(d.position.line());
+      row.column = static_cast<uint32_t>(d.position.column());
+      row.message = strings.add(d.message);
+      rows.push_back(row);
+    }
+    sections.push_back(makeSection(SectionID::Diagnostics, rows));
+  }
+
+  {
+    sortAndRemoveDuplicates(m_refargs, [](const ArgumentPassedByReference& refarg) {
+      return std::make_tuple(refarg.fileID, refarg.position.bits());
+      });
+
+    std::vector<ArgumentPassedByReferenceRow> rows;
+    for (const ArgumentPassedByReference& refarg : m_refargs) {
+      rows.push_back(ArgumentPassedByReferenceRow{ refarg.fileID, refarg.position.bits() });
+    }
+    sections.push_back(makeSection(SectionID::ArgumentsPassedByReference, rows));
+  }
+
+  sections.push_back(SectionData{ SectionID::Strings, strings.bytes() });
+  sections.push_back(SectionData{ SectionID::FileContents, std::move(contents) });
+
+  // compute the layout
+  Header header{};
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = FormatVersion;
+  header.byteOrderMark = ByteOrderMark;
+  header.sectionCount = static_cast<uint32_t>(sections.size());
+
+  std::vector<SectionEntry> entries;
+  uint64_t offset = sizeof(Header) + sections.size() * sizeof(SectionEntry);
+
+  for (const SectionData& section : sections)
+  {
+    offset = (offset + 7) & ~uint64_t(7);
+
+    SectionEntry entry{};
+    entry.id = static_cast<uint32_t>(section.id);
+    entry.recordSize = recordSizeOf(section.id);
+    entry.offset = offset;
+    entry.size = section.bytes.size();
+    entries.push_back(entry);
+
+    offset += entry.size;
+  }
+
+  std::ofstream file{ p, std::ios::binary | std::ios::trunc };
+
+  if (!file.good()) {
+    throw std::runtime_error("could not open " + p.u8string() + " for writing");
+  }
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(SectionEntry));
+
+  uint64_t written = sizeof(Header) + entries.size() * sizeof(SectionEntry);
+
+  for (size_t i(0); i < sections.size(); ++i)
+  {
+    const char padding[8] = {};
+    file.write(padding, static_cast<std::streamsize>(entries[i].offset - written));
+    file.write(sections[i].bytes.data(), static_cast<std::streamsize>(sections[i].bytes.size()));
+    written = entries[i].offset + entries[i].size;
+  }
+
+  if (!file.good()) {
+    throw std::runtime_error("could not write columnar snapshot " + p.u8string());
+  }
+}
+
+ColumnarSnapshotReader::ColumnarSnapshotReader() = default;
+ColumnarSnapshotReader::ColumnarSnapshotReader(ColumnarSnapshotReader&&) = default;
+ColumnarSnapshotReader::~ColumnarSnapshotReader() = default;
+ColumnarSnapshotReader& ColumnarSnapshotReader::operator=(ColumnarSnapshotReader&&) = default;
+
+ColumnarSnapshotReader::ColumnarSnapshotReader(const std::filesystem::path& p)
+{
+  if (!open(p))
+  {
+    throw std::runtime_error("could not open columnar snapshot " + p.u8string());
+  }
+}
+
+/**
+ * \brief maps a columnar snapshot in memory
+ * \param p  the path of the snapshot
+ *
+ * Returns false if the file cannot be mapped, is not a columnar snapshot,
+ * was written by a machine with a different byte order or is truncated.
+ */
+bool ColumnarSnapshotReader::open(const std::filesystem::path& p)
+{
+  close();
+
+  if (!m_file.open(p)) {
+    return false;
+  }
+
+  auto fail = [this]() {
+    close();
+    return false;
+    };
+
+  if (m_file.size() < sizeof(Header)) {
+    return fail();
+  }
+
+  Header header;
+  std::memcpy(&header, m_file.data(), sizeof(Header));
+
+  if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != FormatVersion || header.byteOrderMark != ByteOrderMark) {
+    return fail();
+  }
+
+  if ((m_file.size() - sizeof(Header)) / sizeof(SectionEntry) < header.sectionCount) {
+    return fail();
+  }
+
+  for (uint32_t i(0); i < header.sectionCount; ++i)
+  {
+    SectionEntry entry;
+    std::memcpy(&entry, m_file.data() + sizeof(Header) + i * sizeof(SectionEntry), sizeof(SectionEntry));
+
+    const uint32_t expected_size = recordSizeOf(static_cast<SectionID>(entry.id));
+
+    if (expected_size == 0) {
+      continue; // written by a later version of the format
+    }
+
+    if (entry.recordSize != expected_size || entry.size % expected_size != 0 || entry.offset % 8 != 0
+      || entry.offset > m_file.size() || entry.size > m_file.size() - entry.offset)
+    {
+      return fail();
+    }
+
+    m_sections[static_cast<SectionID>(entry.id)] = entry;
+  }
+
+  return true;
+}
+
+bool ColumnarSnapshotReader::isOpen() const
+{
+  return m_file.isOpen();
+}
+
+void ColumnarSnapshotReader::close()
+{
+  m_sections.clear();
+  m_file.close();
+}
+
+/**
+ * \brief returns whether a file starts like a columnar snapshot
+ */
+bool ColumnarSnapshotReader::isColumnarSnapshot(const std::filesystem::path& p)
+{
+  std::ifstream file{ p, std::ios::binary };
+  char magic[sizeof(Magic)] = {};
+  file.read(magic, sizeof(magic));
+  return file.good() && std::memcmp(magic, Magic, sizeof(Magic)) == 0;
+}
+
+std::string_view ColumnarSnapshotReader::bytes(SectionID id) const
+{
+  auto it = m_sections.find(id);
+
+  if (it == m_sections.end()) {
+    return std::string_view();
+  }
+
+  return std::string_view(m_file.data() + it->second.offset, static_cast<size_t>(it->second.size));
+}
+
+template<typename T>
+ArrayView<T> ColumnarSnapshotReader::section(SectionID id) const
+{
+  const std::string_view data = bytes(id);
+  return ArrayView<T>(reinterpret_cast<const T*>(data.data()), data.size() / sizeof(T));
+}
+
+/**
+ * \brief returns a string of the snapshot
+ *
+ * Throws std::runtime_error if the reference is out of bounds.
+ */
+std::string_view ColumnarSnapshotReader::string(StringRef str) const
+{
+  const std::string_view pool = bytes(SectionID::Strings);
+
+  if (str.offset > pool.size() || str.size > pool.size() - str.offset) {
+    throw std::runtime_error("invalid string in columnar snapshot");
+  }
+
+  return pool.substr(str.offset, str.size);
+}
+
+ArrayView<FileRow> ColumnarSnapshotReader::files() const
+{
+  return section<FileRow>(SectionID::Files);
+}
+
+ArrayView<SymbolRow> ColumnarSnapshotReader::symbols() const
+{
+  return section<SymbolRow>(SectionID::Symbols);
+}
+
+ArrayView<ReferenceRow> ColumnarSnapshotReader::references() const
+{
+  return section<ReferenceRow>(SectionID::References);
+}
+
+/**
+ * \brief returns the references in a file, sorted by position
+ */
+ArrayView<ReferenceRow> ColumnarSnapshotReader::referencesInFile(FileID fid) const
+{
+  const ArrayView<ReferenceRow> refs = references();
+  const ArrayView<uint64_t> by_file = section<uint64_t>(SectionID::ReferencesByFile);
+
+  if (static_cast<size_t>(fid) + 1 >= by_file.size()) {
+    return ArrayView<ReferenceRow>();
+  }
+
+  const uint64_t begin = by_file[fid];
+  const uint64_t end = by_file[static_cast<size_t>(fid) + 1];
+
+  if (begin > end || end > refs.size()) {
+    throw std::runtime_error("invalid reference index in columnar snapshot");
+  }
+
+  return ArrayView<ReferenceRow>(refs.data() + begin, static_cast<size_t>(end - begin));
+}
+
+ArrayView<DeclarationRow> ColumnarSnapshotReader::declarations() const
+{
+  return section<DeclarationRow>(SectionID::Declarations);
+}
+
+Snapshot::Properties ColumnarSnapshotReader::readProperties() const
+{
+  Snapshot::Properties result;
+
+  for (const PropertyRow& row : section<PropertyRow>(SectionID::Properties)) {
+    result[std::string(string(row.key))] = std::string(string(row.value));
+  }
+
+  return result;
+}
+
+std::vector<File> ColumnarSnapshotReader::getFiles(bool fetchContent) const
+{
+  std::vector<File> result;
+  result.reserve(files().size());
+
+  for (const FileRow& row : files())
+  {
+    File f;
+    f.id = row.id;
+    f.path = string(row.path);
+    f.sha1 = string(row.sha1);
+
+    if (fetchContent) {
+      f.content = getFileContent(row.id);
+    }
+
+    result.push_back(std::move(f));
+  }
+
+  return result;
+}
+
+static const FileRow* findFile(const ArrayView<FileRow>& files, FileID fid)
+{
+  auto it = std::lower_bound(files.begin(), files.end(), fid, [](const FileRow& row, FileID id) {
+    return row.id < id;
+    });
+
+  return (it != files.end() && it->id == fid) ? it : nullptr;
+}
+
+std::string_view ColumnarSnapshotReader::getFilePath(FileID fid) const
+{
+  const FileRow* row = findFile(files(), fid);
+  return row ? string(row->path) : std::string_view();
+}
+
+/**
+ * \brief returns the content of a file, without copying it
+ *
+ * An empty string is returned if the file does not exist or its content
+ * was not captured.
+ */
+std::string_view ColumnarSnapshotReader::getFileContent(FileID fid) const
+{
+  const FileRow* row = findFile(files(), fid);
+
+  if (!row || !(row->flags & FileRow::HasContent)) {
+    return std::string_view();
+  }
+
+  const std::string_view contents = bytes(SectionID::FileContents);
+
+  if (row->contentOffset > contents.size() || row->contentSize > contents.size() - row->contentOffset) {
+    throw std::runtime_error("invalid file content in columnar snapshot");
+  }
+
+  return contents.substr(static_cast<size_t>(row->contentOffset), static_cast<size_t>(row->contentSize));
+}
+
+std::vector<Include> ColumnarSnapshotReader::getIncludes() const
+{
+  return convertRows<IncludeRow, Include>(section<IncludeRow>(SectionID::Includes), [](const IncludeRow& row) {
+    Include inc;
+    inc.fileID = row.fileID;
+    inc.line = row.line;
+    inc.includedFileID = row.includedFileID;
+    return inc;
+    });
+}
+
+const SymbolRow* ColumnarSnapshotReader::findSymbol(SymbolID id) const
+{
+  const ArrayView<SymbolRow> rows = symbols();
+
+  auto it = std::lower_bound(rows.begin(), rows.end(), id.rawID(), [](const SymbolRow& row, uint64_t rawID) {
+    return row.id < rawID;
+    });
+
+  return (it != rows.end() && it->id == id.rawID()) ? it : nullptr;
+}
+
+std::vector<SymbolRecord> ColumnarSnapshotReader::getSymbols() const
+{
+  return convertRows<SymbolRow, SymbolRecord>(symbols(), [this](const SymbolRow& row) {
+    SymbolRecord s;
+    s.id = SymbolID::fromRawID(row.id);
+    s.kind = static_cast<SymbolKind>(row.kind);
+    s.name = string(row.name);
+    s.parentId = SymbolID::fromRawID(row.parentID);
+    s.flags = row.flags;
+    return s;
+    });
+}
+
+/**
+ * \brief returns a symbol by its id
+ *
+ * The returned record has an invalid id if the symbol does not exist.
+ */
+SymbolRecord ColumnarSnapshotReader::getSymbolById(SymbolID id) const
+{
+  SymbolRecord s;
+  const SymbolRow* row = findSymbol(id);
+
+  if (row)
+  {
+    s.id = id;
+    s.kind = static_cast<SymbolKind>(row->kind);
+    s.name = string(row->name);
+    s.parentId = SymbolID::fromRawID(row->parentID);
+    s.flags = row->flags;
+  }
+
+  return s;
+}
+
+/**
+ * \brief returns the extra info of the symbols of a given kind
+ *
+ * T is one of MacroInfo, NamespaceAliasInfo, EnumInfo, EnumConstantInfo,
+ * FunctionInfo, ParameterInfo or VariableInfo.
+ */
+template<typename T>
+std::map<SymbolID, T> ColumnarSnapshotReader::getSymbolInfos() const
+{
+  using Traits = InfoTraits<T>;
+
+  std::map<SymbolID, T> result;
+
+  for (const auto& row : section<typename Traits::Row>(Traits::section))
+  {
+    T& info = result[SymbolID::fromRawID(row.id)];
+    Traits::decode(*this, row, info);
+  }
+
+  return result;
+}
+
+template std::map<SymbolID, MacroInfo> ColumnarSnapshotReader::getSymbolInfos<MacroInfo>() const;
+template std::map<SymbolID, NamespaceAliasInfo> ColumnarSnapshotReader::getSymbolInfos<NamespaceAliasInfo>() const;
+template std::map<SymbolID, EnumInfo> ColumnarSnapshotReader::getSymbolInfos<EnumInfo>() const;
+template std::map<SymbolID, EnumConstantInfo> ColumnarSnapshotReader::getSymbolInfos<EnumConstantInfo>() const;
+template std::map<SymbolID, FunctionInfo> ColumnarSnapshotReader::getSymbolInfos<FunctionInfo>() const;
+template std::map<SymbolID, ParameterInfo> ColumnarSnapshotReader::getSymbolInfos<ParameterInfo>() const;
+template std::map<SymbolID, VariableInfo> ColumnarSnapshotReader::getSymbolInfos<VariableInfo>() const;
+
+std::vector<SymbolReference> ColumnarSnapshotReader::getSymbolReferences() const
+{
+  return convertRows<ReferenceRow, SymbolReference>(references(), toSymbolReference);
+}
+
+/**
+ * \brief returns the references to a symbol, sorted by file and position
+ */
+std::vector<SymbolReference> ColumnarSnapshotReader::findReferences(SymbolID symbolID) const
+{
+  const ArrayView<ReferenceRow> refs = references();
+  const ArrayView<uint32_t> by_symbol = section<uint32_t>(SectionID::ReferencesBySymbol);
+
+  if (by_symbol.size() != refs.size()) {
+    throw std::runtime_error("invalid reference index in columnar snapshot");
+  }
+
+  auto range = std::equal_range(by_symbol.begin(), by_symbol.end(), symbolID.rawID(), [&refs](const auto& a, const auto& b) {
+    if constexpr (std::is_same_v<std::decay_t<decltype(a)>, uint32_t>) {
+      return refs[a].symbolID < b;
+    } else {
+      return a < refs[b].symbolID;
+    }
+    });
+
+  std::vector<SymbolReference> result;
+  result.reserve(std::distance(range.first, range.second));
+
+  for (auto it = range.first; it != range.second; ++it) {
+    result.push_back(toSymbolReference(refs[*it]));
+  }
+
+  return result;
+}
+
+std::vector<SymbolDeclaration> ColumnarSnapshotReader::getSymbolDeclarations() const
+{
+  return convertRows<DeclarationRow, SymbolDeclaration>(declarations(), toSymbolDeclaration);
+}
+
+std::vector<SymbolDeclaration> ColumnarSnapshotReader::getSymbolDeclarations(SymbolID symbolID) const
+{
+  const ArrayView<DeclarationRow> rows = declarations();
+
+  auto begin = std::lower_bound(rows.begin(), rows.end(), symbolID.rawID(), [](const DeclarationRow& row, uint64_t id) {
+    return row.symbolID < id;
+    });
+
+  auto end = std::upper_bound(begin, rows.end(), symbolID.rawID(), [](uint64_t id, const DeclarationRow& row) {
+    return id < row.symbolID;
+    });
+
+  return convertRows<DeclarationRow, SymbolDeclaration>(ArrayView<DeclarationRow>(begin, end - begin), toSymbolDeclaration);
+}
+
+std::vector<BaseOf> ColumnarSnapshotReader::getBases() const
+{
+  return convertRows<BaseOfRow, BaseOf>(section<BaseOfRow>(SectionID::BaseOfs), toBaseOf);
+}
+
+/**
+ * \brief returns the base classes of a class
+ */
+std::vector<BaseOf> ColumnarSnapshotReader::getBasesOf(SymbolID classID) const
+{
+  const ArrayView<BaseOfRow> rows = section<BaseOfRow>(SectionID::BaseOfs);
+
+  auto begin = std::lower_bound(rows.begin(), rows.end(), classID.rawID(), [](const BaseOfRow& row, uint64_t id) {
+    return row.derivedClassID < id;
+    });
+
+  auto end = std::upper_bound(begin, rows.end(), classID.rawID(), [](uint64_t id, const BaseOfRow& row) {
+    return id < row.derivedClassID;
+    });
+
+  return convertRows<BaseOfRow, BaseOf>(ArrayView<BaseOfRow>(begin, end - begin), toBaseOf);
+}
+
+std::vector<Override> ColumnarSnapshotReader::getOverrides() const
+{
+  return convertRows<OverrideRow, Override>(section<OverrideRow>(SectionID::Overrides), toOverride);
+}
+
+/**
+ * \brief returns the overrides of a virtual method
+ */
+std::vector<Override> ColumnarSnapshotReader::getOverridesOf(SymbolID methodID) const
+{
+  const ArrayView<OverrideRow> rows = section<OverrideRow>(SectionID::Overrides);
+
+  auto begin = std::lower_bound(rows.begin(), rows.end(), methodID.rawID(), [](const OverrideRow& row, uint64_t id) {
+    return row.baseMethodID < id;
+    });
+
+  auto end = std::upper_bound(begin, rows.end(), methodID.rawID(), [](uint64_t id, const OverrideRow& row) {
+    return id < row.baseMethodID;
+    });
+
+  return convertRows<OverrideRow, Override>(ArrayView<OverrideRow>(begin, end - begin), toOverride);
+}
+
+std::vector<Diagnostic> ColumnarSnapshotReader::getDiagnostics() const
+{
+  return convertRows<DiagnosticRow, Diagnostic>(section<DiagnosticRow>(SectionID::Diagnostics), [this](const DiagnosticRow& row) {
+    Diagnostic d;
+    d.level = static_cast<DiagnosticLevel>(row.level);
+    d.fileID = row.fileID;
+    d.position = positionOf(row);
+    d.message = string(row.message);
+    return d;
+    });
+}
+
+std::vector<ArgumentPassedByReference> ColumnarSnapshotReader::getArgumentsPassedByReference() const
+{
+  return convertRows<ArgumentPassedByReferenceRow, ArgumentPassedByReference>(section<ArgumentPassedByReferenceRow>(SectionID::ArgumentsPassedByReference),
+    [](const ArgumentPassedByReferenceRow& row) {
+      ArgumentPassedByReference refarg;
+      refarg.fileID = row.fileID;
+      refarg.position = FilePosition::fromBits(row.position);
+      return refarg;
+    });
+}
+
+namespace
+{
+
+template<typename T, typename F>
+std::map<SymbolID, T> readSymbolInfos(Database& db, const char* query, F&& fill)
+{
+  std::map<SymbolID, T> result;
+  sql::Statement stmt{ db, query };
+
+  while (stmt.fetchNextRow())
+  {
+    T& info = result[SymbolID::fromRawID(stmt.columnInt64(0))];
+    fill(stmt, info);
+  }
+
+  return result;
+}
+
+} // namespace
+
+/**
+ * \brief converts a SQLite snapshot to the columnar format
+ * \param input   the path of the SQLite snapshot
+ * \param output  the path of the columnar snapshot
+ *
+ * The content of the files is always stored uncompressed, even if it was
+ * compressed or in a blob store in the SQLite snapshot.
+ * Throws std::runtime_error on failure.
+ */
+void convertToColumnarSnapshot(const std::filesystem::path& input, const std::filesystem::path& output)
+{
+  SnapshotReader reader{ input };
+  Database& db = reader.database();
+  ColumnarSnapshotWriter writer;
+
+  for (const auto& [key, value] : reader.readProperties())
+  {
+    if (!isStorageProperty(key)) {
+      writer.setProperty(key, value);
+    }
+  }
+
+  writer.insertFiles(reader.getFiles(true));
+  writer.insertIncludes(reader.getIncludes());
+
+  {
+    sql::Statement stmt{ db, "SELECT id, kind, parent, name, flags FROM symbol" };
+
+    writer.insertSymbols(sql::readRowsAsVector<SymbolRecord>(stmt, [](sql::Statement& row) {
+      SymbolRecord s;
+      s.id = SymbolID::fromRawID(row.columnInt64(0));
+      s.kind = static_cast<SymbolKind>(row.columnInt(1));
+      s.parentId = SymbolID::fromRawID(row.nullColumn(2) ? 0 : row.columnInt64(2));
+      s.name = row.column(3);
+      s.flags = row.columnInt(4);
+      return s;
+      }));
+  }
+
+  writer.insert(readSymbolInfos<MacroInfo>(db, "SELECT id, definition FROM macroInfo", [](sql::Statement& row, MacroInfo& info) {
+    info.definition = row.column(1);
+    }));
+  writer.insert(readSymbolInfos<NamespaceAliasInfo>(db, "SELECT id, value FROM namespaceAliasInfo", [](sql::Statement& row, NamespaceAliasInfo& info) {
+    info.value = row.column(1);
+    }));
+  writer.insert(readSymbolInfos<EnumInfo>(db, "SELECT id, integerType FROM enumInfo", [](sql::Statement& row, EnumInfo& info) {
+    info.underlyingType = row.column(1);
+    }));
+  writer.insert(readSymbolInfos<EnumConstantInfo>(db, "SELECT id, value, expression FROM enumConstantInfo", [](sql::Statement& row, EnumConstantInfo& info) {
+    info.value = row.columnInt64(1);
+    info.expression = row.column(2);
+    }));
+  writer.insert(readSymbolInfos<FunctionInfo>(db, "SELECT id, returnType FROM functionInfo", [](sql::Statement& row, FunctionInfo& info) {
+    info.returnType = row.column(1);
+    }));
+  writer.insert(readSymbolInfos<ParameterInfo>(db, "SELECT id, parameterIndex, type, defaultValue FROM parameterInfo", [](sql::Statement& row, ParameterInfo& info) {
+    info.parameterIndex = row.columnInt(1);
+    info.type = row.column(2);
+    info.defaultValue = row.column(3);
+    }));
+  writer.insert(readSymbolInfos<VariableInfo>(db, "SELECT id, type, init FROM variableInfo", [](sql::Statement& row, VariableInfo& info) {
+    info.type = row.column(1);
+    info.init = row.column(2);
+    }));
+
+  writer.insert(reader.getSymbolReferences());
+  writer.insert(reader.getSymbolDeclarations());
+  writer.insertBaseOfs(reader.getBases());
+  writer.insertOverrides(reader.getOverrides());
+  writer.insertDiagnostics(reader.getDiagnostics());
+  writer.insert(reader.getArgumentsPassedByReference());
+
+  writer.write(output);
+}
+
+/**
+ * \brief converts a columnar snapshot to a SQLite snapshot
+ * \param input    the path of the columnar snapshot
+ * \param output   the path of the SQLite snapshot, which must not exist
+ * \param profile  the profile used to write the SQLite snapshot
+ *
+ * Throws std::runtime_error on failure.
+ */
+void convertToSQLiteSnapshot(const std::filesystem::path& input, const std::filesystem::path& output, DatabaseProfile profile)
+{
+  ColumnarSnapshotReader reader{ input };
+
+  if (std::filesystem::exists(output)) {
+    throw std::runtime_error("output file already exists: " + output.u8string());
+  }
+
+  {
+    SnapshotWriter writer{ output, profile };
+    writer.beginTransaction();
+
+    writer.insert(reader.readProperties());
+
+    {
+      std::vector<File> files = reader.getFiles(true);
+      writer.insertFilePaths(files);
+      writer.insertFiles(files);
+    }
+
+    writer.insertIncludes(reader.getIncludes());
+
+    {
+      // the names are views into the mapped file, which outlives the writer
+      std::vector<IndexerSymbol> symbols;
+      symbols.reserve(reader.symbols().size());
+
+      for (const SymbolRow& row : reader.symbols())
+      {
+        IndexerSymbol s;
+        s.id = SymbolID::fromRawID(row.id);
+        s.kind = static_cast<SymbolKind>(row.kind);
+        s.name = reader.string(row.name);
+        s.parentId = SymbolID::fromRawID(row.parentID);
+        s.flags = row.flags;
+        symbols.push_back(std::move(s));
+      }
+
+      std::vector<const IndexerSymbol*> pointers;
+      pointers.reserve(symbols.size());
+
+      for (const IndexerSymbol& s : symbols) {
+        pointers.push_back(&s);
+      }
+
+      writer.insertSymbols(pointers);
+    }
+
+    writer.insert(reader.getSymbolInfos<MacroInfo>());
+    writer.insert(reader.getSymbolInfos<NamespaceAliasInfo>());
+    writer.insert(reader.getSymbolInfos<EnumInfo>());
+    writer.insert(reader.getSymbolInfos<EnumConstantInfo>());
+    writer.insert(reader.getSymbolInfos<FunctionInfo>());
+    writer.insert(reader.getSymbolInfos<ParameterInfo>());
+    writer.insert(reader.getSymbolInfos<VariableInfo>());
+
+    writer.insert(reader.getSymbolReferences());
+    writer.insert(reader.getSymbolDeclarations());
+    writer.insertBaseOfs(reader.getBases());
+    writer.insertOverrides(reader.getOverrides());
+    writer.insertDiagnostics(reader.getDiagnostics());
+    writer.insert(reader.getArgumentsPassedByReference());
+
+    writer.endTransaction();
+    writer.createIndexes();
+    writer.close();
+  }
+
+  if (profile == DatabaseProfile::Publish) {
+    SnapshotWriter::publish(output);
+  }
+}
+
+} // namespace cppscanner
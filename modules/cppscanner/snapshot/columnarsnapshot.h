@@ -0,0 +1,365 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_COLUMNARSNAPSHOT_H
+#define CPPSCANNER_COLUMNARSNAPSHOT_H
+
+#include "databaseprofile.h"
+#include "snapshot.h"
+
+#include "cppscanner/base/mappedfile.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cppscanner
+{
+
+/**
+ * \brief the on-disk layout of columnar snapshots
+ *
+ * A columnar snapshot is a single file made of a header, a section table
+ * and sections aligned on 8 bytes.
+ * Each section is an array of fixed-width records (or the bytes of a string
+ * pool), sorted so that lookups are done by binary search; strings are
+ * stored as (offset, size) pairs into the "Strings" section and the content
+ * of files in the "FileContents" section.
+ * Integers are stored in the byte order of the machine that wrote the file,
+ * which is checked when the file is opened.
+ */
+namespace columnar
+{
+
+constexpr char Magic[8] = { 'C', 'P', 'P', 'S', 'C', 'O', 'L', '\n' };
+constexpr uint32_t FormatVersion = 1;
+constexpr uint32_t ByteOrderMark = 0x01020304;
+
+enum class SectionID : uint32_t
+{
+  Strings = 1,
+  FileContents,
+  Properties,
+  Files,                      //< sorted by id
+  Includes,                   //< sorted by (file, line, included file)
+  Symbols,                    //< sorted by id
+  MacroInfos,                 //< the *Infos sections are sorted by symbol id
+  NamespaceAliasInfos,
+  EnumInfos,
+  EnumConstantInfos,
+  FunctionInfos,
+  ParameterInfos,
+  VariableInfos,
+  References,                 //< sorted by (file, position, symbol)
+  ReferencesByFile,           //< index of the first reference of each file id
+  ReferencesBySymbol,         //< indices of the references sorted by (symbol, file, position)
+  Declarations,               //< sorted by (symbol, file, position)
+  BaseOfs,                    //< sorted by (derived class, base class)
+  Overrides,                  //< sorted by (base method, override)
+  Diagnostics,                //< sorted by (file, line, column)
+  ArgumentsPassedByReference, //< sorted by (file, position)
+};
+
+struct Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrderMark;
+  uint32_t sectionCount;
+  uint32_t reserved;
+};
+
+struct SectionEntry
+{
+  uint32_t id;
+  uint32_t recordSize;
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct StringRef
+{
+  uint32_t offset;
+  uint32_t size;
+};
+
+struct PropertyRow
+{
+  StringRef key;
+  StringRef value;
+};
+
+struct FileRow
+{
+  enum Flag
+  {
+    HasContent = 1,
+  };
+
+  uint32_t id;
+  uint32_t flags;
+  StringRef path;
+  StringRef sha1;
+  uint64_t contentOffset;
+  uint64_t contentSize;
+};
+
+struct IncludeRow
+{
+  uint32_t fileID;
+  int32_t line;
+  uint32_t includedFileID;
+};
+
+struct SymbolRow
+{
+  uint64_t id;
+  uint64_t parentID; //< zero if the symbol has no parent
+  StringRef name;
+  uint32_t kind;
+  int32_t flags;
+};
+
+// macro definition, namespace alias value, enum underlying type
+// and function return type
+struct TextInfoRow
+{
+  uint64_t id;
+  StringRef text;
+};
+
+struct EnumConstantInfoRow
+{
+  uint64_t id;
+  int64_t value;
+  StringRef expression;
+};
+
+struct ParameterInfoRow
+{
+  uint64_t id;
+  int32_t parameterIndex;
+  uint32_t reserved;
+  StringRef type;
+  StringRef defaultValue;
+};
+
+struct VariableInfoRow
+{
+  uint64_t id;
+  StringRef type;
+  StringRef init;
+};
+
+struct ReferenceRow
+{
+  uint64_t symbolID;
+  uint64_t parentSymbolID; //< zero if the reference is not inside a symbol
+  uint32_t fileID;
+  uint32_t position; //< see FilePosition::bits()
+  int32_t flags;
+  uint32_t reserved;
+};
+
+struct DeclarationRow
+{
+  uint64_t symbolID;
+  uint32_t fileID;
+  uint32_t startPosition;
+  uint32_t endPosition;
+  uint32_t isDefinition;
+};
+
+struct BaseOfRow
+{
+  uint64_t baseClassID;
+  uint64_t derivedClassID;
+  uint32_t access;
+  uint32_t reserved;
+};
+
+struct OverrideRow
+{
+  uint64_t overrideMethodID;
+  uint64_t baseMethodID;
+};
+
+struct DiagnosticRow
+{
+  uint32_t level;
+  uint32_t fileID;
+  uint32_t line;
+  uint32_t column;
+  StringRef message;
+};
+
+struct ArgumentPassedByReferenceRow
+{
+  uint32_t fileID;
+  uint32_t position;
+};
+
+/**
+ * \brief a read-only view of an array of records
+ */
+template<typename T>
+class ArrayView
+{
+private:
+  const T* m_data = nullptr;
+  size_t m_size = 0;
+
+public:
+  ArrayView() = default;
+  ArrayView(const T* data, size_t size) : m_data(data), m_size(size) { }
+
+  const T* data() const { return m_data; }
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  const T* begin() const { return m_data; }
+  const T* end() const { return m_data + m_size; }
+
+  const T& operator[](size_t i) const { return m_data[i]; }
+};
+
+} // namespace columnar
+
+/**
+ * \brief writes a snapshot in the columnar format
+ *
+ * Unlike SnapshotWriter, which writes rows as they are inserted, this class
+ * keeps all the data in memory until write() sorts it and writes the file.
+ */
+class ColumnarSnapshotWriter
+{
+public:
+  ColumnarSnapshotWriter();
+  ColumnarSnapshotWriter(const ColumnarSnapshotWriter&) = delete;
+  ~ColumnarSnapshotWriter();
+
+  void setProperty(const std::string& key, const std::string& value);
+  void insert(const Snapshot::Properties& properties);
+
+  void insertFiles(const std::vector<File>& files);
+  void insertIncludes(const std::vector<Include>& includes);
+  void insertSymbols(const std::vector<SymbolRecord>& symbols);
+  void insertBaseOfs(const std::vector<BaseOf>& bofs);
+  void insertOverrides(const std::vector<Override>& overrides);
+  void insertDiagnostics(const std::vector<Diagnostic>& diagnostics);
+  void insert(const std::vector<ArgumentPassedByReference>& refargs);
+  void insert(const std::vector<SymbolReference>& refs);
+  void insert(const std::vector<SymbolDeclaration>& declarations);
+
+  void insert(const std::map<SymbolID, EnumConstantInfo>& infomap);
+  void insert(const std::map<SymbolID, EnumInfo>& infomap);
+  void insert(const std::map<SymbolID, FunctionInfo>& infomap);
+  void insert(const std::map<SymbolID, MacroInfo>& infomap);
+  void insert(const std::map<SymbolID, NamespaceAliasInfo>& infomap);
+  void insert(const std::map<SymbolID, ParameterInfo>& infomap);
+  void insert(const std::map<SymbolID, VariableInfo>& infomap);
+
+  void write(const std::filesystem::path& p);
+
+private:
+  Snapshot::Properties m_properties;
+  std::map<FileID, File> m_files;
+  std::vector<Include> m_includes;
+  std::map<SymbolID, SymbolRecord> m_symbols;
+  std::map<SymbolID, MacroInfo> m_macro_infos;
+  std::map<SymbolID, NamespaceAliasInfo> m_namespace_alias_infos;
+  std::map<SymbolID, EnumInfo> m_enum_infos;
+  std::map<SymbolID, EnumConstantInfo> m_enum_constant_infos;
+  std::map<SymbolID, FunctionInfo> m_function_infos;
+  std::map<SymbolID, ParameterInfo> m_parameter_infos;
+  std::map<SymbolID, VariableInfo> m_variable_infos;
+  std::vector<SymbolReference> m_references;
+  std::vector<SymbolDeclaration> m_declarations;
+  std::vector<BaseOf> m_bases;
+  std::vector<Override> m_overrides;
+  std::vector<Diagnostic> m_diagnostics;
+  std::vector<ArgumentPassedByReference> m_refargs;
+};
+
+/**
+ * \brief reads a snapshot in the columnar format
+ *
+ * The file is mapped in memory and the functions returning views
+ * (e.g., referencesInFile()) do not copy anything; the views remain
+ * valid until the reader is closed.
+ */
+class ColumnarSnapshotReader
+{
+public:
+  ColumnarSnapshotReader();
+  ColumnarSnapshotReader(const ColumnarSnapshotReader&) = delete;
+  ColumnarSnapshotReader(ColumnarSnapshotReader&&);
+  ~ColumnarSnapshotReader();
+
+  explicit ColumnarSnapshotReader(const std::filesystem::path& p);
+
+  bool open(const std::filesystem::path& p);
+  bool isOpen() const;
+  void close();
+
+  static bool isColumnarSnapshot(const std::filesystem::path& p);
+
+  std::string_view string(columnar::StringRef str) const;
+
+  columnar::ArrayView<columnar::FileRow> files() const;
+  columnar::ArrayView<columnar::SymbolRow> symbols() const;
+  columnar::ArrayView<columnar::ReferenceRow> references() const;
+  columnar::ArrayView<columnar::ReferenceRow> referencesInFile(FileID fid) const;
+  columnar::ArrayView<columnar::DeclarationRow> declarations() const;
+
+  Snapshot::Properties readProperties() const;
+
+  std::vector<File> getFiles(bool fetchContent = false) const;
+  std::string_view getFilePath(FileID fid) const;
+  std::string_view getFileContent(FileID fid) const;
+  std::vector<Include> getIncludes() const;
+
+  const columnar::SymbolRow* findSymbol(SymbolID id) const;
+  std::vector<SymbolRecord> getSymbols() const;
+  SymbolRecord getSymbolById(SymbolID id) const;
+
+  template<typename T>
+  std::map<SymbolID, T> getSymbolInfos() const;
+
+  std::vector<SymbolReference> getSymbolReferences() const;
+  std::vector<SymbolReference> findReferences(SymbolID symbolID) const;
+
+  std::vector<SymbolDeclaration> getSymbolDeclarations() const;
+  std::vector<SymbolDeclaration> getSymbolDeclarations(SymbolID symbolID) const;
+
+  std::vector<BaseOf> getBases() const;
+  std::vector<BaseOf> getBasesOf(SymbolID classID) const;
+  std::vector<Override> getOverrides() const;
+  std::vector<Override> getOverridesOf(SymbolID methodID) const;
+
+  std::vector<Diagnostic> getDiagnostics() const;
+  std::vector<ArgumentPassedByReference> getArgumentsPassedByReference() const;
+
+  ColumnarSnapshotReader& operator=(ColumnarSnapshotReader&&);
+
+private:
+  template<typename T>
+  columnar::ArrayView<T> section(columnar::SectionID id) const;
+  std::string_view bytes(columnar::SectionID id) const;
+
+private:
+  MappedFile m_file;
+  std::map<columnar::SectionID, columnar::SectionEntry> m_sections;
+};
+
+void convertToColumnarSnapshot(const std::filesystem::path& input, const std::filesystem::path& output);
+void convertToSQLiteSnapshot(const std::filesystem::path& input, const std::filesystem::path& output, DatabaseProfile profile = DatabaseProfile::Default);
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_COLUMNARSNAPSHOT_H
@@ -0,0 +1,169 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "compression.h"
+
+#include "cppscanner/database/sql.h"
+
+#include <stdexcept>
+
+#ifdef CPPSCANNER_HAS_ZSTD
+#include <zstd.h>
+#endif // CPPSCANNER_HAS_ZSTD
+
+namespace cppscanner
+{
+
+namespace
+{
+
+#ifdef CPPSCANNER_HAS_ZSTD
+
+// Higher levels compress source code only slightly better but are much slower.
+constexpr int ZstdCompressionLevel = 3;
+
+std::string zstdCompress(std::string_view text)
+{
+  std::string result;
+  result.resize(ZSTD_compressBound(text.size()));
+
+  const size_t n = ZSTD_compress(result.data(), result.size(), text.data(), text.size(), ZstdCompressionLevel);
+
+  if (ZSTD_isError(n)) {
+    throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(n));
+  }
+
+  result.resize(n);
+  return result;
+}
+
+std::string zstdDecompress(std::string_view data)
+{
+  // frames produced by ZSTD_compress() always record the size of the content
+  const unsigned long long size = ZSTD_getFrameContentSize(data.data(), data.size());
+
+  if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN) {
+    throw std::runtime_error("invalid zstd frame");
+  }
+
+  std::string result;
+  result.resize(static_cast<size_t>(size));
+
+  const size_t n = ZSTD_decompress(result.data(), result.size(), data.data(), data.size());
+
+  if (ZSTD_isError(n) || n != result.size()) {
+    throw std::runtime_error("zstd decompression failed");
+  }
+
+  return result;
+}
+
+#endif // CPPSCANNER_HAS_ZSTD
+
+[[noreturn]] void throwUnavailable(FileContentCodec codec)
+{
+  throw std::runtime_error("cppscanner was built without support for " + std::string(getFileContentCodecString(codec)));
+}
+
+void sqlZstdDecompress(sqlite3_context* context, int /* argc */, sqlite3_value** argv)
+{
+  if (sqlite3_value_type(argv[0]) == SQLITE_NULL)
+  {
+    sqlite3_result_null(context);
+    return;
+  }
+
+  const char* bytes = static_cast<const char*>(sqlite3_value_blob(argv[0]));
+  const int len = sqlite3_value_bytes(argv[0]);
+
+  try
+  {
+    const std::string text = decompress(FileContentCodec::Zstd, std::string_view(bytes, len));
+    sqlite3_result_text(context, text.data(), static_cast<int>(text.size()), SQLITE_TRANSIENT);
+  }
+  catch (const std::exception& ex)
+  {
+    sqlite3_result_error(context, ex.what(), -1);
+  }
+}
+
+} // namespace
+
+/**
+ * \brief returns whether cppscanner was built with support for a codec
+ */
+bool isCodecAvailable(FileContentCodec codec)
+{
+  switch (codec)
+  {
+  case FileContentCodec::None:
+    return true;
+  case FileContentCodec::Zstd:
+#ifdef CPPSCANNER_HAS_ZSTD
+    return true;
+#else
+    return false;
+#endif // CPPSCANNER_HAS_ZSTD
+  default:
+    return false;
+  }
+}
+
+/**
+ * \brief compresses the content of a file
+ *
+ * Throws std::runtime_error if the codec is not available.
+ */
+std::string compress(FileContentCodec codec, std::string_view text)
+{
+  switch (codec)
+  {
+  case FileContentCodec::None:
+    return std::string(text);
+  case FileContentCodec::Zstd:
+#ifdef CPPSCANNER_HAS_ZSTD
+    return zstdCompress(text);
+#else
+    throwUnavailable(codec);
+#endif // CPPSCANNER_HAS_ZSTD
+  default:
+    throwUnavailable(codec);
+  }
+}
+
+/**
+ * \brief decompresses data produced by compress()
+ *
+ * Throws std::runtime_error if the codec is not available or the data is invalid.
+ */
+std::string decompress(FileContentCodec codec, std::string_view data)
+{
+  switch (codec)
+  {
+  case FileContentCodec::None:
+    return std::string(data);
+  case FileContentCodec::Zstd:
+#ifdef CPPSCANNER_HAS_ZSTD
+    return zstdDecompress(data);
+#else
+    throwUnavailable(codec);
+#endif // CPPSCANNER_HAS_ZSTD
+  default:
+    throwUnavailable(codec);
+  }
+}
+
+/**
+ * \brief registers the SQL functions used by the "fileContent" view
+ *
+ * The function zstd_decompress(blob) returns the text stored in a zstd frame,
+ * or raises an error if cppscanner was built without zstd.
+ */
+void registerDecompressionFunctions(Database& db)
+{
+  sqlite3_create_function(db.sqliteHandle(), "zstd_decompress", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+    nullptr, &sqlZstdDecompress, nullptr, nullptr);
+}
+
+} // namespace cppscanner
@@ -0,0 +1,65 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_COMPRESSION_H
+#define CPPSCANNER_COMPRESSION_H
+
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace cppscanner
+{
+
+class Database;
+
+/**
+ * \brief the codecs that can be used to store the content of files in a snapshot
+ */
+enum class FileContentCodec
+{
+  /**
+   * the content is stored as text in the "content" column of the "file" table
+   */
+  None,
+  /**
+   * the content is stored as a zstd frame in the "compressedContent" column
+   * of the "file" table
+   */
+  Zstd,
+};
+
+inline std::string_view getFileContentCodecString(FileContentCodec c)
+{
+  switch (c)
+  {
+  case FileContentCodec::None: return "none";
+  case FileContentCodec::Zstd: return "zstd";
+  default:                     return "none";
+  }
+}
+
+inline std::optional<FileContentCodec> parseFileContentCodec(std::string_view str)
+{
+  for (FileContentCodec c : { FileContentCodec::None, FileContentCodec::Zstd })
+  {
+    if (getFileContentCodecString(c) == str) {
+      return c;
+    }
+  }
+
+  return std::nullopt;
+}
+
+bool isCodecAvailable(FileContentCodec codec);
+
+std::string compress(FileContentCodec codec, std::string_view text);
+std::string decompress(FileContentCodec codec, std::string_view data);
+
+void registerDecompressionFunctions(Database& db);
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_COMPRESSION_H
@@ -0,0 +1,64 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_DATABASEPROFILE_H
+#define CPPSCANNER_DATABASEPROFILE_H
+
+#include <initializer_list>
+#include <optional>
+#include <string_view>
+
+namespace cppscanner
+{
+
+/**
+ * \brief controls the SQLite settings used while writing a snapshot
+ */
+enum class DatabaseProfile
+{
+  /**
+   * the SQLite defaults are used: the database is consistent on disk
+   * after each transaction (this is the default).
+   */
+  Default,
+  /**
+   * settings tuned for bulk writing: exclusive locking, no journal, no sync,
+   * a large page cache and temporary tables in memory.
+   * The database is very likely to be corrupted if the process is interrupted.
+   */
+  Build,
+  /**
+   * same as Build, but the snapshot is published once complete: statistics
+   * are gathered and the database is rewritten with a larger page size
+   * (see SnapshotWriter::publish()).
+   */
+  Publish,
+};
+
+inline std::string_view getDatabaseProfileString(DatabaseProfile p)
+{
+  switch (p)
+  {
+  case DatabaseProfile::Default: return "default";
+  case DatabaseProfile::Build:   return "build";
+  case DatabaseProfile::Publish: return "publish";
+  default:                       return "default";
+  }
+}
+
+inline std::optional<DatabaseProfile> parseDatabaseProfile(std::string_view str)
+{
+  for (DatabaseProfile p : { DatabaseProfile::Default, DatabaseProfile::Build, DatabaseProfile::Publish })
+  {
+    if (getDatabaseProfileString(p) == str) {
+      return p;
+    }
+  }
+
+  return std::nullopt;
+}
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_DATABASEPROFILE_H
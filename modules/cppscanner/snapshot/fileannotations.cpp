@@ -0,0 +1,493 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "fileannotations.h"
+
+#include "positionencoding.h"
+
+#include "cppscanner/database/readrows.h"
+#include "cppscanner/database/sql.h"
+#include "cppscanner/database/transaction.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+namespace cppscanner
+{
+
+namespace
+{
+
+/**
+ * \brief maps the ids of the symbols to their index in the dictionary
+ */
+class SymbolDictionary
+{
+private:
+  std::vector<SymbolRecord> m_symbols;
+  std::map<SymbolID, uint64_t> m_indices;
+
+public:
+  void add(const SymbolRecord& symbol)
+  {
+    if (symbol.id.isValid() && m_indices.emplace(symbol.id, m_symbols.size()).second) {
+      m_symbols.push_back(symbol);
+    }
+  }
+
+  uint64_t indexOf(SymbolID id)
+  {
+    auto it = m_indices.find(id);
+
+    if (it == m_indices.end())
+    {
+      SymbolRecord placeholder;
+      placeholder.id = id;
+      placeholder.kind = SymbolKind::Unknown;
+      it = m_indices.emplace(id, m_symbols.size()).first;
+      m_symbols.push_back(placeholder);
+    }
+
+    return it->second;
+  }
+
+  const std::vector<SymbolRecord>& symbols() const
+  {
+    return m_symbols;
+  }
+};
+
+template<typename T, typename Less>
+std::vector<T> sorted(std::vector<T> elements, Less&& less)
+{
+  std::stable_sort(elements.begin(), elements.end(), less);
+  return elements;
+}
+
+} // namespace
+
+/**
+ * \brief encodes the annotations of a file in the format described in the fileannotations namespace
+ * \param data  the annotations
+ *
+ * Lists need not be sorted; symbols that are referenced but missing
+ * from data.symbols are added to the dictionary with an unknown kind
+ * and an empty name.
+ */
+std::string encodeFileAnnotations(const FileAnnotationData& data)
+{
+  SymbolDictionary dictionary;
+
+  for (const SymbolRecord& symbol : data.symbols) {
+    dictionary.add(symbol);
+  }
+
+  auto position_less = [](const auto& a, const auto& b) {
+    return a.position < b.position;
+  };
+
+  const std::vector<SymbolReference> references = sorted(data.references, position_less);
+  const std::vector<SymbolDeclaration> declarations = sorted(data.declarations, [](const SymbolDeclaration& a, const SymbolDeclaration& b) {
+    return a.startPosition < b.startPosition;
+  });
+  const std::vector<Diagnostic> diagnostics = sorted(data.diagnostics, position_less);
+  const std::vector<ArgumentPassedByReference> refargs = sorted(data.refargs, position_less);
+  const std::vector<Include> includes = sorted(data.includes, [](const Include& a, const Include& b) {
+    return a.line < b.line;
+  });
+
+  // the references and declarations are encoded first so that the
+  // dictionary is complete when it is written.
+  ByteWriter body;
+
+  body.writeVarint(references.size());
+  {
+    PositionEncoder positions{ body };
+
+    for (const SymbolReference& ref : references)
+    {
+      positions.write(ref.position);
+      body.writeVarint(dictionary.indexOf(ref.symbolID));
+      body.writeVarint(static_cast<uint32_t>(ref.flags));
+      body.writeVarint(ref.referencedBySymbolID.isValid() ? dictionary.indexOf(ref.referencedBySymbolID) + 1 : 0);
+    }
+  }
+
+  body.writeVarint(declarations.size());
+  {
+    PositionEncoder positions{ body };
+
+    for (const SymbolDeclaration& decl : declarations)
+    {
+      positions.write(decl.startPosition);
+      body.writeSignedVarint(decl.endPosition.line() - decl.startPosition.line());
+      body.writeVarint(decl.endPosition.column());
+      body.writeVarint(dictionary.indexOf(decl.symbolID) * 2 + (decl.isDefinition ? 1 : 0));
+    }
+  }
+
+  body.writeVarint(diagnostics.size());
+  {
+    PositionEncoder positions{ body };
+
+    for (const Diagnostic& d : diagnostics)
+    {
+      positions.write(d.position);
+      body.writeVarint(static_cast<uint64_t>(d.level));
+      body.writeString(d.message);
+    }
+  }
+
+  body.writeVarint(refargs.size());
+  {
+    PositionEncoder positions{ body };
+
+    for (const ArgumentPassedByReference& refarg : refargs) {
+      positions.write(refarg.position);
+    }
+  }
+
+  body.writeVarint(includes.size());
+  {
+    PositionEncoder positions{ body };
+
+    for (const Include& inc : includes)
+    {
+      positions.write(inc.line, 0);
+      body.writeVarint(inc.includedFileID);
+    }
+  }
+
+  body.writeVarint(data.includedFiles.size());
+  for (const File& f : data.includedFiles)
+  {
+    body.writeVarint(f.id);
+    body.writeString(f.path);
+  }
+
+  ByteWriter writer;
+  writer.reserve(body.size() + 32 * dictionary.symbols().size() + 8);
+  writer.writeBytes(std::string_view(fileannotations::Magic, sizeof(fileannotations::Magic)));
+  writer.writeVarint(fileannotations::FormatVersion);
+
+  writer.writeVarint(dictionary.symbols().size());
+  for (const SymbolRecord& symbol : dictionary.symbols())
+  {
+    writer.writeFixed64(symbol.id.rawID());
+    writer.writeVarint(static_cast<uint64_t>(symbol.kind));
+    writer.writeVarint(static_cast<uint32_t>(symbol.flags));
+    writer.writeString(symbol.name);
+  }
+
+  writer.writeBytes(body.bytes());
+
+  return writer.release();
+}
+
+/**
+ * \brief decodes a blob produced by encodeFileAnnotations()
+ * \param bytes  the content of the blob
+ * \param fid    the id of the annotated file
+ *
+ * Throws std::runtime_error if the blob is malformed or was written
+ * with another version of the format.
+ */
+FileAnnotationData decodeFileAnnotations(std::string_view bytes, FileID fid)
+{
+  ByteReader reader{ bytes };
+
+  if (reader.readBytes(sizeof(fileannotations::Magic)) != std::string_view(fileannotations::Magic, sizeof(fileannotations::Magic))) {
+    throw std::runtime_error("not a file annotations blob");
+  }
+
+  if (reader.readVarint() != fileannotations::FormatVersion) {
+    throw std::runtime_error("unsupported file annotations format version");
+  }
+
+  FileAnnotationData data;
+
+  data.symbols.resize(readElementCount(reader));
+  for (SymbolRecord& symbol : data.symbols)
+  {
+    symbol.id = SymbolID::fromRawID(reader.readFixed64());
+    symbol.kind = static_cast<SymbolKind>(reader.readVarint());
+    symbol.flags = static_cast<int>(reader.readVarint());
+    symbol.name = std::string(reader.readString());
+  }
+
+  auto symbol_at = [&data](uint64_t index) -> SymbolID {
+    if (index >= data.symbols.size()) {
+      throw std::runtime_error("invalid symbol index in file annotations");
+    }
+
+    return data.symbols[index].id;
+  };
+
+  data.references.resize(readElementCount(reader));
+  {
+    PositionDecoder positions{ reader };
+
+    for (SymbolReference& ref : data.references)
+    {
+      ref.fileID = fid;
+      ref.position = positions.read();
+      ref.symbolID = symbol_at(reader.readVarint());
+      ref.flags = static_cast<int>(reader.readVarint());
+
+      if (uint64_t parent = reader.readVarint()) {
+        ref.referencedBySymbolID = symbol_at(parent - 1);
+      }
+    }
+  }
+
+  data.declarations.resize(readElementCount(reader));
+  {
+    PositionDecoder positions{ reader };
+
+    for (SymbolDeclaration& decl : data.declarations)
+    {
+      decl.fileID = fid;
+      decl.startPosition = positions.read();
+      const int end_line = decl.startPosition.line() + static_cast<int>(reader.readSignedVarint());
+      decl.endPosition = FilePosition(end_line, static_cast<int>(reader.readVarint()));
+      const uint64_t value = reader.readVarint();
+      decl.symbolID = symbol_at(value / 2);
+      decl.isDefinition = value & 1;
+    }
+  }
+
+  data.diagnostics.resize(readElementCount(reader));
+  {
+    PositionDecoder positions{ reader };
+
+    for (Diagnostic& d : data.diagnostics)
+    {
+      d.fileID = fid;
+      d.position = positions.read();
+      d.level = static_cast<DiagnosticLevel>(reader.readVarint());
+      d.message = std::string(reader.readString());
+    }
+  }
+
+  data.refargs.resize(readElementCount(reader));
+  {
+    PositionDecoder positions{ reader };
+
+    for (ArgumentPassedByReference& refarg : data.refargs)
+    {
+      refarg.fileID = fid;
+      refarg.position = positions.read();
+    }
+  }
+
+  data.includes.resize(readElementCount(reader));
+  {
+    PositionDecoder positions{ reader };
+
+    for (Include& inc : data.includes)
+    {
+      inc.fileID = fid;
+      inc.line = positions.read().line();
+      inc.includedFileID = static_cast<FileID>(reader.readVarint());
+    }
+  }
+
+  data.includedFiles.resize(readElementCount(reader));
+  for (File& f : data.includedFiles)
+  {
+    f.id = static_cast<FileID>(reader.readVarint());
+    f.path = std::string(reader.readString());
+  }
+
+  if (!reader.atEnd()) {
+    throw std::runtime_error("unexpected trailing data in file annotations");
+  }
+
+  return data;
+}
+
+static const char* SQL_CREATE_FILE_ANNOTATIONS = R"(
+CREATE TABLE IF NOT EXISTS "fileAnnotations" (
+  "file_id"  INTEGER NOT NULL PRIMARY KEY,
+  "data"     BLOB NOT NULL,
+  FOREIGN KEY("file_id") REFERENCES "file"("id")
+);
+
+DELETE FROM "fileAnnotations";
+)";
+
+static FileAnnotationData readFileAnnotations(Database& db, FileID fid)
+{
+  FileAnnotationData data;
+
+  {
+    sql::Statement stmt{ db, "SELECT position, symbol_id, parent_symbol_id, flags FROM symbolReference WHERE file_id = ?" };
+    stmt.bind(1, static_cast<int>(fid));
+
+    data.references = sql::readRowsAsVector<SymbolReference>(stmt, [fid](sql::Statement& row) {
+      SymbolReference ref;
+      ref.fileID = fid;
+      ref.position = FilePosition::fromBits(row.columnInt(0));
+      ref.symbolID = SymbolID::fromRawID(row.columnInt64(1));
+      ref.referencedBySymbolID = SymbolID::fromRawID(row.nullColumn(2) ? 0 : row.columnInt64(2));
+      ref.flags = row.columnInt(3);
+      return ref;
+    });
+  }
+
+  {
+    sql::Statement stmt{ db, "SELECT symbol_id, startPosition, endPosition, isDefinition FROM symbolDeclaration WHERE file_id = ?" };
+    stmt.bind(1, static_cast<int>(fid));
+
+    data.declarations = sql::readRowsAsVector<SymbolDeclaration>(stmt, [fid](sql::Statement& row) {
+      SymbolDeclaration decl;
+      decl.symbolID = SymbolID::fromRawID(row.columnInt64(0));
+      decl.fileID = fid;
+      decl.startPosition = FilePosition::fromBits(row.columnInt(1));
+      decl.endPosition = FilePosition::fromBits(row.columnInt(2));
+      decl.isDefinition = row.columnInt(3) != 0;
+      return decl;
+    });
+  }
+
+  {
+    sql::Statement stmt{ db, "SELECT level, line, column, message FROM diagnostic WHERE fileID = ?" };
+    stmt.bind(1, static_cast<int>(fid));
+
+    data.diagnostics = sql::readRowsAsVector<Diagnostic>(stmt, [fid](sql::Statement& row) {
+      Diagnostic d;
+      d.level = static_cast<DiagnosticLevel>(row.columnInt(0));
+      d.fileID = fid;
+      d.position = FilePosition(row.columnInt(1), row.columnInt(2));
+      d.message = row.column(3);
+      return d;
+    });
+  }
+
+  {
+    sql::Statement stmt{ db, "SELECT line, column FROM argumentPassedByReference WHERE file_id = ?" };
+    stmt.bind(1, static_cast<int>(fid));
+
+    data.refargs = sql::readRowsAsVector<ArgumentPassedByReference>(stmt, [fid](sql::Statement& row) {
+      return ArgumentPassedByReference{ fid, FilePosition(row.columnInt(0), row.columnInt(1)) };
+    });
+  }
+
+  {
+    sql::Statement stmt{ db, "SELECT include.line, include.included_file_id, file.path FROM include LEFT JOIN file ON file.id = include.included_file_id WHERE include.file_id = ?" };
+    stmt.bind(1, static_cast<int>(fid));
+
+    while (stmt.fetchNextRow())
+    {
+      Include inc;
+      inc.fileID = fid;
+      inc.line = stmt.columnInt(0);
+      inc.includedFileID = static_cast<FileID>(stmt.columnInt(1));
+      data.includes.push_back(inc);
+
+      File f;
+      f.id = inc.includedFileID;
+      f.path = stmt.column(2);
+      data.includedFiles.push_back(std::move(f));
+    }
+
+    std::sort(data.includedFiles.begin(), data.includedFiles.end(), [](const File& a, const File& b) {
+      return a.id < b.id;
+    });
+
+    data.includedFiles.erase(std::unique(data.includedFiles.begin(), data.includedFiles.end(), [](const File& a, const File& b) {
+      return a.id == b.id;
+    }), data.includedFiles.end());
+  }
+
+  std::vector<SymbolID> ids;
+
+  for (const SymbolReference& ref : data.references)
+  {
+    ids.push_back(ref.symbolID);
+
+    if (ref.referencedBySymbolID.isValid()) {
+      ids.push_back(ref.referencedBySymbolID);
+    }
+  }
+
+  for (const SymbolDeclaration& decl : data.declarations) {
+    ids.push_back(decl.symbolID);
+  }
+
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+  sql::Statement stmt{ db, "SELECT kind, flags, name FROM symbol WHERE id = ?" };
+
+  for (SymbolID id : ids)
+  {
+    stmt.bind(1, static_cast<int64_t>(id.rawID()));
+
+    if (stmt.fetchNextRow())
+    {
+      SymbolRecord symbol;
+      symbol.id = id;
+      symbol.kind = static_cast<SymbolKind>(stmt.columnInt(0));
+      symbol.flags = stmt.columnInt(1);
+      symbol.name = stmt.column(2);
+      data.symbols.push_back(std::move(symbol));
+    }
+
+    stmt.reset();
+  }
+
+  return data;
+}
+
+/**
+ * \brief fills the "fileAnnotations" table of a snapshot
+ * \param db  the snapshot
+ *
+ * One blob is written for each file that has at least one annotation;
+ * the table is created if needed and its previous content is discarded.
+ * This must be done once everything else has been written to the snapshot.
+ */
+void createFileAnnotations(Database& db)
+{
+  std::string error;
+
+  if (!sql::exec(db, SQL_CREATE_FILE_ANNOTATIONS, &error)) {
+    throw std::runtime_error("could not create file annotations table: " + error);
+  }
+
+  sql::Transaction transaction{ db };
+
+  std::vector<FileID> files;
+
+  {
+    sql::Statement stmt{ db, "SELECT id FROM file" };
+
+    while (stmt.fetchNextRow()) {
+      files.push_back(static_cast<FileID>(stmt.columnInt(0)));
+    }
+  }
+
+  sql::Statement insert{ db, "INSERT INTO fileAnnotations(file_id, data) VALUES(?, ?)" };
+
+  for (FileID fid : files)
+  {
+    const FileAnnotationData data = readFileAnnotations(db, fid);
+
+    if (data.references.empty() && data.declarations.empty() && data.diagnostics.empty()
+      && data.refargs.empty() && data.includes.empty()) {
+      continue;
+    }
+
+    const std::string blob = encodeFileAnnotations(data);
+    insert.bind(1, static_cast<int>(fid));
+    insert.bind(2, sql::Blob(blob));
+    insert.insert();
+  }
+
+  transaction.commit();
+}
+
+} // namespace cppscanner
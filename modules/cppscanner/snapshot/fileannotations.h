@@ -0,0 +1,77 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_FILEANNOTATIONS_H
+#define CPPSCANNER_FILEANNOTATIONS_H
+
+#include "snapshot.h"
+
+#include "cppscanner/index/symbolrecords.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cppscanner
+{
+
+class Database;
+
+/**
+ * \brief the binary format of the per-file annotation blobs
+ *
+ * A blob starts with Magic followed by the format version (a varint) and
+ * contains, in that order, a symbol dictionary, the references, the
+ * declarations, the diagnostics, the arguments passed by reference and
+ * the include directives of a file, followed by the paths of the
+ * included files.
+ * Each list starts with its number of elements; integers are LEB128
+ * varints, symbol ids are 64-bit little-endian integers and strings are
+ * a varint length followed by UTF-8 bytes.
+ *
+ * Elements of a list are sorted by position and store their line as a
+ * delta to the line of the previous element; their column is a delta to
+ * the previous column when both are on the same line, and absolute
+ * otherwise.
+ * References and declarations designate symbols by their index in the
+ * dictionary.
+ *
+ * The JavaScript decoder generated by genjs must be kept in sync with
+ * this format.
+ */
+namespace fileannotations
+{
+
+constexpr char Magic[4] = { 'C', 'S', 'F', 'A' };
+constexpr int FormatVersion = 1;
+
+} // namespace fileannotations
+
+/**
+ * \brief everything needed to render a file, without querying the snapshot
+ *
+ * The \a symbols are the dictionary of the blob: they include every symbol
+ * referenced or declared in the file, as well as the symbols in which
+ * the references occur.
+ * The parentId of the symbols is not stored in the blob.
+ */
+struct FileAnnotationData
+{
+  std::vector<SymbolRecord> symbols;
+  std::vector<SymbolReference> references;
+  std::vector<SymbolDeclaration> declarations;
+  std::vector<Diagnostic> diagnostics;
+  std::vector<ArgumentPassedByReference> refargs;
+  std::vector<Include> includes;
+  std::vector<File> includedFiles; //< id and path of the included files
+};
+
+std::string encodeFileAnnotations(const FileAnnotationData& data);
+FileAnnotationData decodeFileAnnotations(std::string_view bytes, FileID fid = {});
+
+void createFileAnnotations(Database& db);
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_FILEANNOTATIONS_H
@@ -7,25 +7,130 @@
 
 #include "cppscanner/index/symbol.h"
 
-#include <variant>
+#include "cppscanner/base/arena.h"
+
+#include <cassert>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
 
 namespace cppscanner
 {
 
-class IndexerSymbol : public SymbolRecord
+// The following structures mirror MacroInfo, FunctionInfo, etc., with
+// strings that are stored in an Arena.
+
+struct MacroExtraInfo
+{
+  std::string_view definition;
+};
+
+struct FunctionExtraInfo
+{
+  std::string_view returnType;
+  std::string_view declaration;
+};
+
+struct ParameterExtraInfo
+{
+  int parameterIndex = 0;
+  std::string_view type;
+  std::string_view defaultValue;
+};
+
+struct EnumExtraInfo
+{
+  std::string_view underlyingType;
+};
+
+struct EnumConstantExtraInfo
+{
+  int64_t value = 0;
+  std::string_view expression;
+};
+
+struct VariableExtraInfo
+{
+  std::string_view type;
+  std::string_view init;
+};
+
+struct NamespaceAliasExtraInfo
+{
+  std::string_view value;
+};
+
+/**
+ * \brief a tagged union of the extra information about a symbol
+ *
+ * This replaces a std::variant of the *Info structures: all alternatives
+ * are trivially copyable and the tag is a single byte.
+ */
+class SymbolExtraInfo
 {
 public:
-  std::variant<std::monostate, MacroInfo, FunctionInfo, ParameterInfo, EnumInfo, EnumConstantInfo, VariableInfo, NamespaceAliasInfo> extraInfo;
+  enum Kind : uint8_t
+  {
+    None,
+    Macro,
+    Function,
+    Parameter,
+    Enum,
+    EnumConstant,
+    Variable,
+    NamespaceAlias,
+  };
+
+  Kind kind() const { return m_kind; }
+
+  template<typename T> T& get();
+  template<typename T> const T* getIf() const;
+
+  template<typename F> void visit(F&& f) const;
+
+private:
+  template<typename T> static constexpr Kind kindOf();
+
+private:
+  Kind m_kind = None;
+
+  union Data
+  {
+    Data() : none() { }
+
+    struct {} none;
+    MacroExtraInfo macro;
+    FunctionExtraInfo function;
+    ParameterExtraInfo parameter;
+    EnumExtraInfo enumInfo;
+    EnumConstantExtraInfo enumConstant;
+    VariableExtraInfo variable;
+    NamespaceAliasExtraInfo namespaceAlias;
+  } m_data;
+};
+
+/**
+ * \brief the representation of a symbol used while indexing
+ *
+ * Strings are not owned by the symbol: they are views into an Arena,
+ * usually the one of the TranslationUnitIndex the symbol belongs to.
+ */
+class IndexerSymbol
+{
+public:
+  SymbolID id; //< the id of the symbol
+  SymbolKind kind = SymbolKind::Unknown; //< what kind of symbol is this
+  std::string_view name; //< the name of the symbol
+  SymbolID parentId; //< the id of the symbol's parent
+  int flags = 0; //< OR-combination of flags
+  SymbolExtraInfo extraInfo;
 
   template<typename T>
   T& getExtraInfo()
   {
-    if (std::holds_alternative<std::monostate>(extraInfo))
-    {
-      extraInfo = T();
-    }
-
-    return std::get<T>(extraInfo);
+    return extraInfo.get<T>();
   }
 
   bool testFlag(int f) const
@@ -52,7 +157,132 @@ public:
   };
 };
 
-inline int update(IndexerSymbol& symbol, const SymbolRecord& other)
+template<typename T>
+constexpr SymbolExtraInfo::Kind SymbolExtraInfo::kindOf()
+{
+  if constexpr (std::is_same_v<T, MacroExtraInfo>) return Macro;
+  else if constexpr (std::is_same_v<T, FunctionExtraInfo>) return Function;
+  else if constexpr (std::is_same_v<T, ParameterExtraInfo>) return Parameter;
+  else if constexpr (std::is_same_v<T, EnumExtraInfo>) return Enum;
+  else if constexpr (std::is_same_v<T, EnumConstantExtraInfo>) return EnumConstant;
+  else if constexpr (std::is_same_v<T, VariableExtraInfo>) return Variable;
+  else {
+    static_assert(std::is_same_v<T, NamespaceAliasExtraInfo>, "not an extra info type");
+    return NamespaceAlias;
+  }
+}
+
+/**
+ * \brief returns the extra info of type T, creating it if there is none
+ *
+ * A symbol cannot have extra info of two different types: 
+ * std::logic_error is thrown if the symbol already has extra info of 
+ * another type.
+ */
+template<typename T>
+inline T& SymbolExtraInfo::get()
+{
+  if (m_kind == None)
+  {
+    new (&m_data) T();
+    m_kind = kindOf<T>();
+  }
+
+  if (m_kind != kindOf<T>()) {
+    throw std::logic_error("symbol extra info has a different kind");
+  }
+
+  return *std::launder(reinterpret_cast<T*>(&m_data));
+}
+
+template<typename T>
+inline const T* SymbolExtraInfo::getIf() const
+{
+  return m_kind == kindOf<T>() ? std::launder(reinterpret_cast<const T*>(&m_data)) : nullptr;
+}
+
+/**
+ * \brief calls a function with the extra info, if any
+ */
+template<typename F>
+inline void SymbolExtraInfo::visit(F&& f) const
+{
+  switch (m_kind)
+  {
+  case Macro: f(m_data.macro); break;
+  case Function: f(m_data.function); break;
+  case Parameter: f(m_data.parameter); break;
+  case Enum: f(m_data.enumInfo); break;
+  case EnumConstant: f(m_data.enumConstant); break;
+  case Variable: f(m_data.variable); break;
+  case NamespaceAlias: f(m_data.namespaceAlias); break;
+  default: break;
+  }
+}
+
+/**
+ * \brief copies the strings of a symbol into an arena
+ *
+ * This is used to make a symbol outlive the arena its strings were
+ * allocated from.
+ */
+inline void copyStrings(IndexerSymbol& symbol, Arena& arena)
+{
+  symbol.name = arena.copy(symbol.name);
+
+  switch (symbol.extraInfo.kind())
+  {
+  case SymbolExtraInfo::Macro:
+  {
+    auto& info = symbol.getExtraInfo<MacroExtraInfo>();
+    info.definition = arena.copy(info.definition);
+  }
+  break;
+  case SymbolExtraInfo::Function:
+  {
+    auto& info = symbol.getExtraInfo<FunctionExtraInfo>();
+    info.returnType = arena.copy(info.returnType);
+    info.declaration = arena.copy(info.declaration);
+  }
+  break;
+  case SymbolExtraInfo::Parameter:
+  {
+    auto& info = symbol.getExtraInfo<ParameterExtraInfo>();
+    info.type = arena.copy(info.type);
+    info.defaultValue = arena.copy(info.defaultValue);
+  }
+  break;
+  case SymbolExtraInfo::Enum:
+  {
+    auto& info = symbol.getExtraInfo<EnumExtraInfo>();
+    info.underlyingType = arena.copy(info.underlyingType);
+  }
+  break;
+  case SymbolExtraInfo::EnumConstant:
+  {
+    auto& info = symbol.getExtraInfo<EnumConstantExtraInfo>();
+    info.expression = arena.copy(info.expression);
+  }
+  break;
+  case SymbolExtraInfo::Variable:
+  {
+    auto& info = symbol.getExtraInfo<VariableExtraInfo>();
+    info.type = arena.copy(info.type);
+    info.init = arena.copy(info.init);
+  }
+  break;
+  case SymbolExtraInfo::NamespaceAlias:
+  {
+    auto& info = symbol.getExtraInfo<NamespaceAliasExtraInfo>();
+    info.value = arena.copy(info.value);
+  }
+  break;
+  default:
+    break;
+  }
+}
+
+inline int update(IndexerSymbol& symbol, const IndexerSymbol& other)
 {
   int what = 0;
 
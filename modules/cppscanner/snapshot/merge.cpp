@@ -4,6 +4,7 @@
 
 #include "merge.h"
 
+#include "cppscanner/snapshot/blobstore.h"
 #include "cppscanner/snapshot/indexersymbol.h"
 #include "cppscanner/snapshot/symbolrecorditerator.h"
 
@@ -160,59 +161,67 @@ public:
 
 FileIdTable::FileIdTable()
 {
-  m_filesmap[""] = 0;
-  m_filestable.push_back(m_filesmap.begin()->first);
+  m_nodes.push_back(PathTrie::Root);
+  m_ids.push_back(invalidFileID());
 }
 
 size_t FileIdTable::size() const
 {
-  return m_filestable.size();
+  return m_nodes.size();
 }
 
-FileID FileIdTable::getIdentification(const std::string_view& file)
+std::optional<FileID> FileIdTable::findNodeIdentification(PathTrie::NodeID node) const
 {
-  auto it = m_filesmap.find(file);
-  if (it != m_filesmap.end())
-  {
-    return it->second;
+  if (node == PathTrie::Root) {
+    return invalidFileID();
   }
 
-  const auto result = FileID(m_filestable.size());
+  if (node < m_ids.size() && m_ids[node] != invalidFileID()) {
+    return m_ids[node];
+  }
 
-  bool inserted;
-  std::tie(it, inserted) = m_filesmap.insert(std::pair(std::string(file), result));
-  assert(inserted);
+  return std::nullopt;
+}
 
-  m_filestable.push_back(it->first);
+FileID FileIdTable::getIdentification(const std::string_view& file)
+{
+  if (std::optional<FileID> id = insert(file)) {
+    return *id;
+  }
 
-  return result;
+  return findIdentification(file);
 }
 
 FileID FileIdTable::findIdentification(const std::string_view& file) const
 {
-  auto it = m_filesmap.find(file);
-  assert(it != m_filesmap.end());
-  return it->second;
+  std::optional<PathTrie::NodeID> node = m_trie.find(file);
+  assert(node.has_value());
+  std::optional<FileID> id = findNodeIdentification(*node);
+  assert(id.has_value());
+  return *id;
 }
 
 std::optional<FileID> FileIdTable::insert(const std::string_view& filePath)
 {
-  const auto id = FileID(m_filestable.size());
+  const PathTrie::NodeID node = m_trie.insert(filePath);
 
-  auto [it, inserted] = m_filesmap.insert(std::pair(std::string(filePath), id));
- 
-  if (inserted)
-  {
-    m_filestable.push_back(it->first);
-    return id;
+  if (findNodeIdentification(node).has_value()) {
+    return std::nullopt;
   }
 
-  return std::nullopt;
+  if (m_ids.size() < m_trie.size()) {
+    m_ids.resize(m_trie.size(), invalidFileID());
+  }
+
+  const auto id = FileID(m_nodes.size());
+  m_ids[node] = id;
+  m_nodes.push_back(node);
+  return id;
 }
 
-std::string_view FileIdTable::getFile(FileID fid) const
+std::string FileIdTable::getFile(FileID fid) const
 {
-  return fid < m_filestable.size() ? m_filestable[fid] : std::string_view();
+  return fid < m_nodes.size() ? m_trie.path(m_nodes[fid]) : std::string();
 }
 
 void SnapshotMerger::setOutputPath(const std::filesystem::path& outputPath)
@@ -246,11 +255,87 @@ void SnapshotMerger::setExtraProperty(const std::string& name, const std::string
   m_extra_properties[name] = value;
 }
 
+/**
+ * \brief fills the content of several files
+ * 
+ * The default implementation calls fill() on each file; implementations
+ * may override it to process the files in parallel.
+ */
+void FileContentWriter::fill(std::vector<File>& files)
+{
+  for (File& f : files) {
+    fill(f);
+  }
+}
+
 void SnapshotMerger::setFileContentWriter(std::unique_ptr<FileContentWriter> contentWriter)
 {
   m_file_content_writer = std::move(contentWriter);
 }
 
+/**
+ * \brief sets the profile used to write the output snapshot
+ * 
+ * With DatabaseProfile::Publish, the output is published once the merge 
+ * is complete.
+ */
+void SnapshotMerger::setDatabaseProfile(DatabaseProfile profile)
+{
+  m_database_profile = profile;
+}
+
+/**
+ * \brief sets the codec used to store the content of files in the output snapshot
+ * 
+ * Content read from the input snapshots is decompressed first, so inputs 
+ * may use any codec.
+ */
+void SnapshotMerger::setFileContentCodec(FileContentCodec codec)
+{
+  m_file_content_codec = codec;
+}
+
+/**
+ * \brief sets a blob store in which the content of files of the output snapshot is written
+ * 
+ * Content that is already in the store is neither read from the input 
+ * snapshots nor written again.
+ */
+void SnapshotMerger::setBlobStore(const std::filesystem::path& p)
+{
+  m_blob_store_path = p;
+}
+
+/**
+ * \brief sets whether the symbol search index is created in the output snapshot
+ * 
+ * See SnapshotWriter::createSymbolSearchIndex().
+ */
+void SnapshotMerger::setCreateSymbolSearchIndex(bool on)
+{
+  m_create_symbol_search_index = on;
+}
+
+/**
+ * \brief sets whether the per-file annotation blobs are created in the output snapshot
+ * 
+ * See SnapshotWriter::createFileAnnotations().
+ */
+void SnapshotMerger::setCreateFileAnnotations(bool on)
+{
+  m_create_file_annotations = on;
+}
+
+/**
+ * \brief sets whether the per-symbol reference posting lists are created in the output snapshot
+ * 
+ * See SnapshotWriter::createReferencePostings().
+ */
+void SnapshotMerger::setCreateReferencePostings(bool on)
+{
+  m_create_reference_postings = on;
+}
+
 void SnapshotMerger::runMerge()
 {
   // list good snapshots (remove duplicates and non-snapshot files)
@@ -282,7 +367,13 @@ void SnapshotMerger::runMerge()
     }
   }
 
+  writer().setProfile(m_database_profile);
   writer().open(m_output_path);
+  writer().setFileContentCodec(m_file_content_codec);
+
+  if (!m_blob_store_path.empty()) {
+    writer().setBlobStore(m_blob_store_path);
+  }
 
   std::string home;
   // write "info" table, compute (possibly new) home directory
@@ -389,6 +480,7 @@ void SnapshotMerger::runMerge()
     {
       std::string sha1;
       std::string text;
+      bool inBlobStore = false;
     };
     std::map<FileID, FileContent> file_content_map; // content of files belonging to the project
 
@@ -396,15 +488,17 @@ void SnapshotMerger::runMerge()
     {
       std::set<std::string> external_files;
 
+      // with a blob store, content is only read for files whose content 
+      // is not already in the store
+      BlobStore* blob_store = writer().blobStore();
+
       for (InputSnapshot& snapshot : m_snapshots)
       {
         snapshot.reader.reopen();
 
-        constexpr bool fetch_content = true;
+        const bool fetch_content = blob_store == nullptr;
         std::vector<File> files = snapshot.reader.getFiles(fetch_content);
 
-        snapshot.reader.close();
-
         auto outside_project_it = partitionByProjectStatus(files, home);
 
         for (auto it = files.begin(); it != outside_project_it; ++it)
@@ -414,11 +508,20 @@ void SnapshotMerger::runMerge()
           if (fileid.has_value())
           {
             FileContent& content = file_content_map[*fileid];
-            content.text = std::move(it->content);
             content.sha1 = std::move(it->sha1);
+
+            if (!blob_store) {
+              content.text = std::move(it->content);
+            } else if (!content.sha1.empty() && blob_store->contains(content.sha1)) {
+              content.inBlobStore = true;
+            } else {
+              content.text = snapshot.reader.getFileContent(it->id);
+            }
           }
         }
 
+        snapshot.reader.close();
+
         for (auto it = outside_project_it; it != files.end(); ++it)
         {
           external_files.insert(it->path);
@@ -436,20 +539,27 @@ void SnapshotMerger::runMerge()
 
     if (m_file_content_writer)
     {
+      std::vector<File> files;
+
       for (auto& element : file_content_map)
       {
-        if (!element.second.text.empty()) {
+        if (!element.second.text.empty() || element.second.inBlobStore) {
           continue;
         }
 
         File f;
         f.id = element.first;
         f.path = table.getFile(f.id);
-        
-        m_file_content_writer->fill(f);
+        files.push_back(std::move(f));
+      }
 
-        element.second.sha1 = f.sha1;
-        element.second.text = std::move(f.content);
+      m_file_content_writer->fill(files);
+
+      for (File& f : files)
+      {
+        auto& content = file_content_map[f.id];
+        content.sha1 = std::move(f.sha1);
+        content.text = std::move(f.content);
       }
     }
 
@@ -597,6 +707,7 @@ void SnapshotMerger::runMerge()
   // write "symbol" table
   {
     std::map<SymbolID, IndexerSymbol> symbolsmap;
+    Arena strings;
 
     for (InputSnapshot& snapshot : m_snapshots)
     {
@@ -607,7 +718,14 @@ void SnapshotMerger::runMerge()
 
         while (iterator.hasNext())
         {
-          SymbolRecord symbol = iterator.next();
+          SymbolRecord record = iterator.next();
+
+          IndexerSymbol symbol;
+          symbol.id = record.id;
+          symbol.kind = record.kind;
+          symbol.name = record.name;
+          symbol.parentId = record.parentId;
+          symbol.flags = record.flags;
 
           auto it = symbolsmap.find(symbol.id);
 
@@ -618,7 +736,8 @@ void SnapshotMerger::runMerge()
           else
           {
             IndexerSymbol& newsymbol = symbolsmap[symbol.id];
-            static_cast<SymbolRecord&>(newsymbol) = symbol;
+            newsymbol = symbol;
+            copyStrings(newsymbol, strings);
           }
         }
       }
@@ -763,6 +882,26 @@ void SnapshotMerger::runMerge()
   writeInfoTable<ParameterRecordIterator>();
   // write "variableInfo" table
   writeInfoTable<VariableRecordIterator>();
+
+  writer().createIndexes();
+
+  if (m_create_symbol_search_index) {
+    writer().createSymbolSearchIndex();
+  }
+
+  if (m_create_file_annotations) {
+    writer().createFileAnnotations();
+  }
+
+  if (m_create_reference_postings) {
+    writer().createReferencePostings();
+  }
+
+  writer().close();
+
+  if (m_database_profile == DatabaseProfile::Publish) {
+    SnapshotWriter::publish(m_output_path);
+  }
 }
 
 template<typename RecordIterator>
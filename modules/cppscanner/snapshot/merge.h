@@ -8,6 +8,8 @@
 #include "snapshotreader.h"
 #include "snapshotwriter.h"
 
+#include "cppscanner/base/pathtrie.h"
+
 #include <memory>
 #include <optional>
 #include <string>
@@ -16,11 +18,17 @@
 namespace cppscanner
 {
 
+/**
+ * \brief assigns identifiers to file paths while merging snapshots
+ * 
+ * Paths are stored in a PathTrie.
+ */
 class FileIdTable
 {
 private:
-  std::map<std::string, FileID, std::less<>> m_filesmap;
-  std::vector<std::string_view> m_filestable;
+  PathTrie m_trie;
+  std::vector<PathTrie::NodeID> m_nodes; // FileID -> node
+  std::vector<FileID> m_ids; // node -> FileID (zero for directories)
 
 public:
 
@@ -32,7 +40,10 @@ public:
   std::optional<FileID> insert(const std::string_view& filePath);
   FileID findIdentification(const std::string_view& file) const;
 
-  std::string_view getFile(FileID fid) const;
+  std::string getFile(FileID fid) const;
+
+private:
+  std::optional<FileID> findNodeIdentification(PathTrie::NodeID node) const;
 };
 
 class FileContentWriter
@@ -41,6 +52,7 @@ public:
   virtual ~FileContentWriter() = default;
 
   virtual void fill(File& file) = 0;
+  virtual void fill(std::vector<File>& files);
 };
 
 class SnapshotMerger
@@ -53,6 +65,12 @@ public:
   void setProjectHome(const std::filesystem::path& homePath);
   void setExtraProperty(const std::string& name, const std::string& value);
   void setFileContentWriter(std::unique_ptr<FileContentWriter> contentWriter);
+  void setDatabaseProfile(DatabaseProfile profile);
+  void setFileContentCodec(FileContentCodec codec);
+  void setBlobStore(const std::filesystem::path& p);
+  void setCreateSymbolSearchIndex(bool on = true);
+  void setCreateFileAnnotations(bool on = true);
+  void setCreateReferencePostings(bool on = true);
 
   const std::vector<std::filesystem::path>& inputPaths() const;
 
@@ -80,6 +98,12 @@ private:
   std::vector<InputSnapshot> m_snapshots;
   SnapshotWriter m_writer;
   std::unique_ptr<FileContentWriter> m_file_content_writer;
+  DatabaseProfile m_database_profile = DatabaseProfile::Default;
+  FileContentCodec m_file_content_codec = FileContentCodec::None;
+  std::filesystem::path m_blob_store_path;
+  bool m_create_symbol_search_index = false;
+  bool m_create_file_annotations = false;
+  bool m_create_reference_postings = false;
 };
 
 } // namespace cppscanner
@@ -0,0 +1,101 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_POSITIONENCODING_H
+#define CPPSCANNER_POSITIONENCODING_H
+
+#include "cppscanner/base/bytestream.h"
+
+#include "cppscanner/index/fileposition.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace cppscanner
+{
+
+/**
+ * \brief writes the positions of a sorted list as line and column deltas
+ *
+ * The line is written as a delta to the previous line; the column is
+ * a delta to the previous column when both positions are on the same line,
+ * and is absolute otherwise.
+ * Both are varints, so that most positions take two bytes.
+ */
+class PositionEncoder
+{
+private:
+  ByteWriter& m_writer;
+  int m_line = 0;
+  int m_column = 0;
+
+public:
+  explicit PositionEncoder(ByteWriter& writer) : m_writer(writer) { }
+
+  void write(int line, int column)
+  {
+    line = std::max(line, m_line);
+    m_writer.writeVarint(line - m_line);
+
+    if (line == m_line && column >= m_column) {
+      m_writer.writeVarint(column - m_column);
+    } else {
+      m_writer.writeVarint(std::max(column, 0));
+    }
+
+    m_line = line;
+    m_column = std::max(column, 0);
+  }
+
+  void write(FilePosition pos)
+  {
+    write(pos.line(), pos.column());
+  }
+};
+
+/**
+ * \brief reads the positions written by a PositionEncoder
+ */
+class PositionDecoder
+{
+private:
+  ByteReader& m_reader;
+  int m_line = 0;
+  int m_column = 0;
+
+public:
+  explicit PositionDecoder(ByteReader& reader) : m_reader(reader) { }
+
+  FilePosition read()
+  {
+    const int line_delta = static_cast<int>(m_reader.readVarint());
+    const int column = static_cast<int>(m_reader.readVarint());
+
+    m_column = line_delta == 0 ? m_column + column : column;
+    m_line += line_delta;
+
+    return FilePosition(m_line, m_column);
+  }
+};
+
+/**
+ * \brief reads the number of elements of a list
+ *
+ * Every element takes at least one byte, which bounds the size of the
+ * vectors allocated while decoding malformed data.
+ */
+inline size_t readElementCount(ByteReader& reader)
+{
+  const uint64_t n = reader.readVarint();
+
+  if (n > reader.remaining()) {
+    throw std::runtime_error("invalid element count");
+  }
+
+  return static_cast<size_t>(n);
+}
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_POSITIONENCODING_H
@@ -0,0 +1,255 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "referencepostings.h"
+
+#include "positionencoding.h"
+
+#include "cppscanner/database/sql.h"
+#include "cppscanner/database/transaction.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+namespace cppscanner
+{
+
+/**
+ * \brief counts the references of a list by role
+ */
+SymbolReferenceCounts countReferences(const std::vector<SymbolReference>& refs)
+{
+  SymbolReferenceCounts counts;
+  counts.references = static_cast<int>(refs.size());
+
+  for (const SymbolReference& ref : refs)
+  {
+    counts.reads += (ref.flags & SymbolReference::Read) ? 1 : 0;
+    counts.writes += (ref.flags & SymbolReference::Write) ? 1 : 0;
+    counts.calls += (ref.flags & SymbolReference::Call) ? 1 : 0;
+    counts.definitions += (ref.flags & SymbolReference::Definition) ? 1 : 0;
+  }
+
+  return counts;
+}
+
+/**
+ * \brief encodes the references to a symbol as a posting list
+ * \param refs  the references, which need not be sorted
+ *
+ * The symbol ids of the references are not stored: all the references
+ * of a posting list are expected to refer to the same symbol.
+ */
+std::string encodeReferencePostings(std::vector<SymbolReference> refs)
+{
+  std::sort(refs.begin(), refs.end(), [](const SymbolReference& a, const SymbolReference& b) {
+    return std::make_pair(a.fileID, a.position) < std::make_pair(b.fileID, b.position);
+  });
+
+  std::vector<SymbolID> parents;
+  std::map<SymbolID, uint64_t> parent_indices;
+
+  for (const SymbolReference& ref : refs)
+  {
+    if (ref.referencedBySymbolID.isValid() && parent_indices.emplace(ref.referencedBySymbolID, parents.size()).second) {
+      parents.push_back(ref.referencedBySymbolID);
+    }
+  }
+
+  ByteWriter writer;
+  writer.reserve(8 * parents.size() + 5 * refs.size() + 16);
+  writer.writeVarint(referencepostings::FormatVersion);
+
+  writer.writeVarint(parents.size());
+  for (SymbolID parent : parents) {
+    writer.writeFixed64(parent.rawID());
+  }
+
+  size_t nb_groups = 0;
+  for (size_t i(0); i < refs.size(); ++i) {
+    nb_groups += (i == 0 || refs[i].fileID != refs[i - 1].fileID) ? 1 : 0;
+  }
+
+  writer.writeVarint(refs.size());
+  writer.writeVarint(nb_groups);
+
+  FileID previous_file = 0;
+
+  for (auto it = refs.begin(); it != refs.end(); )
+  {
+    const FileID fid = it->fileID;
+    auto end = std::find_if(it, refs.end(), [fid](const SymbolReference& ref) {
+      return ref.fileID != fid;
+    });
+
+    writer.writeVarint(fid - previous_file);
+    writer.writeVarint(std::distance(it, end));
+    previous_file = fid;
+
+    PositionEncoder positions{ writer };
+
+    for (; it != end; ++it)
+    {
+      positions.write(it->position);
+      writer.writeVarint(static_cast<uint32_t>(it->flags));
+      writer.writeVarint(it->referencedBySymbolID.isValid() ? parent_indices[it->referencedBySymbolID] + 1 : 0);
+    }
+  }
+
+  return writer.release();
+}
+
+/**
+ * \brief decodes a posting list produced by encodeReferencePostings()
+ * \param bytes     the posting list
+ * \param symbolID  the id of the referenced symbol
+ *
+ * The references are returned sorted by file and position.
+ * Throws std::runtime_error if the posting list is malformed.
+ */
+std::vector<SymbolReference> decodeReferencePostings(std::string_view bytes, SymbolID symbolID)
+{
+  ByteReader reader{ bytes };
+
+  if (reader.readVarint() != referencepostings::FormatVersion) {
+    throw std::runtime_error("unsupported reference postings format version");
+  }
+
+  std::vector<SymbolID> parents(readElementCount(reader));
+  for (SymbolID& parent : parents) {
+    parent = SymbolID::fromRawID(reader.readFixed64());
+  }
+
+  const size_t nb_refs = readElementCount(reader);
+  std::vector<SymbolReference> refs;
+  refs.reserve(nb_refs);
+  FileID fid = 0;
+
+  for (size_t nb_groups = readElementCount(reader); nb_groups > 0; --nb_groups)
+  {
+    fid += static_cast<FileID>(reader.readVarint());
+    const size_t count = readElementCount(reader);
+
+    PositionDecoder positions{ reader };
+
+    for (size_t i(0); i < count; ++i)
+    {
+      SymbolReference ref;
+      ref.symbolID = symbolID;
+      ref.fileID = fid;
+      ref.position = positions.read();
+      ref.flags = static_cast<int>(reader.readVarint());
+
+      if (uint64_t parent = reader.readVarint())
+      {
+        if (parent > parents.size()) {
+          throw std::runtime_error("invalid parent index in reference postings");
+        }
+
+        ref.referencedBySymbolID = parents[parent - 1];
+      }
+
+      refs.push_back(ref);
+    }
+  }
+
+  if (!reader.atEnd() || refs.size() != nb_refs) {
+    throw std::runtime_error("inconsistent reference postings");
+  }
+
+  return refs;
+}
+
+static const char* SQL_CREATE_REFERENCE_POSTINGS = R"(
+CREATE TABLE IF NOT EXISTS "symbolReferencePostings" (
+  "symbol_id"        INTEGER NOT NULL PRIMARY KEY,
+  "referenceCount"   INTEGER NOT NULL,
+  "readCount"        INTEGER NOT NULL,
+  "writeCount"       INTEGER NOT NULL,
+  "callCount"        INTEGER NOT NULL,
+  "definitionCount"  INTEGER NOT NULL,
+  "data"             BLOB NOT NULL
+);
+
+DELETE FROM "symbolReferencePostings";
+)";
+
+/**
+ * \brief fills the "symbolReferencePostings" table of a snapshot
+ * \param db  the snapshot
+ *
+ * One row is written for each referenced symbol, with the number of
+ * references by role and the posting list of the references.
+ * The table is created if needed and its previous content is discarded.
+ * This must be done once all the references have been written.
+ */
+void createReferencePostings(Database& db)
+{
+  std::string error;
+
+  if (!sql::exec(db, SQL_CREATE_REFERENCE_POSTINGS, &error)) {
+    throw std::runtime_error("could not create reference postings table: " + error);
+  }
+
+  sql::Transaction transaction{ db };
+
+  sql::Statement insert{
+    db,
+    "INSERT INTO symbolReferencePostings(symbol_id, referenceCount, readCount, writeCount, callCount, definitionCount, data) "
+    "VALUES(?, ?, ?, ?, ?, ?, ?)"
+  };
+
+  auto write_postings = [&insert](SymbolID symbolID, std::vector<SymbolReference>& refs) {
+    const SymbolReferenceCounts counts = countReferences(refs);
+    const std::string data = encodeReferencePostings(std::move(refs));
+
+    insert.bind(1, static_cast<int64_t>(symbolID.rawID()));
+    insert.bind(2, counts.references);
+    insert.bind(3, counts.reads);
+    insert.bind(4, counts.writes);
+    insert.bind(5, counts.calls);
+    insert.bind(6, counts.definitions);
+    insert.bind(7, sql::Blob(data));
+    insert.insert();
+
+    refs.clear();
+  };
+
+  // the symbolReference_symbol_id index also orders the rows by file and position
+  sql::Statement stmt{
+    db,
+    "SELECT symbol_id, file_id, position, parent_symbol_id, flags FROM symbolReference ORDER BY symbol_id, file_id, position"
+  };
+
+  SymbolID current;
+  std::vector<SymbolReference> refs;
+
+  while (stmt.fetchNextRow())
+  {
+    const SymbolID symbolID = SymbolID::fromRawID(stmt.columnInt64(0));
+
+    if (symbolID != current && !refs.empty()) {
+      write_postings(current, refs);
+    }
+
+    current = symbolID;
+
+    SymbolReference ref;
+    ref.symbolID = symbolID;
+    ref.fileID = static_cast<FileID>(stmt.columnInt(1));
+    ref.position = FilePosition::fromBits(static_cast<uint32_t>(stmt.columnInt64(2)));
+    ref.referencedBySymbolID = SymbolID::fromRawID(stmt.columnInt64(3));
+    ref.flags = stmt.columnInt(4);
+    refs.push_back(ref);
+  }
+
+  if (!refs.empty()) {
+    write_postings(current, refs);
+  }
+
+  transaction.commit();
+}
+
+} // namespace cppscanner
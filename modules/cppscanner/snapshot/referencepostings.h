@@ -0,0 +1,74 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the 'cppscanner' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef CPPSCANNER_REFERENCEPOSTINGS_H
+#define CPPSCANNER_REFERENCEPOSTINGS_H
+
+#include "cppscanner/index/reference.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cppscanner
+{
+
+class Database;
+
+/**
+ * \brief the binary format of the posting lists of the "symbolReferencePostings" table
+ *
+ * A posting list contains all the references to a symbol.
+ * It starts with the format version, followed by the ids of the symbols
+ * in which the references occur (as 64-bit little-endian integers), the
+ * number of references and the references grouped by file.
+ * Each group starts with the file id, as a delta to the id of the previous
+ * group, and the number of references in the file; each reference is
+ * made of its position (see PositionEncoder), its flags and the index
+ * plus one of the symbol in which it occurs (zero if none).
+ * All integers are LEB128 varints.
+ */
+namespace referencepostings
+{
+
+constexpr int FormatVersion = 1;
+
+} // namespace referencepostings
+
+/**
+ * \brief the number of references to a symbol, by role
+ *
+ * A reference is counted in every role it has, e.g., a compound
+ * assignment is both a read and a write.
+ */
+struct SymbolReferenceCounts
+{
+  int references = 0;
+  int reads = 0;
+  int writes = 0;
+  int calls = 0;
+  int definitions = 0;
+};
+
+inline bool operator==(const SymbolReferenceCounts& lhs, const SymbolReferenceCounts& rhs)
+{
+  return lhs.references == rhs.references && lhs.reads == rhs.reads && lhs.writes == rhs.writes
+    && lhs.calls == rhs.calls && lhs.definitions == rhs.definitions;
+}
+
+inline bool operator!=(const SymbolReferenceCounts& lhs, const SymbolReferenceCounts& rhs)
+{
+  return !(lhs == rhs);
+}
+
+SymbolReferenceCounts countReferences(const std::vector<SymbolReference>& refs);
+
+std::string encodeReferencePostings(std::vector<SymbolReference> refs);
+std::vector<SymbolReference> decodeReferencePostings(std::string_view bytes, SymbolID symbolID);
+
+void createReferencePostings(Database& db);
+
+} // namespace cppscanner
+
+#endif // CPPSCANNER_REFERENCEPOSTINGS_H
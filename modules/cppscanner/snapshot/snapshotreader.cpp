@@ -10,10 +10,39 @@
 
 #include <algorithm>
 #include <cassert>
+#include <optional>
+#include <stdexcept>
 
 namespace cppscanner
 {
 
+static bool hasTable(Database& db, const char* name)
+{
+  sql::Statement stmt{
+    db,
+    "SELECT name FROM sqlite_master WHERE type='table' AND name=?"
+  };
+
+  stmt.bind(1, name);
+  return stmt.fetchNextRow();
+}
+
+// the "info" table may be missing if the database is not a snapshot,
+// which open() reports after reopen() has read the version.
+static int readSchemaVersion(Database& db)
+{
+  if (!hasTable(db, "info")) {
+    return 0;
+  }
+
+  sql::Statement stmt{
+    db,
+    "SELECT value FROM info WHERE key = 'database.schema.version'"
+  };
+
+  return stmt.fetchNextRow() ? stmt.columnInt(0) : 0;
+}
+
 SnapshotReader::SnapshotReader()
 {
 
@@ -33,8 +62,14 @@ SnapshotReader::SnapshotReader(const std::filesystem::path& databasePath)
 SnapshotReader::SnapshotReader(Database db) : 
   m_database(std::make_unique<Database>(std::move(db)))
 {
+  if (m_database->good())
+    registerDecompressionFunctions(*m_database);
+
   if (!m_database->good())
     throw std::runtime_error("snapshot constructor expects a good() database");
+
+  m_schema_version = readSchemaVersion(*m_database);
+  m_has_reference_postings = hasTable(*m_database, "symbolReferencePostings");
 }
 
 bool SnapshotReader::open()
@@ -95,6 +130,11 @@ bool SnapshotReader::reopen()
     return false;
   }
 
+  registerDecompressionFunctions(*m_database);
+
+  m_schema_version = readSchemaVersion(*m_database);
+  m_has_reference_postings = hasTable(*m_database, "symbolReferencePostings");
+
   return true;
 }
 
@@ -129,6 +169,20 @@ Snapshot::Properties SnapshotReader::readProperties() const
   return result;
 }
 
+/**
+ * \brief returns the version of the schema of the database
+ * 
+ * Snapshots written before the version was stored have version 0.
+ * Starting with version 1, the secondary indexes created by 
+ * SnapshotWriter::createIndexes() are present.
+ * 
+ * The version is read once when the snapshot is opened.
+ */
+int SnapshotReader::schemaVersion() const
+{
+  return m_schema_version;
+}
+
 inline static File readFileNoContent(sql::Statement& row)
 {
   File f;
@@ -147,7 +201,7 @@ inline static File readFileWithContent(sql::Statement& row)
 
 std::vector<File> SnapshotReader::getFiles(bool fetchContent) const
 {
-  if (fetchContent)
+  if (fetchContent && schemaVersion() < 3)
   {
     sql::Statement stmt{ 
       database(),
@@ -156,6 +210,26 @@ std::vector<File> SnapshotReader::getFiles(bool fetchContent) const
 
     return sql::readRowsAsVector<File>(stmt, readFileWithContent);
   }
+  else if (fetchContent)
+  {
+    sql::Statement stmt{ 
+      database(),
+      "SELECT id, path, sha1, content, compressedContent FROM file"
+    };
+
+    const FileContentCodec codec = fileContentCodec();
+    BlobStore* store = blobStore();
+
+    return sql::readRowsAsVector<File>(stmt, [codec, store](sql::Statement& row) {
+      File f = readFileWithContent(row);
+      if (row.nullColumn(3) && !row.nullColumn(4)) {
+        f.content = decompress(codec, row.columnBlob(4));
+      } else if (row.nullColumn(3) && store && !f.sha1.empty()) {
+        f.content = store->get(f.sha1).value_or(std::string());
+      }
+      return f;
+      });
+  }
   else
   {
     sql::Statement stmt{ 
@@ -167,6 +241,117 @@ std::vector<File> SnapshotReader::getFiles(bool fetchContent) const
   }
 }
 
+/**
+ * \brief returns the codec used to store the content of files
+ * 
+ * This is the value of the "file.content.codec" property; snapshots 
+ * without this property store the content of files uncompressed.
+ */
+FileContentCodec SnapshotReader::fileContentCodec() const
+{
+  sql::Statement stmt{
+    database(),
+    "SELECT value FROM info WHERE key = 'file.content.codec'"
+  };
+
+  if (!stmt.fetchNextRow()) {
+    return FileContentCodec::None;
+  }
+
+  const std::string value = stmt.column(0);
+  std::optional<FileContentCodec> codec = parseFileContentCodec(value);
+
+  if (!codec.has_value()) {
+    throw std::runtime_error("unknown file content codec: " + value);
+  }
+
+  return *codec;
+}
+
+/**
+ * \brief returns the content of a single file, decompressed if needed
+ * 
+ * An empty string is returned if the file does not exist or its content 
+ * was not captured.
+ */
+std::string SnapshotReader::getFileContent(FileID fid) const
+{
+  const bool compressed = schemaVersion() >= 3;
+
+  sql::Statement stmt{
+    database(),
+    compressed ? "SELECT content, sha1, compressedContent FROM file WHERE id = ?" : "SELECT content, sha1 FROM file WHERE id = ?"
+  };
+
+  stmt.bind(1, static_cast<int>(fid));
+
+  if (!stmt.fetchNextRow()) {
+    return std::string();
+  }
+
+  if (compressed && stmt.nullColumn(0) && !stmt.nullColumn(2)) {
+    return decompress(fileContentCodec(), stmt.columnBlob(2));
+  }
+
+  if (stmt.nullColumn(0) && blobStore()) 
+  {
+    const std::string sha1 = stmt.column(1);
+    return sha1.empty() ? std::string() : blobStore()->get(sha1).value_or(std::string());
+  }
+
+  return stmt.column(0);
+}
+
+/**
+ * \brief returns the store containing the content of the files, if any
+ * 
+ * Unless a store was set with setBlobStore(), the store whose path is given 
+ * by the "file.content.store" property is opened the first time this function 
+ * is called.
+ * Returns nullptr if the snapshot does not use a store or if it does not exist.
+ */
+BlobStore* SnapshotReader::blobStore() const
+{
+  if (m_blob_store) {
+    return m_blob_store.get();
+  }
+
+  sql::Statement stmt{
+    database(),
+    "SELECT value FROM info WHERE key = 'file.content.store'"
+  };
+
+  if (!stmt.fetchNextRow()) {
+    return nullptr;
+  }
+
+  const std::filesystem::path p = std::filesystem::u8path(stmt.column(0));
+
+  if (!std::filesystem::exists(p)) {
+    return nullptr;
+  }
+
+  auto store = std::make_unique<BlobStore>();
+
+  if (store->open(p)) {
+    m_blob_store = std::move(store);
+  }
+
+  return m_blob_store.get();
+}
+
+/**
+ * \brief sets the store used to read the content of the files
+ * \param p  the path of the store
+ * 
+ * This can be used if the store was moved after the snapshot was produced.
+ * Throws std::runtime_error if the store cannot be opened.
+ */
+void SnapshotReader::setBlobStore(const std::filesystem::path& p)
+{
+  m_blob_store = std::make_unique<BlobStore>(p);
+}
+
 inline static Include readInclude(sql::Statement& row)
 {
   Include i;
@@ -348,6 +533,186 @@ std::vector<VariableRecord> SnapshotReader::getStaticProperties(SymbolID classId
   return fetchAll<VariableRecord>(*this, SymbolRecordFilter().ofKind(SymbolKind::StaticProperty).withParent(classId));
 }
 
+/**
+ * \brief returns whether the snapshot has the index created by SnapshotWriter::createSymbolSearchIndex()
+ */
+bool SnapshotReader::hasSymbolSearchIndex() const
+{
+  sql::Statement stmt{
+    database(),
+    "SELECT name FROM sqlite_master WHERE type='table' AND name='symbolSearch'"
+  };
+
+  return stmt.fetchNextRow();
+}
+
+/**
+ * \brief returns whether the snapshot has the blobs created by SnapshotWriter::createFileAnnotations()
+ */
+bool SnapshotReader::hasFileAnnotations() const
+{
+  sql::Statement stmt{
+    database(),
+    "SELECT name FROM sqlite_master WHERE type='table' AND name='fileAnnotations'"
+  };
+
+  return stmt.fetchNextRow();
+}
+
+/**
+ * \brief returns the annotations blob of a file
+ * 
+ * The blob is returned as stored, so that it can be sent as-is to a 
+ * client; use decodeFileAnnotations() to read it.
+ * std::nullopt is returned if the snapshot has no annotations for the file,
+ * either because it has no annotation at all or because the blobs were 
+ * not created.
+ */
+std::optional<std::string> SnapshotReader::getFileAnnotations(FileID fid) const
+{
+  if (!hasFileAnnotations()) {
+    return std::nullopt;
+  }
+
+  sql::Statement stmt{
+    database(),
+    "SELECT data FROM fileAnnotations WHERE file_id = ?"
+  };
+
+  stmt.bind(1, static_cast<int>(fid));
+
+  if (!stmt.fetchNextRow()) {
+    return std::nullopt;
+  }
+
+  return std::string(stmt.columnBlob(0));
+}
+
+static std::string ftsPhrase(const std::string& text)
+{
+  std::string result = "\"";
+
+  for (char c : text)
+  {
+    if (c == '"') {
+      result.push_back('"');
+    }
+
+    result.push_back(c);
+  }
+
+  result.push_back('"');
+  return result;
+}
+
+// the trigram tokenizer only produces tokens for strings of at least 3 characters
+static constexpr size_t MinSymbolSearchLength = 3;
+
+static std::string buildSymbolSearchQuery(const std::string& text, SymbolSearchMode mode)
+{
+  switch (mode)
+  {
+  case SymbolSearchMode::Prefix:
+    return "{name qualifiedName} : ^ " + ftsPhrase(text);
+  case SymbolSearchMode::Fuzzy:
+  {
+    std::vector<std::string> trigrams;
+
+    for (size_t i(0); i + MinSymbolSearchLength <= text.size(); ++i) {
+      trigrams.push_back(ftsPhrase(text.substr(i, MinSymbolSearchLength)));
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    std::string query;
+
+    for (const std::string& t : trigrams)
+    {
+      if (!query.empty()) {
+        query += " OR ";
+      }
+
+      query += t;
+    }
+
+    return query;
+  }
+  case SymbolSearchMode::Substring:
+  default:
+    return ftsPhrase(text);
+  }
+}
+
+inline static SymbolRecord readSymbolRecord(sql::Statement& row)
+{
+  SymbolRecord s;
+  s.id = SymbolID::fromRawID(row.columnInt64(0));
+  s.kind = static_cast<SymbolKind>(row.columnInt(1));
+  s.parentId = SymbolID::fromRawID(row.columnInt64(2));
+  s.name = row.column(3);
+  s.flags = row.columnInt(4);
+  return s;
+}
+
+/**
+ * \brief searches symbols by name
+ * \param text   the text to search for, matched case-insensitively
+ * \param mode   how the text is matched against the names
+ * \param limit  the maximum number of results
+ * 
+ * Both the name and the fully qualified name (e.g., "std::vector::push_back")
+ * of the symbols are searched.
+ * Results are ranked: symbols whose name is the text come first, followed 
+ * by the ones whose name starts with the text, the remaining ones being 
+ * sorted by relevance and then by name length.
+ * 
+ * The search uses the index created by SnapshotWriter::createSymbolSearchIndex().
+ * If the snapshot does not have it, or if the text is shorter than 3 
+ * characters, the symbol table is scanned instead: only names are matched 
+ * and a fuzzy search behaves like a substring search.
+ */
+std::vector<SymbolRecord> SnapshotReader::searchSymbols(const std::string& text, SymbolSearchMode mode, int limit) const
+{
+  if (text.empty() || limit <= 0) {
+    return {};
+  }
+
+  if (text.size() < MinSymbolSearchLength || !hasSymbolSearchIndex())
+  {
+    sql::Statement stmt{
+      database(),
+      mode == SymbolSearchMode::Prefix ?
+        "SELECT id, kind, parent, name, flags FROM symbol "
+        "WHERE lower(substr(name, 1, length(?1))) = lower(?1) "
+        "ORDER BY lower(name) = lower(?1) DESC, length(name), name LIMIT ?2" :
+        "SELECT id, kind, parent, name, flags FROM symbol "
+        "WHERE instr(lower(name), lower(?1)) > 0 "
+        "ORDER BY lower(name) = lower(?1) DESC, lower(substr(name, 1, length(?1))) = lower(?1) DESC, length(name), name LIMIT ?2"
+    };
+
+    stmt.bind(1, text.c_str());
+    stmt.bind(2, limit);
+
+    return sql::readRowsAsVector<SymbolRecord>(stmt, readSymbolRecord);
+  }
+
+  sql::Statement stmt{
+    database(),
+    "SELECT symbol.id, symbol.kind, symbol.parent, symbol.name, symbol.flags "
+    "FROM symbolSearch JOIN symbol ON symbol.id = symbolSearch.rowid "
+    "WHERE symbolSearch MATCH ?1 "
+    "ORDER BY lower(symbol.name) = lower(?2) DESC, lower(substr(symbol.name, 1, length(?2))) = lower(?2) DESC, "
+    "rank, length(symbol.name), symbol.name LIMIT ?3"
+  };
+
+  stmt.bind(1, buildSymbolSearchQuery(text, mode));
+  stmt.bind(2, text.c_str());
+  stmt.bind(3, limit);
+
+  return sql::readRowsAsVector<SymbolRecord>(stmt, readSymbolRecord);
+}
+
 SymbolID sqlColumnAsSymbolID(sql::Statement& row, int col)
 {
   return SymbolID::fromRawID(row.columnInt64(col));
@@ -433,6 +798,19 @@ std::vector<Override> SnapshotReader::getOverridesOf(SymbolID methodID) const
 }
 
 inline static SymbolReference readSymbolReference(sql::Statement& row)
+{
+  SymbolReference r;
+  r.symbolID = SymbolID::fromRawID(row.columnInt64(0));
+  r.fileID = row.columnInt(1);
+  r.position = FilePosition::fromBits(static_cast<uint32_t>(row.columnInt64(2)));
+  r.referencedBySymbolID = SymbolID::fromRawID(row.columnInt64(3));
+  r.flags = row.columnInt(4);
+  return r;
+}
+
+// before version 2, the position of a reference was stored in separate
+// "line" and "col" columns.
+inline static SymbolReference readSymbolReferenceLineCol(sql::Statement& row)
 {
   SymbolReference r;
   r.symbolID = SymbolID::fromRawID(row.columnInt64(0));
@@ -445,24 +823,117 @@ inline static SymbolReference readSymbolReference(sql::Statement& row)
 
 std::vector<SymbolReference> SnapshotReader::getSymbolReferences() const
 {
+  if (schemaVersion() < 2)
+  {
+    sql::Statement stmt{ 
+      database(),
+      "SELECT symbol_id, file_id, line, col, parent_symbol_id, flags FROM symbolReference"
+    };
+
+    return sql::readRowsAsVector<SymbolReference>(stmt, readSymbolReferenceLineCol);
+  }
+
   sql::Statement stmt{ 
     database(),
-    "SELECT symbol_id, file_id, line, col, parent_symbol_id, flags FROM symbolReference"
+    "SELECT symbol_id, file_id, position, parent_symbol_id, flags FROM symbolReference"
   };
 
   return sql::readRowsAsVector<SymbolReference>(stmt, readSymbolReference);
 }
 
+/**
+ * \brief returns all the references to a symbol
+ * 
+ * If the snapshot has the posting lists created by 
+ * SnapshotWriter::createReferencePostings(), the references are decoded 
+ * from a single row; otherwise, they are read from the "symbolReference"
+ * table. In both cases, they are sorted by file and position.
+ */
 std::vector<SymbolReference> SnapshotReader::findReferences(SymbolID symbolID) const
 {
+  if (hasReferencePostings())
+  {
+    sql::Statement stmt{
+      database(),
+      "SELECT data FROM symbolReferencePostings WHERE symbol_id = ?"
+    };
+
+    stmt.bind(1, static_cast<int64_t>(symbolID.rawID()));
+
+    if (!stmt.fetchNextRow()) {
+      return {};
+    }
+
+    return decodeReferencePostings(stmt.columnBlob(0), symbolID);
+  }
+
+  if (schemaVersion() < 2)
+  {
+    sql::Statement stmt{ 
+      database(),
+      "SELECT symbol_id, file_id, line, col, parent_symbol_id, flags FROM symbolReference WHERE symbol_id = ?"
+    };
+
+    stmt.bind(1, symbolID.rawID());
+
+    std::vector<SymbolReference> refs = sql::readRowsAsVector<SymbolReference>(stmt, readSymbolReferenceLineCol);
+    sort(refs);
+    return refs;
+  }
+
   sql::Statement stmt{ 
     database(),
-    "SELECT symbol_id, file_id, line, col, parent_symbol_id, flags FROM symbolReference WHERE symbol_id = ?"
+    "SELECT symbol_id, file_id, position, parent_symbol_id, flags FROM symbolReference WHERE symbol_id = ?"
   };
 
   stmt.bind(1, symbolID.rawID());
 
-  return sql::readRowsAsVector<SymbolReference>(stmt, readSymbolReference);
+  std::vector<SymbolReference> refs = sql::readRowsAsVector<SymbolReference>(stmt, readSymbolReference);
+  sort(refs);
+  return refs;
+}
+
+/**
+ * \brief returns whether the snapshot has the posting lists created by SnapshotWriter::createReferencePostings()
+ * 
+ * This is checked once when the snapshot is opened.
+ */
+bool SnapshotReader::hasReferencePostings() const
+{
+  return m_has_reference_postings;
+}
+
+/**
+ * \brief returns the number of references to a symbol, by role
+ * 
+ * The counts are read directly from the posting lists if the snapshot
+ * has them, and computed from the references otherwise.
+ */
+SymbolReferenceCounts SnapshotReader::getReferenceCounts(SymbolID symbolID) const
+{
+  if (!hasReferencePostings()) {
+    return countReferences(findReferences(symbolID));
+  }
+
+  sql::Statement stmt{
+    database(),
+    "SELECT referenceCount, readCount, writeCount, callCount, definitionCount FROM symbolReferencePostings WHERE symbol_id = ?"
+  };
+
+  stmt.bind(1, static_cast<int64_t>(symbolID.rawID()));
+
+  SymbolReferenceCounts counts;
+
+  if (stmt.fetchNextRow())
+  {
+    counts.references = stmt.columnInt(0);
+    counts.reads = stmt.columnInt(1);
+    counts.writes = stmt.columnInt(2);
+    counts.calls = stmt.columnInt(3);
+    counts.definitions = stmt.columnInt(4);
+  }
+
+  return counts;
 }
 
 inline static Diagnostic readDiagnostic(sql::Statement& row)
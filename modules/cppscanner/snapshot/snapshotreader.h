@@ -5,6 +5,9 @@
 #ifndef CPPSCANNER_SNAPSHOTREADER_H
 #define CPPSCANNER_SNAPSHOTREADER_H
 
+#include "blobstore.h"
+#include "compression.h"
+#include "referencepostings.h"
 #include "snapshot.h"
 
 #include "cppscanner/database/database.h"
@@ -12,11 +15,23 @@
 #include <filesystem>
 #include <initializer_list>
 #include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
 namespace cppscanner
 {
 
+/**
+ * \brief describes how SnapshotReader::searchSymbols() matches names
+ */
+enum class SymbolSearchMode
+{
+  Prefix,    //< the name or the qualified name starts with the text
+  Substring, //< the name or the qualified name contains the text
+  Fuzzy,     //< the names share trigrams with the text, e.g. to tolerate typos
+};
+
 /**
  * \brief helper class for reading snapshots of C++ program produced by the scanner
  * 
@@ -42,8 +57,13 @@ public:
   Database& database() const;
 
   Snapshot::Properties readProperties() const;
+  int schemaVersion() const;
 
   std::vector<File> getFiles(bool fetchContent = false) const;
+  FileContentCodec fileContentCodec() const;
+  std::string getFileContent(FileID fid) const;
+  BlobStore* blobStore() const;
+  void setBlobStore(const std::filesystem::path& p);
   std::vector<Include> getIncludes() const;
   std::vector<Include> getIncludedFiles(FileID fid) const;
   std::vector<ArgumentPassedByReference> getArgumentsPassedByReference() const;
@@ -66,6 +86,9 @@ public:
   std::vector<VariableRecord> getFields(SymbolID classId) const;
   std::vector<VariableRecord> getStaticProperties(SymbolID classId) const;
 
+  bool hasSymbolSearchIndex() const;
+  std::vector<SymbolRecord> searchSymbols(const std::string& text, SymbolSearchMode mode = SymbolSearchMode::Substring, int limit = 50) const;
+
   std::vector<BaseOf> getBases() const;
   std::vector<BaseOf> getBasesOf(SymbolID classID) const;
   std::vector<Override> getOverrides() const;
@@ -73,6 +96,11 @@ public:
 
   std::vector<SymbolReference> getSymbolReferences() const;
   std::vector<SymbolReference> findReferences(SymbolID symbolID) const;
+  bool hasReferencePostings() const;
+  SymbolReferenceCounts getReferenceCounts(SymbolID symbolID) const;
+
+  bool hasFileAnnotations() const;
+  std::optional<std::string> getFileAnnotations(FileID fid) const;
 
   std::vector<Diagnostic> getDiagnostics() const;
 
@@ -81,6 +109,9 @@ public:
 private:
   std::filesystem::path m_database_path;
   std::unique_ptr<Database> m_database;
+  mutable std::unique_ptr<BlobStore> m_blob_store;
+  int m_schema_version = 0;
+  bool m_has_reference_postings = false;
 };
 
 void sort(std::vector<SymbolReference>& refs);
@@ -4,17 +4,22 @@
 
 #include "snapshotwriter.h"
 
+#include "blobstore.h"
+#include "fileannotations.h"
+#include "referencepostings.h"
 #include "indexersymbol.h"
 
 #include "cppscanner/snapshot/symbolrecorditerator.h"
 
-#include "cppscanner/database/readrows.h"
+#include "cppscanner/database/statementcache.h"
 #include "cppscanner/database/transaction.h"
 
 #include "cppscanner/index/symbol.h"
 
 #include <algorithm>
 #include <cassert>
+#include <stdexcept>
+#include <string>
 
 namespace cppscanner
 {
@@ -81,6 +86,19 @@ static_assert(SymbolReference::Implicit == 128);
 
 static_assert(FilePosition::ColumnBits == 12);
 
+// Settings of the Build and Publish profiles.
+// A snapshot that is being written is never read by another process, and an 
+// interrupted scan has to be restarted anyway: the journal and the syncs 
+// only slow down writing.
+static const char* SQL_BUILD_PRAGMAS = R"(
+PRAGMA locking_mode = EXCLUSIVE;
+PRAGMA journal_mode = OFF;
+PRAGMA synchronous = OFF;
+PRAGMA cache_size = -262144;
+PRAGMA temp_store = MEMORY;
+PRAGMA mmap_size = 1073741824;
+)";
+
 static const char* SQL_CREATE_STATEMENTS = R"(
 BEGIN TRANSACTION;
 
@@ -95,10 +113,11 @@ CREATE TABLE "accessSpecifier" (
 );
 
 CREATE TABLE "file" (
-  "id"      INTEGER NOT NULL PRIMARY KEY UNIQUE,
-  "path"    TEXT NOT NULL,
-  "sha1"    TEXT,
-  "content" TEXT
+  "id"                 INTEGER NOT NULL PRIMARY KEY UNIQUE,
+  "path"               TEXT NOT NULL,
+  "sha1"               TEXT,
+  "content"            TEXT,
+  "compressedContent"  BLOB
 );
 
 CREATE TABLE "include" (
@@ -235,12 +254,13 @@ CREATE VIEW variableRecord (
   WHERE (symbol.kind = 15 OR symbol.kind = 16 OR symbol.kind = 17);
 
 CREATE TABLE "symbolReference" (
-  "symbol_id"                     INTEGER NOT NULL,
   "file_id"                       INTEGER NOT NULL,
-  "line"                          INTEGER NOT NULL,
-  "col"                           INTEGER NOT NULL,
+  "position"                      INTEGER NOT NULL,
+  "symbol_id"                     INTEGER NOT NULL,
   "parent_symbol_id"              INTEGER,
   "flags"                         INTEGER NOT NULL DEFAULT 0,
+  line                            INT GENERATED ALWAYS AS (position >> 12) VIRTUAL,
+  col                             INT GENERATED ALWAYS AS (position & 4095) VIRTUAL,
   isDeclaration                   INT GENERATED ALWAYS AS ((flags & 1) != 0) VIRTUAL,
   isDefinition                    INT GENERATED ALWAYS AS ((flags & 2) != 0) VIRTUAL,
   isReference                     INT GENERATED ALWAYS AS ((flags & 3) = 0) VIRTUAL,
@@ -251,8 +271,9 @@ CREATE TABLE "symbolReference" (
   isImplicit                      INT GENERATED ALWAYS AS ((flags & 128) != 0) VIRTUAL,
   FOREIGN KEY("symbol_id")        REFERENCES "symbol"("id"),
   FOREIGN KEY("file_id")          REFERENCES "file"("id"),
-  FOREIGN KEY("parent_symbol_id") REFERENCES "symbol"("id")
-);
+  FOREIGN KEY("parent_symbol_id") REFERENCES "symbol"("id"),
+  PRIMARY KEY(file_id, position, symbol_id)
+) WITHOUT ROWID;
 
 CREATE VIEW symbolDefinition (symbol_id, file_id, line, col, flags) AS
   SELECT symbol_id, file_id, line, col, flags
@@ -269,7 +290,8 @@ CREATE TABLE "symbolDeclaration" (
   endPositionLine                 INT GENERATED ALWAYS AS (endPosition >> 12) VIRTUAL,
   endPositionColumn               INT GENERATED ALWAYS AS (endPosition & 4095) VIRTUAL,
   FOREIGN KEY("symbol_id")        REFERENCES "symbol"("id"),
-  FOREIGN KEY("file_id")          REFERENCES "file"("id")
+  FOREIGN KEY("file_id")          REFERENCES "file"("id"),
+  UNIQUE(file_id, symbol_id, startPosition, endPosition, isDefinition)
 );
 
 CREATE TABLE "baseOf" (
@@ -300,19 +322,87 @@ CREATE TABLE "diagnostic" (
   "line"                 INTEGER NOT NULL,
   "column"               INTEGER NOT NULL,
   "message"              TEXT NOT NULL,
-  FOREIGN KEY("fileID")  REFERENCES "file"("id")
+  FOREIGN KEY("fileID")  REFERENCES "file"("id"),
+  UNIQUE(fileID, line, column, level, message)
 );
 
 CREATE TABLE "argumentPassedByReference" (
   "file_id"               INTEGER NOT NULL,
   "line"                  INTEGER NOT NULL,
   "column"                INTEGER NOT NULL,
-  FOREIGN KEY("file_id")  REFERENCES "file"("id")
+  FOREIGN KEY("file_id")  REFERENCES "file"("id"),
+  UNIQUE(file_id, line, column)
 );
 
 COMMIT;
 )";
 
+// Secondary indexes, created by createIndexes() once the tables are filled.
+// Lookups by file (symbolReference, symbolDeclaration, diagnostic, 
+// argumentPassedByReference, include) are already served by the primary 
+// key or UNIQUE constraints, whose first column is the file id.
+static const char* SQL_CREATE_INDEXES = R"(
+BEGIN TRANSACTION;
+
+CREATE INDEX IF NOT EXISTS symbolReference_symbol_id ON symbolReference(symbol_id);
+CREATE INDEX IF NOT EXISTS symbolDeclaration_symbol_id ON symbolDeclaration(symbol_id);
+CREATE INDEX IF NOT EXISTS symbol_parent ON symbol(parent);
+CREATE INDEX IF NOT EXISTS symbol_name ON symbol(name);
+CREATE INDEX IF NOT EXISTS baseOf_derivedClassID ON baseOf(derivedClassID);
+CREATE INDEX IF NOT EXISTS override_baseMethodID ON override(baseMethodID);
+
+COMMIT;
+)";
+
+// Full-text index over the names and fully qualified names of the symbols,
+// created by createSymbolSearchIndex().
+// The trigram tokenizer allows substring queries and the table is contentless
+// (the rowid is the id of the symbol) so that the names are not stored twice.
+// Qualified names are computed by walking up the parents of each symbol, 
+// which only requires lookups by primary key.
+static const char* SQL_CREATE_SYMBOL_SEARCH = R"(
+BEGIN TRANSACTION;
+
+DROP TABLE IF EXISTS symbolSearch;
+
+CREATE VIRTUAL TABLE symbolSearch USING fts5(name, qualifiedName, content = '', tokenize = 'trigram');
+
+INSERT INTO symbolSearch(rowid, name, qualifiedName)
+  WITH RECURSIVE chain(id, name, ancestor, qualifiedName) AS (
+    SELECT id, name, parent, name FROM symbol
+    UNION ALL
+    SELECT chain.id, chain.name, symbol.parent, symbol.name || '::' || chain.qualifiedName
+    FROM chain JOIN symbol ON symbol.id = chain.ancestor
+  )
+  SELECT id, name, qualifiedName FROM chain
+  WHERE ancestor IS NULL OR NOT EXISTS (SELECT 1 FROM symbol WHERE symbol.id = chain.ancestor);
+
+INSERT INTO symbolSearch(symbolSearch) VALUES('optimize');
+
+COMMIT;
+)";
+
+// The "fileContent" view is only created for snapshots with compressed 
+// file content: querying it requires the zstd_decompress() SQL function
+// registered by registerDecompressionFunctions(), which other SQLite 
+// clients do not have.
+static const char* SQL_CREATE_FILE_CONTENT_VIEW = R"(
+CREATE VIEW IF NOT EXISTS fileContent (id, content) AS
+  SELECT id, coalesce(content, zstd_decompress(compressedContent))
+  FROM file;
+)";
+
+static const char* SQL_INSERT_PROPERTY = "INSERT OR REPLACE INTO info (key, value) VALUES (?,?)";
+
+static void create_file_content_view(Database& db)
+{
+  std::string error;
+
+  if (!sql::exec(db, SQL_CREATE_FILE_CONTENT_VIEW, &error)) {
+    throw std::runtime_error("could not create fileContent view: " + error);
+  }
+}
+
 static void insert_enum_values(Database& db)
 {
   sql::Statement stmt{ db };
@@ -360,7 +450,8 @@ SnapshotWriter::SnapshotWriter()
 SnapshotWriter::SnapshotWriter(SnapshotWriter&&) = default;
 SnapshotWriter::~SnapshotWriter() = default;
 
-SnapshotWriter::SnapshotWriter(const std::filesystem::path& databasePath)
+SnapshotWriter::SnapshotWriter(const std::filesystem::path& databasePath, DatabaseProfile profile) :
+  m_profile(profile)
 {
   if (!open(databasePath))
   {
@@ -368,20 +459,119 @@ SnapshotWriter::SnapshotWriter(const std::filesystem::path& databasePath)
   }
 }
 
+/**
+ * \brief returns the profile used to configure the database
+ */
+DatabaseProfile SnapshotWriter::profile() const
+{
+  return m_profile;
+}
+
+/**
+ * \brief sets the profile used to configure the database
+ * 
+ * This must be called before open().
+ * Note that the writer only applies the settings of the profile; publishing 
+ * the snapshot with publish() is the responsibility of the caller once the 
+ * snapshot is complete and closed.
+ */
+void SnapshotWriter::setProfile(DatabaseProfile profile)
+{
+  assert(!isOpen());
+  m_profile = profile;
+}
+
+/**
+ * \brief returns the codec used to store the content of files
+ */
+FileContentCodec SnapshotWriter::fileContentCodec() const
+{
+  return m_file_content_codec;
+}
+
+/**
+ * \brief sets the codec used to store the content of files
+ * 
+ * The codec is saved in the "file.content.codec" property.
+ * Unless the codec is None, the "fileContent" view, which returns the 
+ * decompressed content of the files, is also created.
+ * Throws std::runtime_error if cppscanner was built without support for the codec.
+ */
+void SnapshotWriter::setFileContentCodec(FileContentCodec codec)
+{
+  if (!isCodecAvailable(codec)) {
+    throw std::runtime_error("unsupported file content codec: " + std::string(getFileContentCodecString(codec)));
+  }
+
+  m_file_content_codec = codec;
+
+  if (isOpen()) 
+  {
+    setProperty("file.content.codec", std::string(getFileContentCodecString(codec)));
+
+    if (codec != FileContentCodec::None) {
+      create_file_content_view(database());
+    }
+  }
+}
+
+/**
+ * \brief returns the store in which the content of files is written, if any
+ */
+BlobStore* SnapshotWriter::blobStore() const
+{
+  return m_blob_store.get();
+}
+
+/**
+ * \brief sets a blob store in which the content of files is written
+ * \param p  the path of the store, which is created if it does not exist
+ * 
+ * When a store is set, the "file" table only contains the path and SHA-1 
+ * of the files and content that is already in the store is not written again.
+ * The absolute path of the store is saved in the "file.content.store" property.
+ * Throws std::runtime_error if the store cannot be opened.
+ */
+void SnapshotWriter::setBlobStore(const std::filesystem::path& p)
+{
+  m_blob_store = std::make_unique<BlobStore>(std::filesystem::absolute(p));
+
+  if (isOpen()) {
+    setProperty("file.content.store", m_blob_store->filePath().u8string());
+  }
+}
+
 bool SnapshotWriter::open()
 {
   m_database = std::make_unique<Database>();
   database().create(m_database_path);
 
+  if (m_profile != DatabaseProfile::Default && !sql::exec(database(), SQL_BUILD_PRAGMAS))
+  {
+    m_database.reset();
+    return false;
+  }
+
   if (!sql::exec(database(), snapshot::db_init_statements()))
   {
     m_database.reset();
     return false;
   }
+
+  m_statements = std::make_unique<sql::StatementCache>(database());
     
+  registerDecompressionFunctions(database());
+
   sql::runTransacted(database(), [this]() {
     insert_enum_values(database());
     setProperty("database.schema.version", DatabaseSchemaVersion);
+    setProperty("file.content.codec", std::string(getFileContentCodecString(m_file_content_codec)));
+    if (m_blob_store) {
+      setProperty("file.content.store", m_blob_store->filePath().u8string());
+    }
+    if (m_file_content_codec != FileContentCodec::None) {
+      create_file_content_view(database());
+    }
     });
 
   return true;
@@ -398,6 +588,67 @@ bool SnapshotWriter::isOpen() const
   return m_database != nullptr;
 }
 
+/**
+ * \brief commits the current transaction, if any, and closes the database
+ */
+void SnapshotWriter::close()
+{
+  if (m_transaction) {
+    endTransaction();
+  }
+
+  m_statements.reset();
+  m_database.reset();
+}
+
+/**
+ * \brief rewrites a complete snapshot so that it is optimized for reading
+ * \param p         the path of the snapshot, which must not be opened
+ * \param pageSize  the page size of the published database
+ * 
+ * Statistics are gathered for the query planner, then the database is 
+ * copied with VACUUM INTO, which defragments the tables and indexes, 
+ * to a temporary file that finally replaces the snapshot.
+ * The snapshot is left untouched if an error occurs.
+ */
+void SnapshotWriter::publish(const std::filesystem::path& p, int pageSize)
+{
+  const std::filesystem::path tmp_path = p.u8string() + ".publish";
+
+  if (std::filesystem::exists(tmp_path)) {
+    std::filesystem::remove(tmp_path);
+  }
+
+  {
+    Database db;
+
+    if (!db.open(p)) {
+      throw std::runtime_error("could not open snapshot " + p.u8string());
+    }
+
+    std::string error;
+
+    if (!sql::exec(db, "ANALYZE; PRAGMA optimize; PRAGMA page_size = " + std::to_string(pageSize) + ";", &error)) {
+      throw std::runtime_error("could not analyze snapshot: " + error);
+    }
+
+    sql::Statement stmt{ db, "VACUUM INTO ?" };
+    stmt.bind(1, tmp_path.u8string());
+
+    if (stmt.step() != SQLITE_DONE)
+    {
+      error = stmt.errormsg();
+      stmt.finalize();
+      db.close();
+      std::filesystem::remove(tmp_path);
+      throw std::runtime_error("could not publish snapshot: " + error);
+    }
+  }
+
+  // rename() atomically replaces the destination
+  std::filesystem::rename(tmp_path, p);
+}
+
 const std::filesystem::path& SnapshotWriter::filePath() const
 {
   return m_database_path;
@@ -412,6 +663,15 @@ Database& SnapshotWriter::database() const
   return *m_database;
 }
 
+/**
+ * \brief returns the statements prepared for the lifetime of the connection
+ */
+sql::StatementCache& SnapshotWriter::statements() const
+{
+  assert(isOpen());
+  return *m_statements;
+}
+
 std::string SnapshotWriter::normalizedPath(std::string p)
 {
   return Snapshot::normalizedPath(p);
@@ -419,16 +679,12 @@ std::string SnapshotWriter::normalizedPath(std::string p)
 
 void SnapshotWriter::setProperty(const std::string& key, const std::string& value)
 {
-  sql::Statement stmt{ database() };
-
-  stmt.prepare("INSERT OR REPLACE INTO info (key, value) VALUES (?,?)");
+  sql::Statement& stmt = statements().get(SQL_INSERT_PROPERTY);
 
   stmt.bind(1, key.c_str());
   stmt.bind(2, value.c_str());
 
-  stmt.step();
-
-  stmt.finalize();
+  stmt.insert();
 }
 
 void SnapshotWriter::setProperty(const std::string& key, bool value)
@@ -453,9 +709,7 @@ void SnapshotWriter::setProperty(const std::string& key, const Snapshot::Path& p
 
 void SnapshotWriter::insert(const Snapshot::Properties& properties)
 {
-  sql::Statement stmt{ database() };
-
-  stmt.prepare("INSERT OR REPLACE INTO info (key, value) VALUES (?,?)");
+  sql::Statement& stmt = statements().get(SQL_INSERT_PROPERTY);
 
   for (const auto& elem : properties)
   {
@@ -464,13 +718,11 @@ void SnapshotWriter::insert(const Snapshot::Properties& properties)
 
     stmt.insert();
   }
-
-  stmt.finalize();
 }
 
 void SnapshotWriter::insertFilePaths(const std::vector<File>& files)
 {
-  sql::Statement stmt{ database(), "INSERT OR IGNORE INTO file(id, path) VALUES(?,?)"};
+  sql::Statement& stmt = statements().get("INSERT OR IGNORE INTO file(id, path) VALUES(?,?)");
 
   for (const File& f : files) {
     const std::string& fpath = normalizedPath(f.path);
@@ -478,13 +730,67 @@ void SnapshotWriter::insertFilePaths(const std::vector<File>& files)
     stmt.bind(2, fpath.c_str());
     stmt.insert();
   }
-
-  stmt.finalize();
 }
 
 void SnapshotWriter::insertFiles(const std::vector<File>& files)
 {
-  sql::Statement stmt{ database(), "INSERT OR REPLACE INTO file(id, path, sha1, content) VALUES(?,?,?,?)"};
+  if (m_blob_store)
+  {
+    insertFilesInBlobStore(files);
+    return;
+  }
+
+  sql::Statement& stmt = statements().get("INSERT OR REPLACE INTO file(id, path, sha1, content, compressedContent) VALUES(?,?,?,?,?)");
+
+  for (const File& f : files) 
+  {
+    const std::string& fpath = normalizedPath(f.path);
+    stmt.bind(1, (int)f.id);
+    stmt.bind(2, fpath.c_str());
+    stmt.bind(3, f.sha1.c_str());
+
+    if (m_file_content_codec == FileContentCodec::None || f.content.empty())
+    {
+      stmt.bind(4, f.content.c_str());
+      stmt.bind(5, nullptr);
+      stmt.insert();
+    }
+    else
+    {
+      const std::string data = compress(m_file_content_codec, f.content);
+      stmt.bind(4, nullptr);
+      stmt.bind(5, sql::Blob(data));
+      stmt.insert();
+    }
+  }
+}
+
+/**
+ * \brief inserts files whose content goes to the blob store
+ * 
+ * Only the path and SHA-1 of the files are written to the snapshot.
+ * Inside a transaction, the contents are kept until endTransaction() so that
+ * the blob store, which may be shared with other processes, is locked once
+ * per group commit rather than once per call.
+ */
+void SnapshotWriter::insertFilesInBlobStore(const std::vector<File>& files)
+{
+  if (files.empty()) {
+    return;
+  }
+
+  for (const File& f : files)
+  {
+    if (!f.sha1.empty() && !f.content.empty()) {
+      m_pending_blobs.emplace_back(f.sha1, f.content);
+    }
+  }
+
+  if (!m_transaction) {
+    writePendingBlobs();
+  }
+
+  sql::Statement& stmt = statements().get("INSERT OR REPLACE INTO file(id, path, sha1) VALUES(?,?,?)");
 
   for (const File& f : files) 
   {
@@ -492,64 +798,119 @@ void SnapshotWriter::insertFiles(const std::vector<File>& files)
     stmt.bind(1, (int)f.id);
     stmt.bind(2, fpath.c_str());
     stmt.bind(3, f.sha1.c_str());
-    stmt.bind(4, f.content.c_str());
     stmt.insert();
   }
+}
 
-  stmt.finalize();
+/**
+ * \brief writes the contents buffered by insertFilesInBlobStore() in a single blob store transaction
+ * 
+ * If an exception is thrown, the blob store transaction is rolled back 
+ * and the contents are kept for the next attempt.
+ */
+void SnapshotWriter::writePendingBlobs()
+{
+  if (m_pending_blobs.empty()) {
+    return;
+  }
+
+  BlobStoreTransaction transaction{ *m_blob_store };
+
+  for (const auto& [sha1, content] : m_pending_blobs) {
+    m_blob_store->insert(sha1, content, m_file_content_codec);
+  }
+
+  transaction.commit();
+  m_pending_blobs.clear();
 }
 
-void SnapshotWriter::insertIncludes(const std::vector<Include>& includes)
+namespace
 {
-  // We use INSERT OR IGNORE here so that duplicates are automatically ignored by sqlite.
-  // See the UNIQUE constraint in the CREATE statement of the "include" table.
 
-  sql::Statement stmt{ 
-    database(), 
-    "INSERT OR IGNORE INTO include (file_id, line, included_file_id) VALUES(?,?,?)"
-  };
+/**
+ * \brief inserts rows using multi-row INSERT statements
+ * \param cache       the statement cache
+ * \param insertInto  the beginning of the statement, up to and including VALUES
+ * \param rows        the rows
+ * \param bindRow     function binding the values of a row, given the index of its first parameter
+ * 
+ * The rows are inserted by batches of StatementCache::maxRowsPerInsert() rows,
+ * the remaining rows are inserted one by one.
+ * Values are bound without being copied: they must remain valid until 
+ * this function returns.
+ */
+template<int NbColumns, typename T, typename F>
+void insertRows(sql::StatementCache& cache, const char* insertInto, const std::vector<T>& rows, F&& bindRow)
+{
+  const size_t batch_size = static_cast<size_t>(cache.maxRowsPerInsert(NbColumns));
+  size_t i = 0;
 
-  for (const Include& inc : includes)
+  if (rows.size() >= batch_size)
   {
-    stmt.bind(1, (int)inc.fileID);
-    stmt.bind(2, inc.line);
-    stmt.bind(3, (int)inc.includedFileID);
+    sql::Statement& stmt = cache.getMultiRowInsert(insertInto, NbColumns, static_cast<int>(batch_size));
 
-    stmt.insert();
+    for (; i + batch_size <= rows.size(); i += batch_size)
+    {
+      for (size_t r(0); r < batch_size; ++r) {
+        bindRow(stmt, static_cast<int>(r) * NbColumns + 1, rows[i + r]);
+      }
+
+      stmt.insert();
+    }
   }
 
-  stmt.finalize();
+  if (i < rows.size())
+  {
+    sql::Statement& stmt = cache.getMultiRowInsert(insertInto, NbColumns, 1);
+
+    for (; i < rows.size(); ++i)
+    {
+      bindRow(stmt, 1, rows[i]);
+      stmt.insert();
+    }
+  }
+}
+
+} // namespace
+
+void SnapshotWriter::insertIncludes(const std::vector<Include>& includes)
+{
+  // We use INSERT OR IGNORE here so that duplicates are automatically ignored by sqlite.
+  // See the UNIQUE constraint in the CREATE statement of the "include" table.
+
+  insertRows<3>(statements(),
+    "INSERT OR IGNORE INTO include (file_id, line, included_file_id) VALUES ",
+    includes,
+    [](sql::Statement& stmt, int n, const Include& inc) {
+      stmt.bind(n, (int)inc.fileID);
+      stmt.bind(n + 1, inc.line);
+      stmt.bind(n + 2, (int)inc.includedFileID);
+    });
 }
 
 class SymbolExtraInfoInserter
 {
 private:
-  sql::Statement m_macroInfo;
-  sql::Statement m_namespaceAliasInfo;
-  sql::Statement m_enumInfo;
-  sql::Statement m_enumConstantInfo;
-  sql::Statement m_functionInfo;
-  sql::Statement m_parameterInfo;
-  sql::Statement m_variableInfo;
+  sql::Statement& m_macroInfo;
+  sql::Statement& m_namespaceAliasInfo;
+  sql::Statement& m_enumInfo;
+  sql::Statement& m_enumConstantInfo;
+  sql::Statement& m_functionInfo;
+  sql::Statement& m_parameterInfo;
+  sql::Statement& m_variableInfo;
   SymbolID m_currentSymbolId;
 
 public:
-  explicit SymbolExtraInfoInserter(Database& db) : 
-    m_macroInfo(db), 
-    m_namespaceAliasInfo(db), 
-    m_enumInfo(db), 
-    m_enumConstantInfo(db), 
-    m_functionInfo(db), 
-    m_parameterInfo(db), 
-    m_variableInfo(db)
+  explicit SymbolExtraInfoInserter(sql::StatementCache& statements) : 
+    m_macroInfo(statements.get("INSERT OR REPLACE INTO macroInfo(id, definition) VALUES(?,?)")), 
+    m_namespaceAliasInfo(statements.get("INSERT OR REPLACE INTO namespaceAliasInfo(id, value) VALUES(?,?)")), 
+    m_enumInfo(statements.get("INSERT OR REPLACE INTO enumInfo(id, integerType) VALUES(?,?)")), 
+    m_enumConstantInfo(statements.get("INSERT OR REPLACE INTO enumConstantInfo(id, value, expression) VALUES(?,?,?)")), 
+    m_functionInfo(statements.get("INSERT OR REPLACE INTO functionInfo(id, returnType) VALUES(?,?)")), 
+    m_parameterInfo(statements.get("INSERT OR REPLACE INTO parameterInfo(id, parameterIndex, type, defaultValue) VALUES(?,?,?,?)")), 
+    m_variableInfo(statements.get("INSERT OR REPLACE INTO variableInfo(id, type, init) VALUES(?,?,?)"))
   {
-    m_macroInfo.prepare("INSERT OR REPLACE INTO macroInfo(id, definition) VALUES(?,?)");
-    m_namespaceAliasInfo.prepare("INSERT OR REPLACE INTO namespaceAliasInfo(id, value) VALUES(?,?)");
-    m_enumInfo.prepare("INSERT OR REPLACE INTO enumInfo(id, integerType) VALUES(?,?)");
-    m_enumConstantInfo.prepare("INSERT OR REPLACE INTO enumConstantInfo(id, value, expression) VALUES(?,?,?)");
-    m_functionInfo.prepare("INSERT OR REPLACE INTO functionInfo(id, returnType) VALUES(?,?)");
-    m_parameterInfo.prepare("INSERT OR REPLACE INTO parameterInfo(id, parameterIndex, type, defaultValue) VALUES(?,?,?,?)");
-    m_variableInfo.prepare("INSERT OR REPLACE INTO variableInfo(id, type, init) VALUES(?,?,?)");
+
   }
 
   void process(const std::vector<const IndexerSymbol*>& symbols)
@@ -557,7 +918,7 @@ public:
     for (auto sptr : symbols)
     {
       m_currentSymbolId = sptr->id;
-      std::visit(*this, sptr->extraInfo);
+      sptr->extraInfo.visit(*this);
     }
   }
 
@@ -577,56 +938,86 @@ public:
     }
   }
 
-  void operator()(std::monostate)
+  void operator()(const MacroInfo& info)
+  {
+    (*this)(MacroExtraInfo{ info.definition });
+  }
+
+  void operator()(const FunctionInfo& info)
   {
+    (*this)(FunctionExtraInfo{ info.returnType, info.declaration });
+  }
 
+  void operator()(const ParameterInfo& info)
+  {
+    (*this)(ParameterExtraInfo{ info.parameterIndex, info.type, info.defaultValue });
   }
 
-  void operator()(const MacroInfo& info)
+  void operator()(const EnumInfo& info)
+  {
+    (*this)(EnumExtraInfo{ info.underlyingType });
+  }
+
+  void operator()(const EnumConstantInfo& info)
+  {
+    (*this)(EnumConstantExtraInfo{ info.value, info.expression });
+  }
+
+  void operator()(const VariableInfo& info)
+  {
+    (*this)(VariableExtraInfo{ info.type, info.init });
+  }
+
+  void operator()(const NamespaceAliasInfo& info)
+  {
+    (*this)(NamespaceAliasExtraInfo{ info.value });
+  }
+
+  void operator()(const MacroExtraInfo& info)
   {
     m_macroInfo.bind(1, m_currentSymbolId.rawID());
-    m_macroInfo.bind(2, std::string_view(info.definition));
+    m_macroInfo.bind(2, info.definition);
 
     m_macroInfo.insert();
   }
 
-  void operator()(const FunctionInfo& info)
+  void operator()(const FunctionExtraInfo& info)
   {
     m_functionInfo.bind(1, m_currentSymbolId.rawID());
-    m_functionInfo.bind(2, std::string_view(info.returnType));
+    m_functionInfo.bind(2, info.returnType);
 
     m_functionInfo.insert();
   }
 
-  void operator()(const ParameterInfo& info)
+  void operator()(const ParameterExtraInfo& info)
   {
     m_parameterInfo.bind(1, m_currentSymbolId.rawID());
     m_parameterInfo.bind(2, info.parameterIndex);
-    m_parameterInfo.bind(3, std::string_view(info.type));
+    m_parameterInfo.bind(3, info.type);
 
     if (!info.defaultValue.empty())
-      m_parameterInfo.bind(4, std::string_view(info.defaultValue));
+      m_parameterInfo.bind(4, info.defaultValue);
     else
       m_parameterInfo.bind(4, nullptr);
 
     m_parameterInfo.insert();
   }
 
-  void operator()(const EnumInfo& info)
+  void operator()(const EnumExtraInfo& info)
   {
     m_enumInfo.bind(1, m_currentSymbolId.rawID());
-    m_enumInfo.bind(2, std::string_view(info.underlyingType));
+    m_enumInfo.bind(2, info.underlyingType);
 
     m_enumInfo.insert();
   }
 
-  void operator()(const EnumConstantInfo& info)
+  void operator()(const EnumConstantExtraInfo& info)
   {
     m_enumConstantInfo.bind(1, m_currentSymbolId.rawID());
     m_enumConstantInfo.bind(2, info.value);
 
     if (!info.expression.empty()) {
-      m_enumConstantInfo.bind(3, std::string_view(info.expression));
+      m_enumConstantInfo.bind(3, info.expression);
     } else {
       m_enumConstantInfo.bind(3, nullptr);
     }
@@ -634,31 +1025,31 @@ public:
     m_enumConstantInfo.insert();
   }
 
-  void operator()(const VariableInfo& info)
+  void operator()(const VariableExtraInfo& info)
   {
     m_variableInfo.bind(1, m_currentSymbolId.rawID());
-    m_variableInfo.bind(2, std::string_view(info.type));
+    m_variableInfo.bind(2, info.type);
 
     if (!info.init.empty())
-      m_variableInfo.bind(3, std::string_view(info.init));
+      m_variableInfo.bind(3, info.init);
     else
       m_variableInfo.bind(3, nullptr);
 
     m_variableInfo.insert();
   }
 
-  void operator()(const NamespaceAliasInfo& info)
+  void operator()(const NamespaceAliasExtraInfo& info)
   {
     m_namespaceAliasInfo.bind(1, m_currentSymbolId.rawID());
-    m_namespaceAliasInfo.bind(2, std::string_view(info.value));
+    m_namespaceAliasInfo.bind(2, info.value);
 
     m_namespaceAliasInfo.insert();
   }
 };
 
-void insert_symbols_extra_info(Database& db, const std::vector<const IndexerSymbol*>& symbols)
+void insert_symbols_extra_info(sql::StatementCache& statements, const std::vector<const IndexerSymbol*>& symbols)
 {
-  SymbolExtraInfoInserter inserter{ db };
+  SymbolExtraInfoInserter inserter{ statements };
   inserter.process(symbols);
 }
 
@@ -668,57 +1059,43 @@ void SnapshotWriter::insertSymbols(const std::vector<const IndexerSymbol*>& symb
     return;
   }
 
-  sql::Statement stmt{ 
-    database(),
-    "INSERT OR REPLACE INTO symbol(id, kind, parent, name, flags) VALUES(?,?,?,?,?)" };
+  insertRows<5>(statements(),
+    "INSERT OR REPLACE INTO symbol(id, kind, parent, name, flags) VALUES ",
+    symbols,
+    [](sql::Statement& stmt, int n, const IndexerSymbol* sptr) {
+      const IndexerSymbol& sym = *sptr;
 
-  for (auto sptr : symbols)
-  {
-    const IndexerSymbol& sym = *sptr;
+      stmt.bind(n, sym.id.rawID());
+      stmt.bind(n + 1, static_cast<int>(sym.kind));
 
-    stmt.bind(1, sym.id.rawID());
-    stmt.bind(2, static_cast<int>(sym.kind));
+      if (sym.parentId.isValid())
+        stmt.bind(n + 2, sym.parentId.rawID());
+      else
+        stmt.bind(n + 2, nullptr);
 
-    if (sym.parentId.isValid())
-      stmt.bind(3, sym.parentId.rawID());
-    else
-      stmt.bind(3, nullptr);
-
-    stmt.bind(4, sym.name.c_str());
-
-    stmt.bind(5, sym.flags);
-
-    stmt.insert();
-  }
+      stmt.bind(n + 3, sym.name);
 
-  stmt.finalize();
+      stmt.bind(n + 4, sym.flags);
+    });
 
-  insert_symbols_extra_info(database(), symbols);
+  insert_symbols_extra_info(statements(), symbols);
 }
 
-void SnapshotWriter::updateSymbolsFlags(const std::vector<const IndexerSymbol*>& symbols)
+void SnapshotWriter::updateSymbolsFlags(const std::vector<std::pair<SymbolID, int>>& symbolsFlags)
 {
-  if (symbols.empty()) {
+  if (symbolsFlags.empty()) {
     return;
   }
 
-  sql::Statement stmt{ 
-    database(),
-    "UPDATE symbol SET flags = ? WHERE id = ?" };
+  sql::Statement& stmt = statements().get("UPDATE symbol SET flags = ? WHERE id = ?");
 
-  for (auto sptr : symbols)
+  for (const auto& [id, flags] : symbolsFlags)
   {
-    const IndexerSymbol& sym = *sptr;
-
-    stmt.bind(1, sym.flags);
-    stmt.bind(2, sym.id.rawID());
+    stmt.bind(1, flags);
+    stmt.bind(2, id.rawID());
 
     stmt.update();
   }
-
-  stmt.finalize();
-
-  insert_symbols_extra_info(database(), symbols);
 }
 
 void SnapshotWriter::insertBaseOfs(const std::vector<BaseOf>& bofs)
@@ -727,19 +1104,14 @@ void SnapshotWriter::insertBaseOfs(const std::vector<BaseOf>& bofs)
     return;
   }
 
-  sql::Statement stmt{ 
-    database(),
-    "INSERT OR IGNORE INTO baseOf(baseClassID, derivedClassID, access) VALUES(?,?,?)" 
-  };
-
-  for (const BaseOf& bof : bofs)
-  {
-    stmt.bind(1, bof.baseClassID.rawID());
-    stmt.bind(2, bof.derivedClassID.rawID());
-    stmt.bind(3, static_cast<int>(bof.accessSpecifier));
-
-    stmt.insert();
-  }
+  insertRows<3>(statements(),
+    "INSERT OR IGNORE INTO baseOf(baseClassID, derivedClassID, access) VALUES ",
+    bofs,
+    [](sql::Statement& stmt, int n, const BaseOf& bof) {
+      stmt.bind(n, bof.baseClassID.rawID());
+      stmt.bind(n + 1, bof.derivedClassID.rawID());
+      stmt.bind(n + 2, static_cast<int>(bof.accessSpecifier));
+    });
 }
 
 void SnapshotWriter::insertOverrides(const std::vector<Override>& overrides)
@@ -748,18 +1120,13 @@ void SnapshotWriter::insertOverrides(const std::vector<Override>& overrides)
     return;
   }
 
-  sql::Statement stmt{ 
-    database(),
-    "INSERT OR IGNORE INTO override(overrideMethodID, baseMethodID) VALUES(?,?)" 
-  };
-
-  for (const Override& ov : overrides)
-  {
-    stmt.bind(1, ov.overrideMethodID.rawID());
-    stmt.bind(2, ov.baseMethodID.rawID());
-
-    stmt.insert();
-  }
+  insertRows<2>(statements(),
+    "INSERT OR IGNORE INTO override(overrideMethodID, baseMethodID) VALUES ",
+    overrides,
+    [](sql::Statement& stmt, int n, const Override& ov) {
+      stmt.bind(n, ov.overrideMethodID.rawID());
+      stmt.bind(n + 1, ov.baseMethodID.rawID());
+    });
 }
 
 void SnapshotWriter::insertDiagnostics(const std::vector<Diagnostic>& diagnostics)
@@ -768,21 +1135,16 @@ void SnapshotWriter::insertDiagnostics(const std::vector<Diagnostic>& diagnostic
     return;
   }
 
-  sql::Statement stmt{ 
-    database(),
-    "INSERT OR IGNORE INTO diagnostic(level, fileID, line, column, message) VALUES(?,?,?,?,?)" 
-  };
-
-  for (const Diagnostic& d : diagnostics)
-  {
-    stmt.bind(1, static_cast<int>(d.level));
-    stmt.bind(2, static_cast<int>(d.fileID));
-    stmt.bind(3, d.position.line());
-    stmt.bind(4, d.position.column());
-    stmt.bind(5, std::string_view(d.message));
-
-    stmt.insert();
-  }
+  insertRows<5>(statements(),
+    "INSERT OR IGNORE INTO diagnostic(level, fileID, line, column, message) VALUES ",
+    diagnostics,
+    [](sql::Statement& stmt, int n, const Diagnostic& d) {
+      stmt.bind(n, static_cast<int>(d.level));
+      stmt.bind(n + 1, static_cast<int>(d.fileID));
+      stmt.bind(n + 2, d.position.line());
+      stmt.bind(n + 3, d.position.column());
+      stmt.bind(n + 4, std::string_view(d.message));
+    });
 }
 
 void SnapshotWriter::insert(const std::vector<ArgumentPassedByReference>& refargs)
@@ -791,19 +1153,14 @@ void SnapshotWriter::insert(const std::vector<ArgumentPassedByReference>& refarg
     return;
   }
 
-  sql::Statement stmt{ 
-    database(),
-    "INSERT OR IGNORE INTO argumentPassedByReference(file_id, line, column) VALUES(?,?,?)" 
-  };
-
-  for (const ArgumentPassedByReference& refarg : refargs)
-  {
-    stmt.bind(1, static_cast<int>(refarg.fileID));
-    stmt.bind(2, refarg.position.line());
-    stmt.bind(3, refarg.position.column());
-
-    stmt.insert();
-  }
+  insertRows<3>(statements(),
+    "INSERT OR IGNORE INTO argumentPassedByReference(file_id, line, column) VALUES ",
+    refargs,
+    [](sql::Statement& stmt, int n, const ArgumentPassedByReference& refarg) {
+      stmt.bind(n, static_cast<int>(refarg.fileID));
+      stmt.bind(n + 1, refarg.position.line());
+      stmt.bind(n + 2, refarg.position.column());
+    });
 }
 
 void SnapshotWriter::insert(const std::vector<SymbolReference>& refs)
@@ -812,29 +1169,21 @@ void SnapshotWriter::insert(const std::vector<SymbolReference>& refs)
     return;
   }
 
-  sql::Statement stmt{
-    database(),
-    "INSERT INTO symbolReference (symbol_id, file_id, line, col, parent_symbol_id, flags) VALUES (?,?,?,?,?,?)"
-  };
+  insertRows<5>(statements(),
+    "INSERT OR IGNORE INTO symbolReference (symbol_id, file_id, position, parent_symbol_id, flags) VALUES ",
+    refs,
+    [](sql::Statement& stmt, int n, const SymbolReference& ref) {
+      stmt.bind(n, ref.symbolID.rawID());
+      stmt.bind(n + 1, (int)ref.fileID);
+      stmt.bind(n + 2, ref.position.bits());
 
-  for (const SymbolReference& ref : refs)
-  {
-    stmt.bind(1, ref.symbolID.rawID());
-    stmt.bind(2, (int)ref.fileID);
-    stmt.bind(3, ref.position.line());
-    stmt.bind(4, ref.position.column());
-
-    if (ref.referencedBySymbolID.isValid())
-      stmt.bind(5, ref.referencedBySymbolID.rawID());
-    else 
-      stmt.bind(5, nullptr);
+      if (ref.referencedBySymbolID.isValid())
+        stmt.bind(n + 3, ref.referencedBySymbolID.rawID());
+      else 
+        stmt.bind(n + 3, nullptr);
 
-    stmt.bind(6, ref.flags);
-
-    stmt.insert();
-  }
-
-  stmt.finalize();
+      stmt.bind(n + 4, ref.flags);
+    });
 }
 
 void SnapshotWriter::insert(const std::vector<SymbolDeclaration>& declarations)
@@ -843,22 +1192,16 @@ void SnapshotWriter::insert(const std::vector<SymbolDeclaration>& declarations)
     return;
   }
 
-  // "insert or ignore" wouldn't work here because there are no primary key in the sql table.
-  sql::Statement stmt{ 
-    database(),
-    "INSERT INTO symbolDeclaration(symbol_id, file_id, startPosition, endPosition, isDefinition) VALUES(?,?,?,?,?)" 
-  };
-
-  for (const SymbolDeclaration& decl : declarations)
-  {
-    stmt.bind(1, decl.symbolID.rawID());
-    stmt.bind(2, static_cast<int>(decl.fileID));
-    stmt.bind(3, decl.startPosition.bits());
-    stmt.bind(4, decl.endPosition.bits());
-    stmt.bind(5, decl.isDefinition);
-
-    stmt.insert();
-  }
+  insertRows<5>(statements(),
+    "INSERT OR IGNORE INTO symbolDeclaration(symbol_id, file_id, startPosition, endPosition, isDefinition) VALUES ",
+    declarations,
+    [](sql::Statement& stmt, int n, const SymbolDeclaration& decl) {
+      stmt.bind(n, decl.symbolID.rawID());
+      stmt.bind(n + 1, static_cast<int>(decl.fileID));
+      stmt.bind(n + 2, decl.startPosition.bits());
+      stmt.bind(n + 3, decl.endPosition.bits());
+      stmt.bind(n + 4, decl.isDefinition);
+    });
 }
 
 void SnapshotWriter::insert(const std::map<SymbolID, EnumConstantInfo>& infomap)
@@ -868,7 +1211,7 @@ void SnapshotWriter::insert(const std::map<SymbolID, EnumConstantInfo>& infomap)
     return;
   }
 
-  SymbolExtraInfoInserter inserter{ database() };
+  SymbolExtraInfoInserter inserter{ statements() };
   inserter.process(infomap);
 }
 
@@ -879,7 +1222,7 @@ void SnapshotWriter::insert(const std::map<SymbolID, EnumInfo>& infomap)
     return;
   }
 
-  SymbolExtraInfoInserter inserter{ database() };
+  SymbolExtraInfoInserter inserter{ statements() };
   inserter.process(infomap);
 }
 
@@ -890,7 +1233,7 @@ void SnapshotWriter::insert(const std::map<SymbolID, FunctionInfo>& infomap)
     return;
   }
 
-  SymbolExtraInfoInserter inserter{ database() };
+  SymbolExtraInfoInserter inserter{ statements() };
   inserter.process(infomap);
 }
 
@@ -901,7 +1244,7 @@ void SnapshotWriter::insert(const std::map<SymbolID, MacroInfo>& infomap)
     return;
   }
 
-  SymbolExtraInfoInserter inserter{ database() };
+  SymbolExtraInfoInserter inserter{ statements() };
   inserter.process(infomap);
 }
 
@@ -912,7 +1255,7 @@ void SnapshotWriter::insert(const std::map<SymbolID, NamespaceAliasInfo>& infoma
     return;
   }
 
-  SymbolExtraInfoInserter inserter{ database() };
+  SymbolExtraInfoInserter inserter{ statements() };
   inserter.process(infomap);
 }
 
@@ -923,7 +1266,7 @@ void SnapshotWriter::insert(const std::map<SymbolID, ParameterInfo>& infomap)
     return;
   }
 
-  SymbolExtraInfoInserter inserter{ database() };
+  SymbolExtraInfoInserter inserter{ statements() };
   inserter.process(infomap);
 }
 
@@ -934,158 +1277,133 @@ void SnapshotWriter::insert(const std::map<SymbolID, VariableInfo>& infomap)
     return;
   }
 
-  SymbolExtraInfoInserter inserter{ database() };
+  SymbolExtraInfoInserter inserter{ statements() };
   inserter.process(infomap);
 }
 
 
-std::vector<Include> SnapshotWriter::loadAllIncludesInFile(FileID fid)
-{
-  sql::Statement stmt{ 
-    database(),
-    "SELECT line, included_file_id FROM include WHERE file_id = ?"
-  };
-
-  stmt.bind(1, (int)fid);
-
-  auto read_row = [fid](sql::Statement& q) -> Include {
-    Include row;
-    row.fileID = fid;
-    row.line = q.columnInt(0);
-    row.includedFileID = q.columnInt(1);
-    return row;
-    };
-
-  return sql::readRowsAsVector<Include>(stmt, read_row);
-}
-
-void SnapshotWriter::removeAllIncludesInFile(FileID fid)
+void SnapshotWriter::beginTransaction()
 {
-  sql::Statement stmt{ 
-    database(),
-    "DELETE FROM include WHERE file_id = ?"
-  };
-
-  stmt.bind(1, (int)fid);
-
-  stmt.step();
-}
+  if (m_transaction)
+  {
+    endTransaction();
+  }
 
-std::vector<SymbolReference> SnapshotWriter::loadSymbolReferencesInFile(FileID fid)
-{
-  sql::Statement stmt{ 
-    database(),
-    "SELECT symbol_id, line, col, parent_symbol_id, flags FROM symbolReference WHERE file_id = ?"
-  };
-
-  stmt.bind(1, (int)fid);
-
-  auto read_row = [fid](sql::Statement& q) -> SymbolReference {
-    SymbolReference r;
-    r.fileID = fid;
-    r.symbolID = SymbolID::fromRawID(q.columnInt64(0));
-    r.position = FilePosition(q.columnInt(1), q.columnInt(2));
-    r.referencedBySymbolID = SymbolID::fromRawID(q.columnInt(3));
-    r.flags = q.columnInt(4);
-    return r;
-  };
-
-  return sql::readRowsAsVector<SymbolReference>(stmt, read_row);
+  m_transaction = std::make_unique<sql::Transaction>(database());
 }
 
-void SnapshotWriter::removeAllSymbolReferencesInFile(FileID fid)
+void SnapshotWriter::endTransaction()
 {
-  sql::Statement stmt{ 
-    database(),
-    "DELETE FROM symbolReference WHERE file_id = ?"
-  };
-
-  stmt.bind(1, (int)fid);
+  // the blobs are written first so that a committed snapshot never 
+  // references a content that is missing from the store
+  writePendingBlobs();
 
-  stmt.step();
+  m_transaction->commit();
+  m_transaction.reset();
 }
 
-std::vector<Diagnostic> SnapshotWriter::loadDiagnosticsInFile(FileID fid)
+bool SnapshotWriter::inTransaction() const
 {
-  sql::Statement stmt{ 
-    database(),
-    "SELECT level, line, column, message FROM diagnostic WHERE fileID = ?"
-  };
-
-  stmt.bind(1, (int)fid);
-
-  auto read_row = [fid](sql::Statement& q) -> Diagnostic {
-    Diagnostic d;
-    d.fileID = fid;
-    d.level = static_cast<DiagnosticLevel>(q.columnInt(0));
-    d.position = FilePosition(q.columnInt(1), q.columnInt(2));
-    d.message = q.column(3);
-    return d;
-    };
-
-  return sql::readRowsAsVector<Diagnostic>(stmt, read_row);
+  return m_transaction != nullptr;
 }
 
-void SnapshotWriter::removeAllDiagnosticsInFile(FileID fid)
+/**
+ * \brief creates the secondary indexes of the database
+ * 
+ * These indexes speed up the lookups of symbols by name or parent and of 
+ * references and declarations by symbol, but slow down insertions: they 
+ * should be created once all the data has been written, right before the
+ * snapshot is closed.
+ * Snapshots with a schema version of at least 1 are expected to have them.
+ */
+void SnapshotWriter::createIndexes()
 {
-  sql::Statement stmt{ 
-    database(),
-    "DELETE FROM diagnostic WHERE fileID = ?"
-  };
+  if (m_transaction) {
+    endTransaction();
+  }
 
-  stmt.bind(1, (int)fid);
+  std::string error;
 
-  stmt.step();
+  if (!sql::exec(database(), snapshot::db_index_statements(), &error)) {
+    throw std::runtime_error("could not create indexes: " + error);
+  }
 }
 
-std::vector<SymbolDeclaration> SnapshotWriter::loadDeclarationsInFile(FileID fid)
+/**
+ * \brief returns whether the SQLite library supports the symbol search index
+ * 
+ * The index requires the FTS5 extension and its trigram tokenizer 
+ * (SQLite 3.34.0 or later).
+ */
+bool SnapshotWriter::isSymbolSearchIndexAvailable()
 {
-  sql::Statement stmt{ 
-    database(),
-    "SELECT symbol_id, startPosition, endPosition, isDefinition FROM symbolDeclaration WHERE file_id = ?"
-  };
-
-  stmt.bind(1, (int)fid);
-
-  auto read_row = [fid](sql::Statement& q) -> SymbolDeclaration {
-    SymbolDeclaration d;
-    d.fileID = fid;
-    d.symbolID = SymbolID::fromRawID(q.columnInt64(0));
-    d.startPosition = FilePosition::fromBits(q.columnInt(1));
-    d.endPosition = FilePosition::fromBits(q.columnInt(2));
-    d.isDefinition = q.columnInt(3) != 0;
-    return d;
-    };
-
-  return sql::readRowsAsVector<SymbolDeclaration>(stmt, read_row);
+  return sqlite3_libversion_number() >= 3034000 && sqlite3_compileoption_used("ENABLE_FTS5");
 }
 
-void SnapshotWriter::removeAllDeclarationsInFile(FileID fid)
+/**
+ * \brief creates the full-text index used by SnapshotReader::searchSymbols()
+ * 
+ * The index covers the names and fully qualified names of all the symbols
+ * and is rebuilt from scratch if it already exists: it should be created 
+ * once all the symbols have been written.
+ * It is optional because it noticeably increases the size of the snapshot.
+ * Throws std::runtime_error if the index cannot be created, e.g., because
+ * SQLite was built without FTS5; the snapshot is then left without the 
+ * index.
+ */
+void SnapshotWriter::createSymbolSearchIndex()
 {
-  sql::Statement stmt{ 
-    database(),
-    "DELETE FROM symbolDeclaration WHERE file_id = ?"
-  };
+  if (m_transaction) {
+    endTransaction();
+  }
 
-  stmt.bind(1, (int)fid);
+  std::string error;
 
-  stmt.step();
+  if (!sql::exec(database(), snapshot::db_symbol_search_statements(), &error)) 
+  {
+    // the rollback does not undo anything with journal_mode=OFF (Build and 
+    // Publish profiles), so the partially filled table is dropped explicitly.
+    sql::exec(database(), "ROLLBACK");
+    sql::exec(database(), "DROP TABLE IF EXISTS symbolSearch");
+    throw std::runtime_error("could not create symbol search index: " + error);
+  }
 }
 
-void SnapshotWriter::beginTransaction()
+/**
+ * \brief writes the blobs read by SnapshotReader::getFileAnnotations()
+ * 
+ * Each blob contains all the references, declarations, diagnostics and 
+ * include directives of a file, together with the symbols they refer to,
+ * so that a file can be rendered without any further query.
+ * Like the symbol search index, the blobs are optional and should be 
+ * created once everything else has been written.
+ * See createFileAnnotations(Database&) for the details.
+ */
+void SnapshotWriter::createFileAnnotations()
 {
-  if (m_transaction)
-  {
+  if (m_transaction) {
     endTransaction();
   }
 
-  m_transaction = std::make_unique<sql::Transaction>(database());
+  cppscanner::createFileAnnotations(database());
 }
 
-void SnapshotWriter::endTransaction()
+/**
+ * \brief writes the posting lists read by SnapshotReader::findReferences()
+ * 
+ * Each symbol gets a single row holding all its references, grouped by 
+ * file and delta-encoded, together with its number of references by role.
+ * Like the file annotations, the posting lists are optional and should be
+ * created once all the references have been written.
+ * See createReferencePostings(Database&) for the details.
+ */
+void SnapshotWriter::createReferencePostings()
 {
-  m_transaction->commit();
-  m_transaction.reset();
+  if (m_transaction) {
+    endTransaction();
+  }
+
+  cppscanner::createReferencePostings(database());
 }
 
 namespace snapshot
@@ -1096,6 +1414,16 @@ const char* db_init_statements()
   return SQL_CREATE_STATEMENTS;
 }
 
+const char* db_index_statements()
+{
+  return SQL_CREATE_INDEXES;
+}
+
+const char* db_symbol_search_statements()
+{
+  return SQL_CREATE_SYMBOL_SEARCH;
+}
+
 } // namespace snapshot
 
 } // namespace cppscanner
@@ -5,6 +5,8 @@
 #ifndef CPPSCANNER_SNAPSHOTWRITER_H
 #define CPPSCANNER_SNAPSHOTWRITER_H
 
+#include "compression.h"
+#include "databaseprofile.h"
 #include "snapshot.h"
 
 #include "cppscanner/database/database.h"
@@ -12,16 +14,19 @@
 #include <filesystem>
 #include <map>
 #include <memory>
+#include <utility>
 #include <vector>
 
 namespace sql
 {
+class StatementCache;
 class Transaction;
 }
 
 namespace cppscanner
 {
 
+class BlobStore;
 class IndexerSymbol;
 
 /**
@@ -38,16 +43,29 @@ public:
   SnapshotWriter(SnapshotWriter&&);
   ~SnapshotWriter();
 
-  explicit SnapshotWriter(const std::filesystem::path& p);
+  explicit SnapshotWriter(const std::filesystem::path& p, DatabaseProfile profile = DatabaseProfile::Default);
+
+  DatabaseProfile profile() const;
+  void setProfile(DatabaseProfile profile);
+
+  FileContentCodec fileContentCodec() const;
+  void setFileContentCodec(FileContentCodec codec);
+
+  BlobStore* blobStore() const;
+  void setBlobStore(const std::filesystem::path& p);
 
   bool open();
   bool open(const std::filesystem::path& p);
   bool isOpen() const;
+  void close();
+
+  static constexpr int PublishPageSize = 16384;
+  static void publish(const std::filesystem::path& p, int pageSize = PublishPageSize);
 
   const std::filesystem::path& filePath() const;
   Database& database() const;
 
-  static constexpr int DatabaseSchemaVersion = 0;
+  static constexpr int DatabaseSchemaVersion = 3;
 
   static std::string normalizedPath(std::string p);
 
@@ -63,7 +81,7 @@ public:
 
   void insertIncludes(const std::vector<Include>& includes);
   void insertSymbols(const std::vector<const IndexerSymbol*>& symbols);
-  void updateSymbolsFlags(const std::vector<const IndexerSymbol*>& symbols);
+  void updateSymbolsFlags(const std::vector<std::pair<SymbolID, int>>& symbolsFlags);
   void insertBaseOfs(const std::vector<BaseOf>& bofs);
   void insertOverrides(const std::vector<Override>& overrides);
   void insertDiagnostics(const std::vector<Diagnostic>& diagnostics);
@@ -79,31 +97,39 @@ public:
   void insert(const std::map<SymbolID, ParameterInfo>& infomap);
   void insert(const std::map<SymbolID, VariableInfo>& infomap);
 
-  std::vector<Include> loadAllIncludesInFile(FileID fid);
-  void removeAllIncludesInFile(FileID fid);
-
-  std::vector<SymbolReference> loadSymbolReferencesInFile(FileID fid);
-  void removeAllSymbolReferencesInFile(FileID fid);
+  void beginTransaction();
+  void endTransaction();
+  bool inTransaction() const;
 
-  std::vector<Diagnostic> loadDiagnosticsInFile(FileID fid);
-  void removeAllDiagnosticsInFile(FileID fid);
+  void createIndexes();
 
-  std::vector<SymbolDeclaration> loadDeclarationsInFile(FileID fid);
-  void removeAllDeclarationsInFile(FileID fid);
+  static bool isSymbolSearchIndexAvailable();
+  void createSymbolSearchIndex();
+  void createFileAnnotations();
+  void createReferencePostings();
 
-  void beginTransaction();
-  void endTransaction();
+private:
+  sql::StatementCache& statements() const;
+  void insertFilesInBlobStore(const std::vector<File>& files);
+  void writePendingBlobs();
 
 private:
   std::filesystem::path m_database_path;
+  DatabaseProfile m_profile = DatabaseProfile::Default;
+  FileContentCodec m_file_content_codec = FileContentCodec::None;
+  std::unique_ptr<BlobStore> m_blob_store;
+  std::vector<std::pair<std::string, std::string>> m_pending_blobs;
   std::unique_ptr<Database> m_database;
   std::unique_ptr<sql::Transaction> m_transaction;
+  std::unique_ptr<sql::StatementCache> m_statements;
 };
 
 namespace snapshot
 {
 
 const char* db_init_statements();
+const char* db_index_statements();
+const char* db_symbol_search_statements();
 
 } // namespace snapshot
 
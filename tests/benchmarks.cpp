@@ -0,0 +1,524 @@
+// Micro-benchmarks.
+// These tests are hidden by default, run them with: TEST_cppscanner "[benchmark]"
+
+#include "cppscanner/indexer/fileidentificator.h"
+#include "cppscanner/indexer/fileindexingarbiter.h"
+#include "cppscanner/indexer/indexersymboltable.h"
+#include "cppscanner/indexer/symbolreferencetable.h"
+#include "cppscanner/indexer/translationunitindexserialization.h"
+
+#include "cppscanner/snapshot/snapshotwriter.h"
+
+#include "cppscanner/database/sql.h"
+#include "cppscanner/database/transaction.h"
+
+#include "cppscanner/base/glob.h"
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <regex>
+#include <thread>
+#include <tuple>
+
+using namespace cppscanner;
+
+namespace
+{
+
+template<typename F>
+double measure(F&& fn)
+{
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void report(const std::string& name, double value, const char* unit = "ms")
+{
+  std::cout << "[benchmark] " << name << ": " << value << " " << unit << std::endl;
+}
+
+std::vector<std::string> generatePaths(size_t n)
+{
+  std::vector<std::string> result;
+  result.reserve(n);
+
+  for (size_t i(0); i < n; ++i) {
+    result.push_back("/home/user/project/src/module" + std::to_string(i % 100) + "/subdir" + std::to_string(i % 7) + "/file" + std::to_string(i) + ".cpp");
+  }
+
+  return result;
+}
+
+// what the thread-safe FileIdentificator used to be
+class MutexFileIdentificator
+{
+private:
+  std::map<std::string, FileID> m_files;
+  mutable std::mutex m_mutex;
+
+public:
+  MutexFileIdentificator()
+  {
+    m_files[""] = 0;
+  }
+
+  FileID getIdentification(const std::string& file)
+  {
+    std::lock_guard lock{ m_mutex };
+    auto it = m_files.find(file);
+    if (it != m_files.end()) {
+      return it->second;
+    }
+    auto result = FileID(m_files.size());
+    m_files[file] = result;
+    return result;
+  }
+
+  std::string getFile(FileID fid) const
+  {
+    std::lock_guard lock{ m_mutex };
+    std::vector<std::string> files;
+    files.resize(m_files.size());
+    for (const auto& p : m_files) {
+      files[p.second] = p.first;
+    }
+    return files.at(fid);
+  }
+};
+
+template<typename T>
+void runFileIdentificatorBenchmark(T& identificator, const std::vector<std::string>& paths, size_t nbThreads, size_t nbGetFile)
+{
+  std::vector<std::thread> threads;
+
+  for (size_t t(0); t < nbThreads; ++t)
+  {
+    threads.emplace_back([&identificator, &paths, nbGetFile, t]() {
+      size_t sum = 0;
+      for (size_t i(0); i < paths.size(); ++i)
+      {
+        const FileID fid = identificator.getIdentification(paths[(i + t * 31) % paths.size()]);
+        if (i < nbGetFile) {
+          sum += identificator.getFile(fid).size();
+        }
+      }
+      (void)sum;
+      });
+  }
+
+  for (std::thread& th : threads) {
+    th.join();
+  }
+}
+
+// what glob_match() used to be: the pattern is converted to a regex on each call
+std::string glob2regex(const std::string& pattern)
+{
+  std::string result;
+
+  for (char c : pattern)
+  {
+    switch (c)
+    {
+    case '*':
+      result += ".*";
+      break;
+    case '?':
+      result += ".";
+      break;
+    case '.':
+      result += "\\.";
+      break;
+    default:
+      result.push_back(c);
+      break;
+    }
+  }
+
+  return result;
+}
+
+bool regex_glob_match(const std::string& input, const std::string& pattern)
+{
+  std::regex regex{ glob2regex(pattern) };
+  return std::regex_search(input, regex);
+}
+
+// an arbiter that hides the thread-safety of another one,
+// so that createThreadSafeArbiter() adds a mutex around it
+class OpaqueArbiter : public FileIndexingArbiter
+{
+private:
+  std::unique_ptr<FileIndexingArbiter> m_arbiter;
+
+public:
+  explicit OpaqueArbiter(std::unique_ptr<FileIndexingArbiter> arbiter) :
+    FileIndexingArbiter(arbiter->fileIdentificator()),
+    m_arbiter(std::move(arbiter))
+  {
+
+  }
+
+  bool shouldIndex(FileID file, const TranslationUnitIndex* tu) final
+  {
+    return m_arbiter->shouldIndex(file, tu);
+  }
+};
+
+void runArbiterBenchmark(FileIndexingArbiter& arbiter, const std::vector<FileID>& files, size_t nbThreads)
+{
+  std::vector<std::thread> threads;
+
+  for (size_t t(0); t < nbThreads; ++t)
+  {
+    threads.emplace_back([&arbiter, &files, t]() {
+      auto* tu = reinterpret_cast<const TranslationUnitIndex*>(t + 1);
+      size_t n = 0;
+      // each translation unit includes the same files many times
+      for (int k(0); k < 10; ++k)
+      {
+        for (FileID f : files) {
+          n += arbiter.shouldIndex(f, tu);
+        }
+      }
+      (void)n;
+      });
+  }
+
+  for (std::thread& th : threads) {
+    th.join();
+  }
+}
+
+// what the TranslationUnitIndex used to do with its std::vector<SymbolReference>
+void sortAndRemoveDuplicatesAoS(std::vector<SymbolReference>& refs)
+{
+  auto missing = [](const SymbolReference& r) {
+    return r.referencedBySymbolID.isValid() ? 0 : 1;
+    };
+
+  std::sort(refs.begin(), refs.end(), [&missing](const SymbolReference& a, const SymbolReference& b) {
+    return std::forward_as_tuple(a.fileID, a.position, a.symbolID, missing(a)) <
+      std::forward_as_tuple(b.fileID, b.position, b.symbolID, missing(b));
+    });
+
+  auto it = std::unique(refs.begin(), refs.end(), [](const SymbolReference& a, const SymbolReference& b) {
+    return std::forward_as_tuple(a.fileID, a.position, a.symbolID) == std::forward_as_tuple(b.fileID, b.position, b.symbolID);
+    });
+
+  refs.erase(it, refs.end());
+}
+
+std::vector<SymbolReference> generateSymbolReferences(size_t n)
+{
+  std::mt19937 rng{ 42 };
+  std::vector<SymbolReference> result;
+  result.reserve(n);
+
+  for (size_t i(0); i < n; ++i)
+  {
+    SymbolReference r;
+    r.fileID = FileID(1 + rng() % 500);
+    r.position = FilePosition(1 + rng() % 5000, 1 + rng() % 80);
+    r.symbolID = SymbolID::fromRawID(1 + rng() % 100000);
+    r.referencedBySymbolID = SymbolID::fromRawID(rng() % 2 ? rng() % 1000 : 0);
+    r.flags = rng() % 256;
+    result.push_back(r);
+  }
+
+  return result;
+}
+
+// what SnapshotWriter::insert() used to do: one statement prepared per call
+// and one step per row
+void insertSymbolReferencesRowByRow(Database& db, const std::vector<SymbolReference>& refs)
+{
+  sql::Statement stmt{
+    db,
+    "INSERT OR IGNORE INTO symbolReference (symbol_id, file_id, position, parent_symbol_id, flags) VALUES (?,?,?,?,?)"
+  };
+
+  for (const SymbolReference& ref : refs)
+  {
+    stmt.bind(1, ref.symbolID.rawID());
+    stmt.bind(2, (int)ref.fileID);
+    stmt.bind(3, ref.position.bits());
+
+    if (ref.referencedBySymbolID.isValid())
+      stmt.bind(4, ref.referencedBySymbolID.rawID());
+    else 
+      stmt.bind(4, nullptr);
+
+    stmt.bind(5, ref.flags);
+
+    stmt.insert();
+  }
+}
+
+// splits the references in chunks, as if they came from many translation units
+std::vector<std::vector<SymbolReference>> splitIntoChunks(const std::vector<SymbolReference>& refs, size_t chunkSize)
+{
+  std::vector<std::vector<SymbolReference>> result;
+
+  for (size_t i(0); i < refs.size(); i += chunkSize) {
+    result.emplace_back(refs.begin() + i, refs.begin() + std::min(refs.size(), i + chunkSize));
+  }
+
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("SnapshotWriter insertions", "[.][benchmark]")
+{
+  const std::vector<std::vector<SymbolReference>> chunks = splitIntoChunks(generateSymbolReferences(2'000'000), 2000);
+  const std::filesystem::path db_path = "benchmark_snapshotwriter.db";
+
+  auto count_rows = [](Database& db) {
+    sql::Statement stmt{ db, "SELECT COUNT(*) FROM symbolReference" };
+    stmt.fetchNextRow();
+    return stmt.columnInt(0);
+    };
+
+  int expected = 0;
+
+  {
+    std::filesystem::remove(db_path);
+    SnapshotWriter writer{ db_path, DatabaseProfile::Build };
+    report("one statement per call, one row per step", measure([&]() {
+      sql::runTransacted(writer.database(), [&]() {
+        for (const auto& refs : chunks) {
+          insertSymbolReferencesRowByRow(writer.database(), refs);
+        }
+        });
+      }));
+    expected = count_rows(writer.database());
+  }
+
+  {
+    std::filesystem::remove(db_path);
+    SnapshotWriter writer{ db_path, DatabaseProfile::Build };
+    report("cached multi-row statements", measure([&]() {
+      sql::runTransacted(writer.database(), [&]() {
+        for (const auto& refs : chunks) {
+          writer.insert(refs);
+        }
+        });
+      }));
+    REQUIRE(count_rows(writer.database()) == expected);
+  }
+
+  std::filesystem::remove(db_path);
+}
+
+TEST_CASE("SymbolReference sort", "[.][benchmark]")
+{
+  const std::vector<SymbolReference> refs = generateSymbolReferences(4'000'000);
+
+  std::vector<SymbolReference> aos = refs;
+  report("std::vector<SymbolReference> memory", aos.capacity() * sizeof(SymbolReference) / 1e6, "MB");
+  report("std::vector<SymbolReference> sort", measure([&]() {
+    sortAndRemoveDuplicatesAoS(aos);
+    }));
+
+  SymbolReferenceTable table;
+  table.reserve(refs.size());
+  for (const SymbolReference& r : refs) {
+    table.push_back(r);
+  }
+  report("SymbolReferenceTable memory", table.memoryUsage() / 1e6, "MB");
+  report("SymbolReferenceTable radix sort", measure([&]() {
+    table.sortAndRemoveDuplicates();
+    }));
+
+  REQUIRE(table.toVector() == aos);
+}
+
+TEST_CASE("IndexerSymbolTable benchmark", "[.][benchmark]")
+{
+  constexpr size_t nb_symbols = 500'000;
+  constexpr size_t nb_lookups = 2'000'000;
+
+  std::mt19937_64 rng{ 42 };
+  std::vector<SymbolID> ids;
+  for (size_t i(0); i < nb_symbols; ++i) {
+    ids.push_back(SymbolID::fromRawID(rng()));
+  }
+
+  std::vector<SymbolID> lookups;
+  for (size_t i(0); i < nb_lookups; ++i) {
+    lookups.push_back(ids[rng() % ids.size()]);
+  }
+
+  size_t found_in_map = 0;
+  report("std::map<SymbolID, IndexerSymbol>", measure([&]() {
+    std::map<SymbolID, IndexerSymbol> map;
+    for (const SymbolID& id : ids) {
+      map[id].id = id;
+    }
+    for (const SymbolID& id : lookups) {
+      found_in_map += map.find(id) != map.end();
+    }
+    }));
+
+  size_t found_in_table = 0;
+  report("IndexerSymbolTable", measure([&]() {
+    IndexerSymbolTable table;
+    for (const SymbolID& id : ids) {
+      table[id];
+    }
+    for (const SymbolID& id : lookups) {
+      found_in_table += table.find(id) != nullptr;
+    }
+    }));
+
+  REQUIRE(found_in_map == nb_lookups);
+  REQUIRE(found_in_table == nb_lookups);
+}
+
+TEST_CASE("TranslationUnitIndex serialization benchmark", "[.][benchmark]")
+{
+  auto files = FileIdentificator::createFileIdentificator();
+  for (const std::string& path : generatePaths(500)) {
+    files->getIdentification(path);
+  }
+
+  TranslationUnitIndex index;
+  index.mainFileId = 1;
+
+  const char* types[] = { "int", "void", "const std::string&", "std::vector<int>", "bool" };
+
+  for (uint64_t i(1); i <= 100'000; ++i)
+  {
+    IndexerSymbol& symbol = index.symbols[SymbolID::fromRawID(i)];
+    symbol.kind = SymbolKind::Function;
+    symbol.name = index.strings.copy("function_" + std::to_string(i) + "()");
+    symbol.parentId = SymbolID::fromRawID(1 + i % 1000);
+    symbol.getExtraInfo<FunctionExtraInfo>().returnType = index.strings.copy(types[i % 5]);
+  }
+
+  for (const SymbolReference& ref : generateSymbolReferences(4'000'000)) {
+    index.add(ref);
+  }
+  index.symReferences.sortAndRemoveDuplicates();
+
+  std::string data;
+  const double serialize_ms = measure([&]() {
+    data = serializeTranslationUnitIndex(index, *files);
+    });
+
+  const double in_memory_size = index.symReferences.memoryUsage() + index.symbols.size() * sizeof(IndexerSymbol) + index.strings.memoryUsage();
+  report("TranslationUnitIndex in memory", in_memory_size / 1e6, "MB");
+  report("TranslationUnitIndex serialized", data.size() / 1e6, "MB");
+  report("TranslationUnitIndex serialization", serialize_ms);
+  report("TranslationUnitIndex serialization throughput", data.size() / 1e3 / serialize_ms, "MB/s");
+
+  auto other_files = FileIdentificator::createFileIdentificator();
+  TranslationUnitIndex copy;
+  const double deserialize_ms = measure([&]() {
+    copy = deserializeTranslationUnitIndex(data, *other_files);
+    });
+
+  report("TranslationUnitIndex deserialization", deserialize_ms);
+  report("TranslationUnitIndex deserialization throughput", data.size() / 1e3 / deserialize_ms, "MB/s");
+
+  REQUIRE(copy.symReferences.size() == index.symReferences.size());
+  REQUIRE(copy.symbols.size() == index.symbols.size());
+}
+
+TEST_CASE("Indexing arbiter with 16 threads", "[.][benchmark]")
+{
+  constexpr size_t nb_threads = 16;
+  const std::vector<std::string> paths = generatePaths(20000);
+
+  std::unique_ptr<FileIdentificator> identificator = FileIdentificator::createThreadSafeFileIdentificator();
+  std::vector<FileID> files;
+  for (const std::string& p : paths) {
+    files.push_back(identificator->getIdentification(p));
+  }
+
+  CreateIndexingArbiterOptions opts;
+  opts.homeDirectory = "/home/user/project";
+  opts.filters = { "/subdir3/" };
+
+  {
+    auto arbiter = FileIndexingArbiter::createThreadSafeArbiter(std::make_unique<OpaqueArbiter>(createIndexingArbiter(*identificator, opts)));
+    report("global mutex", measure([&]() {
+      runArbiterBenchmark(*arbiter, files, nb_threads);
+      }));
+  }
+
+  {
+    auto arbiter = FileIndexingArbiter::createThreadSafeArbiter(createIndexingArbiter(*identificator, opts));
+    report("lock-free claims", measure([&]() {
+      runArbiterBenchmark(*arbiter, files, nb_threads);
+      }));
+  }
+}
+
+TEST_CASE("GlobMatcher", "[.][benchmark]")
+{
+  const std::vector<std::string> paths = generatePaths(20000);
+  const std::vector<std::string> patterns = { "/module1/", "subdir3/", "file1?.cpp", "/module9?/*.h" };
+
+  size_t expected = 0;
+
+  report("std::regex per call", measure([&]() {
+    for (const std::string& p : paths) {
+      expected += std::any_of(patterns.begin(), patterns.end(), [&p](const std::string& e) {
+        return regex_glob_match(p, e);
+        });
+    }
+    }));
+
+  size_t count = 0;
+
+  report("compiled GlobMatcher", measure([&]() {
+    GlobMatcher matcher{ patterns };
+    for (const std::string& p : paths) {
+      count += matcher.match(p);
+    }
+    }));
+
+  REQUIRE(count == expected);
+}
+
+TEST_CASE("FileIdentificator with 64 threads", "[.][benchmark]")
+{
+  constexpr size_t nb_threads = 64;
+  const std::vector<std::string> paths = generatePaths(20000);
+
+  // note: the old implementation is so slow at getFile() that we only
+  // call it a few times per thread.
+  constexpr size_t nb_get_file = 20;
+
+  {
+    MutexFileIdentificator identificator;
+    report("mutex + std::map", measure([&]() {
+      runFileIdentificatorBenchmark(identificator, paths, nb_threads, nb_get_file);
+      }));
+  }
+
+  {
+    std::unique_ptr<FileIdentificator> identificator = FileIdentificator::createThreadSafeFileIdentificator();
+    report("sharded map + path trie", measure([&]() {
+      runFileIdentificatorBenchmark(*identificator, paths, nb_threads, nb_get_file);
+      }));
+  }
+
+  {
+    std::unique_ptr<FileIdentificator> identificator = FileIdentificator::createThreadSafeFileIdentificator();
+    report("sharded map + path trie (getFile() for all ids)", measure([&]() {
+      runFileIdentificatorBenchmark(*identificator, paths, nb_threads, paths.size());
+      }));
+  }
+}
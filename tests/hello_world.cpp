@@ -63,3 +63,98 @@ TEST_CASE("hello_world test project", "[scanner][hello_world]")
     REQUIRE(refs.size() == 1);
   }
 }
+
+TEST_CASE("hello_world with outline profile", "[scanner][hello_world]")
+{
+  const std::string snapshot_name = "hello_world_outline.db";
+
+  ScannerInvocation inv{
+    { "run",
+    "--compile-commands", HELLO_WORLD_BUILD_DIR + std::string("/compile_commands.json"),
+    "--home", HELLO_WORLD_ROOT_DIR,
+    "--profile", "outline",
+    "--overwrite",
+    "-o", snapshot_name }
+  };
+
+  REQUIRE_NOTHROW(inv.run());
+  CHECK(inv.errors().empty());
+
+  SnapshotReader s{ snapshot_name };
+
+  CHECK(s.readProperties()["scanner.indexingProfile"] == "outline");
+
+  std::vector<File> files = s.getFiles();
+  File srcfile = getFile(files, std::regex("main\\.cpp"));
+  File hdrfile = getFile(files, std::regex("hello\\.h"));
+
+  SymbolRecord sayHello = s.getSymbolByName("sayHello()");
+  SymbolRecord mainfn = s.getSymbolByName("main()");
+
+  // declarations are indexed
+  {
+    std::vector<SymbolReference> refs = s.findReferences(sayHello.id);
+    REQUIRE(refs.size() == 1);
+    CHECK(refs.front().fileID == hdrfile.id);
+    CHECK(refs.front().flags & SymbolReference::Definition);
+
+    refs = s.findReferences(mainfn.id);
+    REQUIRE(refs.size() == 1);
+    CHECK(refs.front().fileID == srcfile.id);
+  }
+
+  // but the content of the function bodies isn't
+  {
+    std::vector<SymbolRecord> symbols = s.getSymbolsByName("cout");
+    CHECK(symbols.empty());
+  }
+}
+
+TEST_CASE("hello_world with declarations profile", "[scanner][hello_world]")
+{
+  const std::string snapshot_name = "hello_world_declarations.db";
+
+  ScannerInvocation inv{
+    { "run",
+    "--compile-commands", HELLO_WORLD_BUILD_DIR + std::string("/compile_commands.json"),
+    "--home", HELLO_WORLD_ROOT_DIR,
+    "--profile", "declarations",
+    "--overwrite",
+    "-o", snapshot_name }
+  };
+
+  REQUIRE_NOTHROW(inv.run());
+  CHECK(inv.errors().empty());
+
+  SnapshotReader s{ snapshot_name };
+
+  CHECK(s.readProperties()["scanner.indexingProfile"] == "declarations");
+
+  std::vector<File> files = s.getFiles();
+  File hdrfile = getFile(files, std::regex("hello\\.h"));
+
+  // the reference at namespace scope is recorded
+  {
+    SymbolRecord greetingType = s.getSymbolByName("Greeting");
+    std::vector<SymbolReference> refs = s.findReferences(greetingType.id);
+    CHECK(containsRef(refs, SymbolRefPattern(greetingType).inFile(hdrfile).at(6)));
+    CHECK(containsRef(refs, SymbolRefPattern(greetingType).inFile(hdrfile).at(8)));
+  }
+
+  // but not the one in the body of sayHello()
+  {
+    SymbolRecord greeting = s.getSymbolByName("greeting");
+    std::vector<SymbolReference> refs = s.findReferences(greeting.id);
+    REQUIRE(refs.size() == 1);
+    CHECK(refs.front().position.line() == 8);
+    CHECK(refs.front().flags & SymbolReference::Definition);
+  }
+
+  // macro expansions are recorded
+  {
+    SymbolRecord macro = s.getSymbolByName("HELLO_WORLD");
+    std::vector<SymbolReference> refs = s.findReferences(macro.id);
+    CHECK(containsRef(refs, SymbolRefPattern(macro).inFile(hdrfile).at(4)));
+    CHECK(containsRef(refs, SymbolRefPattern(macro).inFile(hdrfile).at(8)));
+  }
+}
@@ -4,12 +4,34 @@
 
 #include "cppscanner/scannerInvocation/scannerinvocation.h"
 #include "cppscanner/index/symbol.h"
+#include "cppscanner/indexer/filecontentcapture.h"
+#include "cppscanner/indexer/fileidentificator.h"
 #include "cppscanner/indexer/fileindexingarbiter.h"
+#include "cppscanner/indexer/indexersymboltable.h"
+#include "cppscanner/indexer/symbolflagstable.h"
+#include "cppscanner/indexer/symbolreferencetable.h"
+#include "cppscanner/indexer/translationunitindexserialization.h"
+#include "cppscanner/snapshot/blobstore.h"
+#include "cppscanner/snapshot/columnarsnapshot.h"
+#include "cppscanner/snapshot/compression.h"
+#include "cppscanner/snapshot/fileannotations.h"
+#include "cppscanner/snapshot/referencepostings.h"
+#include "cppscanner/snapshot/snapshotreader.h"
+#include "cppscanner/snapshot/snapshotwriter.h"
+#include "cppscanner/database/sql.h"
+#include "cppscanner/base/arena.h"
 #include "cppscanner/base/glob.h"
+#include "cppscanner/base/pathtrie.h"
+#include "cppscanner/base/sortedspool.h"
 
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <thread>
+
 using namespace cppscanner;
 
 
@@ -46,6 +68,1468 @@ TEST_CASE("Matching files", "[glob]")
   REQUIRE(glob_match("a/b", "a/b"));
 #endif // WIN32
 
+  // '*' does not cross directory boundaries, '**' does
+  REQUIRE(!glob_match("~/src/a/b.cpp", "src/*.cpp"));
+  REQUIRE(glob_match("~/src/b.cpp", "src/*.cpp"));
+  REQUIRE(glob_match("~/src/a/b.cpp", "src/**.cpp"));
+  REQUIRE(glob_match("~/src/a/b.cpp", "src/**/*.cpp"));
+  REQUIRE(glob_match("~/src/b.cpp", "src/**/*.cpp"));
+  REQUIRE(!glob_match("~/include/b.cpp", "src/**/*.cpp"));
+
+  // character classes
+  REQUIRE(is_glob_pattern("[ab].cpp"));
+  REQUIRE(glob_match("~/a.cpp", "/[ab].cpp"));
+  REQUIRE(!glob_match("~/c.cpp", "/[ab].cpp"));
+  REQUIRE(glob_match("~/file3.h", "file[0-9].h"));
+  REQUIRE(!glob_match("~/fileX.h", "file[0-9].h"));
+  REQUIRE(glob_match("~/fileX.h", "file[!0-9].h"));
+  REQUIRE(!glob_match("~/file/.h", "file[!0-9].h"));
+
+  GlobMatcher matcher{ std::vector<std::string>{ "/test/", "*_test.cpp", "/third_party/**.h" } };
+  REQUIRE(!matcher.empty());
+  REQUIRE(matcher.match("/home/project/test/main.cpp"));
+  REQUIRE(matcher.match("/home/project/src/foo_test.cpp"));
+  REQUIRE(matcher.match("/home/project/third_party/lib/include/lib.h"));
+  REQUIRE(!matcher.match("/home/project/src/foo.cpp"));
+  REQUIRE(!matcher.match("/home/project/third_party/lib/src/lib.cpp"));
+  REQUIRE(!GlobMatcher().match("/home/project/src/foo.cpp"));
+
+  GlobMatcher large_matcher;
+  for (int i(0); i < 100; ++i) {
+    large_matcher.add("/module" + std::to_string(i) + "/**/*.h");
+  }
+  REQUIRE(large_matcher.match("/home/project/module42/a/b/c.h"));
+  REQUIRE(!large_matcher.match("/home/project/module42/a/b/c.cpp"));
+  REQUIRE(!large_matcher.match("/home/project/module100/c.h"));
+
+  FilePathMatcher pathmatcher{ std::vector<std::string>{ "main.cpp", "include/" } };
+  REQUIRE(pathmatcher.match("/home/project/src/main.cpp"));
+  REQUIRE(pathmatcher.match("/home/project/include/foo.h"));
+  REQUIRE(!pathmatcher.match("/home/project/src/foo.cpp"));
+}
+
+TEST_CASE("Arena", "[base]")
+{
+  Arena arena;
+  REQUIRE(arena.memoryUsage() == 0);
+
+  std::string_view empty = arena.copy("");
+  REQUIRE(empty.empty());
+  REQUIRE(empty.data() != nullptr);
+
+  std::string str = "hello";
+  std::string_view hello = arena.copy(str);
+  str = "world";
+  REQUIRE(hello == "hello");
+
+  const std::string large(100 * 1024, 'x');
+  std::string_view large_copy = arena.copy(large);
+  std::string_view after = arena.copy("after");
+
+  Arena moved = std::move(arena);
+  REQUIRE(hello == "hello");
+  REQUIRE(large_copy == large);
+  REQUIRE(after == "after");
+  REQUIRE(moved.memoryUsage() >= large.size());
+  REQUIRE(arena.memoryUsage() == 0);
+}
+
+TEST_CASE("PathTrie", "[base]")
+{
+  PathTrie trie;
+
+  REQUIRE(trie.insert("") == PathTrie::Root);
+  REQUIRE(trie.path(PathTrie::Root) == "");
+
+  const PathTrie::NodeID a = trie.insert("/home/project/src/a.cpp");
+  const PathTrie::NodeID b = trie.insert("/home/project/src/b.cpp");
+  const PathTrie::NodeID c = trie.insert("/home/project/include/c.h");
+  const PathTrie::NodeID rel = trie.insert("src/a.cpp");
+  REQUIRE(trie.insert("/home/project/src/a.cpp") == a);
+
+  // "", "home", "project", "src", "include", "a.cpp", "b.cpp", "c.h" and the relative "src", "a.cpp"
+  REQUIRE(trie.size() == 1 + 10);
+
+  REQUIRE(trie.path(a) == "/home/project/src/a.cpp");
+  REQUIRE(trie.path(c) == "/home/project/include/c.h");
+  REQUIRE(trie.path(rel) == "src/a.cpp");
+  REQUIRE(trie.name(b) == "b.cpp");
+  REQUIRE(trie.parent(a) == trie.parent(b));
+  REQUIRE(trie.path(trie.parent(a)) == "/home/project/src");
+
+  REQUIRE(trie.find("/home/project/src/b.cpp") == b);
+  REQUIRE(!trie.find("/home/project/src/d.cpp").has_value());
+  REQUIRE(trie.find("/home/project/src").has_value());
+
+  REQUIRE(trie.matches(a, "/home/project/src/a.cpp"));
+  REQUIRE(!trie.matches(a, "/home/project/src/b.cpp"));
+  REQUIRE(!trie.matches(a, "home/project/src/a.cpp"));
+  REQUIRE(!trie.matches(rel, "/src/a.cpp"));
+  REQUIRE(!trie.matches(a, "/home/project//src/a.cpp"));
+
+  REQUIRE(trie.isAncestor(*trie.find("/home/project"), c));
+  REQUIRE(!trie.isAncestor(*trie.find("/home/project/src"), c));
+  REQUIRE(!trie.isAncestor(a, a));
+
+  REQUIRE(trie.isUnder(a, "/home/project"));
+  REQUIRE(trie.isUnder(a, "/home"));
+  REQUIRE(!trie.isUnder(a, "/home/proj"));
+  REQUIRE(!trie.isUnder(a, "/home/project/src/a.cpp"));
+  REQUIRE(!trie.isUnder(a, "/usr"));
+  REQUIRE(!trie.isUnder(rel, "/home/project"));
+}
+
+TEST_CASE("SortedSpool", "[base]")
+{
+  const std::filesystem::path path = std::filesystem::temp_directory_path() / "cppscanner_test.spool";
+
+  std::vector<int> values;
+  for (int i(0); i < 10000; ++i) {
+    values.push_back((i * 7919) % 3001);
+  }
+
+  std::vector<int> expected = values;
+  std::sort(expected.begin(), expected.end());
+  expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+
+  auto read_all = [](SortedSpool<int>& spool) {
+    std::vector<int> result;
+    spool.consume([&result](const int* begin, const int* end) {
+      result.insert(result.end(), begin, end);
+      });
+    return result;
+    };
+
+  // everything fits in memory
+  {
+    SortedSpool<int> spool{ path };
+    spool.append(values.begin(), values.end());
+    REQUIRE(spool.size() == values.size());
+    REQUIRE(spool.runCount() == 0);
+    REQUIRE(read_all(spool) == expected);
+    REQUIRE(spool.empty());
+  }
+
+  // the buffer can only hold 100 values, so that runs are merged
+  {
+    SortedSpool<int> spool{ path, 100 * sizeof(int) };
+    spool.append(values.begin(), values.end());
+    REQUIRE(spool.runCount() > 1);
+    REQUIRE(std::filesystem::exists(path));
+    REQUIRE(read_all(spool) == expected);
+    REQUIRE(!std::filesystem::exists(path));
+  }
+}
+
+TEST_CASE("FileContentCapture", "[indexer]")
+{
+  const std::filesystem::path dir = std::filesystem::temp_directory_path();
+  const std::vector<std::string> contents{ "hello", "", "int main() { }\n" };
+
+  std::vector<File> files;
+  for (size_t i(0); i < contents.size(); ++i)
+  {
+    File f;
+    f.id = FileID(i + 1);
+    f.path = (dir / ("cppscanner_capture_" + std::to_string(i) + ".txt")).u8string();
+    std::ofstream(f.path, std::ios::binary) << contents.at(i);
+    files.push_back(f);
+  }
+
+  File missing;
+  missing.id = FileID(contents.size() + 1);
+  missing.path = (dir / "cppscanner_capture_missing.txt").u8string();
+  files.push_back(missing);
+
+  auto check = [&contents](const std::vector<File>& results) {
+    REQUIRE(results.size() == contents.size() + 1);
+
+    for (const File& f : results)
+    {
+      if (f.id > contents.size())
+      {
+        REQUIRE(f.content.empty());
+        REQUIRE(f.sha1.empty());
+        continue;
+      }
+
+      REQUIRE(f.content == contents.at(f.id - 1));
+
+      if (f.id == 1) {
+        REQUIRE(f.sha1 == "aaf4c61ddcc5e8a2dabede0f3b482cd9aea9434d");
+      } else if (f.content.empty()) {
+        REQUIRE(f.sha1.empty());
+      }
+    }
+  };
+
+  {
+    FileContentCapture capture{ 2 };
+
+    for (const File& f : files) {
+      capture.submit(f);
+    }
+
+    check(capture.waitAll());
+    REQUIRE(capture.takeFinished().empty());
+  }
+
+  {
+    std::vector<File> copy = files;
+    FileContentCapture::fill(copy, 3);
+    check(copy);
+  }
+
+  for (const File& f : files) {
+    std::filesystem::remove(f.path);
+  }
+}
+
+TEST_CASE("FileIdentificator", "[indexer]")
+{
+  std::unique_ptr<FileIdentificator> identificator = FileIdentificator::createFileIdentificator();
+
+  REQUIRE(identificator->getIdentification("") == invalidFileID());
+  const FileID a = identificator->getIdentification("/home/a.cpp");
+  const FileID b = identificator->getIdentification("/home/b.cpp");
+  REQUIRE(a == 1);
+  REQUIRE(b == 2);
+  REQUIRE(identificator->getIdentification("/home/a.cpp") == a);
+  REQUIRE(identificator->getFile(b) == "/home/b.cpp");
+  std::string path = "/a/longer/path/than/the/one/of/b.cpp";
+  identificator->getFilePath(b, path);
+  REQUIRE(path == "/home/b.cpp");
+  REQUIRE(identificator->getFiles() == std::vector<std::string>{ "", "/home/a.cpp", "/home/b.cpp" });
+  REQUIRE(identificator->isInDirectory(a, "/home"));
+  REQUIRE(!identificator->isInDirectory(a, "/usr"));
+
+  // a file may also be the parent directory of another one
+  const FileID dir = identificator->getIdentification("/home");
+  REQUIRE(dir == 3);
+  REQUIRE(identificator->getFile(dir) == "/home");
+  REQUIRE(identificator->getIdentification("/home/a.cpp") == a);
+}
+
+TEST_CASE("ThreadSafeFileIdentificator", "[indexer]")
+{
+  std::unique_ptr<FileIdentificator> identificator = FileIdentificator::createThreadSafeFileIdentificator();
+
+  constexpr size_t nb_threads = 64;
+  constexpr size_t nb_files = 5000;
+
+  // all threads identify the same set of files, in a different order
+  std::vector<std::vector<FileID>> ids{ nb_threads, std::vector<FileID>(nb_files) };
+  std::vector<std::thread> threads;
+  std::atomic<int> nb_errors = 0; // note: catch assertions are not thread-safe
+
+  for (size_t t(0); t < nb_threads; ++t)
+  {
+    threads.emplace_back([&identificator, &ids, &nb_errors, t]() {
+      for (size_t i(0); i < nb_files; ++i) 
+      {
+        const size_t n = (i * 7 + t * 13) % nb_files;
+        const FileID fid = identificator->getIdentification("/home/src/file" + std::to_string(n) + ".cpp");
+        ids[t][n] = fid;
+        if (identificator->getFile(fid) != "/home/src/file" + std::to_string(n) + ".cpp") {
+          ++nb_errors;
+        }
+        if (!identificator->isInDirectory(fid, "/home/src")) {
+          ++nb_errors;
+        }
+      }
+      });
+  }
+
+  for (std::thread& th : threads) {
+    th.join();
+  }
+
+  REQUIRE(nb_errors == 0);
+
+  for (size_t t(1); t < nb_threads; ++t) {
+    REQUIRE(ids[t] == ids[0]);
+  }
+
+  std::vector<std::string> files = identificator->getFiles();
+  REQUIRE(files.size() == nb_files + 1);
+  REQUIRE(files.front().empty());
+
+  for (size_t n(0); n < nb_files; ++n) {
+    REQUIRE(files.at(ids[0][n]) == "/home/src/file" + std::to_string(n) + ".cpp");
+  }
+}
+
+TEST_CASE("Indexing arbiter", "[indexer]")
+{
+  std::unique_ptr<FileIdentificator> identificator = FileIdentificator::createFileIdentificator();
+
+  CreateIndexingArbiterOptions opts;
+  opts.homeDirectory = "/home/project";
+  opts.filters = { "*.h" };
+  std::unique_ptr<FileIndexingArbiter> arbiter = createIndexingArbiter(*identificator, opts);
+
+  const FileID header = identificator->getIdentification("/home/project/header.h");
+  const FileID source = identificator->getIdentification("/home/project/source.cpp");
+  const FileID external = identificator->getIdentification("/usr/include/vector.h");
+
+  auto* tu1 = reinterpret_cast<const TranslationUnitIndex*>(1);
+  auto* tu2 = reinterpret_cast<const TranslationUnitIndex*>(2);
+
+  REQUIRE(!arbiter->shouldIndex(invalidFileID(), tu1));
+
+  // decisions are cached, results must be stable
+  for (int i(0); i < 2; ++i)
+  {
+    REQUIRE(arbiter->shouldIndex(header, tu1));
+    REQUIRE(!arbiter->shouldIndex(header, tu2));
+    REQUIRE(!arbiter->shouldIndex(source, tu1));
+    REQUIRE(!arbiter->shouldIndex(source, tu2));
+    REQUIRE(!arbiter->shouldIndex(external, tu1));
+    REQUIRE(!arbiter->shouldIndex(external, tu2));
+  }
+}
+
+TEST_CASE("Indexing arbiter with multiple threads", "[indexer]")
+{
+  std::unique_ptr<FileIdentificator> identificator = FileIdentificator::createThreadSafeFileIdentificator();
+
+  constexpr size_t nb_files = 5000;
+  std::vector<FileID> files;
+  for (size_t i(0); i < nb_files; ++i) {
+    files.push_back(identificator->getIdentification("/home/project/file" + std::to_string(i) + ".h"));
+  }
+
+  CreateIndexingArbiterOptions opts;
+  opts.homeDirectory = "/home/project";
+  std::unique_ptr<FileIndexingArbiter> arbiter = createIndexingArbiter(*identificator, opts);
+  REQUIRE(arbiter->isThreadSafe());
+
+  // no lock is added around an arbiter that is already thread-safe
+  FileIndexingArbiter* ptr = arbiter.get();
+  arbiter = FileIndexingArbiter::createThreadSafeArbiter(std::move(arbiter));
+  REQUIRE(arbiter.get() == ptr);
+
+  constexpr size_t nb_threads = 16;
+  std::vector<std::atomic<int>> nb_owners(nb_files);
+  std::vector<std::thread> threads;
+
+  for (size_t t(0); t < nb_threads; ++t)
+  {
+    threads.emplace_back([&, t]() {
+      auto* tu = reinterpret_cast<const TranslationUnitIndex*>(t + 1);
+      for (size_t i(0); i < nb_files; ++i)
+      {
+        if (arbiter->shouldIndex(files[i], tu)) {
+          ++nb_owners[i];
+        }
+      }
+      });
+  }
+
+  for (std::thread& th : threads) {
+    th.join();
+  }
+
+  // each file is indexed in exactly one translation unit
+  REQUIRE(std::all_of(nb_owners.begin(), nb_owners.end(), [](const std::atomic<int>& n) {
+    return n.load() == 1;
+    }));
+}
+
+TEST_CASE("SymbolReferenceTable", "[indexer]")
+{
+  auto ref = [](FileID file, int line, int col, uint64_t symbol, uint64_t referencedBy, int flags) {
+    SymbolReference r;
+    r.fileID = file;
+    r.position = FilePosition(line, col);
+    r.symbolID = SymbolID::fromRawID(symbol);
+    r.referencedBySymbolID = SymbolID::fromRawID(referencedBy);
+    r.flags = flags;
+    return r;
+    };
+
+  SymbolReferenceTable table;
+  table.push_back(ref(2, 1, 1, 10, 0, SymbolReference::Read));
+  table.push_back(ref(1, 5, 3, 11, 0, SymbolReference::Declaration));
+  table.push_back(ref(1, 5, 1, 12, 0, SymbolReference::Implicit));
+  table.push_back(ref(300, 1, 1, 13, 0, 0));
+  table.push_back(ref(1, 5, 3, 11, 7, SymbolReference::Declaration | SymbolReference::Definition)); // duplicate, with a referencing symbol
+  table.push_back(ref(1, 5, 3, 9, 0, SymbolReference::Call));
+  table.push_back(ref(2, 1, 1, 10, 0, SymbolReference::Read)); // exact duplicate
+
+  REQUIRE(table.at(1) == ref(1, 5, 3, 11, 0, SymbolReference::Declaration));
+
+  table.sortAndRemoveDuplicates();
+
+  const std::vector<SymbolReference> expected = {
+    ref(1, 5, 1, 12, 0, SymbolReference::Implicit),
+    ref(1, 5, 3, 9, 0, SymbolReference::Call),
+    ref(1, 5, 3, 11, 7, SymbolReference::Declaration | SymbolReference::Definition),
+    ref(2, 1, 1, 10, 0, SymbolReference::Read),
+    ref(300, 1, 1, 13, 0, 0),
+  };
+
+  REQUIRE(table.toVector() == expected);
+
+  REQUIRE(table.findFileEnd(0) == 3);
+  REQUIRE(table.findFileEnd(3) == 4);
+  REQUIRE(table.findFileEnd(4) == 5);
+  REQUIRE(table.fileID(4) == 300);
+  REQUIRE(table.position(1) == FilePosition(5, 3));
+}
+
+TEST_CASE("IndexerSymbolTable", "[indexer]")
+{
+  Arena strings;
+  IndexerSymbolTable table;
+  REQUIRE(table.empty());
+  REQUIRE(table.find(SymbolID::fromRawID(1)) == nullptr);
+
+  auto [first, inserted] = table.insert(SymbolID::fromRawID(1));
+  REQUIRE(inserted);
+  REQUIRE(first->id == SymbolID::fromRawID(1));
+  first->name = "first";
+
+  // pointers stay valid when the table grows
+  for (uint64_t i(2); i <= 1000; ++i) {
+    table[SymbolID::fromRawID(i * 0x100000000ull)].name = strings.copy(std::to_string(i));
+  }
+
+  REQUIRE(table.size() == 1000);
+  REQUIRE(table.find(SymbolID::fromRawID(1)) == first);
+  REQUIRE(first->name == "first");
+  REQUIRE(table.insert(SymbolID::fromRawID(1)) == std::make_pair(first, false));
+  REQUIRE(table.at(0).name == "first");
+  REQUIRE(table.at(999).name == "1000");
+  REQUIRE(table.find(SymbolID::fromRawID(500 * 0x100000000ull))->name == "500");
+  REQUIRE(table.find(SymbolID::fromRawID(2)) == nullptr);
+
+  IndexerSymbolTable moved = std::move(table);
+  REQUIRE(moved.find(SymbolID::fromRawID(1)) == first);
+}
+
+TEST_CASE("SymbolFlagsTable", "[indexer]")
+{
+  SymbolFlagsTable table;
+  REQUIRE(table.empty());
+  REQUIRE(table.find(SymbolID::fromRawID(1)) == nullptr);
+
+  constexpr uint64_t n = 10000;
+
+  for (uint64_t i(1); i <= n; ++i)
+  {
+    auto [flags, inserted] = table.insert(SymbolID::fromRawID(i << 20), int(i % 7));
+    REQUIRE(inserted);
+    REQUIRE(*flags == int(i % 7));
+  }
+
+  REQUIRE(table.size() == n);
+  REQUIRE(table.memoryUsage() <= 4 * n * 12);
+
+  auto [flags, inserted] = table.insert(SymbolID::fromRawID(42 << 20), 0);
+  REQUIRE(!inserted);
+  REQUIRE(*flags == 0);
+  *flags |= 8;
+  REQUIRE(*table.find(SymbolID::fromRawID(42 << 20)) == 8);
+
+  for (uint64_t i(1); i <= n; ++i) {
+    REQUIRE(table.find(SymbolID::fromRawID(i << 20)) != nullptr);
+  }
+
+  REQUIRE(table.find(SymbolID::fromRawID(n + 1)) == nullptr);
+  REQUIRE(table.find(SymbolID()) == nullptr);
+
+  table.clear();
+  REQUIRE(table.empty());
+  REQUIRE(table.find(SymbolID::fromRawID(1 << 20)) == nullptr);
+}
+
+TEST_CASE("IndexerSymbol", "[indexer]")
+{
+  Arena tu_strings;
+  IndexerSymbol symbol;
+  symbol.name = tu_strings.copy("foo");
+  REQUIRE(symbol.extraInfo.kind() == SymbolExtraInfo::None);
+  REQUIRE(symbol.extraInfo.getIf<FunctionExtraInfo>() == nullptr);
+
+  symbol.getExtraInfo<FunctionExtraInfo>().returnType = tu_strings.copy("int");
+  REQUIRE(symbol.extraInfo.kind() == SymbolExtraInfo::Function);
+  REQUIRE(symbol.extraInfo.getIf<FunctionExtraInfo>()->returnType == "int");
+  REQUIRE(symbol.extraInfo.getIf<VariableExtraInfo>() == nullptr);
+  REQUIRE_THROWS_AS(symbol.getExtraInfo<VariableExtraInfo>(), std::logic_error);
+  REQUIRE(symbol.extraInfo.kind() == SymbolExtraInfo::Function);
+
+  Arena strings;
+  IndexerSymbol copy = symbol;
+  copyStrings(copy, strings);
+  tu_strings.clear();
+
+  REQUIRE(copy.name == "foo");
+  REQUIRE(copy.getExtraInfo<FunctionExtraInfo>().returnType == "int");
+  REQUIRE(copy.getExtraInfo<FunctionExtraInfo>().declaration.empty());
+
+  int nb_visited = 0;
+  copy.extraInfo.visit([&nb_visited](const auto&) {
+    ++nb_visited;
+    });
+  REQUIRE(nb_visited == 1);
+}
+
+TEST_CASE("TranslationUnitIndex serialization", "[indexer]")
+{
+  auto source_files = FileIdentificator::createFileIdentificator();
+  const FileID main_cpp = source_files->getIdentification("/project/main.cpp");
+  const FileID foo_h = source_files->getIdentification("/project/foo.h");
+  const FileID vector_h = source_files->getIdentification("/usr/include/vector");
+
+  const SymbolID foo = SymbolID::fromRawID(0x1234567890ABCDEFull);
+  const SymbolID main_fn = SymbolID::fromRawID(42);
+  const SymbolID param = SymbolID::fromRawID(43);
+  const SymbolID external = SymbolID::fromRawID(0xFFFFFFFFFFFFFFFFull);
+
+  TranslationUnitIndex index;
+  index.mainFileId = main_cpp;
+  index.indexedFiles = { main_cpp, foo_h };
+  index.ppIncludes.push_back(Include{ main_cpp, foo_h, 1 });
+  index.ppIncludes.push_back(Include{ main_cpp, vector_h, 2 });
+
+  {
+    IndexerSymbol& s = index.symbols[foo];
+    s.kind = SymbolKind::Class;
+    s.name = index.strings.copy("Foo");
+    s.flags = SymbolFlag::FromProject;
+  }
+
+  {
+    IndexerSymbol& s = index.symbols[main_fn];
+    s.kind = SymbolKind::Function;
+    s.name = index.strings.copy("main()");
+    s.getExtraInfo<FunctionExtraInfo>().returnType = index.strings.copy("int");
+    s.getExtraInfo<FunctionExtraInfo>().declaration = index.strings.copy("int main()");
+  }
+
+  {
+    IndexerSymbol& s = index.symbols[param];
+    s.kind = SymbolKind::Parameter;
+    s.name = index.strings.copy("n");
+    s.parentId = main_fn;
+    s.setLocal();
+    auto& info = s.getExtraInfo<ParameterExtraInfo>();
+    info.parameterIndex = 0;
+    info.type = index.strings.copy("int");
+    info.defaultValue = index.strings.copy("-1");
+  }
+
+  auto ref = [](FileID file, int line, int col, SymbolID symbol, SymbolID referencedBy, int flags) {
+    SymbolReference r;
+    r.fileID = file;
+    r.position = FilePosition(line, col);
+    r.symbolID = symbol;
+    r.referencedBySymbolID = referencedBy;
+    r.flags = flags;
+    return r;
+    };
+
+  index.add(ref(foo_h, 3, 7, foo, SymbolID(), SymbolReference::Definition));
+  index.add(ref(main_cpp, 5, 5, main_fn, SymbolID(), SymbolReference::Definition));
+  index.add(ref(main_cpp, 5, 14, param, main_fn, SymbolReference::Definition));
+  index.add(ref(main_cpp, 6, 3, foo, main_fn, SymbolReference::Read));
+  index.add(ref(main_cpp, 7, 3, external, main_fn, SymbolReference::Call));
+  index.symReferences.sortAndRemoveDuplicates();
+
+  index.add(BaseOf{ external, foo, AccessSpecifier::Public });
+  index.add(Override{ external, main_fn });
+
+  Diagnostic warning;
+  warning.level = DiagnosticLevel::Warning;
+  warning.message = "unused parameter 'n'";
+  warning.fileID = main_cpp;
+  warning.position = FilePosition(5, 14);
+  index.add(warning);
+
+  index.add(ArgumentPassedByReference{ main_cpp, FilePosition(7, 10) });
+  index.add(SymbolDeclaration{ foo, foo_h, FilePosition(3, 1), FilePosition(3, 12), true });
+
+  const std::string data = serializeTranslationUnitIndex(index, *source_files);
+
+  // file ids are remapped by the target identificator
+  auto target_files = FileIdentificator::createFileIdentificator();
+  target_files->getIdentification("/other/file.cpp");
+
+  TranslationUnitIndex copy = deserializeTranslationUnitIndex(data, *target_files);
+
+  auto path = [&target_files](FileID fid) {
+    return target_files->getFile(fid);
+    };
+
+  REQUIRE(path(copy.mainFileId) == "/project/main.cpp");
+  REQUIRE(copy.indexedFiles.size() == 2);
+  REQUIRE(path(copy.indexedFiles.at(1)) == "/project/foo.h");
+  REQUIRE(copy.ppIncludes.size() == 2);
+  REQUIRE(path(copy.ppIncludes.at(1).includedFileID) == "/usr/include/vector");
+  REQUIRE(copy.ppIncludes.at(1).line == 2);
+
+  REQUIRE(copy.symbols.size() == 3);
+  REQUIRE(copy.symbols.at(0).id == foo);
+  REQUIRE(copy.symbols.at(0).name == "Foo");
+  REQUIRE(copy.symbols.at(0).flags == SymbolFlag::FromProject);
+  REQUIRE(copy.symbols.at(0).extraInfo.kind() == SymbolExtraInfo::None);
+  REQUIRE(copy.getSymbolById(main_fn)->getExtraInfo<FunctionExtraInfo>().declaration == "int main()");
+  const IndexerSymbol* n = copy.getSymbolById(param);
+  REQUIRE(n->kind == SymbolKind::Parameter);
+  REQUIRE(n->parentId == main_fn);
+  REQUIRE(n->testFlag(SymbolFlag::Local));
+  REQUIRE(n->extraInfo.getIf<ParameterExtraInfo>()->type == "int");
+  REQUIRE(n->extraInfo.getIf<ParameterExtraInfo>()->defaultValue == "-1");
+
+  REQUIRE(copy.symReferences.size() == index.symReferences.size());
+  for (size_t i(0); i < index.symReferences.size(); ++i)
+  {
+    SymbolReference expected = index.symReferences.at(i);
+    SymbolReference actual = copy.symReferences.at(i);
+    REQUIRE(path(actual.fileID) == source_files->getFile(expected.fileID));
+    actual.fileID = expected.fileID;
+    REQUIRE(actual == expected);
+  }
+
+  REQUIRE(copy.relations.baseOfs.size() == 1);
+  REQUIRE(copy.relations.baseOfs.front().baseClassID == external);
+  REQUIRE(copy.relations.baseOfs.front().accessSpecifier == AccessSpecifier::Public);
+  REQUIRE(copy.relations.overrides.front().overrideMethodID == main_fn);
+
+  REQUIRE(copy.diagnostics.size() == 1);
+  REQUIRE(copy.diagnostics.front().level == DiagnosticLevel::Warning);
+  REQUIRE(copy.diagnostics.front().message == warning.message);
+  REQUIRE(copy.diagnostics.front().position == warning.position);
+
+  REQUIRE(copy.fileAnnotations.refargs.size() == 1);
+  REQUIRE(copy.fileAnnotations.refargs.front().position == FilePosition(7, 10));
+  REQUIRE(copy.declarations.size() == 1);
+  REQUIRE(path(copy.declarations.front().fileID) == "/project/foo.h");
+  REQUIRE(copy.declarations.front().endPosition == FilePosition(3, 12));
+  REQUIRE(copy.declarations.front().isDefinition);
+
+  // serializing the copy gives the same data
+  REQUIRE(serializeTranslationUnitIndex(copy, *target_files) == data);
+
+  // the lists sorted by file are sorted again if the target identificator
+  // orders the files differently
+  {
+    auto reversed_files = FileIdentificator::createFileIdentificator();
+    reversed_files->getIdentification("/project/foo.h");
+    reversed_files->getIdentification("/project/main.cpp");
+
+    TranslationUnitIndex reversed = deserializeTranslationUnitIndex(data, *reversed_files);
+
+    REQUIRE(std::is_sorted(reversed.indexedFiles.begin(), reversed.indexedFiles.end()));
+    REQUIRE(reversed_files->getFile(reversed.indexedFiles.front()) == "/project/foo.h");
+    REQUIRE(reversed.symReferences.size() == index.symReferences.size());
+    REQUIRE(reversed_files->getFile(reversed.symReferences.at(0).fileID) == "/project/foo.h");
+
+    for (size_t i(1); i < reversed.symReferences.size(); ++i)
+    {
+      const SymbolReference& prev = reversed.symReferences.at(i - 1);
+      const SymbolReference& cur = reversed.symReferences.at(i);
+      REQUIRE(std::make_pair(prev.fileID, prev.position) <= std::make_pair(cur.fileID, cur.position));
+    }
+  }
+
+  // invalid data
+  REQUIRE_THROWS_AS(deserializeTranslationUnitIndex("", *target_files), std::runtime_error);
+
+  // a symbol id appearing twice in the symbol table
+  {
+    const std::string id_43("\x2B\0\0\0\0\0\0\0", 8);
+    const std::string id_42("\x2A\0\0\0\0\0\0\0", 8);
+    std::string duplicate = data;
+    const size_t offset = duplicate.find(id_43);
+    REQUIRE(offset != std::string::npos);
+    REQUIRE(duplicate.find(id_43, offset + 1) == std::string::npos);
+    duplicate.replace(offset, id_43.size(), id_42);
+    REQUIRE_THROWS_AS(deserializeTranslationUnitIndex(duplicate, *target_files), std::runtime_error);
+  }
+  REQUIRE_THROWS_AS(deserializeTranslationUnitIndex("not an index", *target_files), std::runtime_error);
+
+  for (size_t size : { size_t(5), data.size() / 2, data.size() - 1 }) {
+    REQUIRE_THROWS_AS(deserializeTranslationUnitIndex(std::string_view(data).substr(0, size), *target_files), std::runtime_error);
+  }
+}
+
+TEST_CASE("Database profiles", "[snapshot]")
+{
+  REQUIRE(parseDatabaseProfile("build") == DatabaseProfile::Build);
+  REQUIRE(parseDatabaseProfile("publish") == DatabaseProfile::Publish);
+  REQUIRE_FALSE(parseDatabaseProfile("fast").has_value());
+
+  const std::filesystem::path db_path = "test_database_profiles.db";
+  std::filesystem::remove(db_path);
+
+  std::vector<SymbolReference> refs;
+
+  for (int i(1); i <= 100; ++i)
+  {
+    SymbolReference ref;
+    ref.fileID = 1;
+    ref.symbolID = SymbolID::fromRawID(i);
+    ref.position = FilePosition(i, 1);
+    refs.push_back(ref);
+  }
+
+  {
+    SnapshotWriter writer{ db_path, DatabaseProfile::Build };
+
+    File file;
+    file.id = 1;
+    file.path = "/home/test.cpp";
+    writer.insertFilePaths({ file });
+
+    writer.beginTransaction();
+    writer.insert(refs);
+    writer.endTransaction();
+
+    writer.createIndexes();
+  }
+
+  SnapshotWriter::publish(db_path, 8192);
+
+  REQUIRE_FALSE(std::filesystem::exists(db_path.u8string() + ".publish"));
+
+  {
+    SnapshotReader reader{ db_path };
+    REQUIRE(reader.getSymbolReferences().size() == refs.size());
+    REQUIRE(reader.getFiles().size() == 1);
+    REQUIRE(reader.schemaVersion() == SnapshotWriter::DatabaseSchemaVersion);
+    reader.close();
+    REQUIRE(reader.reopen());
+    REQUIRE(reader.schemaVersion() == SnapshotWriter::DatabaseSchemaVersion);
+    REQUIRE(reader.findReferences(SymbolID::fromRawID(42)).size() == 1);
+
+    {
+      sql::Statement stmt{ reader.database(), "EXPLAIN QUERY PLAN SELECT file_id FROM symbolReference WHERE symbol_id = 42" };
+      REQUIRE(stmt.fetchNextRow());
+      REQUIRE(stmt.column(3).find("symbolReference_symbol_id") != std::string::npos);
+    }
+
+    sql::Statement stmt{ reader.database(), "PRAGMA page_size" };
+    REQUIRE(stmt.fetchNextRow());
+    REQUIRE(stmt.columnInt(0) == 8192);
+  }
+
+  std::filesystem::remove(db_path);
+}
+
+TEST_CASE("Symbol reference layout", "[snapshot]")
+{
+  const std::filesystem::path db_path = "test_symbol_reference_layout.db";
+  std::filesystem::remove(db_path);
+
+  SymbolReference ref;
+  ref.fileID = 1;
+  ref.symbolID = SymbolID::fromRawID(42);
+  ref.position = FilePosition(17, 5);
+  ref.referencedBySymbolID = SymbolID::fromRawID(7);
+  ref.flags = SymbolReference::Call;
+
+  {
+    SnapshotWriter writer{ db_path };
+    writer.insert(std::vector<SymbolReference>{ ref });
+  }
+
+  {
+    SnapshotReader reader{ db_path };
+
+    std::vector<SymbolReference> refs = reader.findReferences(ref.symbolID);
+    REQUIRE(refs.size() == 1);
+    REQUIRE(refs.front().position == ref.position);
+    REQUIRE(refs.front().referencedBySymbolID == ref.referencedBySymbolID);
+
+    // line and column are computed from the packed position
+    sql::Statement stmt{ reader.database(), "SELECT line, col FROM symbolReference WHERE symbol_id = 42" };
+    REQUIRE(stmt.fetchNextRow());
+    REQUIRE(stmt.columnInt(0) == 17);
+    REQUIRE(stmt.columnInt(1) == 5);
+  }
+
+  std::filesystem::remove(db_path);
+
+  // snapshots with a schema version lower than 2 store line and column
+  // in separate columns.
+  {
+    Database db;
+    db.create(db_path);
+
+    std::string error;
+    bool ok = sql::exec(db, R"(
+      CREATE TABLE "info" ("key" TEXT NOT NULL UNIQUE, "value" TEXT NOT NULL);
+      INSERT INTO info (key, value) VALUES ('database.schema.version', '1');
+      CREATE TABLE "symbolReference" (
+        "symbol_id"         INTEGER NOT NULL,
+        "file_id"           INTEGER NOT NULL,
+        "line"              INTEGER NOT NULL,
+        "col"               INTEGER NOT NULL,
+        "parent_symbol_id"  INTEGER,
+        "flags"             INTEGER NOT NULL DEFAULT 0,
+        UNIQUE(file_id, line, col, symbol_id)
+      );
+      INSERT INTO symbolReference (symbol_id, file_id, line, col, parent_symbol_id, flags) VALUES (42, 1, 17, 5, 7, 16);
+      INSERT INTO symbolReference (symbol_id, file_id, line, col, parent_symbol_id, flags) VALUES (43, 1, 18, 2, NULL, 0);
+    )", &error);
+    REQUIRE(ok);
+
+    SnapshotReader reader{ std::move(db) };
+    REQUIRE(reader.schemaVersion() == 1);
+    REQUIRE(reader.getSymbolReferences().size() == 2);
+
+    std::vector<SymbolReference> refs = reader.findReferences(ref.symbolID);
+    REQUIRE(refs.size() == 1);
+    REQUIRE(refs.front().fileID == ref.fileID);
+    REQUIRE(refs.front().position == ref.position);
+    REQUIRE(refs.front().referencedBySymbolID == ref.referencedBySymbolID);
+    REQUIRE(refs.front().flags == ref.flags);
+  }
+
+  std::filesystem::remove(db_path);
+}
+
+TEST_CASE("File content compression", "[snapshot]")
+{
+  REQUIRE(parseFileContentCodec("zstd") == FileContentCodec::Zstd);
+  REQUIRE(isCodecAvailable(FileContentCodec::None));
+
+  const std::filesystem::path db_path = "test_file_content_compression.db";
+  std::filesystem::remove(db_path);
+
+  // without compression, the snapshot does not depend on zstd_decompress()
+  {
+    SnapshotWriter writer{ db_path };
+    sql::Statement stmt{ writer.database(), "SELECT name FROM sqlite_master WHERE name = 'fileContent'" };
+    REQUIRE_FALSE(stmt.fetchNextRow());
+  }
+
+  std::filesystem::remove(db_path);
+
+  if (!isCodecAvailable(FileContentCodec::Zstd))
+  {
+    REQUIRE_THROWS_AS(compress(FileContentCodec::Zstd, "int main() { }"), std::runtime_error);
+    return;
+  }
+
+  std::string text;
+  for (int i(0); i < 1000; ++i) {
+    text += "int f" + std::to_string(i) + "(int n) { return n + " + std::to_string(i) + "; }\n";
+  }
+
+  const std::string data = compress(FileContentCodec::Zstd, text);
+  REQUIRE(data.size() < text.size() / 4);
+  REQUIRE(decompress(FileContentCodec::Zstd, data) == text);
+  REQUIRE_THROWS_AS(decompress(FileContentCodec::Zstd, "not a zstd frame"), std::runtime_error);
+
+  {
+    SnapshotWriter writer{ db_path };
+    writer.setFileContentCodec(FileContentCodec::Zstd);
+
+    std::vector<File> files(2);
+    files[0].id = 1;
+    files[0].path = "/home/test.cpp";
+    files[0].content = text;
+    files[1].id = 2;
+    files[1].path = "/home/empty.h";
+    writer.insertFiles(files);
+  }
+
+  {
+    SnapshotReader reader{ db_path };
+    REQUIRE(reader.fileContentCodec() == FileContentCodec::Zstd);
+    REQUIRE(reader.getFileContent(1) == text);
+    REQUIRE(reader.getFileContent(2).empty());
+
+    std::vector<File> files = reader.getFiles(true);
+    REQUIRE(files.size() == 2);
+    REQUIRE(files.at(0).content == text);
+
+    sql::Statement stmt{ reader.database(), "SELECT content FROM fileContent WHERE id = 1" };
+    REQUIRE(stmt.fetchNextRow());
+    REQUIRE(stmt.column(0) == text);
+  }
+
+  std::filesystem::remove(db_path);
+}
+
+TEST_CASE("Blob store", "[snapshot]")
+{
+  const std::filesystem::path store_path = "test_blob_store.db";
+  const std::filesystem::path db_paths[] = { "test_blob_store_1.db", "test_blob_store_2.db" };
+  std::filesystem::remove(store_path);
+  for (const auto& p : db_paths) {
+    std::filesystem::remove(p);
+  }
+
+  const std::string shared_text = "int shared() { return 0; }\n";
+
+  for (int i(0); i < 2; ++i)
+  {
+    SnapshotWriter writer{ db_paths[i] };
+    writer.setBlobStore(store_path);
+    REQUIRE(writer.blobStore() != nullptr);
+
+    if (i == 1 && isCodecAvailable(FileContentCodec::Zstd)) {
+      writer.setFileContentCodec(FileContentCodec::Zstd);
+    }
+
+    std::vector<File> files(2);
+    files[0].id = 1;
+    files[0].path = "/home/shared.h";
+    files[0].content = shared_text;
+    files[0].sha1 = "e3b9c2f1";
+    files[1].id = 2;
+    files[1].path = "/home/main.cpp";
+    files[1].content = "int main() { return " + std::to_string(i) + "; }\n";
+    files[1].sha1 = "a1f0" + std::to_string(i);
+
+    if (i == 1) 
+    {
+      // inside a transaction, the blobs are written when it ends
+      writer.beginTransaction();
+      writer.insertFiles(files);
+      writer.insertFiles({});
+      REQUIRE_FALSE(BlobStore(store_path).contains(files[1].sha1));
+      writer.endTransaction();
+    }
+    else
+    {
+      writer.insertFiles(files);
+    }
+
+    REQUIRE(BlobStore(store_path).contains(files[1].sha1));
+
+    sql::Statement stmt{ writer.database(), "SELECT count(*) FROM file WHERE content IS NULL AND sha1 IS NOT NULL" };
+    REQUIRE(stmt.fetchNextRow());
+    REQUIRE(stmt.columnInt(0) == 2);
+  }
+
+  {
+    BlobStore store{ store_path };
+    REQUIRE(store.contains("e3b9c2f1"));
+    REQUIRE_FALSE(store.contains("0000"));
+    REQUIRE_FALSE(store.insert("e3b9c2f1", shared_text));
+    REQUIRE(store.get("e3b9c2f1").value_or("") == shared_text);
+
+    sql::Statement stmt{ store.database(), "SELECT count(*) FROM blob" };
+    REQUIRE(stmt.fetchNextRow());
+    REQUIRE(stmt.columnInt(0) == 3);
+
+    // a transaction that is not committed is rolled back
+    {
+      BlobStoreTransaction transaction{ store };
+      REQUIRE(store.insert("0000", "int rolled_back;\n"));
+    }
+    REQUIRE_FALSE(store.contains("0000"));
+
+    // failures to begin or commit a transaction are reported
+    REQUIRE_THROWS_AS(store.endTransaction(), std::runtime_error);
+    store.beginTransaction();
+    REQUIRE_THROWS_AS(store.beginTransaction(), std::runtime_error);
+    store.endTransaction();
+  }
+
+  for (int i(0); i < 2; ++i)
+  {
+    SnapshotReader reader{ db_paths[i] };
+    REQUIRE(reader.blobStore() != nullptr);
+    REQUIRE(reader.getFileContent(1) == shared_text);
+    REQUIRE(reader.getFileContent(2) == "int main() { return " + std::to_string(i) + "; }\n");
+
+    std::vector<File> files = reader.getFiles(true);
+    REQUIRE(files.size() == 2);
+    REQUIRE(files.at(0).content == shared_text);
+  }
+
+  std::filesystem::remove(store_path);
+  for (const auto& p : db_paths) {
+    std::filesystem::remove(p);
+  }
+}
+
+TEST_CASE("Columnar snapshot", "[snapshot]")
+{
+  const std::filesystem::path db_path = "test_columnar_snapshot.db";
+  const std::filesystem::path col_path = "test_columnar_snapshot.cppscol";
+  const std::filesystem::path copy_path = "test_columnar_snapshot_copy.db";
+  std::filesystem::remove(db_path);
+  std::filesystem::remove(col_path);
+  std::filesystem::remove(copy_path);
+
+  const SymbolID base_class = SymbolID::fromRawID(10);
+  const SymbolID derived_class = SymbolID::fromRawID(11);
+  const SymbolID base_method = SymbolID::fromRawID(20);
+  const SymbolID derived_method = SymbolID::fromRawID(21);
+  const SymbolID parameter = SymbolID::fromRawID(30);
+
+  {
+    SnapshotWriter writer{ db_path };
+    writer.beginTransaction();
+
+    writer.setProperty("project.name", "columnar");
+
+    std::vector<File> files(2);
+    files[0].id = 1;
+    files[0].path = "/home/base.h";
+    files[0].content = "struct Base { virtual void f(int n = 0); };\n";
+    files[0].sha1 = "b45e";
+    files[1].id = 2;
+    files[1].path = "/home/main.cpp";
+    files[1].content = "#include \"base.h\"\nstruct Derived : Base { void f(int n) override; };\n";
+    writer.insertFilePaths(files);
+    writer.insertFiles(files);
+
+    Include inc;
+    inc.fileID = 2;
+    inc.line = 1;
+    inc.includedFileID = 1;
+    writer.insertIncludes({ inc });
+
+    std::vector<IndexerSymbol> symbols(5);
+    symbols[0].id = base_class;
+    symbols[0].kind = SymbolKind::Struct;
+    symbols[0].name = "Base";
+    symbols[1].id = derived_class;
+    symbols[1].kind = SymbolKind::Struct;
+    symbols[1].name = "Derived";
+    symbols[2].id = base_method;
+    symbols[2].kind = SymbolKind::Method;
+    symbols[2].name = "f";
+    symbols[2].parentId = base_class;
+    symbols[2].flags = FunctionInfo::Virtual;
+    symbols[3].id = derived_method;
+    symbols[3].kind = SymbolKind::Method;
+    symbols[3].name = "f";
+    symbols[3].parentId = derived_class;
+    symbols[3].flags = FunctionInfo::Virtual | FunctionInfo::Override;
+    symbols[4].id = parameter;
+    symbols[4].kind = SymbolKind::Parameter;
+    symbols[4].name = "n";
+    symbols[4].parentId = base_method;
+
+    std::vector<const IndexerSymbol*> pointers;
+    for (const IndexerSymbol& s : symbols) {
+      pointers.push_back(&s);
+    }
+    writer.insertSymbols(pointers);
+
+    std::map<SymbolID, FunctionInfo> functions;
+    functions[base_method].returnType = "void";
+    functions[derived_method].returnType = "void";
+    writer.insert(functions);
+
+    std::map<SymbolID, ParameterInfo> parameters;
+    parameters[parameter].parameterIndex = 0;
+    parameters[parameter].type = "int";
+    parameters[parameter].defaultValue = "0";
+    writer.insert(parameters);
+
+    std::vector<SymbolReference> refs;
+    for (const auto& [symbol, file, line] : { std::make_tuple(base_class, 1, 1), std::make_tuple(base_method, 1, 1),
+      std::make_tuple(derived_class, 2, 2), std::make_tuple(base_class, 2, 2), std::make_tuple(derived_method, 2, 2) })
+    {
+      SymbolReference ref;
+      ref.symbolID = symbol;
+      ref.fileID = file;
+      ref.position = FilePosition(line, static_cast<int>(refs.size()) + 1);
+      ref.flags = SymbolReference::Declaration;
+      refs.push_back(ref);
+    }
+    writer.insert(refs);
+
+    SymbolDeclaration decl;
+    decl.symbolID = derived_class;
+    decl.fileID = 2;
+    decl.startPosition = FilePosition(2, 1);
+    decl.endPosition = FilePosition(2, 50);
+    decl.isDefinition = true;
+    writer.insert(std::vector<SymbolDeclaration>{ decl });
+
+    BaseOf bof;
+    bof.baseClassID = base_class;
+    bof.derivedClassID = derived_class;
+    bof.accessSpecifier = AccessSpecifier::Public;
+    writer.insertBaseOfs({ bof });
+
+    Override ov;
+    ov.baseMethodID = base_method;
+    ov.overrideMethodID = derived_method;
+    writer.insertOverrides({ ov });
+
+    Diagnostic d;
+    d.level = DiagnosticLevel::Warning;
+    d.fileID = 2;
+    d.position = FilePosition(2, 30);
+    d.message = "unused parameter 'n'";
+    writer.insertDiagnostics({ d });
+
+    writer.endTransaction();
+  }
+
+  convertToColumnarSnapshot(db_path, col_path);
+  REQUIRE(ColumnarSnapshotReader::isColumnarSnapshot(col_path));
+  REQUIRE_FALSE(ColumnarSnapshotReader::isColumnarSnapshot(db_path));
+
+  {
+    ColumnarSnapshotReader reader{ col_path };
+    REQUIRE(reader.readProperties().at("project.name") == "columnar");
+    REQUIRE(reader.files().size() == 2);
+    REQUIRE(reader.getFilePath(2) == "/home/main.cpp");
+    REQUIRE(reader.getFileContent(1) == "struct Base { virtual void f(int n = 0); };\n");
+    REQUIRE(reader.getIncludes().size() == 1);
+
+    const columnar::SymbolRow* method = reader.findSymbol(derived_method);
+    REQUIRE(method != nullptr);
+    REQUIRE(reader.string(method->name) == "f");
+    REQUIRE(method->parentID == derived_class.rawID());
+    REQUIRE(reader.findSymbol(SymbolID::fromRawID(99)) == nullptr);
+    REQUIRE(reader.getSymbolInfos<ParameterInfo>().at(parameter).defaultValue == "0");
+
+    REQUIRE(reader.referencesInFile(1).size() == 2);
+    REQUIRE(reader.referencesInFile(2).size() == 3);
+    REQUIRE(reader.referencesInFile(3).empty());
+    REQUIRE(reader.findReferences(base_class).size() == 2);
+    REQUIRE(reader.findReferences(base_class).front().fileID == 1);
+    REQUIRE(reader.getSymbolDeclarations(derived_class).size() == 1);
+    REQUIRE(reader.getBasesOf(derived_class).size() == 1);
+    REQUIRE(reader.getOverridesOf(base_method).front().overrideMethodID == derived_method);
+    REQUIRE(reader.getDiagnostics().front().message == "unused parameter 'n'");
+  }
+
+  // the reader rejects anything that is not a complete columnar snapshot
+  {
+    std::ofstream file{ copy_path, std::ios::binary };
+    file << "CPPSCOL\n";
+  }
+  REQUIRE_FALSE(ColumnarSnapshotReader().open(copy_path));
+  REQUIRE_FALSE(ColumnarSnapshotReader().open(db_path));
+  std::filesystem::remove(copy_path);
+
+  convertToSQLiteSnapshot(col_path, copy_path);
+
+  {
+    SnapshotReader original{ db_path };
+    SnapshotReader copy{ copy_path };
+
+    REQUIRE(copy.readProperties().at("project.name") == "columnar");
+    REQUIRE(copy.getFiles(true).size() == 2);
+    REQUIRE(copy.getFileContent(2) == original.getFileContent(2));
+    REQUIRE(copy.getFiles().at(0).sha1 == "b45e");
+    REQUIRE(copy.getIncludes().size() == 1);
+    REQUIRE(copy.getSymbolById(derived_method).flags == original.getSymbolById(derived_method).flags);
+    REQUIRE(copy.getSymbolById(derived_method).parentId == derived_class);
+    REQUIRE_FALSE(copy.getSymbolById(base_class).parentId.isValid());
+    REQUIRE(copy.getFunctionParameters(base_method).size() == 1);
+    REQUIRE(copy.getFunctionParameters(base_method).front().defaultValue == "0");
+    REQUIRE(copy.getSymbolReferences().size() == original.getSymbolReferences().size());
+    REQUIRE(copy.findReferences(base_class).size() == 2);
+    REQUIRE(copy.getSymbolDeclarations().size() == 1);
+    REQUIRE(copy.getBasesOf(derived_class).size() == 1);
+    REQUIRE(copy.getOverridesOf(base_method).size() == 1);
+    REQUIRE(copy.getDiagnostics().size() == 1);
+  }
+
+  // converting the copy gives the same columnar snapshot
+  {
+    const std::filesystem::path col_copy_path = "test_columnar_snapshot_copy.cppscol";
+    convertToColumnarSnapshot(copy_path, col_copy_path);
+
+    MappedFile a{ col_path };
+    MappedFile b{ col_copy_path };
+    REQUIRE(a.bytes() == b.bytes());
+
+    std::filesystem::remove(col_copy_path);
+  }
+
+  std::filesystem::remove(db_path);
+  std::filesystem::remove(col_path);
+  std::filesystem::remove(copy_path);
+}
+
+TEST_CASE("Symbol search", "[snapshot]")
+{
+  const std::filesystem::path db_path = "test_symbol_search.db";
+  std::filesystem::remove(db_path);
+
+  auto names = [](const std::vector<SymbolRecord>& symbols) {
+    std::vector<std::string> result;
+    for (const SymbolRecord& s : symbols) {
+      result.push_back(s.name);
+    }
+    return result;
+    };
+
+  SnapshotWriter writer{ db_path };
+
+  {
+    std::vector<IndexerSymbol> symbols(8);
+    const std::pair<const char*, int> defs[] = {
+      { "std", 0 }, { "vector", 1 }, { "push_back", 2 }, { "mylib", 0 },
+      { "vec_push", 4 }, { "VectorBase", 4 }, { "math", 0 }, { "inverse", 7 },
+    };
+
+    for (size_t i(0); i < symbols.size(); ++i)
+    {
+      symbols[i].id = SymbolID::fromRawID(i + 1);
+      symbols[i].name = defs[i].first;
+      symbols[i].parentId = SymbolID::fromRawID(defs[i].second);
+      symbols[i].kind = SymbolKind::Function;
+    }
+
+    std::vector<const IndexerSymbol*> pointers;
+    for (const IndexerSymbol& s : symbols) {
+      pointers.push_back(&s);
+    }
+
+    writer.beginTransaction();
+    writer.insertSymbols(pointers);
+    writer.endTransaction();
+    writer.createIndexes();
+  }
+
+  {
+    // without the index, the symbol table is scanned
+    SnapshotReader reader{ db_path };
+    REQUIRE_FALSE(reader.hasSymbolSearchIndex());
+    REQUIRE(names(reader.searchSymbols("vec")) == std::vector<std::string>{ "vector", "vec_push", "VectorBase" });
+    REQUIRE(names(reader.searchSymbols("VECTOR", SymbolSearchMode::Prefix)) == std::vector<std::string>{ "vector", "VectorBase" });
+    REQUIRE(reader.searchSymbols("").empty());
+  }
+
+  if (!SnapshotWriter::isSymbolSearchIndexAvailable())
+  {
+    REQUIRE_THROWS_AS(writer.createSymbolSearchIndex(), std::runtime_error);
+    writer.close();
+    std::filesystem::remove(db_path);
+    return;
+  }
+
+  writer.createSymbolSearchIndex();
+  writer.close();
+
+  {
+    SnapshotReader reader{ db_path };
+    REQUIRE(reader.hasSymbolSearchIndex());
+
+    // qualified names are indexed too
+    REQUIRE(names(reader.searchSymbols("vector")) == std::vector<std::string>{ "vector", "VectorBase", "push_back" });
+    REQUIRE(names(reader.searchSymbols("vector", SymbolSearchMode::Substring, 1)) == std::vector<std::string>{ "vector" });
+    REQUIRE(names(reader.searchSymbols("std::vec", SymbolSearchMode::Prefix)) == std::vector<std::string>{ "vector", "push_back" });
+    REQUIRE(names(reader.searchSymbols("vec", SymbolSearchMode::Prefix)) == std::vector<std::string>{ "vector", "vec_push", "VectorBase" });
+    REQUIRE(reader.searchSymbols("math::inv", SymbolSearchMode::Prefix).front().id == SymbolID::fromRawID(8));
+    REQUIRE(reader.searchSymbols("\"vec", SymbolSearchMode::Substring).empty());
+
+    const std::vector<SymbolRecord> fuzzy = reader.searchSymbols("vectr", SymbolSearchMode::Fuzzy);
+    REQUIRE(fuzzy.size() >= 3);
+    REQUIRE(fuzzy.front().name == "vector");
+    REQUIRE(fuzzy.front().parentId == SymbolID::fromRawID(1));
+  }
+
+  std::filesystem::remove(db_path);
+
+  // a failure does not leave a partial index behind, even without a journal
+  {
+    SnapshotWriter failing_writer{ db_path, DatabaseProfile::Build };
+    REQUIRE(sql::exec(failing_writer.database(), "DROP TABLE symbol"));
+    REQUIRE_THROWS_AS(failing_writer.createSymbolSearchIndex(), std::runtime_error);
+
+    sql::Statement stmt{ failing_writer.database(), "SELECT name FROM sqlite_master WHERE name = 'symbolSearch'" };
+    REQUIRE_FALSE(stmt.fetchNextRow());
+  }
+
+  std::filesystem::remove(db_path);
+}
+
+TEST_CASE("File annotations", "[snapshot]")
+{
+  const std::filesystem::path db_path = "test_file_annotations.db";
+  std::filesystem::remove(db_path);
+
+  const SymbolID ns = SymbolID::fromRawID(1);
+  const SymbolID f = SymbolID::fromRawID(2);
+  const SymbolID x = SymbolID::fromRawID(0xFFFFFFFF00000003); // negative once stored by SQLite
+
+  {
+    SnapshotWriter writer{ db_path };
+    writer.beginTransaction();
+
+    writer.insertFiles({ File{ 1, "a.cpp", "", "" }, File{ 2, "a.h", "", "" }, File{ 3, "empty.txt", "", "" } });
+
+    std::vector<IndexerSymbol> symbols(3);
+    const std::tuple<SymbolID, const char*, SymbolKind> defs[] = {
+      { ns, "ns", SymbolKind::Namespace }, { f, "f", SymbolKind::Function }, { x, "x", SymbolKind::Variable },
+    };
+
+    for (size_t i(0); i < symbols.size(); ++i)
+    {
+      symbols[i].id = std::get<0>(defs[i]);
+      symbols[i].name = std::get<1>(defs[i]);
+      symbols[i].kind = std::get<2>(defs[i]);
+    }
+
+    writer.insertSymbols({ &symbols[0], &symbols[1], &symbols[2] });
+
+    writer.insert(std::vector<SymbolReference>{
+      { f, 1, FilePosition(3, 6), SymbolID(), SymbolReference::Definition },
+      { x, 1, FilePosition(4, 10), f, SymbolReference::Read },
+      { ns, 1, FilePosition(2, 11), SymbolID(), 0 },
+      { x, 1, FilePosition(4, 3), f, SymbolReference::Write },
+      { f, 2, FilePosition(1, 6), SymbolID(), SymbolReference::Declaration },
+    });
+
+    writer.insert(std::vector<SymbolDeclaration>{
+      { f, 1, FilePosition(3, 1), FilePosition(6, 2), true },
+      { x, 1, FilePosition(4, 3), FilePosition(4, 8), false },
+    });
+
+    Diagnostic diagnostic;
+    diagnostic.level = DiagnosticLevel::Warning;
+    diagnostic.message = "unused";
+    diagnostic.fileID = 1;
+    diagnostic.position = FilePosition(5, 7);
+    writer.insertDiagnostics({ diagnostic });
+
+    writer.insert(std::vector<ArgumentPassedByReference>{ { 1, FilePosition(4, 10) } });
+
+    Include inc;
+    inc.fileID = 1;
+    inc.includedFileID = 2;
+    inc.line = 1;
+    writer.insertIncludes({ inc });
+
+    writer.endTransaction();
+    writer.createIndexes();
+    writer.createFileAnnotations();
+    writer.close();
+  }
+
+  SnapshotReader reader{ db_path };
+  REQUIRE(reader.hasFileAnnotations());
+  REQUIRE_FALSE(reader.getFileAnnotations(3).has_value());
+  REQUIRE(reader.getFileAnnotations(2).has_value());
+
+  const std::optional<std::string> blob = reader.getFileAnnotations(1);
+  REQUIRE(blob.has_value());
+
+  const FileAnnotationData data = decodeFileAnnotations(*blob, 1);
+
+  REQUIRE(data.symbols.size() == 3);
+  REQUIRE(std::find_if(data.symbols.begin(), data.symbols.end(), [x](const SymbolRecord& s) { return s.id == x; })->name == "x");
+
+  REQUIRE(data.references.size() == 4);
+  REQUIRE(data.references.at(0).symbolID == ns);
+  REQUIRE(data.references.at(0).position == FilePosition(2, 11));
+  REQUIRE(data.references.at(1).symbolID == f);
+  REQUIRE(data.references.at(1).flags == SymbolReference::Definition);
+  REQUIRE(data.references.at(2).position == FilePosition(4, 3));
+  REQUIRE(data.references.at(2).referencedBySymbolID == f);
+  REQUIRE(data.references.at(3).position == FilePosition(4, 10));
+  REQUIRE(data.references.at(3).fileID == 1);
+
+  REQUIRE(data.declarations.size() == 2);
+  REQUIRE(data.declarations.at(0) == SymbolDeclaration{ f, 1, FilePosition(3, 1), FilePosition(6, 2), true });
+  REQUIRE(data.declarations.at(1) == SymbolDeclaration{ x, 1, FilePosition(4, 3), FilePosition(4, 8), false });
+
+  REQUIRE(data.diagnostics.size() == 1);
+  REQUIRE(data.diagnostics.front().level == DiagnosticLevel::Warning);
+  REQUIRE(data.diagnostics.front().position == FilePosition(5, 7));
+  REQUIRE(data.diagnostics.front().message == "unused");
+
+  REQUIRE(data.refargs == std::vector<ArgumentPassedByReference>{ { 1, FilePosition(4, 10) } });
+
+  REQUIRE(data.includes.size() == 1);
+  REQUIRE(data.includes.front().line == 1);
+  REQUIRE(data.includes.front().includedFileID == 2);
+  REQUIRE(data.includedFiles.size() == 1);
+  REQUIRE(data.includedFiles.front().path == "a.h");
+
+  // the encoding is deterministic and rejects malformed blobs
+  REQUIRE(encodeFileAnnotations(data) == *blob);
+  REQUIRE_THROWS_AS(decodeFileAnnotations(blob->substr(0, blob->size() - 1)), std::runtime_error);
+  REQUIRE_THROWS_AS(decodeFileAnnotations("CSFA\x7f"), std::runtime_error);
+
+  reader.close();
+  std::filesystem::remove(db_path);
+}
+
+TEST_CASE("Reference postings", "[snapshot]")
+{
+  const std::filesystem::path db_path = "test_reference_postings.db";
+  std::filesystem::remove(db_path);
+
+  const SymbolID f = SymbolID::fromRawID(1);
+  const SymbolID g = SymbolID::fromRawID(2);
+  const SymbolID x = SymbolID::fromRawID(0xFFFFFFFF00000003); // negative once stored by SQLite
+  const SymbolID unused = SymbolID::fromRawID(4);
+
+  std::vector<SymbolReference> xrefs;
+
+  for (FileID fid : { 7, 2, 300 })
+  {
+    for (int line : { 1, 1000, 3 })
+    {
+      xrefs.push_back({ x, fid, FilePosition(line, 12), f, SymbolReference::Read });
+      xrefs.push_back({ x, fid, FilePosition(line, 4), g, SymbolReference::Write | SymbolReference::Read });
+    }
+  }
+
+  xrefs.push_back({ x, 2, FilePosition(1, 1), SymbolID(), SymbolReference::Definition });
+
+  auto sorted = [](std::vector<SymbolReference> refs) {
+    std::sort(refs.begin(), refs.end(), [](const SymbolReference& a, const SymbolReference& b) {
+      return std::make_pair(a.fileID, a.position) < std::make_pair(b.fileID, b.position);
+    });
+    return refs;
+  };
+
+  auto same_refs = [](const std::vector<SymbolReference>& a, const std::vector<SymbolReference>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const SymbolReference& lhs, const SymbolReference& rhs) {
+      return lhs.symbolID == rhs.symbolID && lhs.fileID == rhs.fileID && lhs.position == rhs.position
+        && lhs.referencedBySymbolID == rhs.referencedBySymbolID && lhs.flags == rhs.flags;
+    });
+  };
+
+  SnapshotWriter writer{ db_path };
+  writer.beginTransaction();
+  writer.insert(xrefs);
+  writer.insert(std::vector<SymbolReference>{ { f, 2, FilePosition(5, 1), SymbolID(), SymbolReference::Call } });
+  writer.endTransaction();
+  writer.createIndexes();
+
+  SymbolReferenceCounts expected;
+  expected.references = 19;
+  expected.reads = 18;
+  expected.writes = 9;
+  expected.definitions = 1;
+
+  {
+    SnapshotReader reader{ db_path };
+    REQUIRE_FALSE(reader.hasReferencePostings());
+    REQUIRE(same_refs(reader.findReferences(x), sorted(xrefs)));
+    REQUIRE(reader.getReferenceCounts(x) == expected);
+  }
+
+  writer.createReferencePostings();
+  writer.close();
+
+  SnapshotReader reader{ db_path };
+  REQUIRE(reader.hasReferencePostings());
+  REQUIRE(same_refs(reader.findReferences(x), sorted(xrefs)));
+  REQUIRE(reader.getReferenceCounts(x) == expected);
+  REQUIRE(reader.findReferences(f).size() == 1);
+  REQUIRE(reader.getReferenceCounts(f).calls == 1);
+  REQUIRE(reader.findReferences(unused).empty());
+  REQUIRE(reader.getReferenceCounts(unused) == SymbolReferenceCounts());
+
+  const std::string postings = encodeReferencePostings(xrefs);
+  REQUIRE(same_refs(decodeReferencePostings(postings, x), sorted(xrefs)));
+  REQUIRE_THROWS_AS(decodeReferencePostings(postings.substr(0, postings.size() - 1), x), std::runtime_error);
+
+  reader.close();
+  std::filesystem::remove(db_path);
 }
 
 TEST_CASE("jobs", "[scannerInvocation]")
@@ -66,4 +1550,38 @@ TEST_CASE("jobs", "[scannerInvocation]")
   REQUIRE(opts.output == "output.db");
   REQUIRE(opts.inputs.size() == 1);
   REQUIRE(opts.inputs.at(0) == "test.cpp");
+  REQUIRE_FALSE(opts.db_profile.has_value());
+
+  args.push_back("--db-profile");
+  args.push_back("publish");
+  REQUIRE(inv.parseCommandLine(args));
+  opts = std::get<ScannerInvocation::RunOptions>(inv.options().command);
+  REQUIRE(opts.db_profile.value_or("") == "publish");
+}
+
+TEST_CASE("Command line consistency", "[scannerInvocation]")
+{
+  {
+    ScannerInvocation inv;
+    REQUIRE_FALSE(inv.parseCommandLine({ "convert", "-o", "out.db" }));
+    REQUIRE_FALSE(inv.errors().empty());
+  }
+
+  {
+    ScannerInvocation inv;
+    REQUIRE(inv.parseCommandLine({ "convert", "-h" }));
+    REQUIRE(inv.options().helpFlag);
+  }
+
+  {
+    ScannerInvocation inv;
+    REQUIRE(inv.parseCommandLine({ "convert", "in.db", "-o", "out.db" }));
+  }
+
+  {
+    ScannerInvocation inv;
+    REQUIRE_FALSE(inv.parseCommandLine({ "run", "-i", "test.cpp", "--db-profile", "publsh" }));
+    REQUIRE_FALSE(inv.parseCommandLine({ "run", "-i", "test.cpp", "--profile", "outlin" }));
+    REQUIRE_FALSE(inv.parseCommandLine({ "merge", "a.db", "b.db", "--db-profile", "biuld" }));
+  }
 }
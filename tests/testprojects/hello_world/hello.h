@@ -1,7 +1,13 @@
 
 #include <iostream>
 
+#define HELLO_WORLD "Hello World!"
+
+using Greeting = const char*;
+
+const Greeting greeting = HELLO_WORLD;
+
 inline void sayHello()
 {
-  std::cout << "Hello World!" << std::endl;
+  std::cout << greeting << std::endl;
 }